@@ -209,7 +209,7 @@ void BigBuf_print_status(void) {
 }
 
 // return the maximum trace length (i.e. the unallocated size of BigBuf)
-uint16_t BigBuf_max_traceLen(void) {
+uint32_t BigBuf_max_traceLen(void) {
     return s_bigbuf_hi & BIGBUF_ALIGN_MASK;
 }
 
@@ -632,6 +632,8 @@ static void SendCapabilities(void) {
     capabilities.is_rdv4 = false;
 #endif
 
+    capabilities.bulk_download = true;
+
 #ifdef WITH_FLASH
     capabilities.compiled_with_flash = true;
     capabilities.hw_available_flash = FlashInit();
@@ -2806,6 +2808,80 @@ static void PacketReceived(PacketCommandNG *packet) {
             LED_B_OFF();
             break;
         }
+        case CMD_DOWNLOAD_BULK: {
+            if (packet->length < sizeof(download_bulk_t)) {
+                reply_ng(CMD_DOWNLOAD_BULK, PM3_EINVARG, NULL, 0);
+                break;
+            }
+            const download_bulk_t *payload = (download_bulk_t *)packet->data.asBytes;
+
+            LED_B_ON();
+            uint8_t *mem = NULL;
+            uint32_t size = 0;
+            bool free_bigbuf = false;
+            int status = PM3_EMALLOC;
+
+            switch (payload->source) {
+                case DOWNLOAD_BULK_BIGBUF: {
+                    mem = BigBuf_get_addr();
+                    size = BigBuf_get_size();
+                    break;
+                }
+                case DOWNLOAD_BULK_EML: {
+                    mem = BigBuf_get_EM_addr();
+                    size = CARD_MEMORY_SIZE;
+                    break;
+                }
+#ifdef WITH_FLASH
+                case DOWNLOAD_BULK_SPIFFS: {
+                    // read the whole file to BigBuf first, like CMD_SPIFFS_DOWNLOAD
+                    char filename[SPIFFS_OBJ_NAME_LEN] = {0};
+                    memcpy(filename, payload->filename, SPIFFS_OBJ_NAME_LEN - 1);
+                    if (exists_in_spiffs(filename) == false) {
+                        status = PM3_EFILE;
+                        break;
+                    }
+                    if (payload->len > UINT32_MAX - payload->start) {
+                        status = PM3_EOVFLOW;
+                        break;
+                    }
+                    size = MIN(payload->start + payload->len, size_in_spiffs(filename));
+                    mem = BigBuf_calloc(size);
+                    if (mem == NULL) {
+                        break;
+                    }
+                    free_bigbuf = true;
+                    rdv40_spiffs_read_as_filetype(filename, mem, size, RDV40_SPIFFS_SAFETY_SAFE);
+                    break;
+                }
+#else
+                case DOWNLOAD_BULK_SPIFFS: {
+                    status = PM3_ENOTIMPL;
+                    break;
+                }
+#endif
+                default:
+                    break;
+            }
+
+            if (mem == NULL || payload->start > size) {
+                reply_ng(CMD_DOWNLOAD_BULK, (mem == NULL) ? status : PM3_EOVFLOW, NULL, 0);
+                if (free_bigbuf) {
+                    BigBuf_free();
+                }
+                LED_B_OFF();
+                break;
+            }
+
+            uint32_t len = MIN(payload->len, size - payload->start);
+            reply_bulk(mem + payload->start, len, BigBuf_get_traceLen(), payload->window);
+
+            if (free_bigbuf) {
+                BigBuf_free();
+            }
+            LED_B_OFF();
+            break;
+        }
         case CMD_READ_MEM: {
             if (packet->length != sizeof(uint32_t))
                 break;
@@ -19,6 +19,8 @@
 #include "crc16.h"
 #include "string.h"
 #include "BigBuf.h"
+#include "proxmark3_arm.h"
+#include "ticks.h"
 
 // Flags to tell where to add CRC on sent replies
 bool g_reply_with_crc_on_usb = false;
@@ -264,3 +266,121 @@ int receive_ng(PacketCommandNG *rx) {
 #endif
     return PM3_ENODATA;
 }
+
+// Send bytes as they are, without any framing.
+// Only meaningful when the client expects raw data, see reply_bulk()
+int reply_raw(const uint8_t *data, size_t len) {
+
+    if (data == NULL || len == 0) {
+        return PM3_EINVARG;
+    }
+
+#ifdef WITH_FPC_USART_HOST
+    int resultfpc = PM3_EUNDEF;
+#endif
+    int resultusb = PM3_EUNDEF;
+
+    if (g_reply_via_usb) {
+        resultusb = usb_write(data, len);
+    }
+    if (g_reply_via_fpc) {
+#ifdef WITH_FPC_USART_HOST
+        resultfpc = usart_writebuffer_sync(data, len);
+#else
+        return PM3_EDEVNOTSUPP;
+#endif
+    }
+    if (g_reply_via_usb && (resultusb != PM3_SUCCESS)) {
+        return resultusb;
+    }
+
+#ifdef WITH_FPC_USART_HOST
+    if (g_reply_via_fpc && (resultfpc != PM3_SUCCESS)) {
+        return resultfpc;
+    }
+#endif
+    return PM3_SUCCESS;
+}
+
+// Bulk download, see CMD_DOWNLOAD_BULK in pm3_cmd.h
+// Announces the transfer, then streams one window per CMD_DOWNLOAD_BULK_ACK until the client
+// asks for an offset past the end, aborts, or stops acknowledging.
+int reply_bulk(const uint8_t *mem, uint32_t len, uint32_t tracelen, uint32_t window) {
+
+    if (window == 0 || window > DOWNLOAD_BULK_WINDOW_MAX) {
+        window = DOWNLOAD_BULK_WINDOW_DEFAULT;
+    }
+
+    download_bulk_hdr_t hdr = {
+        .len = len,
+        .tracelen = tracelen,
+        .window = window,
+    };
+    int res = reply_ng(CMD_DOWNLOAD_BULK, PM3_SUCCESS, (uint8_t *)&hdr, sizeof(hdr));
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    // same rule as for NG replies
+    bool with_crc = (g_reply_via_fpc && g_reply_with_crc_on_fpc) || (g_reply_via_usb && g_reply_with_crc_on_usb);
+
+    uint32_t ticks = GetTickCount();
+    for (;;) {
+        WDT_HIT();
+
+        if (BUTTON_PRESS()) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        PacketCommandNG rx;
+        if (receive_ng(&rx) != PM3_SUCCESS) {
+            if (GetTickCountDelta(ticks) > DOWNLOAD_BULK_ACK_TIMEOUT_MS) {
+                res = PM3_ETIMEOUT;
+                break;
+            }
+            continue;
+        }
+
+        if (rx.cmd == CMD_BREAK_LOOP) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        if (rx.cmd != CMD_DOWNLOAD_BULK_ACK || rx.length < sizeof(download_bulk_ack_t)) {
+            continue;
+        }
+
+        const download_bulk_ack_t *ack = (download_bulk_ack_t *)rx.data.asBytes;
+        if (ack->abort) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        // client has everything
+        if (ack->offset >= len) {
+            res = PM3_SUCCESS;
+            break;
+        }
+
+        uint32_t n = MIN(window, len - ack->offset);
+        uint16_t crc = RESPONSENG_POSTAMBLE_MAGIC;
+        if (with_crc) {
+            uint8_t first, second;
+            compute_crc(CRC_14443_A, mem + ack->offset, n, &first, &second);
+            crc = (first << 8) | second;
+        }
+
+        res = reply_raw(mem + ack->offset, n);
+        if (res == PM3_SUCCESS) {
+            res = reply_raw((uint8_t *)&crc, sizeof(crc));
+        }
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+        ticks = GetTickCount();
+    }
+
+    reply_ng(CMD_DOWNLOAD_BULK_ACK, res, NULL, 0);
+    return res;
+}
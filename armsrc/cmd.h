@@ -32,6 +32,8 @@ int reply_ng(uint16_t cmd, int8_t status, const uint8_t *data, size_t len);
 int reply_mix(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len);
 int reply_reason(uint16_t cmd, int8_t status, int8_t reason, const uint8_t *data, size_t len);
 int receive_ng(PacketCommandNG *rx);
+int reply_raw(const uint8_t *data, size_t len);
+int reply_bulk(const uint8_t *mem, uint32_t len, uint32_t tracelen, uint32_t window);
 
 #endif // _PROXMARK_CMD_H_
 
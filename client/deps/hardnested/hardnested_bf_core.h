@@ -89,6 +89,10 @@ typedef enum {
 } SIMDExecInstr;
 void SetSIMDInstr(SIMDExecInstr instr);
 SIMDExecInstr GetSIMDInstrAuto(void);
+// preferred instruction set when SIMD_AUTO is in effect, e.g. from a benchmark
+void SetSIMDInstrTuned(SIMDExecInstr instr);
+bool SIMDInstrIsAuto(void);
+bool SIMDInstrSupported(SIMDExecInstr instr);
 
 uint64_t crack_states_bitsliced(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found, uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce, uint8_t *bf_test_nonce_2nd_byte, noncelist_t *nonces);
 void bitslice_test_nonces(uint32_t nonces_to_bruteforce, uint32_t *bf_test_nonce, uint8_t *bf_test_nonce_par);
@@ -19,6 +19,7 @@
 #include "hardnested_bitarray_core.h"
 #include "hardnested_bf_core.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -158,6 +159,87 @@ typedef uint32_t count_bitarray_AND4_t(uint32_t *, uint32_t *, uint32_t *, uint3
 count_bitarray_AND4_t count_bitarray_AND4_AVX512, count_bitarray_AND4_AVX2, count_bitarray_AND4_AVX, count_bitarray_AND4_SSE2, count_bitarray_AND4_MMX, count_bitarray_AND4_NOSIMD, count_bitarray_AND4_NEON, count_bitarray_AND4_dispatch;
 
 
+#if defined (__AVX512F__) && (defined (__clang__) || __GNUC__ >= 8)
+// CPUs with AVX512 VPOPCNTDQ count 8 words per instruction instead of running scalar popcnt
+// on every 64 bits. Not all AVX512 CPUs have it (e.g. Skylake-X doesn't), therefore it is
+// checked at runtime instead of being another SIMD variant.
+#include <immintrin.h>
+#define HAS_VPOPCNT_KERNELS
+#define VPOPCNT_TARGET __attribute__((target("avx512f,avx512vpopcntdq")))
+#define VPOPCNT_WORDS (sizeof(__m512i) / sizeof(uint32_t))
+
+// _mm512_reduce_add_epi64 trips -Wuninitialized inside the GCC 12 headers
+VPOPCNT_TARGET static inline uint32_t reduce_add_vpopcnt(__m512i count) {
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, count);
+    uint64_t sum = 0;
+    for (int i = 0; i < 8; i++) {
+        sum += lanes[i];
+    }
+    return sum;
+}
+
+static int vpopcnt_supported = -1;
+
+static bool has_vpopcnt(void) {
+    int supported = __atomic_load_n(&vpopcnt_supported, __ATOMIC_RELAXED);
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx512vpopcntdq") ? 1 : 0;
+        __atomic_store_n(&vpopcnt_supported, supported, __ATOMIC_RELAXED);
+    }
+    return supported;
+}
+
+VPOPCNT_TARGET static uint32_t count_states_vpopcnt(uint32_t *A) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += VPOPCNT_WORDS) {
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(_mm512_loadu_si512(A + i)));
+    }
+    return reduce_add_vpopcnt(count);
+}
+
+VPOPCNT_TARGET static uint32_t count_bitarray_AND_vpopcnt(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += VPOPCNT_WORDS) {
+        __m512i a = _mm512_and_si512(_mm512_loadu_si512(A + i), _mm512_loadu_si512(B + i));
+        _mm512_storeu_si512(A + i, a);
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(a));
+    }
+    return reduce_add_vpopcnt(count);
+}
+
+VPOPCNT_TARGET static uint32_t count_bitarray_AND2_vpopcnt(uint32_t *restrict A, uint32_t *restrict B) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += VPOPCNT_WORDS) {
+        __m512i a = _mm512_and_si512(_mm512_loadu_si512(A + i), _mm512_loadu_si512(B + i));
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(a));
+    }
+    return reduce_add_vpopcnt(count);
+}
+
+VPOPCNT_TARGET static uint32_t count_bitarray_AND3_vpopcnt(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += VPOPCNT_WORDS) {
+        // 0x80: A & B & C in one vpternlogd
+        __m512i a = _mm512_ternarylogic_epi64(_mm512_loadu_si512(A + i), _mm512_loadu_si512(B + i), _mm512_loadu_si512(C + i), 0x80);
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(a));
+    }
+    return reduce_add_vpopcnt(count);
+}
+
+VPOPCNT_TARGET static uint32_t count_bitarray_AND4_vpopcnt(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+    __m512i count = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < (1 << 19); i += VPOPCNT_WORDS) {
+        __m512i a = _mm512_ternarylogic_epi64(_mm512_loadu_si512(A + i), _mm512_loadu_si512(B + i), _mm512_loadu_si512(C + i), 0x80);
+        a = _mm512_and_si512(a, _mm512_loadu_si512(D + i));
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(a));
+    }
+    return reduce_add_vpopcnt(count);
+}
+#endif
+
+
 inline uint32_t *MALLOC_BITARRAY(uint32_t x) {
 #if defined (_WIN32)
     return __builtin_assume_aligned(_aligned_malloc((x), __BIGGEST_ALIGNMENT__), __BIGGEST_ALIGNMENT__);
@@ -189,6 +271,11 @@ inline uint32_t BITCOUNT(uint32_t a) {
 
 
 inline uint32_t COUNT_STATES(uint32_t *A) {
+#if defined (HAS_VPOPCNT_KERNELS)
+    if (has_vpopcnt()) {
+        return count_states_vpopcnt(A);
+    }
+#endif
     uint32_t count = 0;
     for (uint32_t i = 0; i < (1 << 19); i++) {
         count += BITCOUNT(A[i]);
@@ -219,6 +306,11 @@ inline void BITARRAY_LOW20_AND(uint32_t *restrict A, uint32_t *restrict B) {
 
 
 inline uint32_t COUNT_BITARRAY_AND(uint32_t *restrict A, uint32_t *restrict B) {
+#if defined (HAS_VPOPCNT_KERNELS)
+    if (has_vpopcnt()) {
+        return count_bitarray_AND_vpopcnt(A, B);
+    }
+#endif
     A = __builtin_assume_aligned(A, __BIGGEST_ALIGNMENT__);
     B = __builtin_assume_aligned(B, __BIGGEST_ALIGNMENT__);
     uint32_t count = 0;
@@ -266,6 +358,11 @@ inline void BITARRAY_OR(uint32_t *restrict A, uint32_t *restrict B) {
 
 
 inline uint32_t COUNT_BITARRAY_AND2(uint32_t *restrict A, uint32_t *restrict B) {
+#if defined (HAS_VPOPCNT_KERNELS)
+    if (has_vpopcnt()) {
+        return count_bitarray_AND2_vpopcnt(A, B);
+    }
+#endif
     A = __builtin_assume_aligned(A, __BIGGEST_ALIGNMENT__);
     B = __builtin_assume_aligned(B, __BIGGEST_ALIGNMENT__);
     uint32_t count = 0;
@@ -277,6 +374,11 @@ inline uint32_t COUNT_BITARRAY_AND2(uint32_t *restrict A, uint32_t *restrict B)
 
 
 inline uint32_t COUNT_BITARRAY_AND3(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C) {
+#if defined (HAS_VPOPCNT_KERNELS)
+    if (has_vpopcnt()) {
+        return count_bitarray_AND3_vpopcnt(A, B, C);
+    }
+#endif
     A = __builtin_assume_aligned(A, __BIGGEST_ALIGNMENT__);
     B = __builtin_assume_aligned(B, __BIGGEST_ALIGNMENT__);
     C = __builtin_assume_aligned(C, __BIGGEST_ALIGNMENT__);
@@ -289,6 +391,11 @@ inline uint32_t COUNT_BITARRAY_AND3(uint32_t *restrict A, uint32_t *restrict B,
 
 
 inline uint32_t COUNT_BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B, uint32_t *restrict C, uint32_t *restrict D) {
+#if defined (HAS_VPOPCNT_KERNELS)
+    if (has_vpopcnt()) {
+        return count_bitarray_AND4_vpopcnt(A, B, C, D);
+    }
+#endif
     A = __builtin_assume_aligned(A, __BIGGEST_ALIGNMENT__);
     B = __builtin_assume_aligned(B, __BIGGEST_ALIGNMENT__);
     C = __builtin_assume_aligned(C, __BIGGEST_ALIGNMENT__);
@@ -482,6 +482,66 @@ static bool read_bench_data(statelist_t *test_candidates) {
 }
 
 
+static float run_benchmark(statelist_t *test_candidates, int num_brute_force_threads) {
+    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
+        test_candidates[i].len[ODD_STATE] = TEST_BENCH_SIZE;
+        test_candidates[i].len[EVEN_STATE] = TEST_BENCH_SIZE;
+        test_candidates[i].states[ODD_STATE][TEST_BENCH_SIZE] = -1;
+        test_candidates[i].states[EVEN_STATE][TEST_BENCH_SIZE] = -1;
+    }
+
+    uint64_t maximum_states = TEST_BENCH_SIZE * TEST_BENCH_SIZE * (uint64_t)num_brute_force_threads;
+
+    float bf_rate;
+    uint64_t found_key = 0;
+    brute_force_bs(&bf_rate, test_candidates, 0, 0, maximum_states, NULL, 0, &found_key);
+    return bf_rate;
+}
+
+// The widest SIMD core isn't always the fastest one, e.g. some CPUs lower their clock
+// when running AVX512 code. Unless the user asked for a specific core, try all of them
+// once per session and keep the fastest one.
+static bool simd_tuned = false;
+
+static float tune_SIMD_instruction_set(statelist_t *test_candidates, int num_brute_force_threads) {
+    static const struct {
+        SIMDExecInstr instr;
+        const char *name;
+    } candidates[] = {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        { SIMD_AVX512, "AVX512F" },
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+        { SIMD_AVX2, "AVX2" },
+        { SIMD_AVX, "AVX" },
+        { SIMD_SSE2, "SSE2" },
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        { SIMD_NEON, "NEON" },
+#endif
+        { SIMD_NONE, NULL },
+    };
+
+    SIMDExecInstr best_instr = SIMD_AUTO;
+    float best_rate = 0;
+    for (int i = 0; candidates[i].name != NULL; i++) {
+        if (SIMDInstrSupported(candidates[i].instr) == false) {
+            continue;
+        }
+        SetSIMDInstrTuned(candidates[i].instr);
+        float bf_rate = run_benchmark(test_candidates, num_brute_force_threads);
+        PrintAndLogEx(DEBUG, "Brute force benchmark %-7s %6.1f million keys/s", candidates[i].name, bf_rate / 1000000.0);
+        if (bf_rate > best_rate) {
+            best_rate = bf_rate;
+            best_instr = candidates[i].instr;
+        }
+    }
+
+    SetSIMDInstrTuned(best_instr);
+    simd_tuned = true;
+    return best_rate;
+}
+
 float brute_force_benchmark(void) {
     const int num_brute_force_threads = NUM_BRUTE_FORCE_THREADS;
     statelist_t test_candidates[num_brute_force_threads];
@@ -502,18 +562,12 @@ float brute_force_benchmark(void) {
         return DEFAULT_BRUTE_FORCE_RATE;
     }
 
-    for (uint32_t i = 0; i < num_brute_force_threads; i++) {
-        test_candidates[i].len[ODD_STATE] = TEST_BENCH_SIZE;
-        test_candidates[i].len[EVEN_STATE] = TEST_BENCH_SIZE;
-        test_candidates[i].states[ODD_STATE][TEST_BENCH_SIZE] = -1;
-        test_candidates[i].states[EVEN_STATE][TEST_BENCH_SIZE] = -1;
-    }
-
-    uint64_t maximum_states = TEST_BENCH_SIZE * TEST_BENCH_SIZE * (uint64_t)num_brute_force_threads;
-
     float bf_rate;
-    uint64_t found_key = 0;
-    brute_force_bs(&bf_rate, test_candidates, 0, 0, maximum_states, NULL, 0, &found_key);
+    if (SIMDInstrIsAuto() && simd_tuned == false) {
+        bf_rate = tune_SIMD_instruction_set(test_candidates, num_brute_force_threads);
+    } else {
+        bf_rate = run_benchmark(test_candidates, num_brute_force_threads);
+    }
 
     free(test_candidates[0].states[ODD_STATE]);
     free(test_candidates[0].states[EVEN_STATE]);
@@ -22,7 +22,8 @@
  * along with CRC RevEng.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-/* 2018-07-26: NOFORCE renamed ALWPCK
+/* 2026-10-16: uprog() reports percentage done and time left
+ * 2018-07-26: NOFORCE renamed ALWPCK
  * 2017-02-18: -G ignored if R_HAVEP
  * 2017-02-05: added -G
  * 2016-06-27: -P sets width like -k
@@ -542,22 +543,16 @@ uerror(const char *msg) {
 }
 
 void
-uprog(const poly_t gpoly, int flags, unsigned long seq) {
+uprog(unsigned long width, int flags, double done, unsigned long eta) {
     /* Callback function to report search progress */
-    char *string;
-
-    /* Suppress first report in CLI */
-    if (!seq)
-        return;
-    string = ptostr(gpoly, P_RTJUST, 4);
-    fprintf(stderr, "%s: searching: width=%lu  poly=0x%s  refin=%s  refout=%s\n",
+    fprintf(stderr, "%s: searching: width=%lu  refin=%s  refout=%s  %5.1f%%  eta %lu:%02lu:%02lu\n",
             myname,
-            plen(gpoly),
-            string,
+            width,
             ((flags & P_REFIN) ? "true" : "false"),
-            ((flags & P_REFOUT) ? "true" : "false")
+            ((flags & P_REFOUT) ? "true" : "false"),
+            done * 100.0,
+            eta / 3600UL, eta / 60UL % 60UL, eta % 60UL
            );
-    free(string);
 }
 
 static poly_t
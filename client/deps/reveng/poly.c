@@ -81,6 +81,7 @@
  */
 
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "reveng.h"
@@ -1012,6 +1013,35 @@ piter(poly_t *poly) {
     return (*bptr != BMP_C(0));
 }
 
+int
+pstep(poly_t *poly, unsigned long count) {
+    /* Replace poly with the polynomial count calls of piter()
+     * would give.  count must fit in a bmp_t.
+     * Returns zero if the sequence wrapped past all zeroes, a
+     * nonzero value otherwise.
+     * Does not clean poly.
+     */
+    bmp_t *bptr, add, high, carry;
+    int ofs;
+
+    if (!count) return (1);
+    if (!poly->length) return (0);
+
+    bptr = poly->bitmap + IDX(poly->length - 1UL);
+    ofs = OFS(poly->length - 1UL);
+    add = (bmp_t) count << ofs;
+    high = ofs ? (bmp_t) count >> (BMP_BIT - ofs) : BMP_C(0);
+    *bptr += add;
+    carry = *bptr < add;
+    while (bptr != poly->bitmap && (high || carry)) {
+        add = high + carry;
+        high = BMP_C(0);
+        *--bptr += add;
+        carry = *bptr < add;
+    }
+    return (!high && !carry);
+}
+
 void
 palloc(poly_t *poly, unsigned long length) {
     /* Replaces poly with a CLEAN object of the specified length,
@@ -1128,6 +1158,21 @@ pident(const poly_t a, const poly_t b) {
     return (a.length == b.length && a.bitmap == b.bitmap);
 }
 
+double
+pfrac(const poly_t poly) {
+    /* Return poly as a binary fraction 0.b0b1b2..., i.e. its
+     * position among all polys of the same length, in [0, 1).
+     * Only the first 53 terms are significant.
+     */
+    unsigned long iter, end = poly.length < 53UL ? poly.length : 53UL;
+    double frac = 0.0;
+
+    for (iter = 0UL; iter < end; ++iter)
+        if (poly.bitmap[IDX(iter)] >> OFS(iter) & BMP_C(1))
+            frac += ldexp(1.0, -(int) iter - 1);
+    return (frac);
+}
+
 /* Private functions */
 
 static bmp_t
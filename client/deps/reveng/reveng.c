@@ -22,7 +22,8 @@
  * along with CRC RevEng.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-/* 2013-09-16: calini(), calout() work on shortest argument
+/* 2026-10-16: polynomial search split across threads, progress with ETA
+ * 2013-09-16: calini(), calout() work on shortest argument
  * 2013-06-11: added sequence number to uprog() calls
  * 2013-02-08: added polynomial range search
  * 2013-01-18: refactored model checking to pshres(); renamed chkres()
@@ -49,10 +50,16 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "util.h"   // num_CPUs
 
 #define FILE void
 #include "reveng.h"
 
+static void search_polys(int *resc, model_t **result, const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys, const poly_t *pworks);
 static poly_t *modpol(const poly_t init, int rflags, int args, const poly_t *argpolys);
 static void engini(int *resc, model_t **result, const poly_t divisor, int flags, int args, const poly_t *argpolys);
 static void calout(int *resc, model_t **result, const poly_t divisor, const poly_t init, int flags, int args, const poly_t *argpolys);
@@ -64,10 +71,9 @@ static const poly_t pzero = PZERO;
 model_t *
 reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys) {
     /* Complete the parameters of a model by calculation or brute search. */
-    poly_t *pworks, *wptr, rem, gpoly;
+    poly_t *pworks, *wptr;
     model_t *result = NULL, *rptr;
     int resc = 0;
-    unsigned long spin = 0, seq = 0;
 
     if (~rflags & R_HAVEP) {
         /* The poly is not known.
@@ -78,52 +84,9 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
             free(pworks);
             goto requit;
         }
-        /* Initialise the guessed poly to the starting value. */
-        gpoly = pclone(guess->spoly);
-        /* Clear the least significant term, to be set in the
-         * loop. qpoly does not need fixing as it is only
-         * compared with odd polys.
-         */
-        if (plen(gpoly))
-            pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
+        search_polys(&resc, &result, guess, qpoly, rflags, args, argpolys, pworks);
 
-        while (piter(&gpoly) && (~rflags & R_HAVEQ || pcmp(&gpoly, &qpoly) < 0)) {
-            /* For each possible poly of this size, try
-             * dividing all the differences in the list.
-             */
-            if (!(spin++ & R_SPMASK)) {
-                uprog(gpoly, guess->flags, seq++);
-            }
-            for (wptr = pworks; plen(*wptr); ++wptr) {
-                /* straight divide message by poly, don't multiply by x^n */
-                rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
-                if (ptst(rem)) {
-                    pfree(&rem);
-                    break;
-                } else
-                    pfree(&rem);
-            }
-            /* If gpoly divides all the differences, it is a
-             * candidate.  Search for an Init value for this
-             * poly or if Init is known, log the result.
-             */
-            if (!plen(*wptr)) {
-                /* gpoly is a candidate poly */
-                if (rflags & R_HAVEI && rflags & R_HAVEX)
-                    chkres(&resc, &result, gpoly, guess->init, guess->flags, guess->xorout, args, argpolys);
-                else if (rflags & R_HAVEI)
-                    calout(&resc, &result, gpoly, guess->init, guess->flags, args, argpolys);
-                else if (rflags & R_HAVEX)
-                    calini(&resc, &result, gpoly, guess->flags, guess->xorout, args, argpolys);
-                else
-                    engini(&resc, &result, gpoly, guess->flags, args, argpolys);
-            }
-            if (!piter(&gpoly))
-                break;
-        }
-        /* Finished with gpoly and the differences list, free them.
-         */
-        pfree(&gpoly);
+        /* Finished with the differences list, free it. */
         for (wptr = pworks; plen(*wptr); ++wptr)
             pfree(wptr);
         free(pworks);
@@ -157,6 +120,213 @@ requit:
     return (result);
 }
 
+typedef struct {
+    const model_t *guess;
+    const poly_t *qpoly;
+    int rflags;
+    int args;
+    const poly_t *argpolys;
+    const poly_t *pworks;
+    unsigned long nthreads;
+    uint64_t tested;        /* polys tested so far, all threads (atomic) */
+    double total;           /* polys in the search range */
+    time_t started;
+    time_t report;
+} search_t;
+
+typedef struct {
+    search_t *s;
+    unsigned long id;
+    int resc;
+    model_t *result;
+    pthread_t thread;
+} searcher_t;
+
+static void
+search_progress(search_t *s, unsigned long width) {
+    /* Report progress and time remaining.  Called by thread 0 only. */
+    time_t now = time(NULL);
+    uint64_t tested;
+    double done;
+
+    if (now < s->report)
+        return;
+    s->report = now + R_PROGRESS;
+    tested = __atomic_load_n(&s->tested, __ATOMIC_RELAXED);
+    done = (double) tested / s->total;
+    if (done <= 0.0)
+        return;
+    if (done > 1.0)
+        done = 1.0;
+    uprog(width, s->guess->flags, done, (unsigned long)((double)(now - s->started) * (1.0 - done) / done));
+}
+
+static void *
+search_worker(void *arg) {
+    /* Chunk k of R_CHUNK odd polys belongs to thread k % nthreads.
+     * Each thread tests its chunk, then steps over the other threads'
+     * chunks, so the split needs no shared state.
+     */
+    searcher_t *w = (searcher_t *) arg;
+    search_t *s = w->s;
+    const poly_t *wptr;
+    poly_t gpoly, rem;
+    unsigned long i, mine;
+    int alive;
+
+    /* Initialise the guessed poly to the starting value. */
+    gpoly = pclone(s->guess->spoly);
+    /* Clear the least significant term, to be set in the
+     * loop. qpoly does not need fixing as it is only
+     * compared with odd polys.
+     */
+    if (plen(gpoly))
+        pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
+
+    /* Each odd poly is two steps on from the last */
+    alive = pstep(&gpoly, (R_CHUNK << 1) * w->id);
+    while (alive) {
+        for (i = mine = 0UL; i < R_CHUNK; ++i) {
+            if (!piter(&gpoly) || (s->rflags & R_HAVEQ && pcmp(&gpoly, s->qpoly) >= 0)) {
+                alive = 0;
+                break;
+            }
+            ++mine;
+            /* For each possible poly of this size, try
+             * dividing all the differences in the list.
+             */
+            for (wptr = s->pworks; plen(*wptr); ++wptr) {
+                /* straight divide message by poly, don't multiply by x^n */
+                rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
+                if (ptst(rem)) {
+                    pfree(&rem);
+                    break;
+                } else
+                    pfree(&rem);
+            }
+            /* If gpoly divides all the differences, it is a
+             * candidate.  Search for an Init value for this
+             * poly or if Init is known, log the result.
+             */
+            if (!plen(*wptr)) {
+                /* gpoly is a candidate poly */
+                if (s->rflags & R_HAVEI && s->rflags & R_HAVEX)
+                    chkres(&w->resc, &w->result, gpoly, s->guess->init, s->guess->flags, s->guess->xorout, s->args, s->argpolys);
+                else if (s->rflags & R_HAVEI)
+                    calout(&w->resc, &w->result, gpoly, s->guess->init, s->guess->flags, s->args, s->argpolys);
+                else if (s->rflags & R_HAVEX)
+                    calini(&w->resc, &w->result, gpoly, s->guess->flags, s->guess->xorout, s->args, s->argpolys);
+                else
+                    engini(&w->resc, &w->result, gpoly, s->guess->flags, s->args, s->argpolys);
+            }
+            if (!piter(&gpoly)) {
+                alive = 0;
+                break;
+            }
+        }
+        __atomic_add_fetch(&s->tested, mine, __ATOMIC_RELAXED);
+        if (w->id == 0)
+            search_progress(s, plen(gpoly));
+        if (alive)
+            alive = pstep(&gpoly, (R_CHUNK << 1) * (s->nthreads - 1UL));
+    }
+    pfree(&gpoly);
+    return NULL;
+}
+
+static void
+search_polys(int *resc, model_t **result, const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys, const poly_t *pworks) {
+    /* Brute force search of the poly range for polys dividing all
+     * the differences in pworks, on all CPUs.  Init and XorOut are
+     * solved directly for each candidate, so only the poly range is
+     * split.  The results are returned in ascending poly order, as
+     * a single threaded search would give.
+     */
+    search_t s;
+    searcher_t *workers;
+    unsigned long i, k, best, width = plen(guess->spoly);
+    int *pos, found;
+    double first, last;
+
+    memset(&s, 0, sizeof(s));
+    s.guess = guess;
+    s.qpoly = &qpoly;
+    s.rflags = rflags;
+    s.args = args;
+    s.argpolys = argpolys;
+    s.pworks = pworks;
+    s.nthreads = num_CPUs();
+    if (s.nthreads < 1)
+        s.nthreads = 1;
+
+    /* Odd polys between the start and the end of the range */
+    first = pfrac(guess->spoly);
+    last = (rflags & R_HAVEQ) ? pfrac(qpoly) : 1.0;
+    s.total = width ? (last - first) * ldexp(1.0, (int) width - 1) : 0.0;
+    if (s.total < 1.0)
+        s.total = 1.0;
+
+    /* Only spread out searches worth it */
+    if (s.total < (double)(R_CHUNK * 2))
+        s.nthreads = 1;
+
+    workers = calloc(s.nthreads, sizeof(searcher_t));
+    if (!workers) {
+        uerror("cannot allocate memory for search threads");
+        return;
+    }
+
+    s.started = time(NULL);
+    s.report = s.started + R_PROGRESS;
+
+    for (i = 0UL; i < s.nthreads; ++i) {
+        workers[i].s = &s;
+        workers[i].id = i;
+        /* thread 0 is this one */
+        if (i && pthread_create(&workers[i].thread, NULL, search_worker, &workers[i]))
+            workers[i].s = NULL;
+    }
+    search_worker(&workers[0]);
+    for (i = 1UL; i < s.nthreads; ++i) {
+        if (workers[i].s)
+            pthread_join(workers[i].thread, NULL);
+        else {
+            /* could not start it, do its share here */
+            workers[i].s = &s;
+            search_worker(&workers[i]);
+        }
+    }
+
+    /* Each worker's results are in poly order; merge them keeping
+     * all the results for one poly together.
+     */
+    for (k = 0UL, found = 0; k < s.nthreads; ++k)
+        found += workers[k].resc;
+    pos = calloc(s.nthreads, sizeof(int));
+    if (found && pos && (*result = realloc(*result, (*resc + found) * sizeof(model_t)))) {
+        for (;;) {
+            best = s.nthreads;
+            for (k = 0UL; k < s.nthreads; ++k) {
+                if (pos[k] >= workers[k].resc)
+                    continue;
+                if (best == s.nthreads || pcmp(&workers[k].result[pos[k]].spoly, &workers[best].result[pos[best]].spoly) < 0)
+                    best = k;
+            }
+            if (best == s.nthreads)
+                break;
+            do {
+                (*result)[(*resc)++] = workers[best].result[pos[best]++];
+            } while (pos[best] < workers[best].resc && !pcmp(&workers[best].result[pos[best]].spoly, &workers[best].result[pos[best] - 1].spoly));
+        }
+    } else if (found)
+        uerror("cannot reallocate result array");
+
+    for (k = 0UL; k < s.nthreads; ++k)
+        free(workers[k].result);
+    free(pos);
+    free(workers);
+}
+
 static poly_t *
 modpol(const poly_t init, int rflags, int args, const poly_t *argpolys) {
     /* Produce, in ascending length order, a list of differences
@@ -169,11 +169,13 @@ void pinv(poly_t *poly);
 poly_t pmod(const poly_t dividend, const poly_t divisor);
 poly_t pcrc(const poly_t message, const poly_t divisor, const poly_t init, const poly_t xorout, int flags);
 int piter(poly_t *poly);
+int pstep(poly_t *poly, unsigned long count);
 void palloc(poly_t *poly, unsigned long length);
 void pfree(poly_t *poly);
 void praloc(poly_t *poly, unsigned long length);
 int pmpar(const poly_t poly, const poly_t mask);
 int pident(const poly_t a, const poly_t b);
+double pfrac(const poly_t poly);
 
 /* model.c */
 
@@ -216,7 +218,8 @@ void mmatch(model_t *model, int flags);
 #define R_HAVEX     16
 #define R_HAVEQ     32
 
-#define R_SPMASK 0x7FFFFFFUL
+#define R_CHUNK     4096UL  /* polys per work unit in the brute force search */
+#define R_PROGRESS  10      /* seconds between progress reports */
 
 model_t *reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys);
 
@@ -231,6 +234,6 @@ model_t *reveng(const model_t *guess, const poly_t qpoly, int rflags, int args,
 int reveng_main(int argc, char *argv[]);
 void ufound(const model_t *model);
 void uerror(const char *msg);
-void uprog(const poly_t gpoly, int flags, unsigned long seq);
+void uprog(unsigned long width, int flags, double done, unsigned long eta);
 
 #endif /* REVENG_H */
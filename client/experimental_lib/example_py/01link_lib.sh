@@ -1,3 +1,4 @@
 #!/bin/bash
 
 ln -sf ../build/libpm3rrg_rdv4.so _pm3.so
+ln -sf ../build/libpm3rrg_rdv4.so pm3bin.so
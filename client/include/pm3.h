@@ -17,13 +17,44 @@
 #define LIBPM3_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct pm3_device pm3;
 
+#define PM3_PACKET_DATA_SIZE 512
+
+// One binary command / response exchange, see pm3_exchange_batch()
+typedef struct pm3_packet {
+    // command
+    uint16_t cmd;
+    bool ng;                            // true: NG frame, false: MIX frame carrying arg[]
+    uint64_t arg[3];                    // MIX frame arguments
+    uint16_t length;
+    uint8_t data[PM3_PACKET_DATA_SIZE];
+    uint16_t resp_expected;             // response command to wait for, 0 for the same as cmd
+    uint32_t timeout;                   // ms to wait for the response, 0 for 2000 ms
+    // response
+    int status;                         // 0 when a response was received, else a negative PM3 error code
+    uint16_t resp_cmd;
+    int16_t resp_status;
+    int8_t resp_reason;
+    bool resp_ng;
+    uint64_t resp_arg[3];               // MIX / OLD response arguments
+    uint16_t resp_length;
+    uint8_t resp_data[PM3_PACKET_DATA_SIZE];
+} pm3_packet_t;
+
+// called for every packet as soon as its response is received, in order.
+// Anything but PM3_SUCCESS (0) stops the batch and is returned by pm3_exchange_batch()
+typedef int (*pm3_packet_cb)(pm3 *dev, size_t index, pm3_packet_t *packet, void *ctx);
+
 pm3 *pm3_open(const char *port);
 int pm3_console(pm3 *dev, const char *cmd, bool capture, bool quiet);
 const char *pm3_grabbed_output_get(pm3 *dev);
 const char *pm3_name_get(pm3 *dev);
 void pm3_close(pm3 *dev);
 pm3 *pm3_get_current_dev(void);
+int pm3_exchange(pm3 *dev, pm3_packet_t *packet);
+int pm3_exchange_batch(pm3 *dev, pm3_packet_t *packets, size_t count, size_t window, pm3_packet_cb cb, void *ctx);
 #endif // LIBPM3_H
@@ -207,4 +207,41 @@ function Command:sendNG( ignore_response, timeout )
     }
 end
 
+--- Binary variants of sendMIX / sendNG.
+-- self.data is sent as raw bytes (lua string or a core pm3.buffer),
+-- no hex conversion either way.
+-- @return response table with raw Data, nil if successful
+--         nil, errormessage if unsuccessful
+function Command:sendMIXBin( ignore_response, timeout, use_cmd_ack)
+    if timeout == nil then timeout = TIMEOUT end
+    local cmd = self.cmd
+    local err, msg = core.SendCommandMIXBin(cmd, self.arg1, self.arg2, self.arg3, self.data)
+    if err == nil then return nil, msg end
+    if ignore_response then return true, nil end
+
+    local ack = _commands.CMD_ACK
+    if use_cmd_ack then
+        ack = cmd
+    end
+
+    local response, msg = core.WaitForResponseBin(ack, timeout)
+    if response == nil then
+        return nil, 'Error, waiting for response timed out :: '..msg
+    end
+    return response, nil
+end
+function Command:sendNGBin( ignore_response, timeout )
+    if timeout == nil then timeout = TIMEOUT end
+    local cmd = self.cmd
+    local err, msg = core.SendCommandNGBin(cmd, self.data)
+    if err == nil then return nil, msg end
+    if ignore_response then return true, nil end
+
+    local response, msg = core.WaitForResponseBin(cmd, timeout)
+    if response == nil then
+        return nil, 'Error, waiting for response timed out :: '..msg
+    end
+    return response, nil
+end
+
 return _commands
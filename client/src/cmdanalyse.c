@@ -37,6 +37,7 @@
 #include "generator.h"    // generate nuid
 #include "iso14b.h"       // defines for ETU conversions
 #include "util.h"         // regex utility
+#include "util_posix.h"   // msclock
 
 static int CmdHelp(const char *Cmd);
 
@@ -271,23 +272,157 @@ static int CmdAnalyseLRC(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// crc16 the way it was done before the per polynomial tables: one table,
+// regenerated whenever the crc type changes, and a byte at a time lookup
+static uint16_t crc_bench_old(CrcType_t ct, const uint8_t *d, size_t n, CrcType_t *current) {
+    if (ct != *current) {
+        switch (ct) {
+            case CRC_14443_A:
+            case CRC_15693:
+            case CRC_ICLASS:
+                generate_table(CRC16_POLY_CCITT, true);
+                break;
+            case CRC_NONE:
+            case CRC_11784:
+            case CRC_14443_B:
+            case CRC_FELICA:
+            case CRC_LEGIC:
+            case CRC_LEGIC_16:
+            case CRC_CCITT:
+            case CRC_KERMIT:
+            case CRC_XMODEM:
+            case CRC_CRYPTORF:
+            case CRC_PHILIPS:
+                generate_table(CRC16_POLY_CCITT, false);
+                break;
+        }
+        *current = ct;
+    }
+
+    switch (ct) {
+        case CRC_14443_A:
+            return crc16_fast(d, n, 0xC6C6, true, true);
+        case CRC_15693:
+            return ~crc16_fast(d, n, 0xFFFF, true, true);
+        case CRC_ICLASS:
+            return crc16_fast(d, n, 0x4807, true, true);
+        case CRC_NONE:
+        case CRC_11784:
+        case CRC_14443_B:
+        case CRC_FELICA:
+        case CRC_LEGIC:
+        case CRC_LEGIC_16:
+        case CRC_CCITT:
+        case CRC_KERMIT:
+        case CRC_XMODEM:
+        case CRC_CRYPTORF:
+        case CRC_PHILIPS:
+            return crc16_fast(d, n, 0x0000, false, false);
+    }
+    return 0;
+}
+
+static bool crc_bench_print(const char *name, uint64_t bytes, uint64_t old_ms, uint64_t new_ms, uint32_t old_sum, uint32_t new_sum) {
+    old_ms = MAX(old_ms, 1);
+    new_ms = MAX(new_ms, 1);
+    PrintAndLogEx(SUCCESS, " %-22s | %8.1f | %8.1f | %5.1fx | %s"
+                  , name
+                  , (double)bytes / (old_ms * 1000.0)
+                  , (double)bytes / (new_ms * 1000.0)
+                  , (double)old_ms / new_ms
+                  , (old_sum == new_sum) ? _GREEN_("ok") : _RED_("mismatch")
+                 );
+    return (old_sum == new_sum);
+}
+
+static int crc_bench(void) {
+
+    // trace list like: short frames, the crc type changes from one to the next
+    const CrcType_t mix[] = { CRC_14443_A, CRC_15693, CRC_FELICA, CRC_ICLASS };
+    const uint32_t frames = 2000000;
+
+    size_t buflen = 0x10000;
+    uint8_t *buf = calloc(buflen, sizeof(uint8_t));
+    if (buf == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+    for (size_t i = 0; i < buflen; i++) {
+        buf[i] = (i * 0x9E) ^ (i >> 7);
+    }
+
+    PrintAndLogEx(INFO, "crc16 throughput, old = regenerated table and bytewise, new = table per polynomial");
+    PrintAndLogEx(INFO, "------------------------+----------+----------+--------+---------");
+    PrintAndLogEx(INFO, " test                   | old MB/s | new MB/s | speed  | result");
+    PrintAndLogEx(INFO, "------------------------+----------+----------+--------+---------");
+
+    uint64_t bytes = 0;
+    uint32_t old_sum = 0, new_sum = 0;
+    CrcType_t current = CRC_NONE;
+    uint64_t t1 = msclock();
+    for (uint32_t i = 0; i < frames; i++) {
+        size_t len = 4 + (i % 15);
+        old_sum += crc_bench_old(mix[i % ARRAYLEN(mix)], buf + (i & 0xFFF), len, &current);
+        bytes += len;
+    }
+    uint64_t old_ms = msclock() - t1;
+
+    t1 = msclock();
+    for (uint32_t i = 0; i < frames; i++) {
+        new_sum += Crc16ex(mix[i % ARRAYLEN(mix)], buf + (i & 0xFFF), 4 + (i % 15));
+    }
+    bool all_ok = crc_bench_print("mixed frames 4-18b", bytes, old_ms, msclock() - t1, old_sum, new_sum);
+
+    // dumps and files, one crc type over a long buffer
+    const size_t sizes[] = { 64, 4096, 0x10000 };
+    for (size_t s = 0; s < ARRAYLEN(sizes); s++) {
+        uint32_t rounds = (64 * 1024 * 1024) / sizes[s];
+        old_sum = new_sum = 0;
+        current = CRC_NONE;
+
+        t1 = msclock();
+        for (uint32_t i = 0; i < rounds; i++) {
+            old_sum += crc_bench_old(CRC_15693, buf, sizes[s] - (i & 1), &current);
+        }
+        old_ms = msclock() - t1;
+
+        t1 = msclock();
+        for (uint32_t i = 0; i < rounds; i++) {
+            new_sum += Crc16ex(CRC_15693, buf, sizes[s] - (i & 1));
+        }
+
+        char name[24];
+        snprintf(name, sizeof(name), "CRC_15693 %zu bytes", sizes[s]);
+        all_ok &= crc_bench_print(name, (uint64_t)rounds * sizes[s], old_ms, msclock() - t1, old_sum, new_sum);
+    }
+    PrintAndLogEx(INFO, "------------------------+----------+----------+--------+---------");
+    PrintAndLogEx(all_ok ? SUCCESS : FAILED, "Tests ( %s )", all_ok ? _GREEN_("ok") : _RED_("fail"));
+
+    reset_table();
+    free(buf);
+    return (all_ok) ? PM3_SUCCESS : PM3_ESOFT;
+}
+
 static int CmdAnalyseCRC(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "analyse crc",
                   "A stub method to test different crc implementations inside the PM3 sourcecode.\n"
                   "Just because you figured out the poly, doesn't mean you get the desired output",
-                  "analyse crc -d 137AF00A0A0D"
+                  "analyse crc -d 137AF00A0A0D\n"
+                  "analyse crc --bench              -> crc16 throughput, old vs new implementation"
                  );
 
     void *argtable[] = {
         arg_param_begin,
-        arg_str1("d", "data", "<hex>", "bytes to calc crc"),
+        arg_str0("d", "data", "<hex>", "bytes to calc crc"),
+        arg_lit0(NULL, "bench", "benchmark crc16 implementations"),
         arg_param_end
     };
-    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
     int dlen = 0;
     uint8_t data[1024] = {0x00};
     int res = CLIParamHexToBuf(arg_get_str(ctx, 1), data, sizeof(data), &dlen);
+    bool bench = arg_get_lit(ctx, 2);
     CLIParserFree(ctx);
 
     if (res) {
@@ -295,6 +430,15 @@ static int CmdAnalyseCRC(const char *Cmd) {
         return PM3_EINVARG;
     }
 
+    if (bench) {
+        return crc_bench();
+    }
+
+    if (dlen == 0) {
+        PrintAndLogEx(FAILED, "Missing data, use `-d`");
+        return PM3_EINVARG;
+    }
+
     PrintAndLogEx(INFO, "\nTests with (%d) | %s", dlen, sprint_hex(data, (size_t)dlen));
 
     // 51  f5  7a  d6
@@ -29,6 +29,7 @@
 #include "graph.h"               // for graph data
 #include "comms.h"
 #include "lfdemod.h"             // for demod code
+#include "lfdsp.h"               // signal conditioning kernels
 #include "cmdlf.h"               // for lf_getconfig
 #include "loclass/cipherutils.h" // for decimating samples in getsamples
 #include "cmdlfem410x.h"         // askem410xdecode
@@ -43,13 +44,9 @@
 #include "atrs.h"                // ATR lookup
 #include "crypto/libpcrypto.h"   // Cryptography
 #include "qrcode/qrcode.h"       // QR Code lib
+#include "util_posix.h"          // msclock
 
 
-uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN] = { 0x00 };
-size_t g_DemodBufferLen = 0;
-int32_t g_DemodStartIdx = 0;
-int g_DemodClock = 0;
-
 static int CmdHelp(const char *Cmd);
 
 
@@ -1660,6 +1657,9 @@ void setClockGrid(uint32_t clk, int offset) {
     else
         PrintAndLogEx(DEBUG, "DEBUG: (setClockGrid) demodoffset %d, clk %d", offset, clk);
 
+    // the plot grid belongs to the main context only
+    if (lf_demod_ctx_is_main() == false) return;
+
     if (offset > clk) offset %= clk;
     if (offset < 0) offset += clk;
 
@@ -2168,9 +2168,8 @@ int CmdNorm(const char *Cmd) {
     int max = INT_MIN, min = INT_MAX;
 
     // Find local min, max
-    for (uint32_t i = 10; i < g_GraphTraceLen; ++i) {
-        if (g_GraphBuffer[i] > max) max = g_GraphBuffer[i];
-        if (g_GraphBuffer[i] < min) min = g_GraphBuffer[i];
+    if (g_GraphTraceLen > 10) {
+        lfdsp_minmax_s32(g_GraphBuffer + 10, g_GraphTraceLen - 10, &min, &max);
     }
 
     if ((g_GraphTraceLen > 10) && (max != min)) {
@@ -2361,23 +2360,7 @@ static int CmdZerocrossings(const char *Cmd) {
     // Zero-crossings aren't meaningful unless the signal is zero-mean.
     CmdHpf("");
 
-    int sign = 1, zc = 0, lastZc = 0;
-
-    for (uint32_t i = 0; i < g_GraphTraceLen; ++i) {
-        if (g_GraphBuffer[i] * sign >= 0) {
-            // No change in sign, reproduce the previous sample count.
-            zc++;
-            g_GraphBuffer[i] = lastZc;
-        } else {
-            // Change in sign, reset the sample count.
-            sign = -sign;
-            g_GraphBuffer[i] = lastZc;
-            if (sign > 0) {
-                lastZc = zc;
-                zc = 0;
-            }
-        }
-    }
+    lfdsp_zero_crossings_s32(g_GraphBuffer, g_GraphTraceLen);
 
     uint8_t *bits = calloc(g_GraphTraceLen, sizeof(uint8_t));
     if (bits == NULL) {
@@ -3388,11 +3371,7 @@ int centerThreshold(const int *in, int *out, size_t len, int8_t up, int8_t down)
         return PM3_EINVARG;
     }
 
-    for (size_t i = 0; i < len; ++i) {
-        if ((in[i] <= up) && (in[i] >= down)) {
-            out[i] = 0;
-        }
-    }
+    lfdsp_center_clip_s32(in, out, len, up, down);
 
     // clean out spikes.
     for (size_t i = 2; i < len - 2; ++i) {
@@ -4106,6 +4085,68 @@ static int CmdQRcode(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int CmdDataDictCompile(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "data dict compile",
+                  "Compile a dictionary file into a binary, deduplicated and indexed `.dicb` file.\n"
+                  "All key checking commands use the compiled file instead of parsing the text file\n"
+                  "as long as it was compiled from the current `.dic` file and has the same key length,\n"
+                  "an outdated compiled file is rebuilt when it is used.",
+                  "data dict compile -f mfc_default_keys                  -> MIFARE Classic keys\n"
+                  "data dict compile -f iclass_default_keys --keylen 8    -> iCLASS keys\n"
+                  "data dict compile -f t55xx_default_pwds --keylen 4     -> T55xx passwords\n"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1("f", "file", "<fn>", "Dictionary filename"),
+        arg_int0(NULL, "keylen", "<dec>", "Key length in bytes (def 6)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    int keylen = arg_get_int_def(ctx, 2, 6);
+    CLIParserFree(ctx);
+
+    if (keylen != 4 && keylen != 5 && keylen != 6 && keylen != 8 && keylen != 12 && keylen != 16 && keylen != 24) {
+        PrintAndLogEx(WARNING, "Key length must be 4, 5, 6, 8, 12, 16 or 24 bytes");
+        return PM3_EINVARG;
+    }
+
+    uint64_t t1 = msclock();
+    uint32_t keycnt = 0, dupcnt = 0;
+    int res = dictionary_compile(filename, keylen, &keycnt, &dupcnt, true);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    PrintAndLogEx(SUCCESS, "Unique keys... " _GREEN_("%u"), keycnt);
+    PrintAndLogEx(SUCCESS, "Duplicates.... " _YELLOW_("%u"), dupcnt);
+    PrintAndLogEx(SUCCESS, "Time.......... %" PRIu64 " ms", msclock() - t1);
+    return PM3_SUCCESS;
+}
+
+static int CmdDataDictHelp(const char *Cmd);
+
+static command_t DictCommandTable[] = {
+    {"help",             CmdDataDictHelp,         AlwaysAvailable,  "This help"},
+    {"compile",          CmdDataDictCompile,      AlwaysAvailable,  "Compile a dictionary file into binary format"},
+    {NULL, NULL, NULL, NULL}
+};
+
+static int CmdDataDictHelp(const char *Cmd) {
+    (void)Cmd; // Cmd is not used so far
+    CmdsHelp(DictCommandTable);
+    return PM3_SUCCESS;
+}
+
+static int CmdDataDict(const char *Cmd) {
+    return CmdsParse(DictCommandTable, Cmd);
+}
+
 static command_t CommandTable[] = {
     {"help",             CmdHelp,                 AlwaysAvailable,  "This help"},
     {"-----------",      CmdHelp,                 AlwaysAvailable, "------------------------- " _CYAN_("General") "-------------------------"},
@@ -4155,6 +4196,7 @@ static command_t CommandTable[] = {
     {"bitsamples",       CmdBitsamples,           IfPm3Present,     "Get raw samples as bitstring"},
     {"bmap",             CmdBinaryMap,            AlwaysAvailable,  "Convert hex value according a binary template"},
     {"crypto",           CmdCryptography,         AlwaysAvailable,  "Encrypt and decrypt data"},
+    {"dict",             CmdDataDict,             AlwaysAvailable,  "{ Dictionary file operations... }"},
     {"diff",             CmdDiff,                 AlwaysAvailable,  "Diff of input files"},
     {"hexsamples",       CmdHexsamples,           IfPm3Present,     "Dump big buffer as hex bytes"},
     {"samples",          CmdSamples,              IfPm3Present,     "Get raw samples for graph window ( GraphBuffer )"},
@@ -20,6 +20,7 @@
 #define CMDDATA_H__
 
 #include "common.h"
+#include "graph.h"          // lf_demod_ctx_t
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -92,11 +93,12 @@ int centerThreshold(const int *in, int *out, size_t len, int8_t up, int8_t down)
 int AskEdgeDetect(const int *in, int *out, int len, int threshold);
 
 #define MAX_DEMOD_BUF_LEN (1024*128)
-extern uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN];
-extern size_t g_DemodBufferLen;
 
-extern int g_DemodClock;
-extern int32_t g_DemodStartIdx;
+// part of the thread's LF demodulation context, see graph.h
+#define g_DemodBuffer   (g_lf_demod_ctx->demod)
+#define g_DemodBufferLen (g_lf_demod_ctx->demod_len)
+#define g_DemodClock    (g_lf_demod_ctx->demod_clock)
+#define g_DemodStartIdx (g_lf_demod_ctx->demod_start_idx)
 
 #ifdef __cplusplus
 }
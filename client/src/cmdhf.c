@@ -63,6 +63,10 @@
 #include "cmddata.h"
 #include "graph.h"
 #include "fpga.h"
+#include "fileutils.h"      // searchFile
+#include "util.h"           // str_endswith
+#include "util_posix.h"     // msclock
+#include "crypto/originality.h"
 
 static int CmdHelp(const char *Cmd);
 
@@ -569,6 +573,214 @@ int CmdHFPlot(const char *Cmd) {
     return handle_hf_plot(true);
 }
 
+static const CLIParserOption hf_sig_type_opts[] = {
+    {PK_MFC,     "mfc"},
+    {PK_MFUL,    "mful"},
+    {PK_MFULAES, "mfulaes"},
+    {PK_MFP,     "mfp"},
+    {PK_MFDES,   "mfdes"},
+    {PK_ST25TA,  "st25ta"},
+    {PK_ST25TN,  "st25tn"},
+    {PK_ST25TV,  "st25tv"},
+    {PK_15,      "15"},
+    {PK_MIK,     "mik"},
+    {PK_ALL,     "all"},
+    {0, NULL},
+};
+
+static bool hf_sig_add(originality_entry_t **entries, size_t *count, size_t *max, const char *uid, const char *sig) {
+    if (*count == *max) {
+        size_t n = (*max) ? (*max) * 2 : 1024;
+        originality_entry_t *tmp = realloc(*entries, n * sizeof(originality_entry_t));
+        if (tmp == NULL) {
+            return false;
+        }
+        *entries = tmp;
+        *max = n;
+    }
+
+    originality_entry_t *e = &(*entries)[*count];
+    memset(e, 0, sizeof(originality_entry_t));
+
+    int ulen = hex_to_bytes(uid, e->data, sizeof(e->data));
+    int slen = hex_to_bytes(sig, e->signature, sizeof(e->signature));
+    if (ulen <= 0 || slen <= 0) {
+        return false;
+    }
+
+    e->data_len = ulen;
+    e->signature_len = slen;
+    e->index = -1;
+    (*count)++;
+    return true;
+}
+
+// `uid,signature` per line, `#` comments. A header line is skipped
+static int hf_sig_load_csv(const char *filename, originality_entry_t **entries, size_t *count, size_t *max) {
+    char *path;
+    if (searchFile(&path, RESOURCES_SUBDIR, filename, "", false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    FILE *f = fopen(path, "r");
+    free(path);
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", filename);
+        return PM3_EFILE;
+    }
+
+    char line[512];
+    uint32_t lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+
+        line[strcspn(line, "\r\n#")] = '\0';
+        if (strlen(line) == 0) {
+            continue;
+        }
+
+        char *sep = strpbrk(line, ",;");
+        if (sep) {
+            *sep = '\0';
+            if (hf_sig_add(entries, count, max, line, sep + 1)) {
+                continue;
+            }
+        }
+
+        if (lineno > 1 || sep == NULL) {
+            PrintAndLogEx(WARNING, "line %u, skipping `" _YELLOW_("%s") "`", lineno, line);
+        }
+    }
+
+    fclose(f);
+    return PM3_SUCCESS;
+}
+
+// { "signatures": [ { "uid": "...", "signature": "..." }, ... ] }
+static int hf_sig_load_json(const char *filename, originality_entry_t **entries, size_t *count, size_t *max) {
+    json_t *root = NULL;
+    int res = loadFileJSONroot(filename, (void **)&root, false);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    json_t *list = json_object_get(root, "signatures");
+    if (json_is_array(list) == false) {
+        PrintAndLogEx(ERR, "ERROR: json " _YELLOW_("%s") " has no `signatures` array", filename);
+        json_decref(root);
+        return PM3_ESOFT;
+    }
+
+    size_t i;
+    json_t *item;
+    json_array_foreach(list, i, item) {
+        const char *uid = json_string_value(json_object_get(item, "uid"));
+        const char *sig = json_string_value(json_object_get(item, "signature"));
+        if (uid == NULL || sig == NULL || hf_sig_add(entries, count, max, uid, sig) == false) {
+            PrintAndLogEx(WARNING, "entry %zu, skipping", i);
+        }
+    }
+
+    json_decref(root);
+    return PM3_SUCCESS;
+}
+
+static int CmdHFSig(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf sig",
+                  "Verify a file of originality signatures against the known manufacturer public keys.\n"
+                  "CSV files hold one `UID,signature` pair in hex per line.\n"
+                  "JSON files hold an object with a `signatures` array of { \"uid\": .., \"signature\": .. } objects.",
+                  "hf sig -f signatures.csv\n"
+                  "hf sig -f signatures.json --type mful\n"
+                  "hf sig -f icode.csv --type 15 --sha -v"
+                 );
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1("f", "file", "<fn>", "CSV or JSON file with UID / signature pairs"),
+        arg_str0(NULL, "type", "<mfc|mful|mfulaes|mfp|mfdes|st25ta|st25tn|st25tv|15|mik|all>", "Public keys to check against (def: all)"),
+        arg_lit0("r", "reverse", "UID and signature are stored in reverse byte order"),
+        arg_lit0(NULL, "sha", "Signature is over the SHA256 of the UID"),
+        arg_lit0("v", "verbose", "Verbose output, print every entry"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+    int type = PK_ALL;
+    if (CLIGetOptionList(arg_get_str(ctx, 2), hf_sig_type_opts, &type)) {
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+
+    bool reverse = arg_get_lit(ctx, 3);
+    bool hash = arg_get_lit(ctx, 4);
+    bool verbose = arg_get_lit(ctx, 5);
+    CLIParserFree(ctx);
+
+    originality_entry_t *entries = NULL;
+    size_t count = 0, max = 0;
+
+    int res;
+    if (str_endswith(filename, ".json")) {
+        res = hf_sig_load_json(filename, &entries, &count, &max);
+    } else {
+        res = hf_sig_load_csv(filename, &entries, &count, &max);
+    }
+
+    if (res != PM3_SUCCESS || count == 0) {
+        PrintAndLogEx(FAILED, "No signatures loaded from `" _YELLOW_("%s") "`", filename);
+        free(entries);
+        return (res != PM3_SUCCESS) ? res : PM3_ESOFT;
+    }
+
+    PrintAndLogEx(INFO, "Loaded " _YELLOW_("%zu") " signatures", count);
+
+    int workers = 0;
+    uint64_t t1 = msclock();
+    size_t found = originality_check_verify_batch(entries, count, (pk_type_t)type, reverse, hash, &workers);
+    uint64_t t2 = msclock() - t1;
+
+    // hits per key, in table order
+    size_t hits[ORIGINALITY_MAX_KEYS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        originality_entry_t *e = &entries[i];
+        if (e->index >= 0 && e->index < ARRAYLEN(hits)) {
+            hits[e->index]++;
+        }
+
+        if (verbose) {
+            PrintAndLogEx(INFO, "%s | %s | %s"
+                          , sprint_hex_inrow(e->data, e->data_len)
+                          , (e->index >= 0) ? _GREEN_("ok  ") : _RED_("fail")
+                          , (e->index >= 0) ? originality_key_name(e->index) : ""
+                         );
+        } else if (e->index < 0) {
+            PrintAndLogEx(INFO, "%s | " _RED_("fail"), sprint_hex_inrow(e->data, e->data_len));
+        }
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    for (int i = 0; i < ARRAYLEN(hits); i++) {
+        if (hits[i]) {
+            PrintAndLogEx(SUCCESS, "%6zu  %s", hits[i], originality_key_name(i));
+        }
+    }
+
+    PrintAndLogEx(SUCCESS, "Verified " _GREEN_("%zu") " / %zu, failed " _RED_("%zu"), found, count, count - found);
+    PrintAndLogEx(SUCCESS, "Time " _YELLOW_("%.3f") " s ( " _YELLOW_("%.0f") " signatures/s, " _YELLOW_("%d") " threads )"
+                  , (float)t2 / 1000.0
+                  , (t2 > 0) ? (float)count * 1000.0 / t2 : 0.0
+                  , workers
+                 );
+
+    free(entries);
+    return (found == count) ? PM3_SUCCESS : PM3_ESOFT;
+}
+
 static int CmdHFList(const char *Cmd) {
     return CmdTraceListAlias(Cmd, "hf", "raw");
 }
@@ -619,6 +831,7 @@ static command_t CommandTable[] = {
     {"plot",        CmdHFPlot,        IfPm3Hfplot,     "Plot signal"},
     {"tune",        CmdHFTune,        IfPm3Present,    "Continuously measure HF antenna tuning"},
     {"search",      CmdHFSearch,      AlwaysAvailable, "Search for known HF tags"},
+    {"sig",         CmdHFSig,         AlwaysAvailable, "Verify originality signatures from file"},
     {"sniff",       CmdHFSniff,       IfPm3Hfsniff,    "Generic HF Sniff"},
     {NULL, NULL, NULL, NULL}
 };
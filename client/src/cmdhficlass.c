@@ -4870,13 +4870,15 @@ static int CmdHFiClass_loclass(const char *Cmd) {
                   "  <8 byte CSN><8 byte CC><4 byte NR><4 byte MAC>\n"
                   "   ... totalling N*24 bytes",
                   "hf iclass loclass -f iclass_dump.bin\n"
-                  "hf iclass loclass --test");
+                  "hf iclass loclass --test\n"
+                  "hf iclass loclass --bench    -> MAC engine self test and keys/s");
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("f", "file", "<fn>", "filename with nr/mac data from `hf iclass sim -t 2` "),
         arg_lit0(NULL, "test",        "Perform self test"),
         arg_lit0(NULL, "long",        "Perform self test, including long ones"),
+        arg_lit0(NULL, "bench",       "Compare MAC engines against the reference and show keys/s"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -4887,12 +4889,18 @@ static int CmdHFiClass_loclass(const char *Cmd) {
 
     bool test = arg_get_lit(ctx, 2);
     bool longtest = arg_get_lit(ctx, 3);
+    bool bench = arg_get_lit(ctx, 4);
 
     CLIParserFree(ctx);
 
+    if (bench) {
+        return testMACEngines(true);
+    }
+
     if (test || longtest) {
         int errors = testCipherUtils();
         errors += testMAC();
+        errors += testMACEngines(false);
         errors += doKeyTests();
         errors += testElite(longtest);
 
@@ -5714,6 +5722,14 @@ static void add_key(uint8_t *key) {
     }
 }
 
+static void print_premac_rate(uint32_t keycnt, uint64_t ms) {
+    PrintAndLogEx(INFO, "Generated " _YELLOW_("%u") " diversified keys in " _YELLOW_("%.3f") " seconds ( " _YELLOW_("%" PRIu64) " keys/s )"
+                  , keycnt
+                  , (float)ms / 1000.0
+                  , (ms) ? ((uint64_t)keycnt * 1000) / ms : (uint64_t)keycnt * 1000
+                 );
+}
+
 static int CmdHFiClassCheckKeys(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf iclass chk",
@@ -5838,7 +5854,9 @@ static int CmdHFiClassCheckKeys(const char *Cmd) {
     if (use_raw)
         PrintAndLogEx(NORMAL, "using " _YELLOW_("raw mode"));
 
+    uint64_t t_gen = msclock();
     GenerateMacFrom(CSN, CCNR, use_raw, use_elite, keyBlock, keycount, pre);
+    print_premac_rate(keycount, msclock() - t_gen);
 
     PrintAndLogEx(SUCCESS, "Searching for " _YELLOW_("%s") " key...", (use_credit_key) ? "CREDIT" : "DEBIT");
 
@@ -6089,132 +6107,405 @@ void generate_key_block_inverted(const uint8_t *startingKey, uint64_t index, uin
 }
 
 
-// HF iClass legbrute - Thread argument structure
+// HF iClass legbrute - the 40 bit keyspace is split into work units, one per machine.
+// Inside a unit the threads take chunks from a shared cursor. A chunk is only marked
+// as done once all of it was tested, so resuming from a checkpoint never skips keys.
+#define LEGBRUTE_KEYSPACE       ((uint64_t)1 << 40)
+#define LEGBRUTE_CHUNK_SIZE     ((uint64_t)1 << 22)
+#define LEGBRUTE_MAX_UNITS      (LEGBRUTE_KEYSPACE / LEGBRUTE_CHUNK_SIZE)
+#define LEGBRUTE_MAX_FILES      64
+#define LEGBRUTE_FILETYPE       "iclass legbrute"
+
+typedef struct {
+    uint8_t epurse[8];
+    uint8_t macs1[8];
+    uint8_t macs2[8];
+    uint8_t pk[8];
+    uint64_t index;         // offset into the keyspace, from --index
+    uint32_t unit;          // 1 .. units
+    uint32_t units;
+    uint64_t unit_start;    // [unit_start, unit_end), relative to index
+    uint64_t unit_end;
+    uint64_t chunks;
+    uint8_t *done;          // one bit per chunk
+    bool found;
+    uint8_t key[8];
+} legbrute_job_t;
+
+// HF iClass legbrute - state shared by the worker threads
 typedef struct {
-    uint8_t startingKey[8];
-    uint64_t index_start;
-    uint64_t index_end;
+    legbrute_job_t *job;
     uint8_t CCNR1[12];
     uint8_t MAC_TAG1[4];
     uint8_t CCNR2[12];
     uint8_t MAC_TAG2[4];
-    int thread_id;
-    int thread_count;
-    uint64_t start_time;
-    _Atomic bool *found;
-    _Atomic bool *aborted;
-    _Atomic uint64_t *aborted_at;
-    bool debug;
-    pthread_mutex_t *log_lock;
-} thread_args_t;
+    uint64_t next_chunk;    // next chunk to hand out
+    uint64_t tested;        // keys in chunks finished during this run
+    int running;            // worker threads still busy
+    bool found;
+    bool aborted;
+} legbrute_ctx_t;
+
+static void legbrute_unit_range(uint32_t unit, uint32_t units, uint64_t *start, uint64_t *end) {
+    uint64_t slice = LEGBRUTE_KEYSPACE / units;
+    *start = (uint64_t)(unit - 1) * slice;
+    // last unit absorbs remainder
+    *end = (unit == units) ? LEGBRUTE_KEYSPACE : (uint64_t)unit * slice;
+}
 
-// HF iClass legbrute - Brute-force worker thread
-static void *brute_thread(void *args_void) {
+static int legbrute_job_init(legbrute_job_t *job, uint32_t unit, uint32_t units) {
+    job->unit = unit;
+    job->units = units;
+    legbrute_unit_range(unit, units, &job->unit_start, &job->unit_end);
+    job->chunks = (job->unit_end - job->unit_start + LEGBRUTE_CHUNK_SIZE - 1) / LEGBRUTE_CHUNK_SIZE;
+    job->done = calloc((job->chunks + 7) / 8, sizeof(uint8_t));
+    return (job->done == NULL) ? PM3_EMALLOC : PM3_SUCCESS;
+}
 
-    thread_args_t *args = (thread_args_t *)args_void;
-    uint8_t div_key[8];
-    uint8_t mac[4];
-    uint8_t verification_mac[4];
-    uint64_t index = args->index_start;
+static bool legbrute_same_job(const legbrute_job_t *a, const legbrute_job_t *b) {
+    return (memcmp(a->epurse, b->epurse, 8) == 0)
+           && (memcmp(a->macs1, b->macs1, 8) == 0)
+           && (memcmp(a->macs2, b->macs2, 8) == 0)
+           && (memcmp(a->pk, b->pk, 8) == 0)
+           && (a->index == b->index)
+           && (a->units == b->units);
+}
 
-    if (args->debug) {
-        pthread_mutex_lock(args->log_lock);
+static bool legbrute_chunk_done(const legbrute_job_t *job, uint64_t c) {
+    return (__atomic_load_n(&job->done[c >> 3], __ATOMIC_RELAXED) >> (c & 7)) & 1;
+}
 
-        PrintAndLogEx(INFO, "Thread[%2d]  range [%" PRIu64 " - %" PRIu64 ")  startingKey: %s"
-                      , args->thread_id
-                      , args->index_start
-                      , args->index_end
-                      , sprint_hex_inrow(args->startingKey, 8));
+static uint64_t legbrute_chunk_keys(const legbrute_job_t *job, uint64_t c) {
+    uint64_t start = job->unit_start + (c * LEGBRUTE_CHUNK_SIZE);
+    return MIN(LEGBRUTE_CHUNK_SIZE, job->unit_end - start);
+}
 
-        // Show first 2 candidates — different threads must start from different candidates
-        for (int d = 0; d < 2; d++) {
-            generate_key_block_inverted(args->startingKey, args->index_start + d, div_key);
-            PrintAndLogEx(INFO, "  [index %" PRIu64 "]: %s", args->index_start + d, sprint_hex_inrow(div_key, 8));
+static uint64_t legbrute_tested(const legbrute_job_t *job) {
+    uint64_t n = 0;
+    for (uint64_t c = 0; c < job->chunks; c++) {
+        if (legbrute_chunk_done(job, c)) {
+            n += legbrute_chunk_keys(job, c);
         }
+    }
+    return n;
+}
 
-        // Show the midpoint of the slice — confirms byte-0 carry is reached inside this thread's range
-        uint64_t mid = args->index_start + (args->index_end - args->index_start) / 2;
-        generate_key_block_inverted(args->startingKey, mid, div_key);
-        PrintAndLogEx(INFO, "  [index %" PRIu64 " (mid)]: %s", mid, sprint_hex_inrow(div_key, 8));
+// HF iClass legbrute - checkpoint file, written to a temp file first so a crash never leaves half a file
+static int legbrute_save(const char *fn, const legbrute_job_t *job) {
+
+    json_t *root = json_object();
+    json_object_set_new(root, "Created", json_string("proxmark3"));
+    json_object_set_new(root, "FileType", json_string(LEGBRUTE_FILETYPE));
+    json_object_set_new(root, "epurse", json_string(sprint_hex_inrow(job->epurse, 8)));
+    json_object_set_new(root, "macs1", json_string(sprint_hex_inrow(job->macs1, 8)));
+    json_object_set_new(root, "macs2", json_string(sprint_hex_inrow(job->macs2, 8)));
+    json_object_set_new(root, "pk", json_string(sprint_hex_inrow(job->pk, 8)));
+    json_object_set_new(root, "index", json_integer(job->index));
+    json_object_set_new(root, "unit", json_integer(job->unit));
+    json_object_set_new(root, "units", json_integer(job->units));
+    json_object_set_new(root, "chunk_size", json_integer(LEGBRUTE_CHUNK_SIZE));
+
+    // finished chunks as [first, last] ranges, counted in the same pass so both agree
+    json_t *done = json_array();
+    uint64_t tested = 0;
+    uint64_t c = 0;
+    while (c < job->chunks) {
+        if (legbrute_chunk_done(job, c) == false) {
+            c++;
+            continue;
+        }
+        uint64_t first = c;
+        while (c < job->chunks && legbrute_chunk_done(job, c)) {
+            tested += legbrute_chunk_keys(job, c);
+            c++;
+        }
+        json_t *range = json_array();
+        json_array_append_new(range, json_integer(first));
+        json_array_append_new(range, json_integer(c - 1));
+        json_array_append_new(done, range);
+    }
+    json_object_set_new(root, "tested", json_integer(tested));
+    json_object_set_new(root, "done", done);
+
+    if (job->found) {
+        json_object_set_new(root, "key", json_string(sprint_hex_inrow(job->key, 8)));
+    }
+
+    char tmp[FILE_PATH_SIZE];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", fn);
+
+    int res = json_dump_file(root, tmp, JSON_INDENT(2));
+    json_decref(root);
+
+    if (res == 0) {
+        res = replaceFile(tmp, fn);
+    } else {
+        // don't leave a partial checkpoint behind
+        remove(tmp);
+    }
 
-        pthread_mutex_unlock(args->log_lock);
-        return NULL;
+    if (res != 0) {
+        PrintAndLogEx(FAILED, "error, can't save the file `" _YELLOW_("%s") "`", fn);
+        return PM3_EFILE;
     }
+    return PM3_SUCCESS;
+}
 
-    uint32_t progress_countdown = 1000000;
-    while (index < args->index_end && !*(args->found) && !*(args->aborted)) {
+// relative names not found in the current directory live in the dump save path
+static void legbrute_filename(const char *name, char *fn, size_t fnlen) {
+    const char *dir = g_session.defaultPaths[spDump];
+    bool relative = (name[0] != '/') && (name[0] != '\\');
+    if (relative && fileExists(name) == false && dir != NULL && strlen(dir)) {
+        snprintf(fn, fnlen, "%s%s%s", dir, PATHSEP, name);
+    } else {
+        snprintf(fn, fnlen, "%s", name);
+    }
+}
 
-        generate_key_block_inverted(args->startingKey, index, div_key);
-        doMAC_brute(args->CCNR1, div_key, mac);
+static bool legbrute_json_hex(json_t *root, const char *name, uint8_t *out) {
+    const char *s = json_string_value(json_object_get(root, name));
+    return (s != NULL) && (hex_to_bytes(s, out, 8) == 8);
+}
 
-        if (memcmp(mac, args->MAC_TAG1, 4) == 0) {
-            doMAC_brute(args->CCNR2, div_key, verification_mac);
-            if (memcmp(verification_mac, args->MAC_TAG2, 4) == 0) {
-                pthread_mutex_lock(args->log_lock);
-                if (!*(args->found)) {
-                    *args->found = true;
-                    PrintAndLogEx(NORMAL, "\n");
-                    PrintAndLogEx(SUCCESS, "Found valid raw key " _GREEN_("%s"), sprint_hex_inrow(div_key, 8));
-                    PrintAndLogEx(HINT, "Hint: Run `"_YELLOW_("hf iclass unhash -k %s")"` to find the needed pre-images", sprint_hex_inrow(div_key, 8));
-                    PrintAndLogEx(INFO, "Done!");
-                    PrintAndLogEx(NORMAL, "");
-                }
-                pthread_mutex_unlock(args->log_lock);
+static int legbrute_load(const char *fn, legbrute_job_t *job) {
+
+    json_error_t error;
+    json_t *root = json_load_file(fn, 0, &error);
+    if (root == NULL) {
+        PrintAndLogEx(ERR, "ERROR: json " _YELLOW_("%s") " error on line %d: %s", fn, error.line, error.text);
+        return PM3_EFILE;
+    }
+
+    int res = PM3_ESOFT;
+    const char *ftype = json_string_value(json_object_get(root, "FileType"));
+    if (ftype == NULL || strcmp(ftype, LEGBRUTE_FILETYPE) != 0) {
+        PrintAndLogEx(ERR, _YELLOW_("%s") " is not a legbrute checkpoint file", fn);
+        goto out;
+    }
+
+    if (legbrute_json_hex(root, "epurse", job->epurse) == false ||
+            legbrute_json_hex(root, "macs1", job->macs1) == false ||
+            legbrute_json_hex(root, "macs2", job->macs2) == false ||
+            legbrute_json_hex(root, "pk", job->pk) == false) {
+        PrintAndLogEx(ERR, _YELLOW_("%s") " has missing or malformed parameters", fn);
+        goto out;
+    }
+
+    json_int_t index = json_integer_value(json_object_get(root, "index"));
+    json_int_t unit = json_integer_value(json_object_get(root, "unit"));
+    json_int_t units = json_integer_value(json_object_get(root, "units"));
+    json_int_t chunk_size = json_integer_value(json_object_get(root, "chunk_size"));
+
+    if (index < 0 || units < 1 || units > (json_int_t)LEGBRUTE_MAX_UNITS || unit < 1 || unit > units) {
+        PrintAndLogEx(ERR, _YELLOW_("%s") " has an invalid work unit", fn);
+        goto out;
+    }
+
+    if (chunk_size != (json_int_t)LEGBRUTE_CHUNK_SIZE) {
+        PrintAndLogEx(ERR, _YELLOW_("%s") " was written with a different chunk size", fn);
+        goto out;
+    }
+
+    job->index = index;
+    res = legbrute_job_init(job, unit, units);
+    if (res != PM3_SUCCESS) {
+        goto out;
+    }
+
+    size_t i;
+    json_t *range;
+    json_array_foreach(json_object_get(root, "done"), i, range) {
+        json_int_t first = json_integer_value(json_array_get(range, 0));
+        json_int_t last = json_integer_value(json_array_get(range, 1));
+        if (first < 0 || first > last || (uint64_t)last >= job->chunks) {
+            PrintAndLogEx(ERR, _YELLOW_("%s") " has an invalid chunk range", fn);
+            res = PM3_ESOFT;
+            goto out;
+        }
+        for (uint64_t c = first; c <= (uint64_t)last; c++) {
+            job->done[c >> 3] |= (1 << (c & 7));
+        }
+    }
+
+    if (json_object_get(root, "key")) {
+        if (legbrute_json_hex(root, "key", job->key) == false) {
+            PrintAndLogEx(ERR, _YELLOW_("%s") " has a malformed key", fn);
+            res = PM3_ESOFT;
+            goto out;
+        }
+        job->found = true;
+    }
+
+out:
+    json_decref(root);
+    return res;
+}
+
+// HF iClass legbrute - Brute-force worker thread
+static void *brute_thread(void *args_void) {
+
+    legbrute_ctx_t *ctx = (legbrute_ctx_t *)args_void;
+    legbrute_job_t *job = ctx->job;
+
+    // candidates go through the MAC engine one bitsliced pass at a time
+    uint8_t div_keys[ICLASS_BS_LANES * PICOPASS_BLOCK_SIZE];
+    uint8_t macs[ICLASS_BS_LANES * 4];
+    uint8_t verification_mac[4];
+
+    while (__atomic_load_n(&ctx->found, __ATOMIC_RELAXED) == false && __atomic_load_n(&ctx->aborted, __ATOMIC_RELAXED) == false) {
+
+        // idle threads keep taking the next chunk until the unit is exhausted
+        uint64_t c = __atomic_fetch_add(&ctx->next_chunk, 1, __ATOMIC_RELAXED);
+        if (c >= job->chunks) {
+            break;
+        }
+
+        if (legbrute_chunk_done(job, c)) {
+            continue;
+        }
+
+        uint64_t start = job->unit_start + (c * LEGBRUTE_CHUNK_SIZE);
+        uint64_t end = start + legbrute_chunk_keys(job, c);
+        uint64_t index = start;
+
+        while (index < end) {
+
+            if (__atomic_load_n(&ctx->found, __ATOMIC_RELAXED) || __atomic_load_n(&ctx->aborted, __ATOMIC_RELAXED)) {
                 break;
             }
-        }
 
-        uint64_t thread_progress = index - args->index_start;
-        if (--progress_countdown == 0 && !*(args->found)) {
-            progress_countdown = 1000000;
-
-            if (args->thread_id == 0) {
-                uint64_t keyspace     = (uint64_t)1 << 40;
-                uint64_t keyspace_m   = keyspace / 1000000;      // 1,099,511
-                uint64_t run_progress = thread_progress * (uint64_t)args->thread_count;
-                // Cumulative absolute position across all threads including any --index offset
-                uint64_t abs_done     = args->index_start * (uint64_t)args->thread_count + run_progress;
-                uint64_t keys_left    = (abs_done < keyspace) ? keyspace - abs_done : 0;
-                uint64_t elapsed_ms   = msclock() - args->start_time;
-
-                pthread_mutex_lock(args->log_lock);
-
-                if (elapsed_ms > 0 && run_progress > 0) {
-                    // speed based on keys tested in this run only
-                    uint64_t kps   = run_progress * 1000 / elapsed_ms;
-                    uint64_t eta_s = (kps > 0) ? keys_left / kps : 0;
-                    uint64_t eta_d = eta_s / 86400;
-                    uint64_t eta_h = (eta_s % 86400) / 3600;
-                    uint64_t eta_m = (eta_s % 3600) / 60;
-                    uint64_t eta_r = eta_s % 60;
-                    PrintAndLogEx(INPLACE, "Tested "_YELLOW_("%" PRIu64)"M / %" PRIu64 "M keys  speed: "_YELLOW_("%" PRIu64)" k/s  ETA: "_YELLOW_("%" PRIu64 "d %02" PRIu64 "h %02" PRIu64 "m %02" PRIu64 "s")
-                                  , abs_done / 1000000
-                                  , keyspace_m
-                                  , kps / 1000
-                                  , eta_d, eta_h, eta_m, eta_r
-                                 );
-                } else {
-                    PrintAndLogEx(INPLACE, "Tested "_YELLOW_("%" PRIu64)"M / %" PRIu64 "M keys"
-                                  , abs_done / 1000000
-                                  , keyspace_m
-                                 );
+            uint32_t n = (uint32_t)MIN((uint64_t)ICLASS_BS_LANES, end - index);
+            for (uint32_t i = 0; i < n; i++) {
+                generate_key_block_inverted(job->pk, job->index + index + i, div_keys + (i * PICOPASS_BLOCK_SIZE));
+            }
+            doMAC_batch(ctx->CCNR1, div_keys, n, macs, ICLASS_CIPHER_AUTO);
+
+            for (uint32_t i = 0; i < n; i++) {
+
+                if (memcmp(macs + (i * 4), ctx->MAC_TAG1, 4)) {
+                    continue;
                 }
 
-                if (kbd_enter_pressed()) {
-                    *args->aborted_at = index;
-                    *args->aborted = true;
+                const uint8_t *div_key = div_keys + (i * PICOPASS_BLOCK_SIZE);
+                doMAC_brute(ctx->CCNR2, div_key, verification_mac);
+                if (memcmp(verification_mac, ctx->MAC_TAG2, 4) == 0) {
+                    // first thread to flip the flag owns the key
+                    if (__atomic_exchange_n(&ctx->found, true, __ATOMIC_SEQ_CST) == false) {
+                        memcpy(job->key, div_key, PICOPASS_BLOCK_SIZE);
+                    }
+                    break;
                 }
-                pthread_mutex_unlock(args->log_lock);
             }
 
+            index += n;
         }
-        index++;
+
+        if (index < end) {
+            break;
+        }
+
+        __atomic_fetch_or(&job->done[c >> 3], (uint8_t)(1 << (c & 7)), __ATOMIC_RELAXED);
+        __atomic_fetch_add(&ctx->tested, end - start, __ATOMIC_RELAXED);
     }
+
+    __atomic_fetch_sub(&ctx->running, 1, __ATOMIC_RELEASE);
     return NULL;
 }
 
+static void legbrute_print_debug(const legbrute_job_t *job, int thread_count) {
+
+    uint8_t div_key[8];
+
+    PrintAndLogEx(INFO, "Work unit %u/%u  range [%" PRIu64 " - %" PRIu64 ")  %" PRIu64 " chunks of %" PRIu64 " keys  startingKey: %s"
+                  , job->unit
+                  , job->units
+                  , job->index + job->unit_start
+                  , job->index + job->unit_end
+                  , job->chunks
+                  , LEGBRUTE_CHUNK_SIZE
+                  , sprint_hex_inrow(job->pk, 8));
+
+    // First 2 candidates of the chunks each thread starts with — they must all differ
+    uint64_t first_chunks = MIN((uint64_t)thread_count, job->chunks);
+    for (uint64_t c = 0; c < first_chunks; c++) {
+        uint64_t start = job->index + job->unit_start + (c * LEGBRUTE_CHUNK_SIZE);
+        for (int d = 0; d < 2; d++) {
+            generate_key_block_inverted(job->pk, start + d, div_key);
+            PrintAndLogEx(INFO, "  Chunk[%2" PRIu64 "] [index %" PRIu64 "]: %s", c, start + d, sprint_hex_inrow(div_key, 8));
+        }
+    }
+
+    // Show the midpoint of the unit — confirms byte-0 carry is reached inside this unit
+    uint64_t mid = job->index + job->unit_start + (job->unit_end - job->unit_start) / 2;
+    generate_key_block_inverted(job->pk, mid, div_key);
+    PrintAndLogEx(INFO, "  [index %" PRIu64 " (mid)]: %s", mid, sprint_hex_inrow(div_key, 8));
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "Work unit summary (%u units, keyspace 2^40 = %" PRIu64 "):", job->units, LEGBRUTE_KEYSPACE);
+    PrintAndLogEx(INFO, "  Unit    start                end                  size");
+
+    // Verify all units are contiguous and non-overlapping, list the first few
+    bool ok = true;
+    uint64_t prev_end = 0;
+    for (uint32_t u = 1; u <= job->units; u++) {
+        uint64_t start, end;
+        legbrute_unit_range(u, job->units, &start, &end);
+        if (u <= 16) {
+            PrintAndLogEx(INFO, "  [%2u]    %-20" PRIu64 " %-20" PRIu64 " %" PRIu64, u, job->index + start, job->index + end, end - start);
+        }
+        if (start != prev_end || end <= start) {
+            PrintAndLogEx(WARNING, _RED_("  Gap or overlap between unit %u and %u!"), u - 1, u);
+            ok = false;
+        }
+        prev_end = end;
+    }
+    if (job->units > 16) {
+        PrintAndLogEx(INFO, "  ...");
+    }
+    if (prev_end != LEGBRUTE_KEYSPACE) {
+        PrintAndLogEx(WARNING, _RED_("  Units don't cover the whole keyspace!"));
+        ok = false;
+    }
+    if (ok) {
+        PrintAndLogEx(SUCCESS, _GREEN_("  Units are contiguous and non-overlapping"));
+    }
+}
+
+static void legbrute_print_progress(const legbrute_job_t *job, uint64_t tested_before, uint64_t tested, uint64_t elapsed_ms) {
+
+    uint64_t unit_size = job->unit_end - job->unit_start;
+    uint64_t abs_done  = tested_before + tested;
+    uint64_t keys_left = (abs_done < unit_size) ? unit_size - abs_done : 0;
+
+    if (elapsed_ms > 0 && tested > 0) {
+        // speed based on keys tested in this run only
+        uint64_t kps   = tested * 1000 / elapsed_ms;
+        uint64_t eta_s = (kps > 0) ? keys_left / kps : 0;
+        uint64_t eta_d = eta_s / 86400;
+        uint64_t eta_h = (eta_s % 86400) / 3600;
+        uint64_t eta_m = (eta_s % 3600) / 60;
+        uint64_t eta_r = eta_s % 60;
+        PrintAndLogEx(INPLACE, "Tested "_YELLOW_("%" PRIu64)"M / %" PRIu64 "M keys  speed: "_YELLOW_("%" PRIu64)" k/s  ETA: "_YELLOW_("%" PRIu64 "d %02" PRIu64 "h %02" PRIu64 "m %02" PRIu64 "s")
+                      , abs_done / 1000000
+                      , unit_size / 1000000
+                      , kps / 1000
+                      , eta_d, eta_h, eta_m, eta_r
+                     );
+    } else {
+        PrintAndLogEx(INPLACE, "Tested "_YELLOW_("%" PRIu64)"M / %" PRIu64 "M keys"
+                      , abs_done / 1000000
+                      , unit_size / 1000000
+                     );
+    }
+}
+
+static void legbrute_print_key(const uint8_t *key) {
+    PrintAndLogEx(SUCCESS, "Found valid raw key " _GREEN_("%s"), sprint_hex_inrow(key, 8));
+    PrintAndLogEx(HINT, "Hint: Run `"_YELLOW_("hf iclass unhash -k %s")"` to find the needed pre-images", sprint_hex_inrow(key, 8));
+}
+
 // HF iClass legbrute - Multithreaded brute-force function
-static int CmdHFiClassLegBrute_MT(uint8_t epurse[8], uint8_t macs[8], uint8_t macs2[8], uint8_t startingKey[8], uint64_t index, int threads, bool debug) {
+static int CmdHFiClassLegBrute_MT(legbrute_job_t *job, const char *fn, int threads, uint32_t interval, bool debug) {
 
     int thread_count = threads;
     if (thread_count < 1) {
@@ -6228,104 +6519,200 @@ static int CmdHFiClassLegBrute_MT(uint8_t epurse[8], uint8_t macs[8], uint8_t ma
     PrintAndLogEx(INFO, "Bruteforcing using " _YELLOW_("%u") " threads", thread_count);
     PrintAndLogEx(NORMAL, "");
 
-    uint8_t CCNR[12], CCNR2[12], MAC_TAG[4], MAC_TAG2[4];
+    if (debug) {
+        legbrute_print_debug(job, thread_count);
+        return PM3_SUCCESS;
+    }
 
-    memcpy(CCNR, epurse, 8);
-    memcpy(CCNR2, epurse, 8);
-    memcpy(CCNR + 8, macs, 4);
-    memcpy(CCNR2 + 8, macs2, 4);
-    memcpy(MAC_TAG, macs + 4, 4);
-    memcpy(MAC_TAG2, macs2 + 4, 4);
+    uint64_t tested_before = legbrute_tested(job);
+    PrintAndLogEx(INFO, "Work unit " _YELLOW_("%u/%u") "  range [%" PRIu64 " - %" PRIu64 ")"
+                  , job->unit
+                  , job->units
+                  , job->index + job->unit_start
+                  , job->index + job->unit_end);
+    if (tested_before) {
+        PrintAndLogEx(INFO, "Resuming, " _YELLOW_("%" PRIu64) "M keys already tested", tested_before / 1000000);
+    }
+    PrintAndLogEx(INFO, "Checkpoint saved to " _YELLOW_("%s") " every %u s", fn, interval);
+
+    legbrute_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.job = job;
+    memcpy(ctx.CCNR1, job->epurse, 8);
+    memcpy(ctx.CCNR2, job->epurse, 8);
+    memcpy(ctx.CCNR1 + 8, job->macs1, 4);
+    memcpy(ctx.CCNR2 + 8, job->macs2, 4);
+    memcpy(ctx.MAC_TAG1, job->macs1 + 4, 4);
+    memcpy(ctx.MAC_TAG2, job->macs2 + 4, 4);
+    ctx.running = thread_count;
 
-    pthread_t tids[thread_count];
-    thread_args_t args[thread_count];
-    _Atomic bool found = false;
-    _Atomic bool aborted = false;
-    _Atomic uint64_t aborted_at = 0;
-    pthread_mutex_t log_lock;
-    pthread_mutex_init(&log_lock, NULL);
     PrintAndLogEx(HINT, "Hint: Press " _YELLOW_("<Enter>") " to abort");
 
-    // Divide the full 40-bit keyspace into equal non-overlapping slices, one per thread.
-    // All threads use the same startingKey; only their index range differs.
-    uint64_t keyspace = (uint64_t)1 << 40;
-    uint64_t slice = keyspace / thread_count;
-    uint64_t start_time = msclock();
-
+    pthread_t tids[thread_count];
     for (int i = 0; i < thread_count; i++) {
-        memcpy(args[i].startingKey, startingKey, 8);
-        args[i].index_start = index + (uint64_t)i * slice;
-        args[i].index_end   = (i == thread_count - 1)
-                              ? index + keyspace                      // last thread absorbs remainder
-                              : index + (uint64_t)(i + 1) * slice;
-        memcpy(args[i].CCNR1, CCNR, 12);
-        memcpy(args[i].MAC_TAG1, MAC_TAG, 4);
-        memcpy(args[i].CCNR2, CCNR2, 12);
-        memcpy(args[i].MAC_TAG2, MAC_TAG2, 4);
-        args[i].thread_id = i;
-        args[i].thread_count = thread_count;
-        args[i].start_time = start_time;
-        args[i].found = &found;
-        args[i].aborted = &aborted;
-        args[i].aborted_at = &aborted_at;
-        args[i].debug = debug;
-        args[i].log_lock = &log_lock;
-
-        if (pthread_create(&tids[i], NULL, brute_thread, &args[i]) != 0) {
+        if (pthread_create(&tids[i], NULL, brute_thread, &ctx) != 0) {
             PrintAndLogEx(WARNING, "Failed to create thread %d, running with %d thread(s)", i, i);
+            __atomic_fetch_sub(&ctx.running, thread_count - i, __ATOMIC_RELEASE);
             thread_count = i;
             break;
         }
     }
 
     if (thread_count == 0) {
-        pthread_mutex_destroy(&log_lock);
         return PM3_ESOFT;
     }
 
+    // the workers only test keys, progress, checkpoints and the keyboard are handled here
+    uint64_t start_time = msclock();
+    uint64_t last_print = start_time;
+    uint64_t last_save = start_time;
+    while (__atomic_load_n(&ctx.running, __ATOMIC_ACQUIRE) > 0) {
+
+        msleep(100);
+
+        if (kbd_enter_pressed()) {
+            __atomic_store_n(&ctx.aborted, true, __ATOMIC_RELAXED);
+        }
+
+        uint64_t now = msclock();
+        if (now - last_print >= 1000) {
+            last_print = now;
+            legbrute_print_progress(job, tested_before, __atomic_load_n(&ctx.tested, __ATOMIC_RELAXED), now - start_time);
+        }
+
+        if (now - last_save >= (uint64_t)interval * 1000) {
+            last_save = now;
+            legbrute_save(fn, job);
+        }
+    }
+
     for (int i = 0; i < thread_count; i++) {
         pthread_join(tids[i], NULL);
     }
-    pthread_mutex_destroy(&log_lock);
 
-    if (debug) {
+    job->found = ctx.found;
+    legbrute_save(fn, job);
+    PrintAndLogEx(NORMAL, "");
+
+    if (ctx.found) {
+        legbrute_print_key(job->key);
+        PrintAndLogEx(INFO, "Done!");
         PrintAndLogEx(NORMAL, "");
-        PrintAndLogEx(INFO, "Index range summary (%d threads, keyspace 2^40 = %" PRIu64 "):", thread_count, (uint64_t)1 << 40);
-        PrintAndLogEx(INFO, "  Thread  start                end                  slice size");
-        for (int i = 0; i < thread_count; i++) {
-            PrintAndLogEx(INFO, "  [%2d]    %-20" PRIu64 " %-20" PRIu64 " %" PRIu64
-                          , i
-                          , args[i].index_start
-                          , args[i].index_end
-                          , args[i].index_end - args[i].index_start);
-        }
-        // Verify ranges are contiguous and non-overlapping
-        bool ok = true;
-        for (int i = 1; i < thread_count; i++) {
-            if (args[i].index_start != args[i - 1].index_end) {
-                PrintAndLogEx(WARNING, _RED_("  Gap or overlap between thread %d and %d!"), i - 1, i);
-                ok = false;
-            }
-        }
-        if (ok) {
-            PrintAndLogEx(SUCCESS, _GREEN_("  Ranges are contiguous and non-overlapping"));
-        }
         return PM3_SUCCESS;
     }
 
-    if (aborted) {
-        uint64_t resume_millions = aborted_at / 1000000;
-        PrintAndLogEx(NORMAL, "");
+    if (ctx.aborted) {
         PrintAndLogEx(WARNING, "aborted via keyboard!");
-        PrintAndLogEx(HINT, "Hint: resume with " _YELLOW_("--index %" PRIu64 " --threads %d"), resume_millions, thread_count);
+        PrintAndLogEx(HINT, "Hint: resume with `" _YELLOW_("hf iclass legbrute -f %s") "`", fn);
         return PM3_EOPABORTED;
     }
 
-    if (found == false) {
+    PrintAndLogEx(WARNING, "Key not found in work unit %u/%u", job->unit, job->units);
+    if (job->units > 1) {
+        PrintAndLogEx(HINT, "Hint: collect the checkpoint files of all units and run `" _YELLOW_("hf iclass legbrute --merge -f <fn> -f <fn> ...") "`");
+    }
+    return PM3_ESOFT;
+}
+
+// HF iClass legbrute - report progress and found key over the checkpoint files of all work units
+static int CmdHFiClassLegBrute_Merge(char *const *files, uint32_t count) {
+
+    if (count < 1 || count > LEGBRUTE_MAX_FILES) {
+        PrintAndLogEx(ERR, "Merge takes 1 to %d checkpoint files", LEGBRUTE_MAX_FILES);
+        return PM3_EINVARG;
+    }
+
+    legbrute_job_t *jobs = calloc(count, sizeof(legbrute_job_t));
+    if (jobs == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    int res = PM3_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        res = legbrute_load(files[i], &jobs[i]);
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+        if (legbrute_same_job(&jobs[0], &jobs[i]) == false) {
+            PrintAndLogEx(ERR, _YELLOW_("%s") " belongs to a different job than " _YELLOW_("%s"), files[i], files[0]);
+            res = PM3_EINVARG;
+            break;
+        }
+    }
+
+    if (res != PM3_SUCCESS) {
+        goto out;
+    }
+
+    PrintAndLogEx(INFO, "Job pk " _YELLOW_("%s") ", %u work units", sprint_hex_inrow(jobs[0].pk, 8), jobs[0].units);
+    PrintAndLogEx(INFO, "  Unit       tested (M)     progress  file");
+
+    int found = -1;
+    uint64_t tested = 0;
+    uint32_t complete = 0;
+    for (uint32_t i = 0; i < count; i++) {
+
+        uint64_t n = legbrute_tested(&jobs[i]);
+        uint64_t unit_size = jobs[i].unit_end - jobs[i].unit_start;
+        PrintAndLogEx(INFO, "  %4u/%-4u  %-14" PRIu64 " %6.2f %%  %s%s"
+                      , jobs[i].unit
+                      , jobs[i].units
+                      , n / 1000000
+                      , (double)n * 100.0 / (double)unit_size
+                      , files[i]
+                      , jobs[i].found ? _GREEN_("  key found") : "");
+
+        if (jobs[i].found && found < 0) {
+            found = i;
+        }
+
+        // the same unit can show up twice, e.g. an old copy of a checkpoint, only count the best one
+        bool dup = false;
+        for (uint32_t j = 0; j < count; j++) {
+            if (j != i && jobs[j].unit == jobs[i].unit) {
+                uint64_t m = legbrute_tested(&jobs[j]);
+                if (m > n || (m == n && j < i)) {
+                    dup = true;
+                    break;
+                }
+            }
+        }
+        if (dup) {
+            continue;
+        }
+
+        tested += n;
+        if (n == unit_size) {
+            complete++;
+        }
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "Tested " _YELLOW_("%" PRIu64) "M / %" PRIu64 "M keys, " _YELLOW_("%u") " of %u units complete"
+                  , tested / 1000000
+                  , LEGBRUTE_KEYSPACE / 1000000
+                  , complete
+                  , jobs[0].units);
+
+    if (found >= 0) {
+        PrintAndLogEx(INFO, "Work unit %u/%u has the key", jobs[found].unit, jobs[found].units);
+        legbrute_print_key(jobs[found].key);
+        res = PM3_SUCCESS;
+    } else if (complete == jobs[0].units) {
         PrintAndLogEx(WARNING, "Key not found in the given keyspace");
+        res = PM3_ESOFT;
+    } else {
+        PrintAndLogEx(INFO, "Key not found yet, %u work unit(s) missing or unfinished", jobs[0].units - complete);
+        res = PM3_ESOFT;
     }
 
-    return found ? PM3_SUCCESS : PM3_ESOFT;
+out:
+    for (uint32_t i = 0; i < count; i++) {
+        free(jobs[i].done);
+    }
+    free(jobs);
+    return res;
 }
 
 // CmdHFiClassLegBrute function with CLI and multithreading support
@@ -6333,18 +6720,27 @@ static int CmdHFiClassLegBrute(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf iclass legbrute",
                   "This command takes sniffed trace data and a partial raw key and bruteforces the remaining 40 bits of the raw key.\n"
-                  "Complete 40 bit keyspace is 1'099'511'627'776.",
-                  "hf iclass legbrute --epurse feffffffffffffff --macs1 1306cad9b6c24466 --macs2 f0bf905e35f97923 --pk B4F12AADC5301225");
+                  "Complete 40 bit keyspace is 1'099'511'627'776.\n"
+                  "Progress is saved to a checkpoint file and a run restarted with the same file resumes where it stopped.\n"
+                  "With `--workunit i/N` independent machines each take one slice of the keyspace, `--merge` reports over their files.",
+                  "hf iclass legbrute --epurse feffffffffffffff --macs1 1306cad9b6c24466 --macs2 f0bf905e35f97923 --pk B4F12AADC5301225\n"
+                  "hf iclass legbrute --epurse feffffffffffffff --macs1 1306cad9b6c24466 --macs2 f0bf905e35f97923 --pk B4F12AADC5301225 --workunit 2/4\n"
+                  "hf iclass legbrute -f iclass_legbrute_B4F12AADC5301225_2of4.json       -> resume a run\n"
+                  "hf iclass legbrute --merge -f unit1.json -f unit2.json -f unit3.json -f unit4.json");
 
     void *argtable[] = {
         arg_param_begin,
-        arg_str1(NULL, "epurse", "<hex>", "Specify ePurse as 8 hex bytes"),
-        arg_str1(NULL, "macs1", "<hex>", "MACs captured from the reader"),
-        arg_str1(NULL, "macs2", "<hex>", "MACs captured from the reader, different than the first set (with the same csn and epurse value)"),
-        arg_str1(NULL, "pk", "<hex>", "Partial Key from legrec or starting key of keyblock from legbrute"),
+        arg_str0(NULL, "epurse", "<hex>", "Specify ePurse as 8 hex bytes"),
+        arg_str0(NULL, "macs1", "<hex>", "MACs captured from the reader"),
+        arg_str0(NULL, "macs2", "<hex>", "MACs captured from the reader, different than the first set (with the same csn and epurse value)"),
+        arg_str0(NULL, "pk", "<hex>", "Partial Key from legrec or starting key of keyblock from legbrute"),
         arg_int0(NULL, "index", "<dec>", "Where to start from to retrieve the key, default 0 - value in millions e.g. 1 is 1 million"),
         arg_int0(NULL, "threads", "<dec>", "Number of threads to use, by default it uses the cpu's max threads."),
-        arg_lit0(NULL, "dbg",    "Print first 2 key candidates and midpoint per thread, then exit (use to verify thread partitioning)"),
+        arg_lit0(NULL, "dbg",    "Print first 2 key candidates per thread chunk, the unit midpoint and the unit split, then exit"),
+        arg_strn("f", "file", "<fn>", 0, LEGBRUTE_MAX_FILES, "Checkpoint file, resumed when it exists (def: iclass_legbrute_<pk>_<i>of<N>.json)"),
+        arg_str0(NULL, "workunit", "<i/N>", "Only bruteforce unit i of N equal slices of the keyspace (def: 1/1)"),
+        arg_int0(NULL, "interval", "<sec>", "Seconds between checkpoint saves (def: 60)"),
+        arg_lit0(NULL, "merge", "Report progress and found key over the checkpoint files of all work units"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -6369,29 +6765,158 @@ static int CmdHFiClassLegBrute(const char *Cmd) {
     index *= 1000000;
     int threads = arg_get_int_def(ctx, 6, num_CPUs());
     bool debug = arg_get_lit(ctx, 7);
+
+    struct arg_str *file_args = arg_get_str(ctx, 8);
+    int fncount = file_args->count;
+    char *fns[LEGBRUTE_MAX_FILES] = {0};
+    for (int i = 0; i < fncount; i++) {
+        fns[i] = calloc(FILE_PATH_SIZE, sizeof(char));
+        if (fns[i]) {
+            legbrute_filename(file_args->sval[i], fns[i], FILE_PATH_SIZE);
+        }
+    }
+
+    uint32_t unit = 1, units = 1;
+    bool have_workunit = (arg_get_str(ctx, 9)->count > 0);
+    int unit_res = 2;
+    if (have_workunit) {
+        // %n only counts when the whole string was consumed
+        int end = 0;
+        const char *wu = arg_get_str(ctx, 9)->sval[0];
+        unit_res = sscanf(wu, "%u/%u%n", &unit, &units, &end);
+        if (unit_res == 2 && wu[end] != '\0') {
+            unit_res = 0;
+        }
+    }
+
+    int interval = arg_get_int_def(ctx, 10, 60);
+    bool merge = arg_get_lit(ctx, 11);
     CLIParserFree(ctx);
 
+    int res = PM3_EINVARG;
+    legbrute_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    for (int i = 0; i < fncount; i++) {
+        if (fns[i] == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            res = PM3_EMALLOC;
+            goto out;
+        }
+    }
+
+    if (merge) {
+        if (fncount == 0) {
+            PrintAndLogEx(ERR, "Specify the checkpoint files to merge with `-f`");
+            goto out;
+        }
+        res = CmdHFiClassLegBrute_Merge(fns, (uint32_t)fncount);
+        goto out;
+    }
+
+    if (fncount > 1) {
+        PrintAndLogEx(ERR, "Only one checkpoint file, unless merging");
+        goto out;
+    }
+
     if (epurse_len && epurse_len != PICOPASS_BLOCK_SIZE) {
         PrintAndLogEx(ERR, "ePurse is incorrect length");
-        return PM3_EINVARG;
+        goto out;
     }
 
     if (macs_len && macs_len != PICOPASS_BLOCK_SIZE) {
         PrintAndLogEx(ERR, "MAC1 is incorrect length");
-        return PM3_EINVARG;
+        goto out;
     }
 
     if (macs2_len && macs2_len != PICOPASS_BLOCK_SIZE) {
         PrintAndLogEx(ERR, "MAC2 is incorrect length");
-        return PM3_EINVARG;
+        goto out;
     }
 
     if (startingkey_len && startingkey_len != PICOPASS_BLOCK_SIZE) {
         PrintAndLogEx(ERR, "Partial Key is incorrect length");
-        return PM3_EINVARG;
+        goto out;
+    }
+
+    if (unit_res != 2 || units < 1 || units > LEGBRUTE_MAX_UNITS || unit < 1 || unit > units) {
+        PrintAndLogEx(ERR, "Work unit must be i/N with 1 <= i <= N <= %" PRIu64, LEGBRUTE_MAX_UNITS);
+        goto out;
     }
 
-    return CmdHFiClassLegBrute_MT(epurse, macs, macs2, startingKey, index, threads, debug);
+    if (interval < 1) {
+        PrintAndLogEx(ERR, "Checkpoint interval must be at least 1 second");
+        goto out;
+    }
+
+    bool have_params = epurse_len && macs_len && macs2_len && startingkey_len;
+
+    char fn[FILE_PATH_SIZE] = {0};
+    if (fncount) {
+        strncpy(fn, fns[0], sizeof(fn) - 1);
+    } else if (have_params) {
+        char name[64];
+        snprintf(name, sizeof(name), "iclass_legbrute_%s_%uof%u.json", sprint_hex_inrow(startingKey, 8), unit, units);
+        legbrute_filename(name, fn, sizeof(fn));
+    }
+
+    legbrute_job_t cli_job;
+    memset(&cli_job, 0, sizeof(cli_job));
+    memcpy(cli_job.epurse, epurse, PICOPASS_BLOCK_SIZE);
+    memcpy(cli_job.macs1, macs, PICOPASS_BLOCK_SIZE);
+    memcpy(cli_job.macs2, macs2, PICOPASS_BLOCK_SIZE);
+    memcpy(cli_job.pk, startingKey, PICOPASS_BLOCK_SIZE);
+    cli_job.index = index;
+    cli_job.units = units;
+
+    if (fn[0] && fileExists(fn)) {
+
+        res = legbrute_load(fn, &job);
+        if (res != PM3_SUCCESS) {
+            goto out;
+        }
+
+        res = PM3_EINVARG;
+        if (have_params && legbrute_same_job(&job, &cli_job) == false) {
+            PrintAndLogEx(ERR, "Checkpoint file " _YELLOW_("%s") " was made with other parameters", fn);
+            goto out;
+        }
+
+        if (have_workunit && job.unit != unit) {
+            PrintAndLogEx(ERR, "Checkpoint file " _YELLOW_("%s") " is for work unit %u/%u", fn, job.unit, job.units);
+            goto out;
+        }
+
+        PrintAndLogEx(SUCCESS, "Loaded checkpoint " _YELLOW_("%s"), fn);
+
+        if (job.found) {
+            legbrute_print_key(job.key);
+            res = PM3_SUCCESS;
+            goto out;
+        }
+
+    } else {
+
+        if (have_params == false) {
+            PrintAndLogEx(ERR, "Specify `--epurse`, `--macs1`, `--macs2` and `--pk`, or an existing checkpoint file");
+            goto out;
+        }
+
+        job = cli_job;
+        res = legbrute_job_init(&job, unit, units);
+        if (res != PM3_SUCCESS) {
+            goto out;
+        }
+    }
+
+    res = CmdHFiClassLegBrute_MT(&job, fn, threads, interval, debug);
+
+out:
+    free(job.done);
+    for (int i = 0; i < fncount; i++) {
+        free(fns[i]);
+    }
+    return res;
 }
 
 static void generate_single_key_block_inverted_opt(const uint8_t *startingKey, uint32_t index, uint8_t *keyBlock) {
@@ -6923,7 +7448,9 @@ static int CmdHFiClassLookUp(const char *Cmd) {
     }
 
     PrintAndLogEx(INFO, "Generating diversified keys...");
+    uint64_t t_gen = msclock();
     GenerateMacKeyFrom(csn, CCNR, use_raw, use_elite, keyBlock, keycount, prekey);
+    print_premac_rate(keycount, msclock() - t_gen);
 
     if (use_elite) {
         PrintAndLogEx(INFO, "Using " _YELLOW_("elite algo"));
@@ -6960,160 +7487,117 @@ static int CmdHFiClassLookUp(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// Keys are handed out in chunks from a shared cursor and each thread only writes
+// the list entries of its own chunks. Diversification and MAC keep their state on
+// the stack, so no lock is needed. A chunk is one bitsliced MAC pass.
+#define ICLASS_PREMAC_CHUNK ICLASS_BS_LANES
+
 typedef struct {
-    uint8_t thread_idx;
-    uint8_t use_raw;
-    uint8_t use_elite;
+    bool use_raw;
+    bool use_elite;
     uint32_t keycnt;
     uint8_t csn[PICOPASS_BLOCK_SIZE];
     uint8_t cc_nr[12];
     uint8_t *keys;
-    union {
-        iclass_premac_t *premac;
-        iclass_prekey_t *prekey;
-    } list;
-} PACKED iclass_thread_arg_t;
-
-static size_t iclass_tc = 1;
+    iclass_premac_t *premac;
+    iclass_prekey_t *prekey;
+    uint32_t next;
+} iclass_premac_job_t;
 
-static pthread_mutex_t generator_mutex = PTHREAD_MUTEX_INITIALIZER;
-static void *bf_generate_mac(void *thread_arg) {
+static void *iclass_premac_worker(void *thread_arg) {
 
-    iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
-    const uint8_t idx = targ->thread_idx;
-    const uint8_t use_raw = targ->use_raw;
-    const uint8_t use_elite = targ->use_elite;
-    const uint32_t keycnt = targ->keycnt;
-
-    uint8_t *keys = targ->keys;
-    iclass_premac_t *list = targ->list.premac;
+    iclass_premac_job_t *job = (iclass_premac_job_t *)thread_arg;
 
     uint8_t csn[PICOPASS_BLOCK_SIZE];
     uint8_t cc_nr[12];
-    memcpy(csn, targ->csn, sizeof(csn));
-    memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
-
-    uint8_t key[PICOPASS_BLOCK_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-    uint8_t div_key[PICOPASS_BLOCK_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    memcpy(csn, job->csn, sizeof(csn));
+    memcpy(cc_nr, job->cc_nr, sizeof(cc_nr));
 
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
+    uint8_t div_keys[ICLASS_PREMAC_CHUNK * PICOPASS_BLOCK_SIZE];
+    uint8_t macs[ICLASS_PREMAC_CHUNK * 4];
 
-        memcpy(key, keys + 8 * i, PICOPASS_BLOCK_SIZE);
+    for (;;) {
+        uint32_t first = __atomic_fetch_add(&job->next, ICLASS_PREMAC_CHUNK, __ATOMIC_RELAXED);
+        if (first >= job->keycnt) {
+            break;
+        }
+        uint32_t n = MIN(ICLASS_PREMAC_CHUNK, job->keycnt - first);
 
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw) {
-            memcpy(div_key, key, PICOPASS_BLOCK_SIZE);
+        uint8_t *keys = job->keys + (first * PICOPASS_BLOCK_SIZE);
+        if (job->use_raw) {
+            memcpy(div_keys, keys, n * PICOPASS_BLOCK_SIZE);
         } else {
-            HFiClassCalcDivKey(csn, key, div_key, use_elite);
+            for (uint32_t i = 0; i < n; i++) {
+                HFiClassCalcDivKey(csn, keys + (i * PICOPASS_BLOCK_SIZE), div_keys + (i * PICOPASS_BLOCK_SIZE), job->use_elite);
+            }
         }
 
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+        doMAC_batch(cc_nr, div_keys, n, macs, ICLASS_CIPHER_AUTO);
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (job->prekey) {
+                memcpy(job->prekey[first + i].key, keys + (i * PICOPASS_BLOCK_SIZE), PICOPASS_BLOCK_SIZE);
+                memcpy(job->prekey[first + i].mac, macs + (i * 4), 4);
+            } else {
+                memcpy(job->premac[first + i].mac, macs + (i * 4), 4);
+            }
+        }
     }
     return NULL;
 }
 
-// precalc diversified keys and their MAC
-void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
-
-    pthread_mutex_init(&generator_mutex, NULL);
+static void iclass_premac_run(iclass_premac_job_t *job) {
 
-    iclass_tc = num_CPUs();
-    pthread_t threads[iclass_tc];
-    iclass_thread_arg_t args[iclass_tc];
-    // init thread arguments
-    for (size_t i = 0; i < iclass_tc; i++) {
-        args[i].thread_idx = i;
-        args[i].use_raw = use_raw;
-        args[i].use_elite = use_elite;
-        args[i].keycnt = keycnt;
-        args[i].keys = keys;
-        args[i].list.premac = list;
-
-        memcpy(args[i].csn, CSN, sizeof(args[i].csn));
-        memcpy(args[i].cc_nr, CCNR, sizeof(args[i].cc_nr));
+    size_t chunks = (job->keycnt + ICLASS_PREMAC_CHUNK - 1) / ICLASS_PREMAC_CHUNK;
+    size_t thread_count = MIN((size_t)num_CPUs(), chunks);
+    if (thread_count < 1) {
+        thread_count = 1;
     }
 
-    for (int i = 0; i < iclass_tc; i++) {
-        int res = pthread_create(&threads[i], NULL, bf_generate_mac, (void *)&args[i]);
-        if (res) {
-            PrintAndLogEx(NORMAL, "");
-            PrintAndLogEx(WARNING, "Failed to create pthreads. Quitting");
-            return;
+    job->next = 0;
+
+    // the calling thread is one of the workers
+    pthread_t threads[thread_count];
+    size_t started = 0;
+    for (size_t i = 1; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, iclass_premac_worker, (void *)job)) {
+            break;
         }
+        started++;
     }
 
-    for (int i = 0; i < iclass_tc; i++) {
+    iclass_premac_worker(job);
+
+    for (size_t i = 0; i < started; i++) {
         pthread_join(threads[i], NULL);
     }
 }
 
-static void *bf_generate_mackey(void *thread_arg) {
-
-    iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
-    const uint8_t idx = targ->thread_idx;
-    const uint8_t use_raw = targ->use_raw;
-    const uint8_t use_elite = targ->use_elite;
-    const uint32_t keycnt = targ->keycnt;
-
-    uint8_t *keys = targ->keys;
-    iclass_prekey_t *list = targ->list.prekey;
-
-    uint8_t csn[PICOPASS_BLOCK_SIZE];
-    uint8_t cc_nr[12];
-    memcpy(csn, targ->csn, sizeof(csn));
-    memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
-
-    uint8_t div_key[PICOPASS_BLOCK_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
-
-        memcpy(list[i].key, keys + 8 * i, PICOPASS_BLOCK_SIZE);
-
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw) {
-            memcpy(div_key, list[i].key, PICOPASS_BLOCK_SIZE);
-        } else {
-            HFiClassCalcDivKey(csn, list[i].key, div_key, use_elite);
-        }
-
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
-    }
-    return NULL;
+// precalc diversified keys and their MAC
+void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
+    iclass_premac_job_t job = {
+        .use_raw = use_raw,
+        .use_elite = use_elite,
+        .keycnt = keycnt,
+        .keys = keys,
+        .premac = list,
+    };
+    memcpy(job.csn, CSN, sizeof(job.csn));
+    memcpy(job.cc_nr, CCNR, sizeof(job.cc_nr));
+    iclass_premac_run(&job);
 }
 
 void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_prekey_t *list) {
-
-    pthread_mutex_init(&generator_mutex, NULL);
-    iclass_tc = num_CPUs();
-    pthread_t threads[iclass_tc];
-    iclass_thread_arg_t args[iclass_tc];
-    // init thread arguments
-    for (size_t i = 0; i < iclass_tc; i++) {
-        args[i].thread_idx = i;
-        args[i].use_raw = use_raw;
-        args[i].use_elite = use_elite;
-        args[i].keycnt = keycnt;
-        args[i].keys = keys;
-        args[i].list.prekey = list;
-
-        memcpy(args[i].csn, CSN, sizeof(args[i].csn));
-        memcpy(args[i].cc_nr, CCNR, sizeof(args[i].cc_nr));
-    }
-
-    for (size_t i = 0; i < iclass_tc; i++) {
-        int res = pthread_create(&threads[i], NULL, bf_generate_mackey, (void *)&args[i]);
-        if (res) {
-            PrintAndLogEx(NORMAL, "");
-            PrintAndLogEx(WARNING, "Failed to create pthreads. Quitting");
-            return;
-        }
-    }
-
-    for (int i = 0; i < iclass_tc; i++) {
-        pthread_join(threads[i], NULL);
-    }
+    iclass_premac_job_t job = {
+        .use_raw = use_raw,
+        .use_elite = use_elite,
+        .keycnt = keycnt,
+        .keys = keys,
+        .prekey = list,
+    };
+    memcpy(job.csn, CSN, sizeof(job.csn));
+    memcpy(job.cc_nr, CCNR, sizeof(job.cc_nr));
+    iclass_premac_run(&job);
 }
 
 // print diversified keys
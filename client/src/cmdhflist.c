@@ -21,6 +21,7 @@
 #include <inttypes.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "commonutil.h"  // ARRAYLEN
 #include "mifare/mifarehost.h"
@@ -32,6 +33,7 @@
 #include "cmdhficlass.h"
 #include "mifare/mifaredefault.h"  // mifare consts
 #include "cmdhfseos.h"
+#include "util.h"           // num_CPUs
 
 enum MifareAuthSeq {
     masNone,
@@ -54,6 +56,33 @@ void ClearAuthData(void) {
     AuthData.ks3 = 0;
 }
 
+// keys recovered while decoding a trace, tried first on the next auth of the same UID
+#define MF_TRACE_KEY_CACHE  64
+
+typedef struct {
+    uint32_t uid;
+    uint64_t key;
+} mf_trace_key_t;
+
+static mf_trace_key_t gs_mf_trace_keys[MF_TRACE_KEY_CACHE];
+static uint32_t gs_mf_trace_keys_count = 0;
+
+void ClearTraceKeyCache(void) {
+    gs_mf_trace_keys_count = 0;
+}
+
+static void mf_trace_key_add(uint32_t uid, uint64_t key) {
+    uint32_t n = MIN(gs_mf_trace_keys_count, MF_TRACE_KEY_CACHE);
+    for (uint32_t i = 0; i < n; i++) {
+        if (gs_mf_trace_keys[i].uid == uid && gs_mf_trace_keys[i].key == key) {
+            return;
+        }
+    }
+    // oldest entry goes when full
+    gs_mf_trace_keys[gs_mf_trace_keys_count % MF_TRACE_KEY_CACHE] = (mf_trace_key_t) { .uid = uid, .key = key };
+    gs_mf_trace_keys_count++;
+}
+
 
 static int gs_ntag_i2c_state = 0;
 static int gs_mfuc_state = 0;
@@ -2338,6 +2367,145 @@ static void mf_get_paritybinstr(char *s, uint32_t val, uint8_t par) {
     s[0] = '\0';
 }
 
+// Key trial against an encrypted (nested) auth and the first command after it.
+// Only reads its arguments, so it can run on several threads.
+static bool mf_nested_key_match(uint64_t key, const AuthData_t *ad, const uint8_t *cmd, uint8_t cmdsize, const uint8_t *parity, uint32_t *nt) {
+    struct Crypto1State s;
+    crypto1_init(&s, key);
+
+    uint32_t nt1 = crypto1_word(&s, ad->nt_enc ^ ad->uid, 1) ^ ad->nt_enc;
+    uint32_t ar = prng_successor(nt1, 64);
+
+    crypto1_word(&s, ad->nr_enc, 1);
+    if ((crypto1_word(&s, 0, 0) ^ ad->ar_enc) != ar) {
+        return false;
+    }
+
+    uint32_t at = prng_successor(ar, 32);
+    if ((crypto1_word(&s, 0, 0) ^ ad->at_enc) != at) {
+        return false;
+    }
+
+    if (NTParityChk(ad, nt1) == false) {
+        return false;
+    }
+
+    uint8_t buf[32] = {0};
+    memcpy(buf, cmd, cmdsize);
+    mf_crypto1_decrypt(&s, buf, cmdsize, 0);
+
+    if (CheckCrypto1Parity(cmd, cmdsize, buf, parity) == false) {
+        return false;
+    }
+
+    if (check_crc(CRC_14443_A, buf, cmdsize) == false) {
+        return false;
+    }
+
+    *nt = nt1;
+    return true;
+}
+
+// Tag nonce trial for a nested auth against a weak prng card
+static bool mf_nested_nt_match(uint32_t ntx, const AuthData_t *ad, const uint8_t *cmd, uint8_t cmdsize, const uint8_t *parity) {
+
+    if (NTParityChk(ad, ntx) == false) {
+        return false;
+    }
+
+    uint32_t ks2 = ad->ar_enc ^ prng_successor(ntx, 64);
+    uint32_t ks3 = ad->at_enc ^ prng_successor(ntx, 96);
+    struct Crypto1State *pcs = lfsr_recovery64(ks2, ks3);
+    if (pcs == NULL) {
+        return false;
+    }
+
+    uint8_t buf[32] = {0};
+    memcpy(buf, cmd, cmdsize);
+    mf_crypto1_decrypt(pcs, buf, cmdsize, 0);
+    crypto1_destroy(pcs);
+
+    return CheckCrypto1Parity(cmd, cmdsize, buf, parity) && check_crc(CRC_14443_A, buf, cmdsize);
+}
+
+#define MF_TRIAL_CHUNK  64
+
+typedef struct {
+    const AuthData_t *ad;
+    const uint8_t *cmd;
+    uint8_t cmdsize;
+    const uint8_t *parity;
+    const uint64_t *keys;   // dictionary trial, or NULL for tag nonce trial
+    uint32_t ntx;           // tag nonce trial, candidate i is ntx advanced i + 1 steps
+    uint32_t count;
+    uint32_t next;
+    uint32_t found;         // lowest matching candidate, count if none
+} mf_trial_t;
+
+static void mf_trial_found(mf_trial_t *t, uint32_t i) {
+    uint32_t cur = __atomic_load_n(&t->found, __ATOMIC_RELAXED);
+    while (i < cur && __atomic_compare_exchange_n(&t->found, &cur, i, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false) {}
+}
+
+static void *mf_trial_worker(void *arg) {
+    mf_trial_t *t = (mf_trial_t *)arg;
+
+    for (;;) {
+        uint32_t i = __atomic_fetch_add(&t->next, MF_TRIAL_CHUNK, __ATOMIC_RELAXED);
+        // chunks are handed out in order, nothing below the current hit is left
+        if (i >= t->count || i >= __atomic_load_n(&t->found, __ATOMIC_RELAXED)) {
+            break;
+        }
+
+        uint32_t end = MIN(i + MF_TRIAL_CHUNK, t->count);
+        uint32_t ntx = (t->keys) ? 0 : prng_successor(t->ntx, i + 1);
+
+        for (; i < end; i++) {
+            bool hit;
+            if (t->keys) {
+                uint32_t nt;
+                hit = mf_nested_key_match(t->keys[i], t->ad, t->cmd, t->cmdsize, t->parity, &nt);
+            } else {
+                hit = mf_nested_nt_match(ntx, t->ad, t->cmd, t->cmdsize, t->parity);
+                ntx = prng_successor(ntx, 1);
+            }
+            if (hit) {
+                mf_trial_found(t, i);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Same result as trying the candidates one by one in order, on all CPUs.
+// Returns index of first matching candidate, or count if none
+static uint32_t mf_trial_run(mf_trial_t *t) {
+    t->next = 0;
+    t->found = t->count;
+
+    int num_threads = MIN((uint32_t)num_CPUs(), (t->count + MF_TRIAL_CHUNK - 1) / MF_TRIAL_CHUNK);
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    pthread_t threads[num_threads];
+    int started = 0;
+    for (int i = 1; i < num_threads; i++) {
+        if (pthread_create(&threads[started], NULL, mf_trial_worker, t) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    mf_trial_worker(t);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return t->found;
+}
+
 bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen, const uint64_t *dicKeys, uint32_t dicKeysCount) {
     static struct Crypto1State *traceCrypto1;
 
@@ -2369,6 +2537,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
                           validate_prng_nonce(AuthData.nt) ? _GREEN_("WEAK") : _YELLOW_("HARD"));
 
             AuthData.first_auth = false;
+            mf_trace_key_add(AuthData.uid, mfLastKey);
 
             traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
         } else {
@@ -2377,55 +2546,70 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
                 traceCrypto1 = NULL;
             }
 
+            // keys already found for this card
+            uint32_t n = MIN(gs_mf_trace_keys_count, MF_TRACE_KEY_CACHE);
+            for (uint32_t i = 0; i < n && traceCrypto1 == NULL; i++) {
+                const mf_trace_key_t *k = &gs_mf_trace_keys[(gs_mf_trace_keys_count - 1 - i) % MF_TRACE_KEY_CACHE];
+                if (k->uid == AuthData.uid && NestedCheckKey(k->key, &AuthData, cmd, cmdsize, parity)) {
+                    PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "cached key", k->key);
+                    mfLastKey = k->key;
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
+                }
+            }
+
             // check last used key
-            if (mfLastKey) {
+            if (!traceCrypto1 && mfLastKey) {
                 if (NestedCheckKey(mfLastKey, &AuthData, cmd, cmdsize, parity)) {
                     PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "last used key", mfLastKey);
+                    mf_trace_key_add(AuthData.uid, mfLastKey);
                     traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 };
             }
 
             // check default keys
             if (!traceCrypto1 && dicKeys != NULL && dicKeysCount > 0) {
-                for (int i = 0; i < dicKeysCount; i++) {
-                    if (NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
-                        PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
+                mf_trial_t t = {
+                    .ad = &AuthData,
+                    .cmd = cmd,
+                    .cmdsize = cmdsize,
+                    .parity = parity,
+                    .keys = dicKeys,
+                    .count = dicKeysCount,
+                };
+                uint32_t i = mf_trial_run(&t);
+                if (i < dicKeysCount && NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
+                    PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
 
-                        mfLastKey = dicKeys[i];
-                        traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-                        break;
-                    };
+                    mfLastKey = dicKeys[i];
+                    mf_trace_key_add(AuthData.uid, mfLastKey);
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 }
             }
 
             // nested
             if (!traceCrypto1 && validate_prng_nonce(AuthData.nt)) {
-                uint32_t ntx = prng_successor(AuthData.nt, 90);
-                for (int i = 0; i < 16383; i++) {
-                    ntx = prng_successor(ntx, 1);
-                    if (NTParityChk(&AuthData, ntx)) {
+                mf_trial_t t = {
+                    .ad = &AuthData,
+                    .cmd = cmd,
+                    .cmdsize = cmdsize,
+                    .parity = parity,
+                    .ntx = prng_successor(AuthData.nt, 90),
+                    .count = 16383,
+                };
+                uint32_t i = mf_trial_run(&t);
+                if (i < t.count) {
+                    uint32_t ntx = prng_successor(t.ntx, i + 1);
+                    AuthData.ks2 = AuthData.ar_enc ^ prng_successor(ntx, 64);
+                    AuthData.ks3 = AuthData.at_enc ^ prng_successor(ntx, 96);
+                    AuthData.nt = ntx;
+                    mfLastKey = GetCrypto1ProbableKey(&AuthData);
+                    mf_trace_key_add(AuthData.uid, mfLastKey);
+                    PrintAndLogEx(NORMAL, "            |            |  *  | nested probable key: " _GREEN_("%012" PRIX64) "     ks2:%08x ks3:%08x |     |",
+                                  mfLastKey,
+                                  AuthData.ks2,
+                                  AuthData.ks3);
 
-                        uint32_t ks2 = AuthData.ar_enc ^ prng_successor(ntx, 64);
-                        uint32_t ks3 = AuthData.at_enc ^ prng_successor(ntx, 96);
-                        struct Crypto1State *pcs = lfsr_recovery64(ks2, ks3);
-                        memcpy(mfData, cmd, cmdsize);
-                        mf_crypto1_decrypt(pcs, mfData, cmdsize, 0);
-                        crypto1_destroy(pcs);
-
-                        if (CheckCrypto1Parity(cmd, cmdsize, mfData, parity) && check_crc(CRC_14443_A, mfData, cmdsize)) {
-                            AuthData.ks2 = ks2;
-                            AuthData.ks3 = ks3;
-                            AuthData.nt = ntx;
-                            mfLastKey = GetCrypto1ProbableKey(&AuthData);
-                            PrintAndLogEx(NORMAL, "            |            |  *  | nested probable key: " _GREEN_("%012" PRIX64) "     ks2:%08x ks3:%08x |     |",
-                                          mfLastKey,
-                                          AuthData.ks2,
-                                          AuthData.ks3);
-
-                            traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-                            break;
-                        }
-                    }
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 }
             }
 
@@ -2492,7 +2676,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
     return *mfDataLen > 0;
 }
 
-bool NTParityChk(AuthData_t *ad, uint32_t ntx) {
+bool NTParityChk(const AuthData_t *ad, uint32_t ntx) {
     if (
         (oddparity8(ntx >> 8 & 0xff) ^ (ntx & 0x01) ^ ((ad->nt_enc_par >> 5) & 0x01) ^ (ad->nt_enc & 0x01)) ||
         (oddparity8(ntx >> 16 & 0xff) ^ (ntx >> 8 & 0x01) ^ ((ad->nt_enc_par >> 6) & 0x01) ^ (ad->nt_enc >> 8 & 0x01)) ||
@@ -2521,40 +2705,18 @@ bool NTParityChk(AuthData_t *ad, uint32_t ntx) {
 }
 
 bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity) {
-    uint8_t buf[32] = {0};
-    struct Crypto1State *pcs;
 
     AuthData.ks2 = 0;
     AuthData.ks3 = 0;
 
-    pcs = crypto1_create(key);
-    uint32_t nt1 = crypto1_word(pcs, ad->nt_enc ^ ad->uid, 1) ^ ad->nt_enc;
-    uint32_t ar = prng_successor(nt1, 64);
-    uint32_t at = prng_successor(nt1, 96);
-
-    crypto1_word(pcs, ad->nr_enc, 1);
-//   uint32_t nr1 = crypto1_word(pcs, ad->nr_enc, 1) ^ ad->nr_enc;  // if needs deciphered nr
-    uint32_t ar1 = crypto1_word(pcs, 0, 0) ^ ad->ar_enc;
-    uint32_t at1 = crypto1_word(pcs, 0, 0) ^ ad->at_enc;
-
-    if (!(ar == ar1 && at == at1 && NTParityChk(ad, nt1))) {
-        crypto1_destroy(pcs);
+    uint32_t nt1 = 0;
+    if (mf_nested_key_match(key, ad, cmd, cmdsize, parity, &nt1) == false) {
         return false;
     }
 
-    memcpy(buf, cmd, cmdsize);
-    mf_crypto1_decrypt(pcs, buf, cmdsize, 0);
-    crypto1_destroy(pcs);
-
-    if (!CheckCrypto1Parity(cmd, cmdsize, buf, parity))
-        return false;
-
-    if (!check_crc(CRC_14443_A, buf, cmdsize))
-        return false;
-
     AuthData.nt = nt1;
-    AuthData.ks2 = AuthData.ar_enc ^ ar;
-    AuthData.ks3 = AuthData.at_enc ^ at;
+    AuthData.ks2 = AuthData.ar_enc ^ prng_successor(nt1, 64);
+    AuthData.ks3 = AuthData.at_enc ^ prng_successor(nt1, 96);
     return true;
 }
 
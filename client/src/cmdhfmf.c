@@ -18,6 +18,7 @@
 
 #include "cmdhfmf.h"
 #include <ctype.h>
+#include <pthread.h>
 
 #include "bruteforce.h"
 #include "cmdparser.h"             // command_t
@@ -46,6 +47,7 @@
 #include "generator.h"              // keygens.
 #include "fpga.h"
 #include "mifare/mifarehost.h"
+#include "mifare/mfkeydb.h"
 #include "crypto/originality.h"
 
 // Defines for Saflok parsing
@@ -1102,7 +1104,8 @@ static int mfc_read_tag(iso14a_card_select_t *card, uint8_t *carddata, uint8_t n
     return PM3_SUCCESS ;
 }
 
-static int mf_load_keys(uint8_t **pkeyBlock, uint32_t *pkeycnt, uint8_t *userkey, int userkeylen, const char *filename, int fnlen, bool load_default) {
+// fp, when set, puts the key database keys right after the user keys, best match for the card first
+static int mf_load_keys(uint8_t **pkeyBlock, uint32_t *pkeycnt, uint8_t *userkey, int userkeylen, const char *filename, int fnlen, bool load_default, mfkeydb_fp_t *fp) {
     // Handle Keys
     *pkeycnt = 0;
     *pkeyBlock = NULL;
@@ -1170,6 +1173,15 @@ static int mf_load_keys(uint8_t **pkeyBlock, uint32_t *pkeycnt, uint8_t *userkey
             free(keyBlock_tmp);
         }
     }
+
+    // Handle keys recovered on earlier cards, the key list is left as is on failure
+    if (fp != NULL) {
+        uint32_t userkeycnt = (userkeylen >= MIFARE_KEY_SIZE) ? userkeylen / MIFARE_KEY_SIZE : 0;
+        int res = mfkeydb_prepend(fp, pkeyBlock, pkeycnt, userkeycnt, NULL);
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(DEBUG, "key database not used ( %d )", res);
+        }
+    }
     return PM3_SUCCESS;
 }
 
@@ -2651,6 +2663,9 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "    hf mf hardnested -r --tk [known target key]\n"
                   "Add the known target key to check if it is present in the remaining key space\n"
                   "    hf mf hardnested --blk 0 -a -k A0A1A2A3A4A5 --tblk 4 --ta --tk FFFFFFFFFFFF\n"
+                  " \n"
+                  "`--cache` keeps the decompressed tables in `~/.proxmark3/hardnested_tables.bin`.\n"
+                  "It is used as long as the tables in the resources folder are unchanged\n"
                   ,
                   "hf mf hardnested --tblk 4 --ta     --> works for MFC EV1\n"
                   "hf mf hardnested --blk 0 -a -k FFFFFFFFFFFF --tblk 4 --ta\n"
@@ -2659,6 +2674,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "hf mf hardnested -r\n"
                   "hf mf hardnested -r --tk a0a1a2a3a4a5\n"
                   "hf mf hardnested -t --tk a0a1a2a3a4a5\n"
+                  "hf mf hardnested -t --tk a0a1a2a3a4a5 --cache   --> later runs map the tables instead of decompressing them\n"
                   "hf mf hardnested --blk 0 -a -k a0a1a2a3a4a5 --tblk 4 --ta --tk FFFFFFFFFFFF\n"
                  );
 
@@ -2678,6 +2694,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         arg_lit0("s",  "slow",           "Slower acquisition (required by some non standard cards)"),
         arg_lit0("t",  "tests",          "Run tests"),
         arg_lit0("w",  "wr",             "Acquire nonces and UID, and write them to file `hf-mf-<UID>-nonces.bin`"),
+        arg_lit0(NULL, "cache",          "Save the decompressed tables in the user folder for faster start (~500 MB)"),
 
         arg_lit0(NULL, "in", "None (use CPU regular instruction set)"),
 #if defined(COMPILER_HAS_SIMD_X86)
@@ -2738,19 +2755,20 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     bool slow = arg_get_lit(ctx, 12);
     bool tests = arg_get_lit(ctx, 13);
     bool nonce_file_write = arg_get_lit(ctx, 14);
+    bool table_cache = arg_get_lit(ctx, 15);
 
-    bool in = arg_get_lit(ctx, 15);
+    bool in = arg_get_lit(ctx, 16);
 #if defined(COMPILER_HAS_SIMD_X86)
-    bool im = arg_get_lit(ctx, 16);
-    bool is = arg_get_lit(ctx, 17);
-    bool ia = arg_get_lit(ctx, 18);
-    bool i2 = arg_get_lit(ctx, 19);
+    bool im = arg_get_lit(ctx, 17);
+    bool is = arg_get_lit(ctx, 18);
+    bool ia = arg_get_lit(ctx, 19);
+    bool i2 = arg_get_lit(ctx, 20);
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    bool i5 = arg_get_lit(ctx, 20);
+    bool i5 = arg_get_lit(ctx, 21);
 #endif
 #if defined(COMPILER_HAS_SIMD_NEON)
-    bool ie = arg_get_lit(ctx, 16);
+    bool ie = arg_get_lit(ctx, 17);
 #endif
     CLIParserFree(ctx);
 
@@ -2854,7 +2872,9 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   tests);
 
     uint64_t foundkey = 0;
+    hardnested_set_table_cache(table_cache);
     int16_t isOK = mfnestedhard(blockno, keytype, key, trg_blockno, trg_keytype, known_target_key ? trg_key : NULL, nonce_file_read, nonce_file_write, slow, tests, &foundkey, filename);
+    hardnested_set_table_cache(false);
     switch (isOK) {
         case PM3_ETIMEOUT :
             PrintAndLogEx(ERR, "Error: No response from Proxmark3\n");
@@ -2880,6 +2900,451 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     return isOK;
 }
 
+// tries one key on every sector key still unknown, hits are marked as reused
+static void mf_autopwn_try_key(sector_t *e_sector, uint8_t sector_cnt, uint8_t *key) {
+
+    // <!> The fast check --> mf_check_keys_fast(sector_cnt, true, true, 2, 1, key, e_sector, false, verbose);
+    // <!> Returns false keys, so we just stick to the slower mfchk.
+    for (int i = 0; i < sector_cnt; i++) {
+        for (int j = MF_KEY_A; j <= MF_KEY_B; j++) {
+            // Check if the sector key is already broken
+            if (e_sector[i].foundKey[j]) {
+                continue;
+            }
+
+            // Check if the key works
+            uint64_t key64 = 0;
+            if (mf_check_keys(mfFirstBlockOfSector(i), j, true, 1, key, &key64) == PM3_SUCCESS) {
+                e_sector[i].Key[j] = bytes_to_num(key, MIFARE_KEY_SIZE);
+                e_sector[i].foundKey[j] = 'R';
+                PrintAndLogEx(SUCCESS, "Target sector " _GREEN_("%3u") " key type " _GREEN_("%c") " -- found valid key [ " _GREEN_("%s") " ]",
+                              i,
+                              (j == MF_KEY_B) ? 'B' : 'A',
+                              sprint_hex_inrow(key, MIFARE_KEY_SIZE)
+                             );
+            }
+        }
+    }
+}
+
+// reads key B from the sector trailer with the known key A, when the access conditions allow it
+static bool mf_autopwn_read_b(sector_t *e_sector, uint8_t sector, bool verbose) {
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "--- " _CYAN_("Enter read B key recovery mode") " -----------------------");
+        PrintAndLogEx(INFO, "reading B key of sector %3d with key type %c", sector, 'B');
+    }
+    uint8_t sectrail = (mfFirstBlockOfSector(sector) + mfNumBlocksPerSector(sector) - 1);
+
+    mf_readblock_t payload;
+    payload.blockno = sectrail;
+    payload.keytype = MF_KEY_A;
+
+    num_to_bytes(e_sector[sector].Key[MF_KEY_A], MIFARE_KEY_SIZE, payload.key); // KEY A
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_READBL, (uint8_t *)&payload, sizeof(mf_readblock_t));
+
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_MIFARE_READBL, &resp, 1500) == false) {
+        return false;
+    }
+
+    if (resp.status != PM3_SUCCESS) {
+        return false;
+    }
+
+    uint64_t key64 = bytes_to_num(resp.data.asBytes + 10, MIFARE_KEY_SIZE);
+    if (key64 == 0) {
+        if (verbose) {
+            PrintAndLogEx(WARNING, "Unknown B key: sector %3d key type %c", sector, 'B');
+            PrintAndLogEx(INFO, " -- reading the B key was not possible, maybe due to access rights?");
+        }
+        return false;
+    }
+
+    uint8_t key[MIFARE_KEY_SIZE];
+    num_to_bytes(key64, MIFARE_KEY_SIZE, key);
+    e_sector[sector].foundKey[MF_KEY_B] = 'A';
+    e_sector[sector].Key[MF_KEY_B] = key64;
+    PrintAndLogEx(SUCCESS, "Target sector " _GREEN_("%3u") " key type " _GREEN_("%c") " -- found valid key [ " _GREEN_("%s") " ]",
+                  sector,
+                  'B',
+                  sprint_hex_inrow(key, sizeof(key))
+                 );
+    return true;
+}
+
+// keys found so far go to the key database, also when autopwn stops half way. fp is NULL with --ns
+static void mf_autopwn_remember(mfkeydb_fp_t *fp, uint8_t sector_cnt, const sector_t *e_sector) {
+    if (fp == NULL) {
+        return;
+    }
+    for (uint8_t i = 0; i < sector_cnt; i++) {
+        if (e_sector[i].foundKey[MF_KEY_A] || e_sector[i].foundKey[MF_KEY_B]) {
+            mfkeydb_record(fp, sector_cnt, e_sector);
+            return;
+        }
+    }
+}
+
+// reports a hardnested error that ends autopwn, sector < 0 when the failing target is already marked
+static void mf_autopwn_hardnested_failed(int res, sector_t *e_sector, uint8_t sector_cnt, int sector, int keytype) {
+    switch (res) {
+        case PM3_ETIMEOUT: {
+            PrintAndLogEx(ERR, "\nError: No response from Proxmark3");
+            break;
+        }
+        case PM3_EOPABORTED: {
+            PrintAndLogEx(NORMAL, "\nButton pressed, user aborted");
+            break;
+        }
+        case PM3_ESTATIC_NONCE: {
+            PrintAndLogEx(ERR, "\nError: Static encrypted nonce detected. Aborted\n");
+
+            if (sector >= 0) {
+                e_sector[sector].Key[keytype] = 0xffffffffffff;
+                e_sector[sector].foundKey[keytype] = false;
+            }
+
+            // Show the results to the user
+            printKeyTable(sector_cnt, e_sector);
+            PrintAndLogEx(NORMAL, "");
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+// autopwn hardnested pipeline.
+// The hardnested solver keeps its state in globals, so a single worker thread cracks one key
+// at a time (the brute force itself is already multithreaded) while the main thread keeps the
+// device busy acquiring nonces for the next unknown keys. Keys coming back from the worker are
+// tried on the remaining sectors right away, which cancels queued work that is no longer needed.
+#define MF_AUTOPWN_PREFETCH_MAX     (8 * 1024)
+
+typedef struct mf_autopwn_job_s {
+    uint8_t sector;
+    uint8_t keytype;
+    bool cancelled;
+    int res;
+    uint64_t key;
+    hardnested_nonces_t nonces;
+    struct mf_autopwn_job_s *next;
+} mf_autopwn_job_t;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool running;
+    // known key used to reach the targets
+    uint8_t blockno;
+    uint8_t keytype;
+    uint8_t key[MIFARE_KEY_SIZE];
+    bool slow;
+    mf_autopwn_job_t *queue;    // waiting for the worker, in order
+    mf_autopwn_job_t *done;     // finished by the worker, for the main thread
+    bool busy;                  // worker is cracking
+    bool quit;
+    // the main thread owns the device unless the worker has to top up its nonces
+    bool main_device;
+    bool worker_device;
+    bool worker_wants_device;
+} mf_autopwn_pipeline_t;
+
+static void mf_autopwn_job_append(mf_autopwn_job_t **list, mf_autopwn_job_t *job) {
+    while (*list) {
+        list = &(*list)->next;
+    }
+    job->next = NULL;
+    *list = job;
+}
+
+static void mf_autopwn_worker_acquire(void *ctx) {
+    mf_autopwn_pipeline_t *pl = (mf_autopwn_pipeline_t *)ctx;
+    pthread_mutex_lock(&pl->lock);
+    pl->worker_wants_device = true;
+    while (pl->main_device) {
+        pthread_cond_wait(&pl->cond, &pl->lock);
+    }
+    pl->worker_wants_device = false;
+    pl->worker_device = true;
+    pthread_mutex_unlock(&pl->lock);
+}
+
+static void mf_autopwn_worker_release(void *ctx) {
+    mf_autopwn_pipeline_t *pl = (mf_autopwn_pipeline_t *)ctx;
+    DropField();
+    pthread_mutex_lock(&pl->lock);
+    pl->worker_device = false;
+    pthread_cond_broadcast(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+static void *mf_autopwn_worker(void *arg) {
+    mf_autopwn_pipeline_t *pl = (mf_autopwn_pipeline_t *)arg;
+
+    hardnested_device_t device = {
+        .acquire = mf_autopwn_worker_acquire,
+        .release = mf_autopwn_worker_release,
+        .ctx = pl,
+    };
+
+    pthread_mutex_lock(&pl->lock);
+    while (true) {
+
+        while (pl->queue == NULL && pl->quit == false) {
+            pthread_cond_wait(&pl->cond, &pl->lock);
+        }
+
+        if (pl->quit) {
+            break;
+        }
+
+        mf_autopwn_job_t *job = pl->queue;
+        pl->queue = job->next;
+
+        if (job->cancelled == false) {
+            pl->busy = true;
+            pthread_mutex_unlock(&pl->lock);
+
+            job->res = mfnestedhard_ex(pl->blockno, pl->keytype, pl->key, mfFirstBlockOfSector(job->sector), job->keytype, pl->slow, &job->nonces, &device, &job->key);
+
+            pthread_mutex_lock(&pl->lock);
+            pl->busy = false;
+        }
+
+        hardnested_nonces_free(&job->nonces);
+        mf_autopwn_job_append(&pl->done, job);
+        pthread_cond_broadcast(&pl->cond);
+
+        // the main thread reports the error, anything still queued is dropped
+        if (job->cancelled == false && job->res != PM3_SUCCESS && job->res != PM3_EFAILED) {
+            pl->quit = true;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+    return NULL;
+}
+
+static int mf_autopwn_pipeline_start(mf_autopwn_pipeline_t *pl, uint8_t blockno, uint8_t keytype, const uint8_t *key, bool slow) {
+
+    memset(pl, 0, sizeof(mf_autopwn_pipeline_t));
+    pl->blockno = blockno;
+    pl->keytype = keytype;
+    memcpy(pl->key, key, MIFARE_KEY_SIZE);
+    pl->slow = slow;
+    pl->main_device = true;
+
+    pthread_mutex_init(&pl->lock, NULL);
+    pthread_cond_init(&pl->cond, NULL);
+
+    if (pthread_create(&pl->thread, NULL, mf_autopwn_worker, pl) != 0) {
+        pthread_mutex_destroy(&pl->lock);
+        pthread_cond_destroy(&pl->cond);
+        return PM3_ESOFT;
+    }
+
+    pl->running = true;
+    return PM3_SUCCESS;
+}
+
+static void mf_autopwn_pipeline_take(mf_autopwn_pipeline_t *pl) {
+    pthread_mutex_lock(&pl->lock);
+    while (pl->worker_device || pl->worker_wants_device) {
+        pthread_cond_wait(&pl->cond, &pl->lock);
+    }
+    pl->main_device = true;
+    pthread_mutex_unlock(&pl->lock);
+}
+
+static void mf_autopwn_pipeline_give(mf_autopwn_pipeline_t *pl) {
+    pthread_mutex_lock(&pl->lock);
+    pl->main_device = false;
+    pthread_cond_broadcast(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+// lets the worker top up its nonces when it ran short
+static void mf_autopwn_pipeline_yield(mf_autopwn_pipeline_t *pl) {
+    pthread_mutex_lock(&pl->lock);
+    bool wants = pl->worker_wants_device;
+    pthread_mutex_unlock(&pl->lock);
+
+    if (wants) {
+        mf_autopwn_pipeline_give(pl);
+        mf_autopwn_pipeline_take(pl);
+    }
+}
+
+// prefetching only pays off while the worker has something else to crack
+static bool mf_autopwn_pipeline_prefetch_stop(void *ctx) {
+    mf_autopwn_pipeline_t *pl = (mf_autopwn_pipeline_t *)ctx;
+    pthread_mutex_lock(&pl->lock);
+    bool stop = pl->quit || pl->worker_wants_device || (pl->busy == false && pl->queue == NULL);
+    pthread_mutex_unlock(&pl->lock);
+    return stop;
+}
+
+static int mf_autopwn_pipeline_submit(mf_autopwn_pipeline_t *pl, uint8_t sector, uint8_t keytype) {
+
+    mf_autopwn_job_t *job = calloc(1, sizeof(mf_autopwn_job_t));
+    if (job == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+    job->sector = sector;
+    job->keytype = keytype;
+
+    // an idle worker gets the job right away and acquires its nonces live
+    while (mf_autopwn_pipeline_prefetch_stop(pl) == false && (job->nonces.count * 2) < MF_AUTOPWN_PREFETCH_MAX) {
+
+        int res = mfnestedhard_prefetch(pl->blockno, pl->keytype, pl->key, mfFirstBlockOfSector(sector), keytype, pl->slow, MF_AUTOPWN_PREFETCH_MAX, mf_autopwn_pipeline_prefetch_stop, pl, &job->nonces);
+        if (res != PM3_SUCCESS) {
+            hardnested_nonces_free(&job->nonces);
+            free(job);
+            return res;
+        }
+
+        mf_autopwn_pipeline_yield(pl);
+    }
+
+    if (job->nonces.count) {
+        PrintAndLogEx(INFO, "Sector " _YELLOW_("%3u") " key type " _YELLOW_("%c") " -- prefetched " _YELLOW_("%u") " nonces",
+                      sector,
+                      (keytype == MF_KEY_B) ? 'B' : 'A',
+                      job->nonces.count * 2
+                     );
+    }
+
+    pthread_mutex_lock(&pl->lock);
+    mf_autopwn_job_append(&pl->queue, job);
+    pthread_cond_broadcast(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+    return PM3_SUCCESS;
+}
+
+// applies the keys the worker found, returns the first error that ends autopwn
+static int mf_autopwn_pipeline_collect(mf_autopwn_pipeline_t *pl, sector_t *e_sector, uint8_t sector_cnt, bool verbose) {
+
+    pthread_mutex_lock(&pl->lock);
+    mf_autopwn_job_t *jobs = pl->done;
+    pl->done = NULL;
+    pthread_mutex_unlock(&pl->lock);
+
+    int res = PM3_SUCCESS;
+    while (jobs) {
+        mf_autopwn_job_t *job = jobs;
+        jobs = job->next;
+
+        if (job->cancelled) {
+            free(job);
+            continue;
+        }
+
+        if (job->res == PM3_SUCCESS) {
+
+            if (e_sector[job->sector].foundKey[job->keytype] == 0) {
+
+                uint8_t key[MIFARE_KEY_SIZE];
+                num_to_bytes(job->key, MIFARE_KEY_SIZE, key);
+                e_sector[job->sector].Key[job->keytype] = job->key;
+                e_sector[job->sector].foundKey[job->keytype] = 'H';
+                PrintAndLogEx(SUCCESS, "Target sector " _GREEN_("%3u") " key type " _GREEN_("%c") " -- found valid key [ " _GREEN_("%s") " ]",
+                              job->sector,
+                              (job->keytype == MF_KEY_B) ? 'B' : 'A',
+                              sprint_hex_inrow(key, sizeof(key))
+                             );
+
+                mf_autopwn_try_key(e_sector, sector_cnt, key);
+
+                if (e_sector[job->sector].foundKey[MF_KEY_A] && e_sector[job->sector].foundKey[MF_KEY_B] == 0) {
+                    mf_autopwn_read_b(e_sector, job->sector, verbose);
+                }
+            }
+
+        } else if (job->res == PM3_EFAILED) {
+            PrintAndLogEx(FAILED, "\nFailed to recover a key...");
+        } else if (res == PM3_SUCCESS) {
+            res = job->res;
+            if (res == PM3_ESTATIC_NONCE) {
+                e_sector[job->sector].Key[job->keytype] = 0xffffffffffff;
+                e_sector[job->sector].foundKey[job->keytype] = false;
+            }
+        }
+        free(job);
+    }
+
+    // drop the queued targets which got a key in the meantime
+    pthread_mutex_lock(&pl->lock);
+    for (mf_autopwn_job_t *job = pl->queue; job; job = job->next) {
+        if (e_sector[job->sector].foundKey[job->keytype]) {
+            job->cancelled = true;
+        }
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    return res;
+}
+
+// waits for the worker to run out of work while still applying its results
+static int mf_autopwn_pipeline_finish(mf_autopwn_pipeline_t *pl, sector_t *e_sector, uint8_t sector_cnt, bool verbose) {
+
+    int res = PM3_SUCCESS;
+    bool idle = false;
+    while (res == PM3_SUCCESS && idle == false) {
+
+        mf_autopwn_pipeline_give(pl);
+
+        pthread_mutex_lock(&pl->lock);
+        while (pl->done == NULL && pl->quit == false && (pl->busy || pl->queue)) {
+            pthread_cond_wait(&pl->cond, &pl->lock);
+        }
+        idle = pl->quit || (pl->busy == false && pl->queue == NULL);
+        pthread_mutex_unlock(&pl->lock);
+
+        mf_autopwn_pipeline_take(pl);
+
+        res = mf_autopwn_pipeline_collect(pl, e_sector, sector_cnt, verbose);
+    }
+    return res;
+}
+
+static void mf_autopwn_pipeline_free(mf_autopwn_pipeline_t *pl) {
+
+    if (pl->running == false) {
+        return;
+    }
+
+    // a key being cracked can't be interrupted, the worker stops after it
+    pthread_mutex_lock(&pl->lock);
+    pl->quit = true;
+    pl->main_device = false;
+    pthread_cond_broadcast(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+
+    pthread_join(pl->thread, NULL);
+
+    mf_autopwn_job_t *lists[] = { pl->queue, pl->done };
+    for (size_t i = 0; i < ARRAYLEN(lists); i++) {
+        while (lists[i]) {
+            mf_autopwn_job_t *job = lists[i];
+            lists[i] = job->next;
+            hardnested_nonces_free(&job->nonces);
+            free(job);
+        }
+    }
+
+    pthread_mutex_destroy(&pl->lock);
+    pthread_cond_destroy(&pl->cond);
+    pl->running = false;
+}
+
 static int CmdHF14AMfAutoPWN(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -2887,6 +3352,8 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
                   "This command automates the key recovery process on MIFARE Classic cards.\n"
                   "It uses the fchk, chk, darkside, nested, hardnested and staticnested to recover keys.\n"
                   "If all keys are found, it try dumping card content both to file and emulator memory.\n"
+                  "Hardnested keys are cracked in the background while nonces for the next keys are acquired.\n"
+                  "Recovered keys go to the key database `~/.proxmark3/mfc_keydb.txt`, similar cards try them first.\n"
                   "\n"
                   "default file name template is `hf-mf-<uid>-<dump|key>.`\n"
                   "using suffix the template becomes `hf-mf-<uid>-<dump|key>-<suffix>.` \n",
@@ -2910,13 +3377,15 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
         arg_lit0("v",  "verbose",          "verbose output"),
         arg_lit0(NULL, "mem", "Use dictionary from flashmemory"),
 
-        arg_lit0(NULL, "ns", "No save to file"),
+        arg_lit0(NULL, "ns", "No save to file or key database"),
 
         arg_lit0(NULL, "mini", "MIFARE Classic Mini / S20"),
         arg_lit0(NULL, "1k", "MIFARE Classic 1k / S50 (default)"),
         arg_lit0(NULL, "2k", "MIFARE Classic/Plus 2k"),
         arg_lit0(NULL, "4k", "MIFARE Classic 4k / S70"),
 
+        arg_lit0(NULL, "nopipe", "Don't acquire hardnested nonces while another key is cracked"),
+
         arg_lit0(NULL, "in", "None (use CPU regular instruction set)"),
 #if defined(COMPILER_HAS_SIMD_X86)
         arg_lit0(NULL, "im", "MMX"),
@@ -2969,18 +3438,20 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
     bool m2 = arg_get_lit(ctx, 14);
     bool m4 = arg_get_lit(ctx, 15);
 
-    bool in = arg_get_lit(ctx, 16);
+    bool no_pipeline = arg_get_lit(ctx, 16);
+
+    bool in = arg_get_lit(ctx, 17);
 #if defined(COMPILER_HAS_SIMD_X86)
-    bool im = arg_get_lit(ctx, 17);
-    bool is = arg_get_lit(ctx, 18);
-    bool ia = arg_get_lit(ctx, 19);
-    bool i2 = arg_get_lit(ctx, 20);
+    bool im = arg_get_lit(ctx, 18);
+    bool is = arg_get_lit(ctx, 19);
+    bool ia = arg_get_lit(ctx, 20);
+    bool i2 = arg_get_lit(ctx, 21);
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    bool i5 = arg_get_lit(ctx, 21);
+    bool i5 = arg_get_lit(ctx, 22);
 #endif
 #if defined(COMPILER_HAS_SIMD_NEON)
-    bool ie = arg_get_lit(ctx, 17);
+    bool ie = arg_get_lit(ctx, 18);
 #endif
 
     CLIParserFree(ctx);
@@ -3306,7 +3777,11 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
         fnlen = 0;
     }
 
-    int ret = mf_load_keys(&keyBlock, &key_cnt, in_keys, in_keys_len, filename, fnlen, true);
+    mfkeydb_fp_t keydb_fp;
+    mfkeydb_fp_from_card(&keydb_fp, &card, sector_cnt);
+    mfkeydb_fp_t *keydb = (no_save) ? NULL : &keydb_fp;
+
+    int ret = mf_load_keys(&keyBlock, &key_cnt, in_keys, in_keys_len, filename, fnlen, true, &keydb_fp);
     if (ret != PM3_SUCCESS) {
         free(e_sector);
         return ret;
@@ -3477,12 +3952,27 @@ noValidKeyFound:
     // Clear the needed variables
     num_to_bytes(0, MIFARE_KEY_SIZE, tmp_key);
     bool nested_failed = false;
+    mf_autopwn_pipeline_t pipeline = { .running = false };
 
     // Iterate over each sector and key(A/B)
     for (current_sector_i = 0; current_sector_i < sector_cnt; current_sector_i++) {
 
         for (current_key_type_i = MF_KEY_A; current_key_type_i <= MF_KEY_B; current_key_type_i++) {
 
+            // Keys cracked by the hardnested worker in the meantime
+            if (pipeline.running) {
+                mf_autopwn_pipeline_yield(&pipeline);
+                isOK = mf_autopwn_pipeline_collect(&pipeline, e_sector, sector_cnt, verbose);
+                if (isOK != PM3_SUCCESS) {
+                    mf_autopwn_pipeline_free(&pipeline);
+                    mf_autopwn_hardnested_failed(isOK, e_sector, sector_cnt, -1, 0);
+                    mf_autopwn_remember(keydb, sector_cnt, e_sector);
+                    free(e_sector);
+                    free(fptr);
+                    return PM3_ESOFT;
+                }
+            }
+
             // If the key is already known, just skip it
             if (e_sector[current_sector_i].foundKey[current_key_type_i] == 0) {
 
@@ -3492,86 +3982,20 @@ noValidKeyFound:
 
                 // Try the found keys are reused
                 if (bytes_to_num(tmp_key, MIFARE_KEY_SIZE) != 0) {
-                    // <!> The fast check --> mf_check_keys_fast(sector_cnt, true, true, 2, 1, tmp_key, e_sector, false, verbose);
-                    // <!> Returns false keys, so we just stick to the slower mfchk.
-                    for (int i = 0; i < sector_cnt; i++) {
-                        for (int j = MF_KEY_A; j <= MF_KEY_B; j++) {
-                            // Check if the sector key is already broken
-                            if (e_sector[i].foundKey[j]) {
-                                continue;
-                            }
-
-                            // Check if the key works
-                            if (mf_check_keys(mfFirstBlockOfSector(i), j, true, 1, tmp_key, &key64) == PM3_SUCCESS) {
-                                e_sector[i].Key[j] = bytes_to_num(tmp_key, MIFARE_KEY_SIZE);
-                                e_sector[i].foundKey[j] = 'R';
-                                PrintAndLogEx(SUCCESS, "Target sector " _GREEN_("%3u") " key type " _GREEN_("%c") " -- found valid key [ " _GREEN_("%s") " ]",
-                                              i,
-                                              (j == MF_KEY_B) ? 'B' : 'A',
-                                              sprint_hex_inrow(tmp_key, sizeof(tmp_key))
-                                             );
-                            }
-                        }
-                    }
+                    mf_autopwn_try_key(e_sector, sector_cnt, tmp_key);
                 }
                 // Clear the last found key
                 num_to_bytes(0, MIFARE_KEY_SIZE, tmp_key);
 
                 if (current_key_type_i == MF_KEY_B) {
                     if (e_sector[current_sector_i].foundKey[0] && !e_sector[current_sector_i].foundKey[1]) {
-                        if (verbose) {
-                            PrintAndLogEx(INFO, "--- " _CYAN_("Enter read B key recovery mode") " -----------------------");
-                            PrintAndLogEx(INFO, "reading B key of sector %3d with key type %c",
-                                          current_sector_i,
-                                          (current_key_type_i == MF_KEY_B) ? 'B' : 'A');
-                        }
-                        uint8_t sectrail = (mfFirstBlockOfSector(current_sector_i) + mfNumBlocksPerSector(current_sector_i) - 1);
-
-                        mf_readblock_t payload;
-                        payload.blockno = sectrail;
-                        payload.keytype = MF_KEY_A;
-
-                        num_to_bytes(e_sector[current_sector_i].Key[0], MIFARE_KEY_SIZE, payload.key); // KEY A
-
-                        clearCommandBuffer();
-                        SendCommandNG(CMD_HF_MIFARE_READBL, (uint8_t *)&payload, sizeof(mf_readblock_t));
-
-                        if (WaitForResponseTimeout(CMD_HF_MIFARE_READBL, &resp, 1500) == false) {
-                            goto skipReadBKey;
-                        }
-
-                        if (resp.status != PM3_SUCCESS) {
-                            goto skipReadBKey;
-                        }
-
-                        uint8_t *data = resp.data.asBytes;
-                        key64 = bytes_to_num(data + 10, MIFARE_KEY_SIZE);
-
-                        if (key64) {
-                            e_sector[current_sector_i].foundKey[current_key_type_i] = 'A';
-                            e_sector[current_sector_i].Key[current_key_type_i] = key64;
-                            num_to_bytes(key64, MIFARE_KEY_SIZE, tmp_key);
-                            PrintAndLogEx(SUCCESS, "Target sector " _GREEN_("%3u") " key type " _GREEN_("%c") " -- found valid key [ " _GREEN_("%s") " ]",
-                                          current_sector_i,
-                                          (current_key_type_i == MF_KEY_B) ? 'B' : 'A',
-                                          sprint_hex_inrow(tmp_key, sizeof(tmp_key))
-                                         );
-                        } else {
-                            if (verbose) {
-                                PrintAndLogEx(WARNING, "Unknown B key: sector %3d key type %c",
-                                              current_sector_i,
-                                              (current_key_type_i == MF_KEY_B) ? 'B' : 'A'
-                                             );
-                                PrintAndLogEx(INFO, " -- reading the B key was not possible, maybe due to access rights?");
-
-                            }
-
+                        if (mf_autopwn_read_b(e_sector, current_sector_i, verbose)) {
+                            num_to_bytes(e_sector[current_sector_i].Key[MF_KEY_B], MIFARE_KEY_SIZE, tmp_key);
                         }
                     }
                 }
 
                 // Use the nested / hardnested attack
-skipReadBKey:
                 if (e_sector[current_sector_i].foundKey[current_key_type_i] == 0) {
 
                     if (has_staticnonce == NONCE_STATIC) {
@@ -3594,12 +4018,16 @@ tryNested:
                         switch (isOK) {
                             case PM3_ETIMEOUT: {
                                 PrintAndLogEx(ERR, "\nError: No response from Proxmark3.");
+                                mf_autopwn_pipeline_free(&pipeline);
+                                mf_autopwn_remember(keydb, sector_cnt, e_sector);
                                 free(e_sector);
                                 free(fptr);
                                 return isOK;
                             }
                             case PM3_EOPABORTED: {
                                 PrintAndLogEx(WARNING, "\nButton pressed. Aborted.");
+                                mf_autopwn_pipeline_free(&pipeline);
+                                mf_autopwn_remember(keydb, sector_cnt, e_sector);
                                 free(e_sector);
                                 free(fptr);
                                 return isOK;
@@ -3632,6 +4060,8 @@ tryNested:
                                 // Show the results to the user
                                 printKeyTable(sector_cnt, e_sector);
                                 PrintAndLogEx(NORMAL, "");
+                                mf_autopwn_pipeline_free(&pipeline);
+                                mf_autopwn_remember(keydb, sector_cnt, e_sector);
                                 free(e_sector);
                                 free(fptr);
                                 return isOK;
@@ -3644,6 +4074,8 @@ tryNested:
                             }
                             default: {
                                 PrintAndLogEx(ERR, "Unknown error\n");
+                                mf_autopwn_pipeline_free(&pipeline);
+                                mf_autopwn_remember(keydb, sector_cnt, e_sector);
                                 free(e_sector);
                                 free(fptr);
                                 return isOK;
@@ -3659,6 +4091,7 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
                             // Show the results to the user
                             printKeyTable(sector_cnt, e_sector);
                             PrintAndLogEx(NORMAL, "");
+                            mf_autopwn_remember(keydb, sector_cnt, e_sector);
                             free(e_sector);
                             free(fptr);
                             return PM3_ESOFT;
@@ -3673,38 +4106,36 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
                                           slow ? "Yes" : "No");
                         }
 
+                        // Crack in the background, the device moves on to the next target
+                        if (no_pipeline == false && pipeline.running == false) {
+                            if (mf_autopwn_pipeline_start(&pipeline, mfFirstBlockOfSector(sectorno), keytype, key, slow) != PM3_SUCCESS) {
+                                no_pipeline = true;
+                            }
+                        }
+
+                        if (pipeline.running) {
+                            isOK = mf_autopwn_pipeline_submit(&pipeline, current_sector_i, current_key_type_i);
+                            if (isOK != PM3_SUCCESS) {
+                                mf_autopwn_pipeline_free(&pipeline);
+                                mf_autopwn_hardnested_failed(isOK, e_sector, sector_cnt, current_sector_i, current_key_type_i);
+                                mf_autopwn_remember(keydb, sector_cnt, e_sector);
+                                free(e_sector);
+                                free(fptr);
+                                return PM3_ESOFT;
+                            }
+                            continue;
+                        }
+
                         foundkey = 0;
                         isOK = mfnestedhard(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(current_sector_i), current_key_type_i, NULL, false, false, slow, 0, &foundkey, NULL);
                         DropField();
                         if (isOK != PM3_SUCCESS) {
-                            switch (isOK) {
-                                case PM3_ETIMEOUT: {
-                                    PrintAndLogEx(ERR, "\nError: No response from Proxmark3");
-                                    break;
-                                }
-                                case PM3_EOPABORTED: {
-                                    PrintAndLogEx(NORMAL, "\nButton pressed, user aborted");
-                                    break;
-                                }
-                                case PM3_ESTATIC_NONCE: {
-                                    PrintAndLogEx(ERR, "\nError: Static encrypted nonce detected. Aborted\n");
-
-                                    e_sector[current_sector_i].Key[current_key_type_i] = 0xffffffffffff;
-                                    e_sector[current_sector_i].foundKey[current_key_type_i] = false;
-
-                                    // Show the results to the user
-                                    printKeyTable(sector_cnt, e_sector);
-                                    PrintAndLogEx(NORMAL, "");
-                                    break;
-                                }
-                                case PM3_EFAILED: {
-                                    PrintAndLogEx(FAILED, "\nFailed to recover a key...");
-                                    continue;
-                                }
-                                default: {
-                                    break;
-                                }
+                            if (isOK == PM3_EFAILED) {
+                                PrintAndLogEx(FAILED, "\nFailed to recover a key...");
+                                continue;
                             }
+                            mf_autopwn_hardnested_failed(isOK, e_sector, sector_cnt, current_sector_i, current_key_type_i);
+                            mf_autopwn_remember(keydb, sector_cnt, e_sector);
                             free(e_sector);
                             free(fptr);
                             return PM3_ESOFT;
@@ -3733,12 +4164,14 @@ tryStaticnested:
                             switch (isOK) {
                                 case PM3_ETIMEOUT: {
                                     PrintAndLogEx(ERR, "\nError: No response from Proxmark3");
+                                    mf_autopwn_remember(keydb, sector_cnt, e_sector);
                                     free(e_sector);
                                     free(fptr);
                                     return isOK;
                                 }
                                 case PM3_EOPABORTED: {
                                     PrintAndLogEx(WARNING, "\nButton pressed, user aborted");
+                                    mf_autopwn_remember(keydb, sector_cnt, e_sector);
                                     free(e_sector);
                                     free(fptr);
                                     return isOK;
@@ -3774,6 +4207,20 @@ tryStaticnested:
         }
     }
 
+    // Wait for the keys still being cracked
+    if (pipeline.running) {
+        isOK = mf_autopwn_pipeline_finish(&pipeline, e_sector, sector_cnt, verbose);
+        mf_autopwn_pipeline_free(&pipeline);
+        DropField();
+        if (isOK != PM3_SUCCESS) {
+            mf_autopwn_hardnested_failed(isOK, e_sector, sector_cnt, -1, 0);
+            mf_autopwn_remember(keydb, sector_cnt, e_sector);
+            free(e_sector);
+            free(fptr);
+            return PM3_ESOFT;
+        }
+    }
+
 all_found:
 
     // Show the results to the user
@@ -3788,6 +4235,9 @@ all_found:
         }
     }
 
+    // Remember them for the next card of the same site
+    mf_autopwn_remember(keydb, sector_cnt, e_sector);
+
     // clear emulator mem
     clearCommandBuffer();
     SendCommandNG(CMD_HF_MIFARE_EML_MEMCLR, NULL, 0);
@@ -3872,10 +4322,292 @@ out:
     return PM3_SUCCESS;
 }
 
+// fchk key pipeline.
+// The dictionary is parsed and deduplicated in blocks by a reader thread while
+// the device checks the current chunk, so the next chunk is ready as soon as the ACK arrives.
+// A compiled dictionary is already deduplicated and is read straight from its mapping instead,
+// only the keys it shares with the default keys are skipped.
+// Weak key database keys go after the dictionary, once it was read.
+#define MF_CHK_PIPELINE_BLOCK   2048
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *keys;              // deduplicated keys, grows while the reader runs
+    uint32_t keycnt;
+    uint32_t capacity;
+    uint64_t *seen;             // open addressing set, key | 1 << 48 so the zero key can be stored
+    uint32_t seen_mask;
+    uint32_t seen_cnt;
+    uint32_t dupcnt;
+    uint32_t filecnt;
+    const char *filename;
+    size_t filepos;
+    dictionary_t dict;          // compiled dictionary, keys follow the ones above
+    uint32_t *skip;             // sorted key numbers of dict keys already in keys
+    uint32_t skipcnt;
+    uint8_t *tail;              // weak key database keys, tried after the dictionary
+    uint32_t tailcnt;           // 0 until the dictionary was read
+    uint32_t tailpending;
+    bool done;
+    bool abort;
+    int res;
+} mf_chk_pipeline_t;
+
+static bool mf_chk_pipeline_seen(mf_chk_pipeline_t *pl, uint64_t key) {
+
+    if ((pl->seen_cnt + 1) * 2 > pl->seen_mask + 1) {
+        uint32_t newmask = (pl->seen_mask << 1) | 1;
+        uint64_t *p = calloc((size_t)newmask + 1, sizeof(uint64_t));
+        if (p == NULL) {
+            // can't grow, don't dedup this one
+            return false;
+        }
+        for (uint32_t i = 0; i <= pl->seen_mask; i++) {
+            uint64_t v = pl->seen[i];
+            if (v == 0) {
+                continue;
+            }
+            uint32_t h = (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> 32) & newmask;
+            while (p[h]) {
+                h = (h + 1) & newmask;
+            }
+            p[h] = v;
+        }
+        free(pl->seen);
+        pl->seen = p;
+        pl->seen_mask = newmask;
+    }
+
+    uint64_t v = key | (1ULL << 48);
+    uint32_t h = (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> 32) & pl->seen_mask;
+    while (pl->seen[h]) {
+        if (pl->seen[h] == v) {
+            return true;
+        }
+        h = (h + 1) & pl->seen_mask;
+    }
+    pl->seen[h] = v;
+    pl->seen_cnt++;
+    return false;
+}
+
+// appends the not yet seen keys of a block. Only the reader (or the main thread before it starts) calls this.
+static int mf_chk_pipeline_add(mf_chk_pipeline_t *pl, const uint8_t *keys, uint32_t cnt) {
+
+    pthread_mutex_lock(&pl->lock);
+    if (pl->keycnt + cnt > pl->capacity) {
+        uint32_t newcap = (pl->capacity) ? pl->capacity : MF_CHK_PIPELINE_BLOCK;
+        while (newcap < pl->keycnt + cnt) {
+            newcap <<= 1;
+        }
+        uint8_t *p = realloc(pl->keys, (size_t)newcap * MIFARE_KEY_SIZE);
+        if (p == NULL) {
+            pthread_mutex_unlock(&pl->lock);
+            return PM3_EMALLOC;
+        }
+        pl->keys = p;
+        pl->capacity = newcap;
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    // dedup outside the lock, the main thread only reads below keycnt
+    uint32_t n = pl->keycnt;
+    for (uint32_t i = 0; i < cnt; i++) {
+        const uint8_t *k = keys + (i * MIFARE_KEY_SIZE);
+        if (mf_chk_pipeline_seen(pl, bytes_to_num((uint8_t *)k, MIFARE_KEY_SIZE))) {
+            pl->dupcnt++;
+            continue;
+        }
+        memcpy(pl->keys + (n * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE);
+        n++;
+    }
+
+    pthread_mutex_lock(&pl->lock);
+    pl->keycnt = n;
+    pthread_cond_signal(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+    return PM3_SUCCESS;
+}
+
+// reads one block of the dictionary file. Returns PM3_SUCCESS when the end of file was reached.
+static int mf_chk_pipeline_read(mf_chk_pipeline_t *pl, uint8_t *buf) {
+    size_t datalen = 0;
+    uint32_t cnt = 0;
+    size_t endpos = 0;
+    int res = loadFileDICTIONARYEx(pl->filename, buf, MF_CHK_PIPELINE_BLOCK * MIFARE_KEY_SIZE, &datalen, MIFARE_KEY_SIZE, &cnt, pl->filepos, &endpos, false);
+    if (res != PM3_SUCCESS && res != 1) {
+        return res;
+    }
+
+    pl->filecnt += cnt;
+    int ares = mf_chk_pipeline_add(pl, buf, cnt);
+    if (ares != PM3_SUCCESS) {
+        return ares;
+    }
+
+    if (res == 1 && endpos) {
+        pl->filepos = endpos;
+        return 1;
+    }
+    return PM3_SUCCESS;
+}
+
+// drops the tail keys the dictionary already has, then makes them available.
+// Called once the whole dictionary was read, by the reader when there is one.
+static void mf_chk_pipeline_tail(mf_chk_pipeline_t *pl) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < pl->tailpending; i++) {
+        uint8_t *k = pl->tail + (i * MIFARE_KEY_SIZE);
+        bool dup;
+        if (pl->dict.base != NULL) {
+            dup = dictionary_contains(&pl->dict, k, NULL);
+        } else {
+            dup = mf_chk_pipeline_seen(pl, bytes_to_num(k, MIFARE_KEY_SIZE));
+        }
+        if (dup) {
+            continue;
+        }
+        memmove(pl->tail + (n * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE);
+        n++;
+    }
+
+    pthread_mutex_lock(&pl->lock);
+    pl->tailcnt = n;
+    pl->tailpending = 0;
+    pthread_mutex_unlock(&pl->lock);
+}
+
+static void *mf_chk_pipeline_reader(void *arg) {
+    mf_chk_pipeline_t *pl = (mf_chk_pipeline_t *)arg;
+    int res = PM3_EMALLOC;
+
+    uint8_t *buf = calloc(MF_CHK_PIPELINE_BLOCK, MIFARE_KEY_SIZE);
+    if (buf) {
+        do {
+            res = mf_chk_pipeline_read(pl, buf);
+        } while (res == 1 && __atomic_load_n(&pl->abort, __ATOMIC_RELAXED) == false);
+        free(buf);
+    }
+
+    if (res != 1) {
+        mf_chk_pipeline_tail(pl);
+    }
+
+    pthread_mutex_lock(&pl->lock);
+    pl->res = (res == 1) ? PM3_EOPABORTED : res;
+    pl->done = true;
+    pthread_cond_signal(&pl->cond);
+    pthread_mutex_unlock(&pl->lock);
+    return NULL;
+}
+
+static int mf_chk_pipeline_cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// maps the compiled dictionary behind the keys already added. Returns PM3_EFILE when there is none.
+static int mf_chk_pipeline_open(mf_chk_pipeline_t *pl) {
+
+    int res = dictionary_open(pl->filename, MIFARE_KEY_SIZE, &pl->dict, true);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    pl->skip = calloc(MAX(pl->keycnt, 1), sizeof(uint32_t));
+    if (pl->skip == NULL) {
+        dictionary_close(&pl->dict);
+        return PM3_EMALLOC;
+    }
+
+    for (uint32_t i = 0; i < pl->keycnt; i++) {
+        if (dictionary_contains(&pl->dict, pl->keys + (i * MIFARE_KEY_SIZE), &pl->skip[pl->skipcnt])) {
+            pl->skipcnt++;
+        }
+    }
+    qsort(pl->skip, pl->skipcnt, sizeof(uint32_t), mf_chk_pipeline_cmp_u32);
+
+    pl->filecnt = pl->dict.count;
+    pl->dupcnt = pl->skipcnt;
+    return PM3_SUCCESS;
+}
+
+// copies up to cnt keys of the compiled dictionary, starting at the n-th one not skipped
+static uint32_t mf_chk_pipeline_copy_dict(const mf_chk_pipeline_t *pl, uint32_t n, uint32_t cnt, uint8_t *out) {
+
+    uint32_t s = 0;
+    uint32_t keyno = n;
+    while (s < pl->skipcnt && pl->skip[s] <= keyno) {
+        keyno++;
+        s++;
+    }
+
+    uint32_t size = 0;
+    for (; size < cnt && keyno < pl->dict.count; keyno++) {
+        if (s < pl->skipcnt && pl->skip[s] == keyno) {
+            s++;
+            continue;
+        }
+        memcpy(out + (size * MIFARE_KEY_SIZE), pl->dict.keys + ((size_t)keyno * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+        size++;
+    }
+    return size;
+}
+
+// copies up to chunksize keys starting at pos into chunk.
+// Blocks until a full chunk plus at least one key beyond it is available, or the reader is done,
+// so a chunk is only flagged as last when no more keys can follow.
+static uint32_t mf_chk_pipeline_next(mf_chk_pipeline_t *pl, uint32_t pos, uint32_t chunksize, uint8_t *chunk, bool *last) {
+    pthread_mutex_lock(&pl->lock);
+    while (pl->done == false && pl->keycnt - pos <= chunksize) {
+        pthread_cond_wait(&pl->cond, &pl->lock);
+    }
+
+    uint32_t size = 0;
+    if (pos < pl->keycnt) {
+        size = MIN(pl->keycnt - pos, chunksize);
+        memcpy(chunk, pl->keys + (pos * MIFARE_KEY_SIZE), size * MIFARE_KEY_SIZE);
+    }
+    uint32_t dictend = pl->keycnt + pl->dict.count - pl->skipcnt;
+    if (size < chunksize && pos + size < dictend) {
+        size += mf_chk_pipeline_copy_dict(pl, pos + size - pl->keycnt, chunksize - size, chunk + (size * MIFARE_KEY_SIZE));
+    }
+    uint32_t total = dictend + pl->tailcnt;
+    if (size < chunksize && pos + size < total) {
+        uint32_t t = pos + size - dictend;
+        uint32_t n = MIN(total - (pos + size), chunksize - size);
+        memcpy(chunk + (size * MIFARE_KEY_SIZE), pl->tail + (t * MIFARE_KEY_SIZE), n * MIFARE_KEY_SIZE);
+        size += n;
+    }
+    *last = pl->done && (pos + size == total);
+    pthread_mutex_unlock(&pl->lock);
+    return size;
+}
+
+static uint32_t mf_chk_pipeline_count(mf_chk_pipeline_t *pl) {
+    pthread_mutex_lock(&pl->lock);
+    uint32_t n = pl->keycnt + pl->dict.count - pl->skipcnt + pl->tailcnt;
+    pthread_mutex_unlock(&pl->lock);
+    return n;
+}
+
+static void mf_chk_pipeline_free(mf_chk_pipeline_t *pl) {
+    pthread_mutex_destroy(&pl->lock);
+    pthread_cond_destroy(&pl->cond);
+    dictionary_close(&pl->dict);
+    free(pl->skip);
+    free(pl->keys);
+    free(pl->seen);
+}
+
 static int CmdHF14AMfChk_fast(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf mf fchk",
-                  "This is a improved checkkeys method speedwise. It checks MIFARE Classic tags sector keys against a dictionary file with keys",
+                  "This is a improved checkkeys method speedwise. It checks MIFARE Classic tags sector keys against a dictionary file with keys.\n"
+                  "Keys from the key database `~/.proxmark3/mfc_keydb.txt` that match the card are tried first, best match first,\n"
+                  "the other database keys after the dictionary.",
                   "hf mf fchk --mini -k FFFFFFFFFFFF              --> Key recovery against MIFARE Mini\n"
                   "hf mf fchk --1k -k FFFFFFFFFFFF                --> Key recovery against MIFARE Classic 1k\n"
                   "hf mf fchk --2k -k FFFFFFFFFFFF                --> Key recovery against MIFARE 2k\n"
@@ -3883,7 +4615,9 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
                   "hf mf fchk --1k -f mfc_default_keys.dic        --> Target 1K using default dictionary file\n"
                   "hf mf fchk --1k --emu                          --> Target 1K, write keys to emulator memory\n"
                   "hf mf fchk --1k --dump                         --> Target 1K, write keys to file\n"
-                  "hf mf fchk --1k --mem                          --> Target 1K, use dictionary from flash memory");
+                  "hf mf fchk --1k --mem                          --> Target 1K, use dictionary from flash memory\n"
+                  "hf mf fchk --1k -f mfc_default_keys --chunk 40 --> Target 1K, send 40 keys per chunk\n"
+                  "hf mf fchk --1k --ns                           --> Target 1K, don't add found keys to key database");
 
     void *argtable[] = {
         arg_param_begin,
@@ -3900,6 +4634,8 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
         arg_lit0("a", NULL, "single block recovery key A"),
         arg_lit0("b", NULL, "single block recovery key B"),
         arg_lit0(NULL, "no-default", "Skip check default keys"),
+        arg_int0(NULL, "chunk", "<dec>", "keys per chunk sent to device (def 85)"),
+        arg_lit0(NULL, "ns", "No save of found keys to key database"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -3931,6 +4667,8 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
         keytype = MF_KEY_B;
     }
     bool load_default = ! arg_get_lit(ctx, 13);
+    int chunkarg = arg_get_int_def(ctx, 14, PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE);
+    bool no_save = arg_get_lit(ctx, 15);
 
     CLIParserFree(ctx);
 
@@ -3943,6 +4681,11 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
         m1 = true;
     }
 
+    if (chunkarg < 1 || chunkarg > (PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE)) {
+        PrintAndLogEx(WARNING, "Chunk size must be between 1 and %u", (uint32_t)(PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE));
+        return PM3_EINVARG;
+    }
+
     uint8_t sectorsCnt = MIFARE_1K_MAXSECTOR;
     if (m0) {
         sectorsCnt = MIFARE_MINI_MAXSECTOR;
@@ -3964,25 +4707,100 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     if (use_flashmemory) {
         fnlen = 0;
     }
-    int ret = mf_load_keys(&keyBlock, &keycnt, key, keylen, filename, fnlen, load_default);
+    // the dictionary file itself is streamed by the pipeline below
+    int ret = mf_load_keys(&keyBlock, &keycnt, key, keylen, filename, 0, load_default, NULL);
     if (ret != PM3_SUCCESS) {
         return ret;
     }
 
+    // strong key database keys go first, the weak ones after the dictionary
+    mfkeydb_fp_t keydb_fp = { .sectors = sectorsCnt };
+    uint32_t weakcnt = 0;
+    ret = mfkeydb_prepend(&keydb_fp, &keyBlock, &keycnt, keylen / MIFARE_KEY_SIZE, &weakcnt);
+    if (ret != PM3_SUCCESS) {
+        PrintAndLogEx(DEBUG, "key database not used ( %d )", ret);
+    }
+    if (fnlen == 0) {
+        weakcnt = 0;
+    }
+
+    mf_chk_pipeline_t pl;
+    memset(&pl, 0, sizeof(pl));
+    pthread_mutex_init(&pl.lock, NULL);
+    pthread_cond_init(&pl.cond, NULL);
+    pl.filename = filename;
+    if (weakcnt) {
+        pl.tail = keyBlock + ((size_t)(keycnt - weakcnt) * MIFARE_KEY_SIZE);
+        pl.tailpending = weakcnt;
+    }
+    pl.seen_mask = 0xFFF;
+    pl.seen = calloc(pl.seen_mask + 1, sizeof(uint64_t));
+    if (pl.seen == NULL || mf_chk_pipeline_add(&pl, keyBlock, keycnt - weakcnt) != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        mf_chk_pipeline_free(&pl);
+        free(keyBlock);
+        return PM3_EMALLOC;
+    }
+
+    // first block is read here, so a missing dictionary fails before touching the card
+    bool reader_running = false;
+    pthread_t reader;
+    pl.done = true;
+    if (fnlen > 0 && mf_chk_pipeline_open(&pl) == PM3_SUCCESS) {
+        if (pl.filecnt == 0) {
+            PrintAndLogEx(FAILED, "An error occurred while loading the dictionary!");
+            mf_chk_pipeline_free(&pl);
+            free(keyBlock);
+            return PM3_EFILE;
+        }
+        mf_chk_pipeline_tail(&pl);
+    } else if (fnlen > 0) {
+        uint8_t *buf = calloc(MF_CHK_PIPELINE_BLOCK, MIFARE_KEY_SIZE);
+        int res = (buf) ? mf_chk_pipeline_read(&pl, buf) : PM3_EMALLOC;
+        free(buf);
+        if ((res != PM3_SUCCESS && res != 1) || pl.filecnt == 0) {
+            PrintAndLogEx(FAILED, "An error occurred while loading the dictionary!");
+            mf_chk_pipeline_free(&pl);
+            free(keyBlock);
+            return PM3_EFILE;
+        }
+
+        if (res == PM3_SUCCESS) {
+            mf_chk_pipeline_tail(&pl);
+        } else {
+            pl.done = false;
+            if (pthread_create(&reader, NULL, mf_chk_pipeline_reader, &pl) != 0) {
+                PrintAndLogEx(WARNING, "Failed to start dictionary reader");
+                mf_chk_pipeline_free(&pl);
+                free(keyBlock);
+                return PM3_ESOFT;
+            }
+            reader_running = true;
+        }
+    }
+
     // create/initialize key storage structure
     sector_t *e_sector = NULL;
     if (initSectorTable(&e_sector, sectorsCnt) != PM3_SUCCESS) {
+        if (reader_running) {
+            __atomic_store_n(&pl.abort, true, __ATOMIC_RELAXED);
+            pthread_join(reader, NULL);
+        }
+        mf_chk_pipeline_free(&pl);
         free(keyBlock);
         return PM3_EMALLOC;
     }
 
-    uint32_t chunksize = (keycnt > (PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE)) ? (PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE) : keycnt;
+    uint32_t chunksize = chunkarg;
+    uint8_t chunk[PM3_CMD_DATA_SIZE] = {0};
     bool firstChunk = true, lastChunk = false;
 
     int i = 0;
 
     // time
     uint64_t t1 = msclock();
+    uint64_t device_time = 0;
+    uint64_t keys_tested = 0;
 
     uint16_t singleSectorParams = 0;
     if (blockn != -1) {
@@ -3998,7 +4816,8 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
             PrintAndLogEx(INFO, "Running strategy " _YELLOW_("%u"), strategy);
 
             // main keychunk loop
-            for (i = 0; i < keycnt; i += chunksize) {
+            uint32_t pos = 0;
+            for (;;) {
 
                 if (kbd_enter_pressed()) {
                     clearCommandBuffer();
@@ -4009,13 +4828,17 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
                     goto out;
                 }
 
-                uint32_t size = ((keycnt - i)  > chunksize) ? chunksize : keycnt - i;
-
-                // last chunk?
-                if (size == keycnt - i) {
-                    lastChunk = true;
+                uint32_t size = mf_chk_pipeline_next(&pl, pos, chunksize, chunk, &lastChunk);
+                if (size == 0) {
+                    break;
                 }
-                int res = mf_check_keys_fast_ex(sectorsCnt, firstChunk, lastChunk, strategy, size, keyBlock + (i * MIFARE_KEY_SIZE), e_sector, false, false, true, singleSectorParams);
+
+                uint64_t t2 = msclock();
+                int res = mf_check_keys_fast_ex(sectorsCnt, firstChunk, lastChunk, strategy, size, chunk, e_sector, false, false, true, singleSectorParams);
+                device_time += msclock() - t2;
+                keys_tested += size;
+                pos += size;
+
                 if (firstChunk)
                     firstChunk = false;
 
@@ -4024,10 +4847,16 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
                     PrintAndLogEx(NORMAL, "");
                     goto out;
                 }
-                PrintAndLogEx(INPLACE, "Testing %5i/%5i ( " _YELLOW_("%02.1f %%") " )", i, keycnt, (float)i * 100 / keycnt);
+
+                uint32_t total = mf_chk_pipeline_count(&pl);
+                PrintAndLogEx(INPLACE, "Testing %5u/%5u ( " _YELLOW_("%02.1f %%") " )", pos, total, (float)pos * 100 / total);
+
+                if (lastChunk) {
+                    break;
+                }
             } // end chunks of keys
 
-            PrintAndLogEx(INPLACE, "Testing %5i/%5i ( " _YELLOW_("100 %%") " )  ", keycnt, keycnt);
+            PrintAndLogEx(INPLACE, "Testing %5u/%5u ( " _YELLOW_("100 %%") " )  ", pos, pos);
             PrintAndLogEx(NORMAL, "");
 
             // reset chunks when swapping strategies
@@ -4041,7 +4870,26 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     }
 out:
     t1 = msclock() - t1;
-    PrintAndLogEx(INFO, "Time in checkkeys (fast) " _YELLOW_("%.1fs") "\n", (float)(t1 / 1000.0));
+
+    if (reader_running) {
+        __atomic_store_n(&pl.abort, true, __ATOMIC_RELAXED);
+        pthread_join(reader, NULL);
+    }
+
+    if (fnlen > 0) {
+        if (pl.res != PM3_SUCCESS && pl.res != PM3_EOPABORTED) {
+            PrintAndLogEx(WARNING, "Dictionary reading stopped early ( %d )", pl.res);
+        }
+        PrintAndLogEx(SUCCESS, "loaded " _GREEN_("%u") " keys from dictionary file, " _YELLOW_("%u") " duplicates skipped", pl.filecnt, pl.dupcnt);
+    }
+
+    PrintAndLogEx(INFO, "Time in checkkeys (fast) " _YELLOW_("%.1fs"), (float)(t1 / 1000.0));
+
+    if (use_flashmemory == false && t1 > 0) {
+        PrintAndLogEx(INFO, "Keys checked... " _YELLOW_("%" PRIu64) " ( " _YELLOW_("%.0f") " keys/s )", keys_tested, (float)keys_tested * 1000 / t1);
+        PrintAndLogEx(INFO, "Device idle.... " _YELLOW_("%.1f %%") " ( chunk size %u )", (float)(t1 - MIN(device_time, t1)) * 100 / t1, chunksize);
+    }
+    PrintAndLogEx(NORMAL, "");
 
     if (blockn != -1) {
         goto out2;
@@ -4064,6 +4912,11 @@ out:
 
         printKeyTable(sectorsCnt, e_sector);
 
+        // Remember them for the next card of the same site
+        if (no_save == false) {
+            mfkeydb_record(&keydb_fp, sectorsCnt, e_sector);
+        }
+
         if (use_flashmemory && found_keys == (sectorsCnt << 1)) {
             PrintAndLogEx(SUCCESS, "Card dumped as well. run " _YELLOW_("`%s %c`"),
                           "hf mf esave",
@@ -4108,6 +4961,7 @@ out:
         }
     }
 out2:
+    mf_chk_pipeline_free(&pl);
     free(keyBlock);
     free(e_sector);
     PrintAndLogEx(NORMAL, "");
@@ -4444,7 +5298,7 @@ static int CmdHF14AMfChk(const char *Cmd) {
 
     uint8_t *keyBlock = NULL;
     uint32_t keycnt = 0;
-    int res = mf_load_keys(&keyBlock, &keycnt, key, keylen, filename, fnlen, load_default);
+    int res = mf_load_keys(&keyBlock, &keycnt, key, keylen, filename, fnlen, load_default, NULL);
     if (res != PM3_SUCCESS) {
         return res;
     }
@@ -10423,7 +11277,7 @@ static int CmdHF14AMfInfo(const char *Cmd) {
     int sectorsCnt = 2;
     uint8_t *keyBlock = NULL;
     uint32_t keycnt = 0;
-    res = mf_load_keys(&keyBlock, &keycnt, key, MIFARE_KEY_SIZE * 2, NULL, 0, true);
+    res = mf_load_keys(&keyBlock, &keycnt, key, MIFARE_KEY_SIZE * 2, NULL, 0, true, NULL);
     if (res != PM3_SUCCESS) {
         return res;
     }
@@ -32,6 +32,11 @@
 #include <time.h> // MingW
 #include <lz4frame.h>
 #include <bzlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "commonutil.h"  // ARRAYLEN
 #include "comms.h"
@@ -44,6 +49,7 @@
 #include "hardnested_bf_core.h"
 #include "hardnested_bitarray_core.h"
 #include "fileutils.h"
+#include "crc32.h"
 
 #define NUM_CHECK_BITFLIPS_THREADS      (num_CPUs())
 #define NUM_REDUCTION_WORKING_THREADS   (num_CPUs())
@@ -274,248 +280,508 @@ static void init_bunzip2(bz_stream *compressed_stream, char *input_buffer, uint3
 
 }
 
-static void init_bitflip_bitarrays(void) {
-#if defined (DEBUG_REDUCTION)
-    uint8_t line = 0;
-#endif
-    uint64_t init_bitflip_bitarrays_starttime = msclock();
+//----------------------------------------------------------------------------
+// The bitflip tables are decompressed by NUM_TABLE_LOADING_THREADS workers.
+// With `hf mf hardnested --cache` the uncompressed tables are also written to
+// a single file in the user folder. Later runs map that file instead and the
+// tables are paged in on demand:
+//   bitflip_cache_header_t | bitflip_cache_entry_t[2][0x400] | pad | tables
+// Tables start on a BITFLIP_CACHE_ALIGN boundary. The cache is only used as
+// long as the compressed tables it was made from are unchanged.
+//----------------------------------------------------------------------------
+#define NUM_TABLE_LOADING_THREADS       (num_CPUs())
+#define BITFLIP_TABLE_SIZE              (sizeof(uint32_t) * (1 << 19))
+#define BITFLIP_CACHE_FILE              "hardnested_tables.bin"
+#define BITFLIP_CACHE_MAGIC             "PM3H"
+#define BITFLIP_CACHE_VERSION           1
+#define BITFLIP_CACHE_ALIGN             4096
+#define BITFLIP_CACHE_NO_TABLE          0xFFFFFFFF
+
+typedef enum {
+    TABLE_MISSING = 0,
+    TABLE_RAW,
+    TABLE_LZ4,
+    TABLE_BZ2
+} table_format_t;
+
+typedef struct {
+    char *path;
+    table_format_t format;
+    uint32_t count;
+    uint32_t *bitset;       // NULL if the table is ignored
+    int error;              // exit code if loading failed
+} bitflip_table_t;
+
+typedef struct {
+    uint8_t magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t num_tables;
+    uint32_t table_size;
+    uint32_t source_crc;    // crc32 over number, format, size and time of the compressed tables
+    uint32_t crc;           // crc32 over this header (with crc = 0) and the entries
+} PACKED bitflip_cache_header_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t slot;          // table number in the cache file, or BITFLIP_CACHE_NO_TABLE
+} PACKED bitflip_cache_entry_t;
+
+typedef struct {
+    uint16_t index;
+    uint8_t format;
+    uint64_t size;
+    int64_t mtime;
+} PACKED bitflip_source_t;
+
+static bool bitflip_cache_save = false;
+static void *bitflip_cache_base = NULL;
+static size_t bitflip_cache_size = 0;
+static uint32_t bitflip_tables_next = 0;
+
+void hardnested_set_table_cache(bool save) {
+    bitflip_cache_save = save;
+}
+
+static size_t bitflip_cache_data_offset(void) {
+    size_t offset = sizeof(bitflip_cache_header_t) + 2 * 0x400 * sizeof(bitflip_cache_entry_t);
+    return (offset + BITFLIP_CACHE_ALIGN - 1) & ~((size_t)BITFLIP_CACHE_ALIGN - 1);
+}
+
+static uint32_t bitflip_cache_crc(const bitflip_cache_header_t *hdr, const bitflip_cache_entry_t *entries) {
+    size_t n = sizeof(bitflip_cache_header_t) + 2 * 0x400 * sizeof(bitflip_cache_entry_t);
+    uint8_t *d = calloc(n, sizeof(uint8_t));
+    if (d == NULL) {
+        return 0;
+    }
+    memcpy(d, hdr, sizeof(bitflip_cache_header_t));
+    ((bitflip_cache_header_t *)d)->crc = 0;
+    memcpy(d + sizeof(bitflip_cache_header_t), entries, 2 * 0x400 * sizeof(bitflip_cache_entry_t));
+    uint32_t crc = 0;
+    crc32_ex(d, n, (uint8_t *)&crc);
+    free(d);
+    return crc;
+}
+
+static char *bitflip_cache_path(void) {
+    const char *user_path = get_my_user_directory();
+    if (user_path == NULL) {
+        return NULL;
+    }
+    size_t n = strlen(user_path) + strlen(PM3_USER_DIRECTORY) + strlen(BITFLIP_CACHE_FILE) + 1;
+    char *fn = calloc(n, sizeof(char));
+    if (fn != NULL) {
+        snprintf(fn, n, "%s%s%s", user_path, PM3_USER_DIRECTORY, BITFLIP_CACHE_FILE);
+    }
+    return fn;
+}
+
+// find the table files and fingerprint them, so a stale cache can be detected
+static uint32_t find_bitflip_tables(bitflip_table_t *tables) {
+
+    static const char *templates[] = {STATE_FILE_TEMPLATE_RAW, STATE_FILE_TEMPLATE_LZ4, STATE_FILE_TEMPLATE_BZ2};
+
+    bitflip_source_t *sources = calloc(2 * 0x400, sizeof(bitflip_source_t));
+    uint32_t nsources = 0;
 
     char state_file_name[MAX(sizeof(STATE_FILE_TEMPLATE_RAW), MAX(sizeof(STATE_FILE_TEMPLATE_LZ4), sizeof(STATE_FILE_TEMPLATE_BZ2)))];
-    char state_files_path[strlen(get_my_executable_directory()) + strlen(STATE_FILES_DIRECTORY) + sizeof(state_file_name)];
-    uint16_t nraw = 0, nlz4 = 0, nbz2 = 0;
+    char state_files_path[strlen(STATE_FILES_DIRECTORY) + sizeof(state_file_name)];
+
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-        num_effective_bitflips[odd_even] = 0;
         for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
-            bool open_uncompressed = false;
-            bool open_lz4compressed = false;
-            bool open_bz2compressed = false;
-
-            bitflip_bitarrays[odd_even][bitflip] = NULL;
-            count_bitflip_bitarrays[odd_even][bitflip] = 1 << 24;
-
-            char *path;
-            snprintf(state_file_name, sizeof(state_file_name), STATE_FILE_TEMPLATE_RAW, odd_even, bitflip);
-            strncpy(state_files_path, STATE_FILES_DIRECTORY, sizeof(state_files_path) - 1);
-            strncat(state_files_path, state_file_name, sizeof(state_files_path) - (strlen(STATE_FILES_DIRECTORY) + 1));
-            if (searchFile(&path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
-                open_uncompressed = true;
-            } else {
-                snprintf(state_file_name, sizeof(state_file_name), STATE_FILE_TEMPLATE_LZ4, odd_even, bitflip);
-                strncpy(state_files_path, STATE_FILES_DIRECTORY, sizeof(state_files_path) - 1);
-                strncat(state_files_path, state_file_name, sizeof(state_files_path) - (strlen(STATE_FILES_DIRECTORY) + 1));
-                if (searchFile(&path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
-                    open_lz4compressed = true;
-                } else {
-                    snprintf(state_file_name, sizeof(state_file_name), STATE_FILE_TEMPLATE_BZ2, odd_even, bitflip);
-                    strncpy(state_files_path, STATE_FILES_DIRECTORY, sizeof(state_files_path) - 1);
-                    strncat(state_files_path, state_file_name, sizeof(state_files_path) - (strlen(STATE_FILES_DIRECTORY) + 1));
-                    if (searchFile(&path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
-                        open_bz2compressed = true;
-                    } else {
-                        continue;
-                    }
+            bitflip_table_t *t = &tables[odd_even * 0x400 + bitflip];
+            for (uint8_t i = 0; i < ARRAYLEN(templates); i++) {
+                snprintf(state_file_name, sizeof(state_file_name), templates[i], odd_even, bitflip);
+                snprintf(state_files_path, sizeof(state_files_path), "%s%s", STATE_FILES_DIRECTORY, state_file_name);
+                if (searchFile(&t->path, RESOURCES_SUBDIR, state_files_path, "", true) == PM3_SUCCESS) {
+                    t->format = TABLE_RAW + i;
+                    break;
                 }
             }
 
-            FILE *statesfile = fopen(path, "rb");
-            free(path);
-            if (statesfile == NULL) {
+            struct stat st;
+            if (t->format == TABLE_MISSING || sources == NULL || stat(t->path, &st) != 0) {
                 continue;
             }
+            sources[nsources].index = odd_even * 0x400 + bitflip;
+            sources[nsources].format = t->format;
+            sources[nsources].size = st.st_size;
+            sources[nsources].mtime = st.st_mtime;
+            nsources++;
+        }
+    }
 
-            fseek(statesfile, 0, SEEK_END);
-            int fsize = ftell(statesfile);
-            if (fsize == -1) {
-                PrintAndLogEx(ERR, "File read error with %s. Aborting...\n", state_file_name);
-                fclose(statesfile);
-                exit(5);
-            }
-            uint32_t filesize = (uint32_t)fsize;
-            rewind(statesfile);
+    uint32_t crc = 0;
+    if (sources != NULL) {
+        crc32_ex((uint8_t *)sources, nsources * sizeof(bitflip_source_t), (uint8_t *)&crc);
+        free(sources);
+    }
+    return crc;
+}
 
-            if (open_uncompressed) {
+// decompress one table into buf, which holds the count and the table
+static void load_bitflip_table(bitflip_table_t *t, uint8_t *buf) {
 
-                uint32_t count = 0;
-                size_t bytesread = fread(&count, 1, sizeof(count), statesfile);
-                if (bytesread != 4) {
-                    PrintAndLogEx(ERR, "File read error with %s. Aborting...\n", state_file_name);
-                    fclose(statesfile);
-                    exit(5);
-                }
+    const size_t expected_output_size = BITFLIP_TABLE_SIZE + sizeof(uint32_t);
 
-                if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
-                    if (bitset == NULL) {
-                        PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
-                        fclose(statesfile);
-                        exit(4);
-                    }
+    FILE *statesfile = fopen(t->path, "rb");
+    if (statesfile == NULL) {
+        t->format = TABLE_MISSING;
+        return;
+    }
 
-                    bytesread = fread(bitset, 1, filesize - sizeof(count), statesfile);
-                    if (bytesread != filesize - sizeof(count)) {
-                        PrintAndLogEx(ERR, "File read error with %s. Aborting...\n", state_file_name);
-                        fclose(statesfile);
-                        exit(5);
-                    }
+    fseek(statesfile, 0, SEEK_END);
+    long fsize = ftell(statesfile);
+    rewind(statesfile);
+    if (fsize < (long)sizeof(uint32_t) || (t->format == TABLE_RAW && (size_t)fsize > expected_output_size)) {
+        PrintAndLogEx(ERR, "File read error with %s. Aborting...\n", t->path);
+        fclose(statesfile);
+        t->error = 5;
+        return;
+    }
+    uint32_t filesize = (uint32_t)fsize;
 
-                    effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
-                    bitflip_bitarrays[odd_even][bitflip] = bitset;
-                    count_bitflip_bitarrays[odd_even][bitflip] = count;
-#if defined (DEBUG_REDUCTION)
-                    PrintAndLogEx(INFO, "(%03" PRIx16 " %s:%5.1f%%) ", bitflip, odd_even ? "odd " : "even", (float)count / (1 << 24) * 100.0);
-                    line++;
-                    if (line == 8) {
-                        PrintAndLogEx(NORMAL, "");
-                        line = 0;
-                    }
-#endif
-                }
-                fclose(statesfile);
-                nraw++;
-                continue;
+    uint8_t *compressed_data = calloc(filesize, sizeof(uint8_t));
+    if (compressed_data == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
+        fclose(statesfile);
+        t->error = 4;
+        return;
+    }
 
-            } else if (open_lz4compressed) {
+    size_t bytesread = fread(compressed_data, 1, filesize, statesfile);
+    fclose(statesfile);
+    if (bytesread != filesize) {
+        PrintAndLogEx(ERR, "File read error with %s (2). Aborting...\n", t->path);
+        free(compressed_data);
+        t->error = 5;
+        return;
+    }
 
-                char *compressed_data = calloc(filesize, sizeof(uint8_t));
-                if (compressed_data == NULL) {
-                    PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
-                    fclose(statesfile);
-                    exit(4);
-                }
-                size_t bytesread = fread(compressed_data, 1, filesize, statesfile);
-                if (bytesread != filesize) {
-                    PrintAndLogEx(ERR, "File read error with %s (2). Aborting...\n", state_file_name);
-                    free(compressed_data);
-                    fclose(statesfile);
-                    exit(5);
-                }
-                fclose(statesfile);
+    if (t->format == TABLE_RAW) {
 
-                char *uncompressed_data = calloc((sizeof(uint32_t) * (1 << 19)) + sizeof(uint32_t), sizeof(uint8_t));
-                if (uncompressed_data == NULL) {
-                    PrintAndLogEx(ERR,   "Out of memory error in init_bitflip_statelists(). Aborting...\n");
-                    free(compressed_data);
-                    exit(4);
-                }
+        memset(buf, 0, expected_output_size);
+        memcpy(buf, compressed_data, filesize);
 
-                LZ4F_decompressionContext_t ctx;
-                LZ4F_errorCode_t result = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
-                if (LZ4F_isError(result)) {
-                    PrintAndLogEx(ERR, "File read error with %s (3) Failed to create decompression context: %s. Aborting...\n", state_file_name, LZ4F_getErrorName(result));
-                    free(compressed_data);
-                    free(uncompressed_data);
-                    exit(5);
-                }
+    } else if (t->format == TABLE_LZ4) {
 
-                size_t expected_output_size = (sizeof(uint32_t) * (1 << 19)) + sizeof(uint32_t);
-                size_t consumed_input_size = filesize;
-                size_t generated_output_size = expected_output_size;
-                result = LZ4F_decompress(ctx, uncompressed_data, &generated_output_size, compressed_data, &consumed_input_size, NULL);
+        LZ4F_decompressionContext_t ctx;
+        LZ4F_errorCode_t result = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
+        if (LZ4F_isError(result)) {
+            PrintAndLogEx(ERR, "File read error with %s (3) Failed to create decompression context: %s. Aborting...\n", t->path, LZ4F_getErrorName(result));
+            free(compressed_data);
+            t->error = 5;
+            return;
+        }
 
-                LZ4F_freeDecompressionContext(ctx);
-                free(compressed_data);
+        size_t consumed_input_size = filesize;
+        size_t generated_output_size = expected_output_size;
+        result = LZ4F_decompress(ctx, buf, &generated_output_size, compressed_data, &consumed_input_size, NULL);
+        LZ4F_freeDecompressionContext(ctx);
 
-                if (LZ4F_isError(result)) {
-                    PrintAndLogEx(ERR, "File read error with %s (3) %s. Aborting...\n", state_file_name, LZ4F_getErrorName(result));
-                    free(uncompressed_data);
-                    exit(5);
-                }
-                if (generated_output_size != expected_output_size) {
-                    PrintAndLogEx(ERR, "File read error with %s (3) got %lu instead of %lu bytes. Aborting...\n", state_file_name, generated_output_size, expected_output_size);
-                    free(uncompressed_data);
-                    exit(5);
-                }
+        if (LZ4F_isError(result)) {
+            PrintAndLogEx(ERR, "File read error with %s (3) %s. Aborting...\n", t->path, LZ4F_getErrorName(result));
+            free(compressed_data);
+            t->error = 5;
+            return;
+        }
+        if (generated_output_size != expected_output_size) {
+            PrintAndLogEx(ERR, "File read error with %s (3) got %zu instead of %zu bytes. Aborting...\n", t->path, generated_output_size, expected_output_size);
+            free(compressed_data);
+            t->error = 5;
+            return;
+        }
 
-                uint32_t count;
-                memcpy(&count, uncompressed_data, sizeof(uint32_t));
+    } else if (t->format == TABLE_BZ2) {
 
-                if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
-                    if (bitset == NULL) {
-                        PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
-                        free(uncompressed_data);
-                        exit(4);
-                    }
-                    memcpy(bitset, uncompressed_data + sizeof(uint32_t), sizeof(uint32_t) * (1 << 19));
-                    effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
-                    bitflip_bitarrays[odd_even][bitflip] = bitset;
-                    count_bitflip_bitarrays[odd_even][bitflip] = count;
+        bz_stream compressed_stream;
+        init_bunzip2(&compressed_stream, (char *)compressed_data, filesize, (char *)buf, expected_output_size);
+        int res = BZ2_bzDecompress(&compressed_stream);
+        BZ2_bzDecompressEnd(&compressed_stream);
+        if (res != BZ_OK && res != BZ_STREAM_END) {
+            PrintAndLogEx(ERR, "Bunzip2 error. Aborting...\n");
+            free(compressed_data);
+            t->error = 4;
+            return;
+        }
+    }
+    free(compressed_data);
+
+    memcpy(&t->count, buf, sizeof(uint32_t));
+
+    if ((float)t->count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
+        t->bitset = (uint32_t *)malloc_bitarray(BITFLIP_TABLE_SIZE);
+        if (t->bitset == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
+            t->error = 4;
+            return;
+        }
+        memcpy(t->bitset, buf + sizeof(uint32_t), BITFLIP_TABLE_SIZE);
+    }
+}
+
+static void *load_bitflip_tables_thread(void *args) {
+    bitflip_table_t *tables = ((bitflip_table_t **)args)[0];
+    uint8_t *buf = ((uint8_t **)args)[1];
+
+    for (;;) {
+        uint32_t i = __atomic_fetch_add(&bitflip_tables_next, 1, __ATOMIC_RELAXED);
+        if (i >= 2 * 0x400) {
+            break;
+        }
+        if (tables[i].format != TABLE_MISSING) {
+            load_bitflip_table(&tables[i], buf);
+        }
+    }
+    return NULL;
+}
+
+static uint16_t load_bitflip_tables(bitflip_table_t *tables) {
+
+    uint16_t num_threads = NUM_TABLE_LOADING_THREADS;
+    pthread_t thread_id[num_threads];
+    void *args[num_threads][2];
+
+    __atomic_store_n(&bitflip_tables_next, 0, __ATOMIC_RELAXED);
+
+    for (uint16_t i = 0; i < num_threads; i++) {
+        args[i][0] = tables;
+        args[i][1] = calloc(BITFLIP_TABLE_SIZE + sizeof(uint32_t), sizeof(uint8_t));
+        if (args[i][1] == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
+            exit(4);
+        }
+    }
+
+    for (uint16_t i = 0; i < num_threads; i++) {
+        pthread_create(&thread_id[i], NULL, load_bitflip_tables_thread, args[i]);
+    }
+
+    for (uint16_t i = 0; i < num_threads; i++) {
+        pthread_join(thread_id[i], NULL);
+        free(args[i][1]);
+    }
+
+    for (uint16_t i = 0; i < 2 * 0x400; i++) {
+        if (tables[i].error) {
+            exit(tables[i].error);
+        }
+    }
+    return num_threads;
+}
+
+#ifndef _WIN32
+static bool bitflip_cache_open(const char *fn, uint32_t source_crc, bitflip_table_t *tables) {
+
+    FILE *f = fopen(fn, "rb");
+    if (f == NULL) {
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    if (fsize < (long)bitflip_cache_data_offset()) {
+        fclose(f);
+        return false;
+    }
+
+    void *base = mmap(NULL, fsize, PROT_READ, MAP_SHARED, fileno(f), 0);
+    fclose(f);
+    if (base == MAP_FAILED) {
+        PrintAndLogEx(DEBUG, "failed to map tables cache `%s`", fn);
+        return false;
+    }
+
+    const bitflip_cache_header_t *hdr = (const bitflip_cache_header_t *)base;
+    const bitflip_cache_entry_t *entries = (const bitflip_cache_entry_t *)((uint8_t *)base + sizeof(bitflip_cache_header_t));
+
+    if (memcmp(hdr->magic, BITFLIP_CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+            hdr->version != BITFLIP_CACHE_VERSION ||
+            hdr->table_size != BITFLIP_TABLE_SIZE ||
+            hdr->source_crc != source_crc ||
+            bitflip_cache_data_offset() + (size_t)hdr->num_tables * BITFLIP_TABLE_SIZE != (size_t)fsize ||
+            hdr->crc != bitflip_cache_crc(hdr, entries)) {
+        PrintAndLogEx(DEBUG, "ignoring outdated tables cache `%s`", fn);
+        munmap(base, fsize);
+        return false;
+    }
+
+    for (uint16_t i = 0; i < 2 * 0x400; i++) {
+        if (tables[i].format == TABLE_MISSING) {
+            continue;
+        }
+        tables[i].count = entries[i].count;
+        if (entries[i].slot != BITFLIP_CACHE_NO_TABLE && entries[i].slot < hdr->num_tables) {
+            tables[i].bitset = (uint32_t *)((uint8_t *)base + bitflip_cache_data_offset() + (size_t)entries[i].slot * BITFLIP_TABLE_SIZE);
+        }
+    }
+
+    bitflip_cache_base = base;
+    bitflip_cache_size = fsize;
+    PrintAndLogEx(DEBUG, "using tables cache `%s`", fn);
+    return true;
+}
+
+static bool bitflip_cache_write(const char *fn, uint32_t source_crc, const bitflip_table_t *tables) {
+
+    bitflip_cache_entry_t *entries = calloc(2 * 0x400, sizeof(bitflip_cache_entry_t));
+    if (entries == NULL) {
+        return false;
+    }
+
+    bitflip_cache_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BITFLIP_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = BITFLIP_CACHE_VERSION;
+    hdr.table_size = BITFLIP_TABLE_SIZE;
+    hdr.source_crc = source_crc;
+
+    for (uint16_t i = 0; i < 2 * 0x400; i++) {
+        entries[i].count = tables[i].count;
+        entries[i].slot = (tables[i].bitset != NULL) ? hdr.num_tables++ : BITFLIP_CACHE_NO_TABLE;
+    }
+    hdr.crc = bitflip_cache_crc(&hdr, entries);
+
+    // write aside and rename, a concurrent client never maps a partial file
+    size_t n = strlen(fn) + 5;
+    char *tmp = calloc(n, sizeof(char));
+    if (tmp == NULL) {
+        free(entries);
+        return false;
+    }
+    snprintf(tmp, n, "%s.tmp", fn);
+
+    bool ok = false;
+    FILE *f = fopen(tmp, "wb");
+    if (f != NULL) {
+        size_t pad = bitflip_cache_data_offset() - sizeof(hdr) - 2 * 0x400 * sizeof(bitflip_cache_entry_t);
+        uint8_t zeros[BITFLIP_CACHE_ALIGN] = {0};
+        ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+        ok &= (fwrite(entries, sizeof(bitflip_cache_entry_t), 2 * 0x400, f) == 2 * 0x400);
+        ok &= (fwrite(zeros, 1, pad, f) == pad);
+        for (uint16_t i = 0; i < 2 * 0x400 && ok; i++) {
+            if (tables[i].bitset != NULL) {
+                ok &= (fwrite(tables[i].bitset, BITFLIP_TABLE_SIZE, 1, f) == 1);
+            }
+        }
+        ok &= (fclose(f) == 0);
+        ok = ok && (replaceFile(tmp, fn) == PM3_SUCCESS);
+        if (ok == false) {
+            remove(tmp);
+        }
+    }
+
+    free(tmp);
+    free(entries);
+    return ok;
+}
+#endif
+
+static void init_bitflip_bitarrays(void) {
 #if defined (DEBUG_REDUCTION)
-                    PrintAndLogEx(INFO, "(%03" PRIx16 " %s:%5.1f%%) ", bitflip, odd_even ? "odd " : "even", (float)count / (1 << 24) * 100.0);
-                    line++;
-                    if (line == 8) {
-                        PrintAndLogEx(NORMAL, "");
-                        line = 0;
-                    }
+    uint8_t line = 0;
 #endif
-                }
-                free(uncompressed_data);
-                nlz4++;
+    uint64_t init_bitflip_bitarrays_starttime = msclock();
+
+    bitflip_table_t *tables = calloc(2 * 0x400, sizeof(bitflip_table_t));
+    if (tables == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
+        exit(4);
+    }
+
+    uint32_t source_crc = find_bitflip_tables(tables);
+    bool from_cache = false;
+    uint16_t num_threads = 0;
+
+#ifndef _WIN32
+    char *cache_fn = bitflip_cache_path();
+    if (cache_fn != NULL) {
+        from_cache = bitflip_cache_open(cache_fn, source_crc, tables);
+    }
+#endif
+
+    if (from_cache == false) {
+        num_threads = load_bitflip_tables(tables);
+    }
+
+    uint16_t nraw = 0, nlz4 = 0, nbz2 = 0;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        num_effective_bitflips[odd_even] = 0;
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            bitflip_table_t *t = &tables[odd_even * 0x400 + bitflip];
+
+            bitflip_bitarrays[odd_even][bitflip] = NULL;
+            count_bitflip_bitarrays[odd_even][bitflip] = 1 << 24;
+
+            nraw += (t->format == TABLE_RAW);
+            nlz4 += (t->format == TABLE_LZ4);
+            nbz2 += (t->format == TABLE_BZ2);
+
+            if (t->bitset == NULL) {
                 continue;
-            } else if (open_bz2compressed) {
-
-                char input_buffer[filesize];
-                size_t bytesread = fread(input_buffer, 1, filesize, statesfile);
-                if (bytesread != filesize) {
-                    PrintAndLogEx(ERR, "File read error with %s. Aborting...\n", state_file_name);
-                    fclose(statesfile);
-                    exit(5);
-                }
-                fclose(statesfile);
-
-                uint32_t count = 0;
-                bz_stream compressed_stream;
-                init_bunzip2(&compressed_stream, input_buffer, filesize, (char *)&count, sizeof(count));
-                int res = BZ2_bzDecompress(&compressed_stream);
-                if (res != BZ_OK) {
-                    PrintAndLogEx(ERR, "Bunzip2 error. Aborting...\n");
-                    BZ2_bzDecompressEnd(&compressed_stream);
-                    exit(4);
-                }
-                if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
-                    if (bitset == NULL) {
-                        PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
-                        BZ2_bzDecompressEnd(&compressed_stream);
-                        exit(4);
-                    }
-                    compressed_stream.next_out = (char *)bitset;
-                    compressed_stream.avail_out = sizeof(uint32_t) * (1 << 19);
-                    res = BZ2_bzDecompress(&compressed_stream);
-                    if (res != BZ_OK && res != BZ_STREAM_END) {
-                        PrintAndLogEx(ERR, "Bunzip2 error. Aborting...\n");
-                        BZ2_bzDecompressEnd(&compressed_stream);
-                        exit(4);
-                    }
-                    effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
-                    bitflip_bitarrays[odd_even][bitflip] = bitset;
-                    count_bitflip_bitarrays[odd_even][bitflip] = count;
+            }
+
+            effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
+            bitflip_bitarrays[odd_even][bitflip] = t->bitset;
+            count_bitflip_bitarrays[odd_even][bitflip] = t->count;
 #if defined (DEBUG_REDUCTION)
-                    PrintAndLogEx(INFO, "(%03" PRIx16 " %s:%5.1f%%) ", bitflip, odd_even ? "odd " : "even", (float)count / (1 << 24) * 100.0);
-                    line++;
-                    if (line == 8) {
-                        PrintAndLogEx(NORMAL, "");
-                        line = 0;
-                    }
-#endif
-                }
-                BZ2_bzDecompressEnd(&compressed_stream);
-                nbz2++;
+            PrintAndLogEx(INFO, "(%03" PRIx16 " %s:%5.1f%%) ", bitflip, odd_even ? "odd " : "even", (float)t->count / (1 << 24) * 100.0);
+            line++;
+            if (line == 8) {
+                PrintAndLogEx(NORMAL, "");
+                line = 0;
             }
+#endif
         }
         effective_bitflip[odd_even][num_effective_bitflips[odd_even]] = 0x400; // EndOfList marker
     }
     {
         char progress_text[100];
         memset(progress_text, 0, sizeof(progress_text));
-        snprintf(progress_text, sizeof(progress_text), "Loaded " _YELLOW_("%u") " RAW / " _YELLOW_("%u") " LZ4 / " _YELLOW_("%u") " BZ2 in %4"PRIu64" ms"
-                 , nraw
-                 , nlz4
-                 , nbz2
-                 , msclock() - init_bitflip_bitarrays_starttime
-                );
+        if (from_cache) {
+            snprintf(progress_text, sizeof(progress_text), "Mapped %u tables from cache in %4"PRIu64" ms"
+                     , num_effective_bitflips[EVEN_STATE] + num_effective_bitflips[ODD_STATE]
+                     , msclock() - init_bitflip_bitarrays_starttime
+                    );
+        } else {
+            snprintf(progress_text, sizeof(progress_text), "Loaded " _YELLOW_("%u") " RAW / " _YELLOW_("%u") " LZ4 / " _YELLOW_("%u") " BZ2 in %4"PRIu64" ms (%u threads)"
+                     , nraw
+                     , nlz4
+                     , nbz2
+                     , msclock() - init_bitflip_bitarrays_starttime
+                     , num_threads
+                    );
+        }
         hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
     }
+
+#ifndef _WIN32
+    if (from_cache == false && bitflip_cache_save && cache_fn != NULL) {
+        uint64_t t1 = msclock();
+        char progress_text[100];
+        if (bitflip_cache_write(cache_fn, source_crc, tables)) {
+            snprintf(progress_text, sizeof(progress_text), "Saved %u tables to cache in %4"PRIu64" ms"
+                     , num_effective_bitflips[EVEN_STATE] + num_effective_bitflips[ODD_STATE]
+                     , msclock() - t1
+                    );
+            PrintAndLogEx(DEBUG, "wrote tables cache `%s`", cache_fn);
+        } else {
+            snprintf(progress_text, sizeof(progress_text), "Failed to save tables cache");
+        }
+        hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+    }
+    free(cache_fn);
+#else
+    if (bitflip_cache_save) {
+        hardnested_print_progress(0, "Tables cache is not supported on this platform", (float)(1LL << 47), 0);
+    }
+#endif
+
+    for (uint16_t i = 0; i < 2 * 0x400; i++) {
+        free(tables[i].path);
+    }
+    free(tables);
+
     uint16_t i = 0;
     uint16_t j = 0;
     num_all_effective_bitflips = 0;
@@ -558,6 +824,16 @@ static void init_bitflip_bitarrays(void) {
 }
 
 static void free_bitflip_bitarrays(void) {
+    if (bitflip_cache_base != NULL) {
+        // the tables point into the mapped cache file
+#ifndef _WIN32
+        munmap(bitflip_cache_base, bitflip_cache_size);
+#endif
+        bitflip_cache_base = NULL;
+        bitflip_cache_size = 0;
+        memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+        return;
+    }
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
         free_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
     }
@@ -1613,21 +1889,94 @@ static int simulate_acquire_nonces(void) {
     return PM3_SUCCESS;
 }
 
-static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename) {
+// adds one device round of nonces (9 byte records) and re-evaluates the key space.
+// Shared by the live acquisition and the replay of prefetched nonces.
+static int add_nonce_round(const uint8_t *bufp, uint16_t num_sampled_nonces, FILE *fnonces, bool time_budget, bool *reported_suma8, bool *completed) {
+
+    float brute_force_depth;
+
+    for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
+        uint32_t nt_enc1 = bytes_to_num(bufp, 4);
+        uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
+        uint8_t par_enc = bytes_to_num(bufp + 8, 1);
+
+
+        // PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
+        int add_res = add_nonce(nt_enc1, par_enc >> 4);
+        if (add_res == PM3_EMALLOC) {
+            return add_res;
+        }
+
+        num_acquired_nonces += add_res;
+
+        // PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
+        add_res = add_nonce(nt_enc2, par_enc & 0x0f);
+        if (add_res == PM3_EMALLOC) {
+            return add_res;
+        }
+        num_acquired_nonces += add_res;
+
+        if (fnonces) {
+            fwrite(bufp, 1, 9, fnonces);
+            fflush(fnonces);
+        }
+        bufp += 9;
+    }
+    //total_num_nonces += num_sampled_nonces;
+
+    if (first_byte_num == 256) {
+        if (hardnested_stage == CHECK_1ST_BYTES) {
+            bool got_match = false;
+            for (uint8_t i = 0; i < NUM_SUMS; i++) {
+                if (first_byte_Sum == sums[i]) {
+                    first_byte_Sum = i;
+                    got_match = true;
+                    break;
+                }
+            }
+
+            if (got_match == false) {
+                PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
+                return PM3_EWRONGANSWER;
+            }
+
+            hardnested_stage |= CHECK_2ND_BYTES;
+            apply_sum_a0();
+        }
+        update_nonce_data(time_budget);
+        *completed = shrink_key_space(&brute_force_depth);
+        if (*reported_suma8 == false) {
+            char progress_string[80];
+            snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
+            hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
+            *reported_suma8 = true;
+        } else {
+            hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+        }
+    } else {
+        update_nonce_data(time_budget);
+        *completed = shrink_key_space(&brute_force_depth);
+        hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+    }
+    return PM3_SUCCESS;
+}
+
+// resume keeps the nonces already added, e.g. from a prefetch, and only acquires until the key space is small enough
+static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename, bool resume) {
 
     last_sample_clock = msclock();
-    hardnested_stage = CHECK_1ST_BYTES;
-    num_acquired_nonces = 0;
+    if (resume == false) {
+        hardnested_stage = CHECK_1ST_BYTES;
+        num_acquired_nonces = 0;
 
-    // initial rough estimate. Will be refined.
-    sample_period = 2000;
+        // initial rough estimate. Will be refined.
+        sample_period = 2000;
+    }
 
     bool initialize = true;
     bool field_off = false;
     bool acquisition_completed = false;
-    bool reported_suma8 = false;
-
-    float brute_force_depth;
+    bool reported_suma8 = (hardnested_stage & CHECK_2ND_BYTES) != 0;
 
     FILE *fnonces = NULL;
 
@@ -1687,75 +2036,14 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
         if (initialize == false) {
 
             uint16_t num_sampled_nonces = resp.oldarg[2];
-            uint8_t *bufp = resp.data.asBytes;
-
-            for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
-                uint32_t nt_enc1 = bytes_to_num(bufp, 4);
-                uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
-                uint8_t par_enc = bytes_to_num(bufp + 8, 1);
-
-
-                // PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
-                int add_res = add_nonce(nt_enc1, par_enc >> 4);
-                if (add_res == PM3_EMALLOC) {
-                    DropField();
-                    return add_res;
-                }
-
-                num_acquired_nonces += add_res;
-
-                // PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
-                add_res = add_nonce(nt_enc2, par_enc & 0x0f);
-                if (add_res == PM3_EMALLOC) {
-                    DropField();
-                    return add_res;
-                }
-                num_acquired_nonces += add_res;
 
+            int res = add_nonce_round(resp.data.asBytes, num_sampled_nonces, fnonces, true, &reported_suma8, &acquisition_completed);
+            if (res != PM3_SUCCESS) {
                 if (nonce_file_write) {
-                    fwrite(bufp, 1, 9, fnonces);
-                    fflush(fnonces);
-                }
-                bufp += 9;
-            }
-            //total_num_nonces += num_sampled_nonces;
-
-            if (first_byte_num == 256) {
-                if (hardnested_stage == CHECK_1ST_BYTES) {
-                    bool got_match = false;
-                    for (uint8_t i = 0; i < NUM_SUMS; i++) {
-                        if (first_byte_Sum == sums[i]) {
-                            first_byte_Sum = i;
-                            got_match = true;
-                            break;
-                        }
-                    }
-
-                    if (got_match == false) {
-                        PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
-                        if (nonce_file_write) {
-                            fclose(fnonces);
-                        }
-                        return PM3_EWRONGANSWER;
-                    }
-
-                    hardnested_stage |= CHECK_2ND_BYTES;
-                    apply_sum_a0();
-                }
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                if (!reported_suma8) {
-                    char progress_string[80];
-                    snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
-                    hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
-                    reported_suma8 = true;
-                } else {
-                    hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+                    fclose(fnonces);
                 }
-            } else {
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+                DropField();
+                return res;
             }
         }
 
@@ -1800,6 +2088,114 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
     return PM3_SUCCESS;
 }
 
+// device side only, no hardnested state is touched so this can run while another key is being cracked.
+// Appends the raw 9 byte records to out until max_nonces are collected or stop() returns true.
+int mfnestedhard_prefetch(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool slow, uint32_t max_nonces, bool (*stop)(void *), void *stop_ctx, hardnested_nonces_t *out) {
+
+    bool initialize = true;
+    bool field_off = false;
+
+    PacketResponseNG resp;
+    memset(&resp, 0, sizeof(resp));
+
+    uint64_t t1 = msclock();
+
+    do {
+
+        if (field_off) {
+            DropField();
+            break;
+        }
+
+        uint32_t flags = 0;
+        flags |= initialize ? 0x0001 : 0;
+        flags |= slow ? 0x0002 : 0;
+        clearCommandBuffer();
+        SendCommandMIX(CMD_HF_MIFARE_ACQ_ENCRYPTED_NONCES, blockNo + keyType * 0x100, trgBlockNo + trgKeyType * 0x100, flags, key, 6);
+
+        if (initialize == false) {
+
+            uint32_t records = (resp.oldarg[2] + 1) / 2;
+            if (out->count + records > out->capacity) {
+                uint32_t newcap = (out->capacity) ? out->capacity : 256;
+                while (newcap < out->count + records) {
+                    newcap <<= 1;
+                }
+                uint8_t *p = realloc(out->data, (size_t)newcap * 9);
+                if (p == NULL) {
+                    PrintAndLogEx(WARNING, "Failed to allocate memory");
+                    DropField();
+                    return PM3_EMALLOC;
+                }
+                out->data = p;
+                out->capacity = newcap;
+            }
+            memcpy(out->data + ((size_t)out->count * 9), resp.data.asBytes, (size_t)records * 9);
+            out->count += records;
+            out->rounds++;
+
+            if ((out->count * 2) >= max_nonces || (stop && stop(stop_ctx))) {
+                field_off = true;
+            }
+        }
+
+        if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
+            DropField();
+            return PM3_ETIMEOUT;
+        }
+
+        // error during nested_hard
+        if (resp.oldarg[0]) {
+            DropField();
+            return resp.oldarg[0];
+        }
+
+        if (initialize) {
+            out->cuid = resp.oldarg[1];
+        }
+
+        initialize = false;
+
+    } while (true);
+
+    out->elapsed += msclock() - t1;
+    return PM3_SUCCESS;
+}
+
+void hardnested_nonces_free(hardnested_nonces_t *n) {
+    free(n->data);
+    memset(n, 0, sizeof(hardnested_nonces_t));
+}
+
+// feeds prefetched nonces through the same steps as a live acquisition, one device round at a time,
+// so the reduction rate and the stop criterion see the samples they would have seen live
+static int replay_nonces(const hardnested_nonces_t *pre, bool *completed) {
+
+    cuid = pre->cuid;
+    hardnested_stage = CHECK_1ST_BYTES;
+    num_acquired_nonces = 0;
+
+    uint32_t rounds = MAX(pre->rounds, 1);
+    sample_period = MAX(pre->elapsed / rounds, 1);
+    uint32_t per_round = MIN(MAX((pre->count + rounds - 1) / rounds, 1), 0x7FFF);
+
+    char progress_text[80];
+    snprintf(progress_text, sizeof(progress_text), "Adding %u prefetched nonces, cuid = %08x", pre->count * 2, cuid);
+    hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+
+    bool reported_suma8 = false;
+    *completed = false;
+    for (uint32_t i = 0; i < pre->count && *completed == false; i += per_round) {
+        uint32_t n = MIN(per_round, pre->count - i);
+        last_sample_clock = msclock();
+        int res = add_nonce_round(pre->data + ((size_t)i * 9), n * 2, NULL, false, &reported_suma8, completed);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+    return PM3_SUCCESS;
+}
+
 static inline bool invariant_holds(uint_fast8_t byte_diff, uint_fast32_t state1, uint_fast32_t state2, uint_fast8_t bit, uint_fast8_t state_bit) {
     uint_fast8_t j_1_bit_mask = 0x01 << (bit - 1);
     uint_fast8_t bit_diff = byte_diff & j_1_bit_mask;                                               // difference of (j-1)th bit
@@ -2462,18 +2858,19 @@ static void init_it_all(void) {
     memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
 }
 
-int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename) {
+static int mfnestedhard_run(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename,
+                            const hardnested_nonces_t *prefetched, const hardnested_device_t *device) {
     char progress_text[80];
     char instr_set[12] = {0};
 
-    get_SIMD_instruction_set(instr_set);
-
     // initialize static arrays
     memset(part_sum_count, 0, sizeof(part_sum_count));
     init_it_all();
 
     srand((unsigned) time(NULL));
+    // may select a different SIMD core in auto mode
     brute_force_per_second = brute_force_benchmark();
+    get_SIMD_instruction_set(instr_set);
     write_stats = false;
 
     if (tests) {
@@ -2636,7 +3033,23 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
 
         } else { // acquire nonces.
 
-            res = acquire_nonces(blockNo, keyType, key, trgBlockNo, trgKeyType, nonce_file_write, slow, filename);
+            bool completed = false;
+            bool resume = (prefetched != NULL && prefetched->count);
+            res = PM3_SUCCESS;
+            if (resume) {
+                res = replay_nonces(prefetched, &completed);
+            }
+
+            // top up live when the prefetched nonces weren't enough
+            if (res == PM3_SUCCESS && completed == false) {
+                if (device) {
+                    device->acquire(device->ctx);
+                }
+                res = acquire_nonces(blockNo, keyType, key, trgBlockNo, trgKeyType, nonce_file_write, slow, filename, resume);
+                if (device) {
+                    device->release(device->ctx);
+                }
+            }
 
             if (res != PM3_SUCCESS) {
                 free_bitflip_bitarrays();
@@ -2727,3 +3140,11 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
 
     return PM3_SUCCESS;
 }
+
+int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename) {
+    return mfnestedhard_run(blockNo, keyType, key, trgBlockNo, trgKeyType, trgkey, nonce_file_read, nonce_file_write, slow, tests, foundkey, filename, NULL, NULL);
+}
+
+int mfnestedhard_ex(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool slow, const hardnested_nonces_t *prefetched, const hardnested_device_t *device, uint64_t *foundkey) {
+    return mfnestedhard_run(blockNo, keyType, key, trgBlockNo, trgKeyType, NULL, false, false, slow, 0, foundkey, NULL, prefetched, device);
+}
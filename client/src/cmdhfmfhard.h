@@ -21,8 +21,31 @@
 
 #include "common.h"
 
+// raw encrypted nonces from a prefetch, 9 byte records nt_enc1 | nt_enc2 | par_enc
+typedef struct {
+    uint32_t cuid;
+    uint8_t *data;
+    uint32_t count;         // records, two nonces each
+    uint32_t capacity;
+    uint32_t rounds;        // device round trips
+    uint64_t elapsed;       // ms spent acquiring
+} hardnested_nonces_t;
+
+// serializes device access when the crack runs in a worker thread, called around a live acquisition
+typedef struct {
+    void (*acquire)(void *ctx);
+    void (*release)(void *ctx);
+    void *ctx;
+} hardnested_device_t;
+
 int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename);
+// cracks from prefetched nonces, topping up live through device when they aren't enough
+int mfnestedhard_ex(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool slow, const hardnested_nonces_t *prefetched, const hardnested_device_t *device, uint64_t *foundkey);
+int mfnestedhard_prefetch(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool slow, uint32_t max_nonces, bool (*stop)(void *), void *stop_ctx, hardnested_nonces_t *out);
+void hardnested_nonces_free(hardnested_nonces_t *n);
 void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time);
+// also save the decompressed bitflip tables into a cache file in the user folder
+void hardnested_set_table_cache(bool save);
 
 #endif
 
@@ -1321,6 +1321,34 @@ static int CmdVersion(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static void print_latency_histogram(const comms_latency_t *l) {
+    if (l->count == 0) {
+        PrintAndLogEx(INFO, "  no round trips recorded");
+        return;
+    }
+
+    PrintAndLogEx(INFO, "  round trips... " _YELLOW_("%u"), l->count);
+    PrintAndLogEx(INFO, "  min / avg / max... " _YELLOW_("%" PRIu64) " / " _YELLOW_("%" PRIu64) " / " _YELLOW_("%" PRIu64) " us"
+                  , l->min_us
+                  , l->total_us / l->count
+                  , l->max_us
+                 );
+
+    uint32_t most = 0;
+    for (uint8_t i = 0; i < COMMS_LATENCY_BUCKETS; i++) {
+        most = MAX(most, l->buckets[i]);
+    }
+
+    for (uint8_t i = 0; i < COMMS_LATENCY_BUCKETS; i++) {
+        if (l->buckets[i] == 0) {
+            continue;
+        }
+        char bar[41] = {0};
+        memset(bar, '#', MAX(1, (uint64_t)l->buckets[i] * 40 / most));
+        PrintAndLogEx(INFO, "  %8u - %8u us | %6u | %s", (1U << i) - (i == 0), (2U << i) - 1, l->buckets[i], bar);
+    }
+}
+
 static int CmdStatus(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hw status",
@@ -1351,6 +1379,24 @@ static int CmdStatus(const char *Cmd) {
         PrintAndLogEx(WARNING, "Status command timeout. Communication speed test timed out");
         return PM3_ETIMEOUT;
     }
+
+    comms_latency_t l;
+    GetCommunicationLatency(&l);
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Client round trip latency") " ( this session )");
+    print_latency_histogram(&l);
+
+    comms_rx_stats_t rx;
+    GetCommunicationRxStats(&rx);
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Client reply buffer") " ( this session )");
+    PrintAndLogEx(INFO, "  size........... %u entries", rx.size);
+    PrintAndLogEx(INFO, "  high water..... %u entries", rx.high_water);
+    if (rx.drops) {
+        PrintAndLogEx(INFO, "  dropped........ " _RED_("%u"), rx.drops);
+    } else {
+        PrintAndLogEx(INFO, "  dropped........ " _GREEN_("0"));
+    }
     return PM3_SUCCESS;
 }
 
@@ -1539,24 +1585,160 @@ static int CmdTimeout(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static const char *get_transport_name(void) {
+    static char name[40];
+    bool is_tcp_conn = (g_conn.send_via_ip == PM3_TCPv4 || g_conn.send_via_ip == PM3_TCPv6);
+    bool is_udp_conn = (g_conn.send_via_ip == PM3_UDPv4 || g_conn.send_via_ip == PM3_UDPv6);
+    bool is_bt_conn = (memcmp(g_conn.serial_port_name, "bt:", 3) == 0);
+
+    snprintf(name, sizeof(name), "%s%s%s%s",
+             (g_conn.send_via_fpc_usart) ? "FPC UART" : "USB-CDC",
+             (is_tcp_conn) ? " over TCP" : "",
+             (is_bt_conn) ? " over BT" : "",
+             (is_udp_conn) ? " over UDP" : ""
+            );
+    return name;
+}
+
+static int CmdDownloadBench(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw dlbench",
+                  "Measure download throughput of device BigBuf over the current transport.\n"
+                  "Compares the framed 512 byte download against the bulk download",
+                  "hw dlbench\n"
+                  "hw dlbench -n 10 --len 16384\n"
+                  "hw dlbench -w 32768              -> bulk download with 32kb windows"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("n", "num", "<dec>", "number of downloads per mode (def 3)"),
+        arg_u64_0("l", "len", "<dec>", "bytes per download (def BigBuf size)"),
+        arg_u64_0("w", "window", "<dec>", "bulk window size in bytes (def device default)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t num = arg_get_u32_def(ctx, 1, 3);
+    uint32_t len = arg_get_u32_def(ctx, 2, g_pm3_capabilities.bigbuf_size);
+    uint32_t window = arg_get_u32_def(ctx, 3, 0);
+    CLIParserFree(ctx);
+
+    if (num == 0) {
+        num = 1;
+    }
+
+    if (len == 0 || len > g_pm3_capabilities.bigbuf_size) {
+        PrintAndLogEx(WARNING, "Length must be between 1 and %u", g_pm3_capabilities.bigbuf_size);
+        return PM3_EINVARG;
+    }
+
+    if (window > DOWNLOAD_BULK_WINDOW_MAX) {
+        PrintAndLogEx(WARNING, "Window must not exceed %u", DOWNLOAD_BULK_WINDOW_MAX);
+        return PM3_EINVARG;
+    }
+
+    uint8_t *framed = calloc(len, sizeof(uint8_t));
+    uint8_t *bulk = calloc(len, sizeof(uint8_t));
+    if (framed == NULL || bulk == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(framed);
+        free(bulk);
+        return PM3_EMALLOC;
+    }
+
+    PrintAndLogEx(INFO, "Transport... " _YELLOW_("%s"), get_transport_name());
+    PrintAndLogEx(INFO, "Download.... " _YELLOW_("%u") " bytes x " _YELLOW_("%u"), len, num);
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, " mode   |    ms    |   MB/s");
+    PrintAndLogEx(INFO, "--------+----------+---------");
+
+    int res = PM3_SUCCESS;
+    for (uint8_t mode = 0; mode < 2; mode++) {
+
+        if (mode == 1 && g_pm3_capabilities.bulk_download == false) {
+            PrintAndLogEx(INFO, " bulk   | " _YELLOW_("not supported by firmware"));
+            break;
+        }
+
+        uint64_t t = usclock();
+        uint32_t done = 0;
+        for (; done < num; done++) {
+
+            if (kbd_enter_pressed()) {
+                PrintAndLogEx(WARNING, "\naborted via keyboard!");
+                res = PM3_EOPABORTED;
+                break;
+            }
+
+            bool ok;
+            if (mode == 0) {
+                ok = GetFromDeviceFramed(BIG_BUF, framed, len, 0, NULL, 0, NULL, 2500, false);
+            } else {
+                ok = GetFromDeviceBulk(BIG_BUF, bulk, len, 0, NULL, 0, NULL, 2500, window);
+            }
+            if (ok == false) {
+                res = PM3_ETIMEOUT;
+                break;
+            }
+        }
+        t = usclock() - t;
+
+        if (done == 0) {
+            PrintAndLogEx(INFO, " %-6s | " _RED_("failed"), (mode == 0) ? "framed" : "bulk");
+            continue;
+        }
+
+        double secs = (double)t / 1000000.0;
+        PrintAndLogEx(INFO, " %-6s | %8.1f | " _GREEN_("%7.3f"),
+                      (mode == 0) ? "framed" : "bulk",
+                      (double)t / 1000.0 / done,
+                      ((double)len * done) / secs / 1000000.0
+                     );
+
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    if (res == PM3_SUCCESS && g_pm3_capabilities.bulk_download) {
+        if (memcmp(framed, bulk, len) == 0) {
+            PrintAndLogEx(SUCCESS, "Downloaded data ( " _GREEN_("match") " )");
+        } else {
+            PrintAndLogEx(FAILED, "Downloaded data ( " _RED_("mismatch") " )");
+            res = PM3_ESOFT;
+        }
+    }
+
+    free(framed);
+    free(bulk);
+    return res;
+}
+
 static int CmdPing(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hw ping",
                   "Test if the Proxmark3 is responsive",
                   "hw ping\n"
-                  "hw ping --len 32"
+                  "hw ping --len 32\n"
+                  "hw ping -c 1000   -> latency histogram over 1000 pings"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_u64_0("l", "len", "<dec>", "length of payload to send"),
+        arg_u64_0("c", "count", "<dec>", "number of pings to send (def 1)"),
         arg_param_end
     };
 
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     uint32_t len = arg_get_u32_def(ctx, 1, 32);
+    uint32_t count = arg_get_u32_def(ctx, 2, 1);
     CLIParserFree(ctx);
 
+    if (count == 0)
+        count = 1;
+
     if (len > PM3_CMD_DATA_SIZE)
         len = PM3_CMD_DATA_SIZE;
 
@@ -1574,6 +1756,40 @@ static int CmdPing(const char *Cmd) {
         data[i] = i & 0xFF;
     }
 
+    if (count > 1) {
+        comms_latency_t l;
+        memset(&l, 0, sizeof(l));
+        uint32_t errors = 0;
+        int res = PM3_SUCCESS;
+        for (uint32_t i = 0; i < count; i++) {
+
+            if (kbd_enter_pressed()) {
+                PrintAndLogEx(WARNING, "\naborted via keyboard!");
+                res = PM3_EOPABORTED;
+                break;
+            }
+
+            uint64_t tus = usclock();
+            SendCommandNG(CMD_PING, data, len);
+            if (WaitForResponseTimeout(CMD_PING, &resp, 1000) == false) {
+                PrintAndLogEx(WARNING, "Ping response " _RED_("timeout"));
+                res = PM3_ETIMEOUT;
+                break;
+            }
+            AddCommunicationLatency(&l, usclock() - tus);
+            if (len && memcmp(data, resp.data.asBytes, len) != 0) {
+                errors++;
+            }
+        }
+        if (res == PM3_SUCCESS && errors == 0) {
+            PrintAndLogEx(SUCCESS, "Ping responses " _GREEN_("received") " %u/%u, content errors %u", l.count, count, errors);
+        } else {
+            PrintAndLogEx(WARNING, "Ping responses received " _RED_("%u") "/%u, content errors " _RED_("%u"), l.count, count, errors);
+        }
+        print_latency_histogram(&l);
+        return res;
+    }
+
     uint64_t tms = msclock();
     SendCommandNG(CMD_PING, data, len);
     if (WaitForResponseTimeout(CMD_PING, &resp, 1000)) {
@@ -1714,6 +1930,7 @@ static command_t CommandTable[] = {
     {"bootloader", CmdBootloader, IfPm3Present, "Reboot into bootloader mode"},
     {"connect", CmdConnect, AlwaysAvailable, "Connect to the device via serial port"},
     {"dbg", CmdDbg, IfPm3Present, "Set device side debug level"},
+    {"dlbench", CmdDownloadBench, IfPm3Present, "Measure download throughput of the current transport"},
     {"fpgaoff", CmdFPGAOff, IfPm3Present, "Turn off FPGA on device"},
     {"lcd", CmdLCD, IfPm3Lcd, "Send command/data to LCD"},
     {"lcdreset", CmdLCDReset, IfPm3Lcd, "Hardware reset LCD"},
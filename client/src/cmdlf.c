@@ -23,6 +23,7 @@
 #include <ctype.h>
 #include <math.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "relay/relay.h"
 
@@ -1884,6 +1885,126 @@ int CmdLFRelay(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int demodParadoxSearch(bool verbose) {
+    return demodParadox(verbose, false);
+}
+
+static int demodIdteckSearch(bool verbose) {
+    return demodIdteck(NULL, verbose);
+}
+
+typedef struct {
+    int (*demod)(bool verbose);
+    const char *name;
+} lf_search_demod_t;
+
+// in the order `lf search` tries and reports them
+static const lf_search_demod_t lf_search_demods[] = {
+    // ask / man
+    { demodEM410x,        "EM410x ID" },
+    { demodDestron,       "FDX-A FECAVA Destron ID" },   // to do before HID
+    { demodGallagher,     "GALLAGHER ID" },
+    { demodNoralsy,       "Noralsy ID" },
+    { demodPresco,        "Presco ID" },
+    { demodSecurakey,     "Securakey ID" },
+    { demodViking,        "Viking ID" },
+    { demodVisa2k,        "Visa2000 ID" },
+    // ask / bi
+    { demodFDXB,          "FDX-B ID" },
+    { demodJablotron,     "Jablotron ID" },
+    { demodGuard,         "Guardall G-Prox II ID" },
+    { demodNedap,         "NEDAP ID" },
+    // nrz
+    { demodPac,           "PAC/Stanley ID" },
+    // fsk
+    { demodHID,           "HID Prox ID" },
+    { demodAWID,          "AWID ID" },
+    { demodIOProx,        "IO Prox ID" },
+    { demodPyramid,       "Pyramid ID" },
+    { demodParadoxSearch, "Paradox ID" },
+    // psk
+    { demodIdteckSearch,  "Idteck ID" },
+    { demodKeri,          "KERI ID" },
+    { demodNexWatch,      "NexWatch ID" },
+    { demodIndala,        "Indala ID" },
+};
+
+typedef struct {
+    lf_demod_ctx_t *ctx;
+    uint32_t *next;
+    bool *candidates;
+} lf_search_worker_t;
+
+static void *lf_search_worker(void *arg) {
+    lf_search_worker_t *w = (lf_search_worker_t *)arg;
+
+    lf_demod_ctx_bind(w->ctx);
+    SetPrintMuted(true);
+
+    for (;;) {
+        uint32_t i = __atomic_fetch_add(w->next, 1, __ATOMIC_RELAXED);
+        if (i >= ARRAYLEN(lf_search_demods)) {
+            break;
+        }
+        // every decoder starts from the untouched graph
+        lf_demod_ctx_reset(w->ctx);
+        w->candidates[i] = (lf_search_demods[i].demod(true) == PM3_SUCCESS);
+    }
+
+    SetPrintMuted(false);
+    lf_demod_ctx_bind(NULL);
+    return NULL;
+}
+
+// Runs all decoders side by side, each thread on its own copy of the graph, and marks
+// the ones which decoded something. Only those are run again, in order, on the main graph
+// to print the result and leave the demod buffer / plot grid like a sequential search would.
+// With a single CPU everything is a candidate and the search stays sequential.
+static void lf_search_prefilter(bool *candidates) {
+    const size_t n = ARRAYLEN(lf_search_demods);
+    for (size_t i = 0; i < n; i++) {
+        candidates[i] = true;
+    }
+
+    int num_threads = MIN((size_t)num_CPUs(), n);
+    if (num_threads <= 1) {
+        return;
+    }
+
+    lf_search_worker_t workers[num_threads];
+    pthread_t threads[num_threads];
+    uint32_t next = 0;
+    int started = 0;
+
+    memset(candidates, 0, n * sizeof(bool));
+
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].ctx = lf_demod_ctx_create();
+        if (workers[i].ctx == NULL) {
+            break;
+        }
+        workers[i].next = &next;
+        workers[i].candidates = candidates;
+        if (pthread_create(&threads[i], NULL, lf_search_worker, &workers[i]) != 0) {
+            lf_demod_ctx_free(workers[i].ctx);
+            break;
+        }
+        started++;
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        lf_demod_ctx_free(workers[i].ctx);
+    }
+
+    if (started == 0) {
+        // couldn't fan out, fall back to the sequential search
+        for (size_t i = 0; i < n; i++) {
+            candidates[i] = true;
+        }
+    }
+}
+
 int CmdLFfind(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -2003,189 +2124,20 @@ int CmdLFfind(const char *Cmd) {
         }
     }
 
-    // ask / man
-    if (demodEM410x(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM410x ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodDestron(true) == PM3_SUCCESS) { // to do before HID
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-A FECAVA Destron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGallagher(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("GALLAGHER ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNoralsy(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Noralsy ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPresco(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Presco ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodSecurakey(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Securakey ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodViking(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Viking ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodVisa2k(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Visa2000 ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
+    bool candidates[ARRAYLEN(lf_search_demods)];
+    lf_search_prefilter(candidates);
 
-    // ask / bi
-    if (demodFDXB(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-B ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodJablotron(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Jablotron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGuard(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Guardall G-Prox II ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNedap(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NEDAP ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // nrz
-    if (demodPac(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("PAC/Stanley ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // fsk
-    if (demodHID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("HID Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodAWID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("AWID ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIOProx(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("IO Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPyramid(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Pyramid ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodParadox(true, false) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Paradox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // psk
-    if (demodIdteck(NULL, true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Idteck ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodKeri(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("KERI ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNexWatch(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NexWatch ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
+    for (size_t i = 0; i < ARRAYLEN(lf_search_demods); i++) {
+        if (candidates[i] == false) {
+            continue;
         }
-    }
-    if (demodIndala(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Indala ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
+        if (lf_search_demods[i].demod(true) == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("%s") " found!", lf_search_demods[i].name);
+            if (search_cont) {
+                found++;
+            } else {
+                goto out;
+            }
         }
     }
     /*
@@ -2213,6 +2165,7 @@ int CmdLFfind(const char *Cmd) {
     if (search_unk) {
 
         // test unknown tag formats (raw mode)
+        // not run on the thread pool, each probe prints as it goes, a clock line is only finished after its detection
         PrintAndLogEx(INFO, _CYAN_("Checking for unknown tags...") "\n");
 
         uint8_t ones[] = {
@@ -36,6 +36,7 @@
 #include "cmdhfmf.h"
 #include "pm3_binlib.h"
 #include "pm3_bitlib.h"
+#include "pm3_pybinlib.h"
 #include "lualib.h"
 #include "lauxlib.h"
 #include "proxmark3.h"
@@ -443,6 +444,8 @@ static int CmdScriptRun(const char *Cmd) {
         // hook Proxmark3 API
         PyImport_AppendInittab("_pm3", PyInit__pm3);
 #endif
+        // binary device I/O
+        PyImport_AppendInittab("pm3bin", PyInit_pm3bin);
 #if PY_MAJOR_VERSION == 3 && PY_MINOR_VERSION < 10
         Py_Initialize();
 #else
@@ -18,6 +18,7 @@
 #include "cmdtrace.h"
 
 #include <ctype.h>
+#include <pthread.h>
 
 #include "cmdparser.h"    // command_t
 #include "protocols.h"
@@ -32,23 +33,88 @@
 #include "cmdlfhitagu.h"        // annotate hitagu
 #include "pm3_cmd.h"            // tracelog_hdr_t
 #include "cliparser.h"          // args..
+#include "util.h"               // num_CPUs
 
 static int CmdHelp(const char *Cmd);
 
+#define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
+
 // trace pointer
 static uint8_t *gs_trace;
-static uint16_t gs_traceLen = 0;
-
-static bool is_last_record(uint16_t tracepos, uint16_t traceLen) {
+static uint32_t gs_traceLen = 0;
+
+// Versioned trace file
+//   trace_file_hdr_t
+//   data_len bytes of tracelog_hdr_t records, same layout as the device trace buffer
+//   index_count trace_index_entry_t
+// Files without the magic are legacy traces, a raw dump of the device buffer.
+#define TRACE_FILE_MAGIC        "PM3TRACE"
+#define TRACE_FILE_VERSION      2
+#define TRACE_PROTOCOL_RAW      0xFF
+
+typedef struct {
+    char magic[8];
+    uint16_t version;
+    uint16_t hdr_len;       // records start at this offset
+    uint32_t flags;         // RFU
+    uint64_t data_len;      // bytes of tracelog records
+    uint64_t index_count;   // index entries following the records
+} PACKED trace_file_hdr_t;
+
+typedef struct {
+    uint64_t offset;        // record offset, relative to start of records
+    uint64_t timestamp;     // monotonic, device timestamp wraps and restarts carried over
+    uint8_t isResponse;
+    uint8_t protocol;       // TRACE_PROTOCOL_RAW if unknown
+    uint8_t rfu[6];
+} PACKED trace_index_entry_t;
+
+// keeps device timestamps monotonic over 32bit wraps and over appended sessions
+typedef struct {
+    uint64_t carry;
+    uint64_t prev_end;
+    uint32_t prev_ts;
+    bool started;
+} trace_clock_t;
+
+// record index of gs_trace, built on demand
+static trace_index_entry_t *gs_trace_index = NULL;
+static uint32_t gs_trace_index_count = 0;
+
+#define TRACE_EXPLANATION_LEN   60
+// records per work item of the annotation pre-pass, and per printed batch
+#define TRACE_ANNOTATE_CHUNK    256
+#define TRACE_ANNOTATE_BATCH    4096
+
+// pre-pass result for one record, parallel to gs_trace_index
+typedef struct {
+    bool done;
+    bool has_explanation;
+    uint8_t crc_status;
+    char explanation[TRACE_EXPLANATION_LEN];
+} trace_annotation_t;
+
+typedef struct {
+    uint8_t protocol;
+    bool per_record;
+    uint32_t last;
+    uint32_t *next;
+} trace_annotate_job_t;
+
+static trace_annotation_t *gs_trace_ann = NULL;
+static uint8_t gs_trace_ann_protocol = TRACE_PROTOCOL_RAW;
+static bool gs_trace_ann_per_record = false;
+
+static bool is_last_record(uint32_t tracepos, uint32_t traceLen) {
     return ((tracepos + TRACELOG_HDR_LEN) >= traceLen);
 }
 
-static bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
+static bool next_record_is_response(uint32_t tracepos, uint8_t *trace) {
     const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
     return (hdr->isResponse);
 }
 
-static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint32_t *tracepos, uint32_t traceLen,
                                       uint8_t *trace, const uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
 
 #define MAX_TOPAZ_READER_CMD_LEN 16
@@ -81,6 +147,410 @@ static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, ui
 
     return true;
 }
+static void trace_reset_index(void) {
+    free(gs_trace_index);
+    gs_trace_index = NULL;
+    gs_trace_index_count = 0;
+    free(gs_trace_ann);
+    gs_trace_ann = NULL;
+}
+
+static uint64_t trace_clock_update(trace_clock_t *clk, const tracelog_hdr_t *hdr) {
+    if (clk->started && hdr->timestamp < clk->prev_ts) {
+        if ((clk->prev_ts - hdr->timestamp) > 0x80000000) {
+            // 32bit counter wrapped around
+            clk->carry += 0x100000000ULL;
+        } else {
+            // device restarted its clock, continue right after the previous frame
+            clk->carry = clk->prev_end - hdr->timestamp;
+        }
+    }
+    uint64_t ts = clk->carry + hdr->timestamp;
+    clk->prev_ts = hdr->timestamp;
+    clk->prev_end = ts + hdr->duration;
+    clk->started = true;
+    return ts;
+}
+
+// Walk the records in trace and index them.
+// Returns number of entries, or -1 on memory failure
+static int trace_index_records(const uint8_t *trace, uint32_t traceLen, trace_clock_t *clk, uint64_t base_offset, uint8_t protocol, trace_index_entry_t **out) {
+
+    uint32_t count = 0;
+    uint32_t tracepos = 0;
+    while (is_last_record(tracepos, traceLen) == false) {
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(trace + tracepos);
+        uint32_t next = tracepos + SKIP_TO_NEXT(hdr);
+        if (next > traceLen) {
+            break;
+        }
+        tracepos = next;
+        count++;
+    }
+
+    *out = NULL;
+    if (count == 0) {
+        return 0;
+    }
+
+    trace_index_entry_t *idx = calloc(count, sizeof(trace_index_entry_t));
+    if (idx == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return -1;
+    }
+
+    tracepos = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(trace + tracepos);
+        idx[i].offset = base_offset + tracepos;
+        idx[i].timestamp = trace_clock_update(clk, hdr);
+        idx[i].isResponse = hdr->isResponse;
+        idx[i].protocol = protocol;
+        tracepos += SKIP_TO_NEXT(hdr);
+    }
+
+    *out = idx;
+    return count;
+}
+
+// protocol to annotate a record with, the one from its index entry unless it is unknown
+static uint8_t trace_record_protocol(uint32_t rec, uint8_t protocol, bool per_record) {
+    if (per_record && rec < gs_trace_index_count && gs_trace_index[rec].protocol != TRACE_PROTOCOL_RAW) {
+        return gs_trace_index[rec].protocol;
+    }
+    return protocol;
+}
+
+static int trace_ensure_index(void) {
+    if (gs_trace_index != NULL || gs_traceLen == 0) {
+        return PM3_SUCCESS;
+    }
+
+    trace_clock_t clk = {0};
+    int res = trace_index_records(gs_trace, gs_traceLen, &clk, 0, TRACE_PROTOCOL_RAW, &gs_trace_index);
+    if (res < 0) {
+        return PM3_EMALLOC;
+    }
+    gs_trace_index_count = res;
+    return PM3_SUCCESS;
+}
+
+// first index entry with a time (relative to first record) >= t
+static uint32_t trace_index_lower_bound(uint64_t t) {
+    uint32_t lo = 0, hi = gs_trace_index_count;
+    uint64_t base = gs_trace_index[0].timestamp;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (gs_trace_index[mid].timestamp - base < t) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// index entries must point at consecutive, in bounds records
+static bool trace_index_valid(const trace_index_entry_t *idx, uint64_t count, const uint8_t *trace, uint32_t traceLen) {
+    uint32_t tracepos = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (idx[i].offset != tracepos || is_last_record(tracepos, traceLen)) {
+            return false;
+        }
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(trace + tracepos);
+        tracepos += SKIP_TO_NEXT(hdr);
+        if (tracepos > traceLen) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int trace_write_v2(FILE *f, const uint8_t *data, uint64_t data_len, const trace_index_entry_t *idx, uint64_t count) {
+    trace_file_hdr_t fh = {
+        .version = TRACE_FILE_VERSION,
+        .hdr_len = sizeof(trace_file_hdr_t),
+        .data_len = data_len,
+        .index_count = count,
+    };
+    memcpy(fh.magic, TRACE_FILE_MAGIC, sizeof(fh.magic));
+
+    if (fwrite(&fh, sizeof(fh), 1, f) != 1) {
+        return PM3_EFILE;
+    }
+    if (data_len && fwrite(data, data_len, 1, f) != 1) {
+        return PM3_EFILE;
+    }
+    if (count && fwrite(idx, sizeof(trace_index_entry_t), count, f) != count) {
+        return PM3_EFILE;
+    }
+    return PM3_SUCCESS;
+}
+
+// Parse a loaded trace file into gs_trace / gs_trace_index.
+// Takes ownership of buf.
+static int trace_import_file(uint8_t *buf, size_t len) {
+
+    const trace_file_hdr_t *fh = (const trace_file_hdr_t *)buf;
+
+    if (len < sizeof(trace_file_hdr_t) || memcmp(fh->magic, TRACE_FILE_MAGIC, sizeof(fh->magic)) != 0) {
+        // legacy file
+        if (len > UINT32_MAX) {
+            free(buf);
+            return PM3_EOVFLOW;
+        }
+        gs_trace = buf;
+        gs_traceLen = len;
+        return PM3_SUCCESS;
+    }
+
+    if (fh->version != TRACE_FILE_VERSION || fh->hdr_len < sizeof(trace_file_hdr_t)) {
+        PrintAndLogEx(FAILED, "Unsupported trace file version " _YELLOW_("%u"), fh->version);
+        free(buf);
+        return PM3_ESOFT;
+    }
+
+    if (fh->data_len > UINT32_MAX || fh->hdr_len + fh->data_len > len) {
+        PrintAndLogEx(FAILED, "Trace file is truncated");
+        free(buf);
+        return PM3_EFILE;
+    }
+
+    uint32_t data_len = fh->data_len;
+    uint64_t count = fh->index_count;
+    const uint8_t *data = buf + fh->hdr_len;
+    const trace_index_entry_t *idx = (const trace_index_entry_t *)(data + data_len);
+
+    bool has_index = (count <= (len - fh->hdr_len - data_len) / sizeof(trace_index_entry_t))
+                     && trace_index_valid(idx, count, data, data_len);
+
+    if (has_index && count) {
+        gs_trace_index = calloc(count, sizeof(trace_index_entry_t));
+        if (gs_trace_index == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            free(buf);
+            return PM3_EMALLOC;
+        }
+        memcpy(gs_trace_index, idx, count * sizeof(trace_index_entry_t));
+        gs_trace_index_count = count;
+    } else if (has_index == false) {
+        PrintAndLogEx(WARNING, "Trace file index is damaged, rebuilding");
+    }
+
+    memmove(buf, data, data_len);
+    gs_trace = buf;
+    gs_traceLen = data_len;
+
+    if (has_index == false) {
+        return trace_ensure_index();
+    }
+    return PM3_SUCCESS;
+}
+
+static int trace_copy_file_range(FILE *in, uint64_t offset, uint64_t len, FILE *out) {
+    if (fseek(in, offset, SEEK_SET) != 0) {
+        return PM3_EFILE;
+    }
+    uint8_t buf[4096];
+    while (len) {
+        size_t n = (len < sizeof(buf)) ? len : sizeof(buf);
+        if (fread(buf, 1, n, in) != n || fwrite(buf, 1, n, out) != n) {
+            return PM3_EFILE;
+        }
+        len -= n;
+    }
+    return PM3_SUCCESS;
+}
+
+// Add trace records to the end of an existing trace file.
+// The merged file is written next to it and renamed over it, a legacy file is converted on the way.
+static int trace_append_file(const char *path, const uint8_t *trace, uint32_t traceLen, const trace_index_entry_t *src_idx, uint32_t src_count) {
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", path);
+        return PM3_EFILE;
+    }
+
+    int res = PM3_SUCCESS;
+    uint8_t *legacy = NULL;
+    trace_index_entry_t *idx = NULL;
+    trace_index_entry_t *new_idx = NULL;
+    FILE *out = NULL;
+
+    char tmp_path[FILE_PATH_SIZE + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    trace_file_hdr_t fh = {0};
+    bool is_v2 = (fread(&fh, sizeof(fh), 1, f) == 1) && (memcmp(fh.magic, TRACE_FILE_MAGIC, sizeof(fh.magic)) == 0);
+
+    if (is_v2 == false) {
+        // legacy, read it all back and write it out as v2 below
+        memset(&fh, 0, sizeof(fh));
+        fh.hdr_len = sizeof(trace_file_hdr_t);
+        fseek(f, 0, SEEK_END);
+        long fsize = ftell(f);
+        if (fsize < 0 || fsize > UINT32_MAX) {
+            res = PM3_EFILE;
+            goto out;
+        }
+        fh.data_len = fsize;
+        legacy = calloc(fsize + 1, sizeof(uint8_t));
+        if (legacy == NULL) {
+            res = PM3_EMALLOC;
+            goto out;
+        }
+        fseek(f, 0, SEEK_SET);
+        if (fread(legacy, 1, fsize, f) != (size_t)fsize) {
+            res = PM3_EFILE;
+            goto out;
+        }
+        trace_clock_t clk = {0};
+        int cnt = trace_index_records(legacy, fsize, &clk, 0, TRACE_PROTOCOL_RAW, &idx);
+        if (cnt < 0) {
+            res = PM3_EMALLOC;
+            goto out;
+        }
+        fh.index_count = cnt;
+    } else {
+        if (fh.version != TRACE_FILE_VERSION || fh.hdr_len < sizeof(trace_file_hdr_t)) {
+            PrintAndLogEx(FAILED, "Unsupported trace file version " _YELLOW_("%u"), fh.version);
+            res = PM3_ESOFT;
+            goto out;
+        }
+        if (fh.index_count) {
+            idx = calloc(fh.index_count, sizeof(trace_index_entry_t));
+            if (idx == NULL) {
+                res = PM3_EMALLOC;
+                goto out;
+            }
+            if (fseek(f, fh.hdr_len + fh.data_len, SEEK_SET) != 0
+                    || fread(idx, sizeof(trace_index_entry_t), fh.index_count, f) != fh.index_count) {
+                PrintAndLogEx(FAILED, "Trace file index is damaged, can't append");
+                res = PM3_EFILE;
+                goto out;
+            }
+        }
+    }
+
+    // continue the clock from the last stored record
+    trace_clock_t clk = {0};
+    if (fh.index_count) {
+        const trace_index_entry_t *last = &idx[fh.index_count - 1];
+        tracelog_hdr_t last_hdr;
+        if (legacy) {
+            memcpy(&last_hdr, legacy + last->offset, sizeof(last_hdr));
+        } else if (fseek(f, fh.hdr_len + last->offset, SEEK_SET) != 0 || fread(&last_hdr, sizeof(last_hdr), 1, f) != 1) {
+            res = PM3_EFILE;
+            goto out;
+        }
+        clk.carry = last->timestamp - last_hdr.timestamp;
+        clk.prev_ts = last_hdr.timestamp;
+        clk.prev_end = last->timestamp + last_hdr.duration;
+        clk.started = true;
+    }
+
+    int new_count = trace_index_records(trace, traceLen, &clk, fh.data_len, TRACE_PROTOCOL_RAW, &new_idx);
+    if (new_count < 0) {
+        res = PM3_EMALLOC;
+        goto out;
+    }
+    // keep protocol information we already have for these records
+    for (uint32_t i = 0; i < (uint32_t)new_count && i < src_count; i++) {
+        new_idx[i].protocol = src_idx[i].protocol;
+    }
+
+    uint64_t total = fh.index_count + new_count;
+    trace_index_entry_t *tmp = realloc(idx, total * sizeof(trace_index_entry_t) + 1);
+    if (tmp == NULL) {
+        res = PM3_EMALLOC;
+        goto out;
+    }
+    idx = tmp;
+    if (new_count) {
+        memcpy(idx + fh.index_count, new_idx, new_count * sizeof(trace_index_entry_t));
+    }
+
+    out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", tmp_path);
+        res = PM3_EFILE;
+        goto out;
+    }
+
+    trace_file_hdr_t new_fh = {
+        .version = TRACE_FILE_VERSION,
+        .hdr_len = sizeof(trace_file_hdr_t),
+        .data_len = fh.data_len + traceLen,
+        .index_count = total,
+    };
+    memcpy(new_fh.magic, TRACE_FILE_MAGIC, sizeof(new_fh.magic));
+
+    if (fwrite(&new_fh, sizeof(new_fh), 1, out) != 1) {
+        res = PM3_EFILE;
+        goto out;
+    }
+
+    // old records, then the new ones and the merged index
+    if (legacy) {
+        if (fh.data_len && fwrite(legacy, fh.data_len, 1, out) != 1) {
+            res = PM3_EFILE;
+        }
+    } else {
+        res = trace_copy_file_range(f, fh.hdr_len, fh.data_len, out);
+    }
+    if (res != PM3_SUCCESS) {
+        goto out;
+    }
+
+    if ((traceLen && fwrite(trace, traceLen, 1, out) != 1)
+            || (total && fwrite(idx, sizeof(trace_index_entry_t), total, out) != total)) {
+        res = PM3_EFILE;
+        goto out;
+    }
+
+    fclose(f);
+    f = NULL;
+    int err = fclose(out);
+    out = NULL;
+    if (err != 0) {
+        res = PM3_EFILE;
+        goto out;
+    }
+
+    res = replaceFile(tmp_path, path);
+    if (res != PM3_SUCCESS) {
+        goto out;
+    }
+
+    PrintAndLogEx(SUCCESS, "Appended " _YELLOW_("%u") " bytes, " _YELLOW_("%d") " records to `" _YELLOW_("%s") "`%s"
+                  , traceLen
+                  , new_count
+                  , path
+                  , (legacy) ? " ( converted from legacy format )" : ""
+                 );
+
+out:
+    if (res == PM3_EMALLOC) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+    } else if (res == PM3_EFILE) {
+        PrintAndLogEx(FAILED, "Failed to append to `" _YELLOW_("%s") "`", path);
+    }
+    if (out) {
+        fclose(out);
+    }
+    if (res != PM3_SUCCESS) {
+        remove(tmp_path);
+    }
+    if (f) {
+        fclose(f);
+    }
+    free(legacy);
+    free(idx);
+    free(new_idx);
+    return res;
+}
+
 static uint8_t calc_pos(const uint8_t *d) {
     // PCB [CID] [NAD] [INF] CRC CRC
     uint8_t pos = 1;
@@ -95,12 +565,13 @@ static uint8_t calc_pos(const uint8_t *d) {
 
 // Copy an existing buffer into client trace buffer
 // I think this is cleaner than further globalizing gs_trace, and may lend itself to more modularity later?
-bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len) {
+bool ImportTraceBuffer(const uint8_t *trace_src, uint32_t trace_len) {
     if (trace_len == 0 || trace_src == NULL) return (false);
     if (gs_trace) {
         free(gs_trace);
         gs_traceLen = 0;
     }
+    trace_reset_index();
     gs_trace = calloc(trace_len, sizeof(uint8_t));
     if (gs_trace == NULL) {
         return (false);
@@ -114,9 +585,7 @@ static uint8_t extract_uid[10] = {0};
 static uint8_t extract_uidlen = 0;
 static uint8_t extract_epurse[8] = {0};
 
-#define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
-
-static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
+static uint32_t extractChall_ev2(uint32_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
     tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
     if (next_hdr->data_len != 21) {
         return 0;
@@ -137,7 +606,7 @@ static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdp
     return tracepos;
 }
 
-static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t *trace) {
+static uint32_t extractChallenges(uint32_t tracepos, uint32_t traceLen, uint8_t *trace) {
 
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -411,7 +880,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2F: {
                 PrintAndLogEx(INFO, "Found a MFDES Auth EV2 First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -420,7 +889,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2NF: {
                 PrintAndLogEx(INFO, "Found a MFDES Auth EV2 Non First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -432,7 +901,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
     return tracepos;
 }
 
-static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol) {
+static uint32_t printHexLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) return traceLen;
 
@@ -498,56 +967,16 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
     return ret;
 }
 
-static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
-                               const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
-    // sanity check
-    if (is_last_record(tracepos, traceLen)) {
-        PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %u  t-len %u", tracepos, traceLen);
-        return traceLen;
-    }
-
-    uint32_t end_of_transmission_timestamp = 0;
-    uint8_t topaz_reader_command[9];
-    char explanation[60] = {0};
-    tracelog_hdr_t *first_hdr = (tracelog_hdr_t *)(trace);
-    tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
-
-    uint32_t duration = hdr->duration;
-    uint16_t data_len = hdr->data_len;
-
-    if (tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
-        PrintAndLogEx(DEBUG, "trace pos offset %"PRIu64 " larger than reported tracelen %u",
-                      tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr),
-                      traceLen
-                     );
-        return traceLen;
-    }
-
-    // adjust for different time scales
-    if (protocol == ICLASS || protocol == ISO_15693) {
-        duration *= 32;
-    }
-
-    uint8_t *frame = hdr->frame;
-    uint8_t *parityBytes = hdr->frame + data_len;
-
-    tracepos += TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr);
-
-    if (protocol == TOPAZ && !hdr->isResponse) {
-        // topaz reader commands come in 1 or 9 separate frames with 7 or 8 Bits each.
-        // merge them:
-        if (merge_topaz_reader_frames(hdr->timestamp, &duration, &tracepos, traceLen, trace, frame, topaz_reader_command, &data_len)) {
-            frame = topaz_reader_command;
-        }
-    }
-
-    //Check the CRC status
+//0 CRC-command, CRC not ok
+//1 CRC-command, CRC ok
+//2 Not crc-command
+static uint8_t trace_crc_status(uint8_t protocol, bool isResponse, uint8_t *frame, uint16_t data_len, const uint8_t *parityBytes) {
     uint8_t crcStatus = 2;
 
     if (data_len > 2) {
         switch (protocol) {
             case ICLASS:
-                crcStatus = iclass_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = iclass_CRC_check(isResponse, frame, data_len);
                 break;
             case ISO_14443B:
             case TOPAZ:
@@ -558,18 +987,18 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                 break;
             case PROTO_MIFARE:
             case PROTO_MFPLUS:
-                crcStatus = mifare_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = mifare_CRC_check(isResponse, frame, data_len);
                 break;
             case ISO_14443A:
             case MFDES:
             case LTO:
-                crcStatus = iso14443A_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = iso14443A_CRC_check(isResponse, frame, data_len);
                 break;
             case SEOS:
-                crcStatus = seos_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = seos_CRC_check(isResponse, frame, data_len);
                 break;
             case ISO_7816_4:
-                crcStatus = iso14443A_CRC_check(hdr->isResponse, frame, data_len) == 1 ? 3 : 0;
+                crcStatus = iso14443A_CRC_check(isResponse, frame, data_len) == 1 ? 3 : 0;
                 crcStatus = iso14443B_CRC_check(frame, data_len) == 1 ? 4 : crcStatus;
                 break;
             case THINFILM:
@@ -597,9 +1026,254 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                 break;
         }
     }
-    //0 CRC-command, CRC not ok
-    //1 CRC-command, CRC ok
-    //2 Not crc-command
+    return crcStatus;
+}
+
+static void trace_annotate_frame(uint8_t protocol, bool isResponse, uint8_t *frame, uint16_t data_len, uint8_t *parityBytes, uint16_t parity_len,
+                                 char *explanation, size_t size, const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
+    // Always annotate these protocols both reader/tag messages
+    switch (protocol) {
+        case ISO_14443A:
+        case ISO_7816_4:
+        case PROTO_FMCOS20:
+            annotateIso14443a(explanation, size, frame, data_len, isResponse);
+            break;
+        case PROTO_MIFARE:
+        case PROTO_MFPLUS:
+            annotateMifare(explanation, size, frame, data_len, parityBytes, parity_len, isResponse);
+            break;
+        case PROTO_HITAG1:
+            annotateHitag1(explanation, size, frame, data_len, isResponse);
+            break;
+        case PROTO_HITAG2:
+            annotateHitag2(explanation, size, frame, data_len, parityBytes[0], isResponse, mfDicKeys, mfDicKeysCount, false);
+            break;
+        case PROTO_HITAGS:
+            annotateHitagS(explanation, size, frame, (data_len * 8) - ((8 - parityBytes[0]) % 8), isResponse);
+            break;
+        case PROTO_HITAGU:
+            annotateHitagU(explanation, size, frame, data_len, isResponse);
+            break;
+        case ICLASS:
+            annotateIclass(explanation, size, frame, data_len, isResponse);
+            break;
+        case SEOS:
+            annotateSeos(explanation, size, frame, data_len, isResponse);
+            break;
+        default:
+            break;
+    }
+
+    if (isResponse == false) {
+        switch (protocol) {
+            case LEGIC:
+                annotateLegic(explanation, size, frame, data_len);
+                break;
+            case MFDES:
+                annotateMfDesfire(explanation, size, frame, data_len);
+                break;
+            case PROTO_MFPLUS:
+                annotateMfPlus(explanation, size, frame, data_len);
+                break;
+            case ISO_14443B:
+                annotateIso14443b(explanation, size, frame, data_len);
+                break;
+            case TOPAZ:
+                annotateTopaz(explanation, size, frame, data_len);
+                break;
+            case ISO_7816_4:
+                annotateIso7816(explanation, size, frame, data_len, isResponse);
+                break;
+            case ISO_15693:
+                annotateIso15693(explanation, size, frame, data_len);
+                break;
+            case FELICA:
+                annotateFelica(explanation, size, frame, data_len);
+                break;
+            case LTO:
+                annotateLTO(explanation, size, frame, data_len);
+                break;
+            case PROTO_CRYPTORF:
+                annotateCryptoRF(explanation, size, frame, data_len);
+                break;
+            case PROTO_FMCOS20:
+                annotateFMCOS20(explanation, size, frame, data_len);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// These annotators keep no state between frames, so their records can be annotated
+// out of order. For all others only the CRC check is done ahead.
+static bool trace_protocol_is_stateless(uint8_t protocol) {
+    switch (protocol) {
+        case ISO_14443B:
+        case ISO_15693:
+        case LEGIC:
+        case MFDES:
+        case FELICA:
+        case LTO:
+        case PROTO_CRYPTORF:
+        case THINFILM:
+        case TRACE_PROTOCOL_RAW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void trace_annotate_record(uint8_t protocol, bool per_record, uint32_t i) {
+    trace_annotation_t *a = &gs_trace_ann[i];
+    if (a->done) {
+        return;
+    }
+
+    protocol = trace_record_protocol(i, protocol, per_record);
+
+    // topaz reader frames are merged while printing, they don't map to a single record
+    if (protocol == TOPAZ) {
+        return;
+    }
+
+    tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + gs_trace_index[i].offset);
+    uint16_t data_len = hdr->data_len;
+    uint8_t *frame = hdr->frame;
+    uint8_t *parityBytes = hdr->frame + data_len;
+
+    a->crc_status = trace_crc_status(protocol, hdr->isResponse, frame, data_len, parityBytes);
+
+    if (trace_protocol_is_stateless(protocol)) {
+        trace_annotate_frame(protocol, hdr->isResponse, frame, data_len, parityBytes, TRACELOG_PARITY_LEN(hdr), a->explanation, sizeof(a->explanation), NULL, 0);
+        a->has_explanation = true;
+    }
+    a->done = true;
+}
+
+static void *trace_annotate_worker(void *arg) {
+    trace_annotate_job_t *job = (trace_annotate_job_t *)arg;
+
+    for (;;) {
+        uint32_t i = __atomic_fetch_add(job->next, TRACE_ANNOTATE_CHUNK, __ATOMIC_RELAXED);
+        if (i >= job->last) {
+            break;
+        }
+        uint32_t end = MIN(i + TRACE_ANNOTATE_CHUNK, job->last);
+        for (; i < end; i++) {
+            trace_annotate_record(job->protocol, job->per_record, i);
+        }
+    }
+    return NULL;
+}
+
+// Annotate records [first, last) of gs_trace on all CPUs.
+// Results are kept until the trace or the protocol changes, so paging back over a range is free.
+static int trace_annotate_range(uint8_t protocol, bool per_record, uint32_t first, uint32_t last) {
+
+    // only the CRC check could be done ahead for stateful annotators, not worth the threads
+    bool stateless = trace_protocol_is_stateless(protocol);
+    for (uint32_t i = first; per_record && stateless == false && i < last; i++) {
+        stateless = trace_protocol_is_stateless(trace_record_protocol(i, protocol, per_record));
+    }
+    if (stateless == false) {
+        return PM3_ENOTIMPL;
+    }
+
+    if (gs_trace_ann == NULL || gs_trace_ann_protocol != protocol || gs_trace_ann_per_record != per_record) {
+        free(gs_trace_ann);
+        gs_trace_ann = calloc(gs_trace_index_count, sizeof(trace_annotation_t));
+        if (gs_trace_ann == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+        gs_trace_ann_protocol = protocol;
+        gs_trace_ann_per_record = per_record;
+    }
+
+    // skip what is already there
+    while (first < last && gs_trace_ann[first].done) {
+        first++;
+    }
+    if (first >= last) {
+        return PM3_SUCCESS;
+    }
+
+    uint32_t next = first;
+    trace_annotate_job_t job = {
+        .protocol = protocol,
+        .per_record = per_record,
+        .last = last,
+        .next = &next,
+    };
+
+    int num_threads = MIN((uint32_t)num_CPUs(), (last - first + TRACE_ANNOTATE_CHUNK - 1) / TRACE_ANNOTATE_CHUNK);
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    pthread_t threads[num_threads + 1];
+    int started = 0;
+    for (int i = 1; i < num_threads; i++) {
+        if (pthread_create(&threads[started], NULL, trace_annotate_worker, &job) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    trace_annotate_worker(&job);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return PM3_SUCCESS;
+}
+
+static uint32_t printTraceLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
+                               const uint64_t *mfDicKeys, uint32_t mfDicKeysCount, const trace_annotation_t *ann) {
+    // sanity check
+    if (is_last_record(tracepos, traceLen)) {
+        PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %u  t-len %u", tracepos, traceLen);
+        return traceLen;
+    }
+
+    uint32_t end_of_transmission_timestamp = 0;
+    uint8_t topaz_reader_command[9];
+    char explanation[TRACE_EXPLANATION_LEN] = {0};
+    tracelog_hdr_t *first_hdr = (tracelog_hdr_t *)(trace);
+    tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
+
+    uint32_t duration = hdr->duration;
+    uint16_t data_len = hdr->data_len;
+
+    if (tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
+        PrintAndLogEx(DEBUG, "trace pos offset %"PRIu64 " larger than reported tracelen %u",
+                      tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr),
+                      traceLen
+                     );
+        return traceLen;
+    }
+
+    // adjust for different time scales
+    if (protocol == ICLASS || protocol == ISO_15693) {
+        duration *= 32;
+    }
+
+    uint8_t *frame = hdr->frame;
+    uint8_t *parityBytes = hdr->frame + data_len;
+
+    tracepos += TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr);
+
+    if (protocol == TOPAZ && !hdr->isResponse) {
+        // topaz reader commands come in 1 or 9 separate frames with 7 or 8 Bits each.
+        // merge them:
+        if (merge_topaz_reader_frames(hdr->timestamp, &duration, &tracepos, traceLen, trace, frame, topaz_reader_command, &data_len)) {
+            frame = topaz_reader_command;
+        }
+    }
+
+    //Check the CRC status
+    uint8_t crcStatus = (ann) ? ann->crc_status : trace_crc_status(protocol, hdr->isResponse, frame, data_len, parityBytes);
 
     // Draw the data column
 #define TRACE_MAX_LINES      36
@@ -789,77 +1463,10 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
         *prev_eot = end_of_transmission_timestamp;
     }
 
-    // Always annotate these protocols both reader/tag messages
-    switch (protocol) {
-        case ISO_14443A:
-        case ISO_7816_4:
-        case PROTO_FMCOS20:
-            annotateIso14443a(explanation, sizeof(explanation), frame, data_len, hdr->isResponse);
-            break;
-        case PROTO_MIFARE:
-        case PROTO_MFPLUS:
-            annotateMifare(explanation, sizeof(explanation), frame, data_len, parityBytes, TRACELOG_PARITY_LEN(hdr), hdr->isResponse);
-            break;
-        case PROTO_HITAG1:
-            annotateHitag1(explanation, sizeof(explanation), frame, data_len, hdr->isResponse);
-            break;
-        case PROTO_HITAG2:
-            annotateHitag2(explanation, sizeof(explanation), frame, data_len, parityBytes[0], hdr->isResponse, mfDicKeys, mfDicKeysCount, false);
-            break;
-        case PROTO_HITAGS:
-            annotateHitagS(explanation, sizeof(explanation), frame, (data_len * 8) - ((8 - parityBytes[0]) % 8), hdr->isResponse);
-            break;
-        case PROTO_HITAGU:
-            annotateHitagU(explanation, sizeof(explanation), frame, data_len, hdr->isResponse);
-            break;
-        case ICLASS:
-            annotateIclass(explanation, sizeof(explanation), frame, data_len, hdr->isResponse);
-            break;
-        case SEOS:
-            annotateSeos(explanation, sizeof(explanation), frame, data_len, hdr->isResponse);
-            break;
-        default:
-            break;
-    }
-
-    if (hdr->isResponse == false) {
-        switch (protocol) {
-            case LEGIC:
-                annotateLegic(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case MFDES:
-                annotateMfDesfire(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case PROTO_MFPLUS:
-                annotateMfPlus(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case ISO_14443B:
-                annotateIso14443b(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case TOPAZ:
-                annotateTopaz(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case ISO_7816_4:
-                annotateIso7816(explanation, sizeof(explanation), frame, data_len, hdr->isResponse);
-                break;
-            case ISO_15693:
-                annotateIso15693(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case FELICA:
-                annotateFelica(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case LTO:
-                annotateLTO(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case PROTO_CRYPTORF:
-                annotateCryptoRF(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case PROTO_FMCOS20:
-                annotateFMCOS20(explanation, sizeof(explanation), frame, data_len);
-                break;
-            default:
-                break;
-        }
+    if (ann && ann->has_explanation) {
+        memcpy(explanation, ann->explanation, sizeof(explanation));
+    } else {
+        trace_annotate_frame(protocol, hdr->isResponse, frame, data_len, parityBytes, TRACELOG_PARITY_LEN(hdr), explanation, sizeof(explanation), mfDicKeys, mfDicKeysCount);
     }
 
     int str_padder = 72;
@@ -1094,18 +1701,18 @@ static int download_trace(void) {
         return PM3_EINVARG;
     }
 
-    // reserve some space.
-    if (gs_trace) {
-        free(gs_trace);
-    }
-
+    // reserve some space, reusing the previous buffer
     gs_traceLen = 0;
+    trace_reset_index();
 
-    gs_trace = calloc(PM3_CMD_DATA_SIZE, sizeof(uint8_t));
-    if (gs_trace == NULL) {
+    uint8_t *tmp = realloc(gs_trace, PM3_CMD_DATA_SIZE);
+    if (tmp == NULL) {
         PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(gs_trace);
+        gs_trace = NULL;
         return PM3_EMALLOC;
     }
+    gs_trace = tmp;
 
     PrintAndLogEx(DEBUG, "downloading tracelog data from device");
 
@@ -1121,19 +1728,24 @@ static int download_trace(void) {
     gs_traceLen = resp.oldarg[2];
 
     // if tracelog buffer was larger and we need to download more.
+    // The first PM3_CMD_DATA_SIZE bytes are already there
     if (gs_traceLen > PM3_CMD_DATA_SIZE) {
 
-        free(gs_trace);
-        gs_trace = calloc(gs_traceLen, sizeof(uint8_t));
-        if (gs_trace == NULL) {
+        tmp = realloc(gs_trace, gs_traceLen);
+        if (tmp == NULL) {
             PrintAndLogEx(WARNING, "Failed to allocate memory");
+            free(gs_trace);
+            gs_trace = NULL;
+            gs_traceLen = 0;
             return PM3_EMALLOC;
         }
+        gs_trace = tmp;
 
-        if (!GetFromDevice(BIG_BUF, gs_trace, gs_traceLen, 0, NULL, 0, NULL, 2500, false)) {
+        if (!GetFromDevice(BIG_BUF, gs_trace + PM3_CMD_DATA_SIZE, gs_traceLen - PM3_CMD_DATA_SIZE, PM3_CMD_DATA_SIZE, NULL, 0, NULL, 2500, false)) {
             PrintAndLogEx(WARNING, "command execution time out");
             free(gs_trace);
             gs_trace = NULL;
+            gs_traceLen = 0;
             return PM3_ETIMEOUT;
         }
     }
@@ -1183,7 +1795,7 @@ static int CmdTraceExtract(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     while (tracepos < gs_traceLen) {
         tracepos = extractChallenges(tracepos, gs_traceLen, gs_trace);
@@ -1195,12 +1807,59 @@ static int CmdTraceExtract(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static const struct {
+    const char *name;
+    uint8_t protocol;
+} trace_protocols[] = {
+    {"14a",      ISO_14443A},
+    {"14b",      ISO_14443B},
+    {"15",       ISO_15693},
+    {"7816",     ISO_7816_4},
+    {"cryptorf", PROTO_CRYPTORF},
+    {"des",      MFDES},
+    {"felica",   FELICA},
+    {"ht1",      PROTO_HITAG1},
+    {"ht2",      PROTO_HITAG2},
+    {"hts",      PROTO_HITAGS},
+    {"htu",      PROTO_HITAGU},
+    {"iclass",   ICLASS},
+    {"legic",    LEGIC},
+    {"lto",      LTO},
+    {"mf",       PROTO_MIFARE},
+    {"raw",      TRACE_PROTOCOL_RAW},
+    {"seos",     SEOS},
+    {"thinfilm", THINFILM},
+    {"topaz",    TOPAZ},
+    {"mfp",      PROTO_MFPLUS},
+    {"fmcos20",  PROTO_FMCOS20},
+    {"",         TRACE_PROTOCOL_RAW},
+};
+
+static bool trace_protocol_from_str(const char *type, uint8_t *protocol) {
+    for (size_t i = 0; i < ARRAYLEN(trace_protocols); i++) {
+        if (strcmp(type, trace_protocols[i].name) == 0) {
+            *protocol = trace_protocols[i].protocol;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *trace_protocol_to_str(uint8_t protocol) {
+    for (size_t i = 0; i < ARRAYLEN(trace_protocols); i++) {
+        if (trace_protocols[i].protocol == protocol) {
+            return trace_protocols[i].name;
+        }
+    }
+    return "raw";
+}
+
 static int CmdTraceLoad(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace load",
                   "Load protocol data from binary file to trace buffer\n"
-                  "File extension is <.trace>",
+                  "File extension is <.trace>, both indexed and legacy trace files are accepted",
                   "trace load -f mytracefile    -> w/o file extension"
                  );
 
@@ -1221,15 +1880,23 @@ static int CmdTraceLoad(const char *Cmd) {
         gs_trace = NULL;
         gs_traceLen = 0;
     }
+    trace_reset_index();
 
     size_t len = 0;
-    if (loadFile_safe(filename, ".trace", (void **)&gs_trace, &len) != PM3_SUCCESS) {
+    uint8_t *buf = NULL;
+    if (loadFile_safe(filename, ".trace", (void **)&buf, &len) != PM3_SUCCESS) {
         PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
         return PM3_EIO;
     }
 
-    gs_traceLen = (long)len;
+    int res = trace_import_file(buf, len);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
 
+    if (gs_trace_index) {
+        PrintAndLogEx(SUCCESS, "Trace file v%u, " _YELLOW_("%u") " indexed records", TRACE_FILE_VERSION, gs_trace_index_count);
+    }
     PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = " _YELLOW_("%u") " bytes)", gs_traceLen);
     PrintAndLogEx(HINT, "Hint: Try `" _YELLOW_("trace list -1 -t ...") "` to view trace.  Remember the " _YELLOW_("`-1`") " param");
     return PM3_SUCCESS;
@@ -1240,13 +1907,19 @@ static int CmdTraceSave(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace save",
                   "Save protocol data from trace buffer to binary file\n"
-                  "File extension is <.trace>",
-                  "trace save -f mytracefile    -> w/o file extension"
+                  "File extension is <.trace>\n"
+                  "Files are saved with a record index, use `--legacy` for tools expecting a raw trace buffer dump",
+                  "trace save -f mytracefile               -> w/o file extension\n"
+                  "trace save -f mytracefile -t 14a        -> remember protocol for `trace list`\n"
+                  "trace save -f mytracefile --append      -> add trace buffer to end of existing file"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str1("f", "file", "<fn>", "Specify trace file to save"),
+        arg_str0("t", "type", "<str>", "protocol of the trace, stored in the record index (def: as last listed)"),
+        arg_lit0(NULL, "append", "append to an existing trace file"),
+        arg_lit0(NULL, "legacy", "save as raw trace buffer dump without index"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -1254,8 +1927,27 @@ static int CmdTraceSave(const char *Cmd) {
     int fnlen = 0;
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+    int tlen = 0;
+    char type[10] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)type, sizeof(type), &tlen);
+    str_lower(type);
+
+    bool append = arg_get_lit(ctx, 3);
+    bool legacy = arg_get_lit(ctx, 4);
     CLIParserFree(ctx);
 
+    uint8_t protocol = TRACE_PROTOCOL_RAW;
+    if (trace_protocol_from_str(type, &protocol) == false) {
+        PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
+        return PM3_EINVARG;
+    }
+
+    if (append && legacy) {
+        PrintAndLogEx(FAILED, "Can't append in legacy format");
+        return PM3_EINVARG;
+    }
+
     if (gs_traceLen == 0) {
         download_trace();
         if (gs_traceLen == 0) {
@@ -1264,8 +1956,54 @@ static int CmdTraceSave(const char *Cmd) {
         }
     }
 
-    saveFile(filename, ".trace", gs_trace, gs_traceLen);
-    return PM3_SUCCESS;
+    if (legacy) {
+        saveFile(filename, ".trace", gs_trace, gs_traceLen);
+        return PM3_SUCCESS;
+    }
+
+    int res = trace_ensure_index();
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    if (protocol != TRACE_PROTOCOL_RAW) {
+        for (uint32_t i = 0; i < gs_trace_index_count; i++) {
+            gs_trace_index[i].protocol = protocol;
+        }
+    }
+
+    if (append) {
+        char *path = NULL;
+        if (searchFile(&path, RESOURCES_SUBDIR, filename, ".trace", true) == PM3_SUCCESS) {
+            res = trace_append_file(path, gs_trace, gs_traceLen, gs_trace_index, gs_trace_index_count);
+            free(path);
+            return res;
+        }
+        PrintAndLogEx(INFO, "No trace file to append to, creating a new one");
+    }
+
+    char *fn = newfilenamemcopyEx(filename, ".trace", spDefault);
+    if (fn == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    FILE *f = fopen(fn, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+        free(fn);
+        return PM3_EFILE;
+    }
+
+    res = trace_write_v2(f, gs_trace, gs_traceLen, gs_trace_index, gs_trace_index_count);
+    fclose(f);
+
+    if (res == PM3_SUCCESS) {
+        PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%u") " bytes, " _YELLOW_("%u") " records to trace file `" _YELLOW_("%s") "`", gs_traceLen, gs_trace_index_count, fn);
+    } else {
+        PrintAndLogEx(FAILED, "Failed to write `" _YELLOW_("%s") "`", fn);
+    }
+    free(fn);
+    return res;
 }
 
 int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol) {
@@ -1295,6 +2033,10 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
         arg_lit0("x", NULL, "show hexdump to convert to pcap(ng)\n"
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "start", "<dec>", "skip records before this time, relative to first record"),
+        arg_u64_0(NULL, "stop", "<dec>", "skip records after this time, relative to first record"),
+        arg_u64_0(NULL, "skip", "<dec>", "skip this many records of the time window"),
+        arg_u64_0("n", "count", "<dec>", "only show this many records"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1336,7 +2078,9 @@ int CmdTraceList(const char *Cmd) {
                   "\n"
                   "trace list -t mf -f mfc_default_keys.dic     -> use default dictionary file\n"
                   "trace list -t 14a --frame                    -> show frame delay times\n"
-                  "trace list -t 14a -1                         -> use trace buffer "
+                  "trace list -t 14a -1                         -> use trace buffer\n"
+                  "trace list -t 14a -1 --start 100000 --stop 200000   -> only show records in this time window\n"
+                  "trace list -t 14a -1 --skip 2000 -n 500              -> show a page of 500 records, from record 2000"
                  );
 
     void *argtable[] = {
@@ -1350,6 +2094,10 @@ int CmdTraceList(const char *Cmd) {
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("t", "type", "<str>", "protocol to annotate the trace"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "start", "<dec>", "skip records before this time, relative to first record"),
+        arg_u64_0(NULL, "stop", "<dec>", "skip records after this time, relative to first record"),
+        arg_u64_0(NULL, "skip", "<dec>", "skip this many records of the time window"),
+        arg_u64_0("n", "count", "<dec>", "only show this many records"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1373,37 +2121,21 @@ int CmdTraceList(const char *Cmd) {
         diclen = 0;
     }
 
+    bool use_window = arg_get_u64_count(ctx, 9) || arg_get_u64_count(ctx, 10) || arg_get_u64_count(ctx, 11) || arg_get_u64_count(ctx, 12);
+    uint64_t start_time = arg_get_u64_def(ctx, 9, 0);
+    uint64_t stop_time = arg_get_u64_def(ctx, 10, UINT64_MAX);
+    uint64_t rec_skip = arg_get_u64_def(ctx, 11, 0);
+    uint64_t rec_count = arg_get_u64_def(ctx, 12, UINT64_MAX);
+
     CLIParserFree(ctx);
 
     clearCommandBuffer();
 
     // no crc, no annotations
-    uint8_t protocol = -1;
+    uint8_t protocol = TRACE_PROTOCOL_RAW;
 
     // validate type of output
-    if (strcmp(type, "14a") == 0)      protocol = ISO_14443A;
-    else if (strcmp(type, "14b") == 0)      protocol = ISO_14443B;
-    else if (strcmp(type, "15") == 0)       protocol = ISO_15693;
-    else if (strcmp(type, "7816") == 0)     protocol = ISO_7816_4;
-    else if (strcmp(type, "cryptorf") == 0) protocol = PROTO_CRYPTORF;
-    else if (strcmp(type, "des") == 0)      protocol = MFDES;
-    else if (strcmp(type, "felica") == 0)   protocol = FELICA;
-    else if (strcmp(type, "ht1") == 0)   protocol = PROTO_HITAG1;
-    else if (strcmp(type, "ht2") == 0)   protocol = PROTO_HITAG2;
-    else if (strcmp(type, "hts") == 0)   protocol = PROTO_HITAGS;
-    else if (strcmp(type, "htu") == 0)   protocol = PROTO_HITAGU;
-    else if (strcmp(type, "iclass") == 0)   protocol = ICLASS;
-    else if (strcmp(type, "legic") == 0)    protocol = LEGIC;
-    else if (strcmp(type, "lto") == 0)      protocol = LTO;
-    else if (strcmp(type, "mf") == 0)       protocol = PROTO_MIFARE;
-    else if (strcmp(type, "raw") == 0)      protocol = -1;
-    else if (strcmp(type, "seos") == 0)     protocol = SEOS;
-    else if (strcmp(type, "thinfilm") == 0) protocol = THINFILM;
-    else if (strcmp(type, "topaz") == 0)    protocol = TOPAZ;
-    else if (strcmp(type, "mfp") == 0)      protocol = PROTO_MFPLUS;
-    else if (strcmp(type, "fmcos20") == 0)  protocol = PROTO_FMCOS20;
-    else if (strcmp(type, "") == 0)         protocol = -1;
-    else {
+    if (trace_protocol_from_str(type, &protocol) == false) {
         PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
         return PM3_EINVARG;
     }
@@ -1427,7 +2159,64 @@ int CmdTraceList(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    int idx_res = trace_ensure_index();
+    if (idx_res != PM3_SUCCESS) {
+        return idx_res;
+    }
+
+    uint32_t tracepos = 0;
+    uint32_t tracestop = gs_traceLen;
+    uint32_t rec_first = 0;
+    uint32_t rec_last = gs_trace_index_count;
+
+    // seek to the requested time window using the record index
+    if (use_window && gs_trace_index_count) {
+        rec_first = trace_index_lower_bound(start_time);
+        rec_last = (stop_time == UINT64_MAX) ? gs_trace_index_count : trace_index_lower_bound(stop_time + 1);
+        // page inside the time window
+        rec_first = MIN((uint64_t)rec_first + rec_skip, rec_last);
+        rec_last = MIN((uint64_t)rec_last, (uint64_t)rec_first + rec_count);
+        tracepos = (rec_first < gs_trace_index_count) ? gs_trace_index[rec_first].offset : gs_traceLen;
+        tracestop = (rec_last < gs_trace_index_count) ? gs_trace_index[rec_last].offset : gs_traceLen;
+        PrintAndLogEx(INFO, "Showing records " _YELLOW_("%u") " to " _YELLOW_("%u") " of " _YELLOW_("%u"), rec_first, (rec_last > rec_first) ? rec_last - 1 : rec_first, gs_trace_index_count);
+    }
+
+    // Without -t each record is annotated with the protocol stored in its index entry.
+    // With -t, records of unknown protocol remember it, so `trace save` keeps it.
+    bool per_record = (tlen == 0);
+    uint32_t seen = 0;
+    if (per_record) {
+        for (uint32_t i = rec_first; i < rec_last; i++) {
+            uint8_t p = gs_trace_index[i].protocol;
+            if (p == TRACE_PROTOCOL_RAW) {
+                continue;
+            }
+            if (protocol == TRACE_PROTOCOL_RAW) {
+                protocol = p;
+                PrintAndLogEx(INFO, "Using protocol " _YELLOW_("%s") " from trace file", trace_protocol_to_str(protocol));
+            }
+            if (p < 32) {
+                seen |= (1U << p);
+            }
+        }
+    } else if (protocol != TRACE_PROTOCOL_RAW) {
+        bool stamped = false;
+        for (uint32_t i = 0; i < gs_trace_index_count; i++) {
+            if (gs_trace_index[i].protocol == TRACE_PROTOCOL_RAW) {
+                gs_trace_index[i].protocol = protocol;
+                stamped = true;
+            }
+        }
+        // per record annotations were made without it
+        if (stamped && gs_trace_ann_per_record) {
+            free(gs_trace_ann);
+            gs_trace_ann = NULL;
+        }
+    }
+    if (protocol < 32) {
+        seen |= (1U << protocol);
+    }
+#define TRACE_SEEN(p) ((seen & (1U << (p))) != 0)
 
     /*
     if (protocol == FELICA) {
@@ -1435,8 +2224,10 @@ int CmdTraceList(const char *Cmd) {
     } */
 
     if (show_hex) {
-        while (tracepos < gs_traceLen) {
-            tracepos = printHexLine(tracepos, gs_traceLen, gs_trace, protocol);
+        uint32_t rec = rec_first;
+        while (tracepos < tracestop) {
+            tracepos = printHexLine(tracepos, tracestop, gs_trace, trace_record_protocol(rec, protocol, per_record));
+            rec++;
         }
     } else {
 
@@ -1501,7 +2292,7 @@ int CmdTraceList(const char *Cmd) {
         uint32_t dicKeysCount = 0;
         bool load_dictionary = false;
 
-        if (protocol == PROTO_MIFARE || protocol == PROTO_MFPLUS) {
+        if (TRACE_SEEN(PROTO_MIFARE) || TRACE_SEEN(PROTO_MFPLUS)) {
 
             if (diclen > 0) {
 
@@ -1535,7 +2326,7 @@ int CmdTraceList(const char *Cmd) {
             }
         }
 
-        if (protocol == PROTO_HITAG2) {
+        if (dicKeys == NULL && TRACE_SEEN(PROTO_HITAG2)) {
 
             if (strlen(dictionary) == 0) {
                 snprintf(dictionary, sizeof(dictionary), HITAG_DICTIONARY);
@@ -1575,12 +2366,13 @@ int CmdTraceList(const char *Cmd) {
         PrintAndLogEx(NORMAL, "------------+------------+-----+-------------------------------------------------------------------------+-----+--------------------");
 
         // clean authentication data used with the mifare classic decrypt fct
-        if (protocol == ISO_14443A || protocol == PROTO_MIFARE || protocol == PROTO_MFPLUS) {
+        if (TRACE_SEEN(ISO_14443A) || TRACE_SEEN(PROTO_MIFARE) || TRACE_SEEN(PROTO_MFPLUS)) {
             ClearAuthData();
+            ClearTraceKeyCache();
         }
 
         // reset hitag state  machine
-        if (protocol == PROTO_HITAG1 || protocol == PROTO_HITAG2 || protocol == PROTO_HITAGS || protocol == PROTO_HITAGU) {
+        if (TRACE_SEEN(PROTO_HITAG1) || TRACE_SEEN(PROTO_HITAG2) || TRACE_SEEN(PROTO_HITAGS) || TRACE_SEEN(PROTO_HITAGU)) {
             annotateHitag2_init();
         }
 
@@ -1590,8 +2382,29 @@ int CmdTraceList(const char *Cmd) {
             prev_EOT = &previous_EOT;
         }
 
-        while (tracepos < gs_traceLen) {
-            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+        uint32_t rec = rec_first;
+        uint32_t annotated = rec_first;
+        bool prepass = true;
+
+        while (tracepos < tracestop) {
+
+            // annotate the next batch ahead on all CPUs, so output starts right away
+            if (prepass && rec >= annotated && rec < rec_last) {
+                annotated = MIN(rec + TRACE_ANNOTATE_BATCH, rec_last);
+                prepass = (trace_annotate_range(protocol, per_record, rec, annotated) == PM3_SUCCESS);
+            }
+
+            const trace_annotation_t *ann = NULL;
+            if (prepass && rec < rec_last && gs_trace_ann[rec].done) {
+                ann = &gs_trace_ann[rec];
+            }
+
+            tracepos = printTraceLine(tracepos, tracestop, gs_trace, trace_record_protocol(rec, protocol, per_record), show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount, ann);
+
+            // topaz frames merge several records into one line
+            while (rec < rec_last && gs_trace_index[rec].offset < tracepos) {
+                rec++;
+            }
 
             if (kbd_enter_pressed()) {
                 PrintAndLogEx(INFO, "User interrupted detected. Aborting");
@@ -1603,6 +2416,7 @@ int CmdTraceList(const char *Cmd) {
             free((void *) dicKeys);
         }
     }
+#undef TRACE_SEEN
 
     if (show_hex) {
         PrintAndLogEx(HINT, "Hint: Syntax to use: `" _YELLOW_("text2pcap -t \"%%S.\" -l 264 -n <input-text-file> <output-pcapng-file>") "`");
@@ -22,8 +22,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "uart/uart.h"
+#include "uart/ringbuffer.h"
 #include "ui.h"
 #include "crc16.h"
 #include "util.h" // g_pendingPrompt
@@ -61,17 +63,39 @@ static pthread_cond_t txBufferSig = PTHREAD_COND_INITIALIZER;
 
 // Used by PacketResponseReceived as a ring buffer for messages that are yet to be
 // processed by a command handler (WaitForResponse{,Timeout})
-static PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
+// Lock free: the communication thread is the only producer, the main thread the only consumer.
+// Allocated when the communication thread starts, sized by g_session.rx_buffer_size
+static RingBuffer *rxBuffer = NULL;
+static uint32_t rxBuffer_size = 0;
 
-// Points to the next empty position to write to
-static int cmd_head = 0;
+// set while replies are dropped because the consumer doesn't keep up, reported once
+static bool rxBuffer_dropping = false;
 
-// Points to the position of the last unread command
-static int cmd_tail = 0;
-
-// to lock rxBuffer operations from different threads
+// to lock rxBufferSig waits from different threads
 static pthread_mutex_t rxBufferMutex = PTHREAD_MUTEX_INITIALIZER;
 
+// signaled by the communication thread when a reply or raw data is stored.
+// rxSeq is bumped atomically, the mutex is only taken when someone is sleeping on rxBufferSig.
+// Waits are timed on the monotonic clock where the condition variable supports it
+static pthread_cond_t rxBufferSig;
+static pthread_once_t rxBufferSigOnce = PTHREAD_ONCE_INIT;
+static clockid_t rxBufferSigClock = CLOCK_REALTIME;
+static uint32_t rxSeq = 0;
+static uint32_t rxWaiters = 0;
+
+// round trip latency, from handing a command to the communication thread until its reply is picked up
+static pthread_mutex_t latencyMutex = PTHREAD_MUTEX_INITIALIZER;
+static comms_latency_t latency;
+
+// send times of the commands still waiting for their reply, oldest first
+#define LATENCY_PENDING_MAX 32
+typedef struct {
+    uint16_t cmd;
+    uint64_t us;
+} pending_send_t;
+static pending_send_t pending_sends[LATENCY_PENDING_MAX];
+static uint32_t pending_sends_count = 0;
+
 // Global start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
 // as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
 static uint64_t timeout_start_time;
@@ -79,6 +103,8 @@ static uint64_t timeout_start_time;
 static uint64_t last_packet_time;
 
 static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd);
+static void recordSend(uint16_t cmd);
+static void clearPendingSends(void);
 
 // Simple alias to track usages linked to the Bootloader, these commands must not be migrated.
 // - commands sent to enter bootloader mode as we might have to talk to old firmwares
@@ -132,9 +158,11 @@ void SendCommandOLD(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
 
     txBuffer = c;
     txBuffer_pending = true;
+    recordSend((uint16_t)cmd);
 
     // tell communication thread that a new command can be send
     pthread_cond_signal(&txBufferSig);
+    uart_wakeup();
 
     pthread_mutex_unlock(&txBufferMutex);
 
@@ -196,9 +224,11 @@ static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool
     print_hex_break((uint8_t *)tx_post, sizeof(PacketCommandNGPostamble), 32);
 #endif
     txBuffer_pending = true;
+    recordSend(cmd);
 
     // tell communication thread that a new command can be send
     pthread_cond_signal(&txBufferSig);
+    uart_wakeup();
 
     pthread_mutex_unlock(&txBufferMutex);
 
@@ -231,50 +261,227 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
  */
 void clearCommandBuffer(void) {
     //This is a very simple operation
-    pthread_mutex_lock(&rxBufferMutex);
-    cmd_tail = cmd_head;
-    pthread_mutex_unlock(&rxBufferMutex);
+    if (rxBuffer != NULL) {
+        RingBuf_clear(rxBuffer);
+    }
+    // replies to earlier commands are not waited for anymore
+    clearPendingSends();
+}
+
+/**
+ * @brief allocates rxBuffer with the preferred size, must be called while the communication thread isn't running
+ */
+static void initReplyBuffer(void) {
+    uint32_t size = g_session.rx_buffer_size;
+    if (size == 0) {
+        size = CMD_BUFFER_SIZE;
+    }
+
+    if (rxBuffer != NULL && rxBuffer_size == size) {
+        RingBuf_clear(rxBuffer);
+        return;
+    }
+
+    RingBuf_destroy(rxBuffer);
+    rxBuffer = RingBuf_createEx(size, sizeof(PacketResponseNG));
+    if (rxBuffer == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory for the reply buffer, falling back to %u entries", CMD_BUFFER_SIZE);
+        rxBuffer = RingBuf_createEx(CMD_BUFFER_SIZE, sizeof(PacketResponseNG));
+        size = CMD_BUFFER_SIZE;
+    }
+    rxBuffer_size = size;
+    rxBuffer_dropping = false;
+}
+
+/**
+ * @brief wakes up threads waiting in waitRxSignal
+ */
+static void initRxSignal(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#if !defined(__APPLE__)
+    // macOS has no pthread_condattr_setclock
+    if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0) {
+        rxBufferSigClock = CLOCK_MONOTONIC;
+    }
+#endif
+    pthread_cond_init(&rxBufferSig, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void signalRx(void) {
+    __atomic_add_fetch(&rxSeq, 1, __ATOMIC_SEQ_CST);
+    // waiters register under the mutex before re-checking rxSeq, so either they see the new value
+    // or we see them here
+    if (__atomic_load_n(&rxWaiters, __ATOMIC_SEQ_CST) > 0) {
+        pthread_once(&rxBufferSigOnce, initRxSignal);
+        pthread_mutex_lock(&rxBufferMutex);
+        pthread_cond_broadcast(&rxBufferSig);
+        pthread_mutex_unlock(&rxBufferMutex);
+    }
 }
+
 /**
- * @brief storeCommand stores a USB command in a circular buffer
- * @param UC
+ * @brief storeReply stores a reply in the rxBuffer ring.
+ * When the ring is full the communication thread waits for the consumer to make room (backpressure),
+ * after RX_BACKPRESSURE_MS or while already dropping, the reply is discarded and counted.
+ * @param packet
  */
 static void storeReply(const PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
-    if ((cmd_head + 1) % CMD_BUFFER_SIZE == cmd_tail) {
-        //If these two are equal, we're about to overwrite in the
-        // circular buffer.
-        PrintAndLogEx(FAILED, "WARNING: Command buffer about to overwrite command! This needs to be fixed!");
-        fflush(stdout);
+    if (rxBuffer == NULL) {
+        return;
     }
-    //Store the command at the 'head' location
-    PacketResponseNG *destination = &rxBuffer[cmd_head];
-    memcpy(destination, packet, sizeof(PacketResponseNG));
 
-    //increment head and wrap
-    cmd_head = (cmd_head + 1) % CMD_BUFFER_SIZE;
+    uint64_t start = 0;
+    while (RingBuf_push(rxBuffer, packet) == false) {
+
+        if (start == 0) {
+            start = msclock();
+            // make sure the consumer is awake
+            signalRx();
+        }
+
+        if (__atomic_load_n(&rxBuffer_dropping, __ATOMIC_RELAXED) || (msclock() - start > RX_BACKPRESSURE_MS) || (g_conn.run == false)) {
+            RingBuf_addDrops(rxBuffer, 1);
+            if (__atomic_exchange_n(&rxBuffer_dropping, true, __ATOMIC_RELAXED) == false) {
+                PrintAndLogEx(FAILED, "WARNING: reply buffer full, dropping replies ( " _YELLOW_("%u") " entries, see `prefs set client.rxbuffer` )", RingBuf_getCapacity(rxBuffer));
+                fflush(stdout);
+            }
+            return;
+        }
+        msleep(1);
+    }
+
+    __atomic_store_n(&rxBuffer_dropping, false, __ATOMIC_RELAXED);
+    signalRx();
+}
+
+static uint32_t getRxSeq(void) {
+    return __atomic_load_n(&rxSeq, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief waits until the communication thread signals new data since seq was read, or ms_timeout elapsed
+ * @param seq value of getRxSeq() taken before checking for data
+ * @param ms_timeout maximum time to wait
+ */
+static void waitRxSignal(uint32_t seq, uint32_t ms_timeout) {
+    pthread_once(&rxBufferSigOnce, initRxSignal);
+
+    // deadline on the clock the condition variable times out with, so wall clock changes don't matter
+    struct timespec ts;
+    clock_gettime(rxBufferSigClock, &ts);
+    uint64_t nsec = (uint64_t)ts.tv_nsec + (uint64_t)ms_timeout * 1000000;
+    ts.tv_sec += nsec / 1000000000;
+    ts.tv_nsec = nsec % 1000000000;
+
+    pthread_mutex_lock(&rxBufferMutex);
+    __atomic_add_fetch(&rxWaiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&rxSeq, __ATOMIC_SEQ_CST) == seq) {
+        if (pthread_cond_timedwait(&rxBufferSig, &rxBufferMutex, &ts) != 0) {
+            break;
+        }
+    }
+    __atomic_sub_fetch(&rxWaiters, 1, __ATOMIC_SEQ_CST);
     pthread_mutex_unlock(&rxBufferMutex);
 }
+
+void GetCommunicationRxStats(comms_rx_stats_t *out) {
+    memset(out, 0, sizeof(comms_rx_stats_t));
+    if (rxBuffer == NULL) {
+        return;
+    }
+    out->size = RingBuf_getCapacity(rxBuffer);
+    out->used = RingBuf_getUsedSize(rxBuffer);
+    out->high_water = RingBuf_getHighWater(rxBuffer);
+    out->drops = RingBuf_getDrops(rxBuffer);
+}
+
+void ResetCommunicationRxStats(void) {
+    if (rxBuffer != NULL) {
+        RingBuf_resetStats(rxBuffer);
+    }
+}
+
+void AddCommunicationLatency(comms_latency_t *l, uint64_t us) {
+    uint8_t bucket = 0;
+    while ((bucket < COMMS_LATENCY_BUCKETS - 1) && (us >> (bucket + 1))) {
+        bucket++;
+    }
+
+    if (l->count == 0 || us < l->min_us) {
+        l->min_us = us;
+    }
+    if (us > l->max_us) {
+        l->max_us = us;
+    }
+    l->count++;
+    l->total_us += us;
+    l->buckets[bucket]++;
+}
+
+static void recordSend(uint16_t cmd) {
+    uint64_t now = usclock();
+    pthread_mutex_lock(&latencyMutex);
+    if (pending_sends_count == LATENCY_PENDING_MAX) {
+        // the oldest one never got its reply
+        memmove(&pending_sends[0], &pending_sends[1], (LATENCY_PENDING_MAX - 1) * sizeof(pending_send_t));
+        pending_sends_count--;
+    }
+    pending_sends[pending_sends_count].cmd = cmd;
+    pending_sends[pending_sends_count].us = now;
+    pending_sends_count++;
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+static void clearPendingSends(void) {
+    pthread_mutex_lock(&latencyMutex);
+    pending_sends_count = 0;
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+// Replies come in the order of their commands. A reply belongs to the oldest pending command
+// of the same type, a CMD_ACK to the oldest pending one. Commands sent before it got no reply.
+static void recordLatency(uint16_t cmd) {
+    uint64_t now = usclock();
+    pthread_mutex_lock(&latencyMutex);
+    uint32_t i = 0;
+    while (i < pending_sends_count && pending_sends[i].cmd != cmd) {
+        i++;
+    }
+    if (i == pending_sends_count && cmd == CMD_ACK) {
+        i = 0;
+    }
+    if (i < pending_sends_count) {
+        AddCommunicationLatency(&latency, now - pending_sends[i].us);
+        i++;
+        memmove(&pending_sends[0], &pending_sends[i], (pending_sends_count - i) * sizeof(pending_send_t));
+        pending_sends_count -= i;
+    }
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+void GetCommunicationLatency(comms_latency_t *out) {
+    pthread_mutex_lock(&latencyMutex);
+    memcpy(out, &latency, sizeof(comms_latency_t));
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+void ResetCommunicationLatency(void) {
+    pthread_mutex_lock(&latencyMutex);
+    memset(&latency, 0, sizeof(comms_latency_t));
+    pthread_mutex_unlock(&latencyMutex);
+}
 /**
  * @brief getCommand gets a command from an internal circular buffer.
  * @param response location to write command
  * @return 1 if response was returned, 0 if nothing has been received
  */
 static int getReply(PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
-    //If head == tail, there's nothing to read, or if we just got initialized
-    if (cmd_head == cmd_tail)  {
-        pthread_mutex_unlock(&rxBufferMutex);
+    //If the ring is empty, there's nothing to read, or if we just got initialized
+    if (rxBuffer == NULL || RingBuf_pop(rxBuffer, packet) == false) {
         return 0;
     }
-
-    //Pick out the next unread command
-    memcpy(packet, &rxBuffer[cmd_tail], sizeof(PacketResponseNG));
-
-    //Increment tail - this is a circular buffer, so modulo buffer size
-    cmd_tail = (cmd_tail + 1) % CMD_BUFFER_SIZE;
-
-    pthread_mutex_unlock(&rxBufferMutex);
     return 1;
 }
 
@@ -443,6 +650,7 @@ __attribute__((force_align_arg_pointer))
                 PrintAndLogEx(WARNING, "\nCommunicating with Proxmark3 device " _RED_("failed"));
             }
             __atomic_test_and_set(&comm_thread_dead, __ATOMIC_SEQ_CST);
+            signalRx();
             break;
         }
 
@@ -461,7 +669,10 @@ __attribute__((force_align_arg_pointer))
                 if (res == PM3_SUCCESS) {
                     uint64_t clk = msclock();
                     __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
-                    __atomic_store_n(&comm_raw_pos, bufferPos + rxlen, __ATOMIC_SEQ_CST);
+                    // the main thread may have rewound the position meanwhile (bulk download resend),
+                    // bytes of the abandoned window are dropped then
+                    __atomic_compare_exchange_n(&comm_raw_pos, &bufferPos, bufferPos + rxlen, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+                    signalRx();
                 } else if (res != PM3_ENODATA) {
                     PrintAndLogEx(WARNING, "Error when reading raw data: %zu/%zu, %d", bufferPos, bufferLen, res);
                     error = true;
@@ -761,6 +972,7 @@ bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed) {
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
         g_conn.send_via_fpc_usart = false;
 
+        initReplyBuffer();
         pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
         __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
         __atomic_clear(&reconnect_ok, __ATOMIC_SEQ_CST);
@@ -827,6 +1039,7 @@ bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
         g_conn.send_via_fpc_usart = false;
 
+        initReplyBuffer();
         pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
         __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
         g_session.pm3_present = true; // TODO support for multiple devices
@@ -1026,6 +1239,8 @@ size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, boo
     size_t pos = 0;
     while (pos < len) {
 
+        uint32_t seq = getRxSeq();
+
         if (kbd_enter_pressed()) {
             // Send anything to stop the transfer
             PrintAndLogEx(INFO, "Stopping");
@@ -1056,7 +1271,10 @@ size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, boo
 
         print_counter++;
         last_pos = pos;
-        msleep(10);
+        // wake up as soon as data arrives, check the keyboard now and then
+        if (__atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST) == pos) {
+            waitRxSignal(seq, 10);
+        }
     }
     if (pos == len && (ms_timeout != (size_t) - 1)) {
         // If ms_timeout != -1, when the desired data is received, tell the arm side
@@ -1102,6 +1320,8 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
     // Wait until the command is received
     while (true) {
 
+        uint32_t seq = getRxSeq();
+
         // if device gets disconnected or resets,  break out of this loop
         if (IsCommunicationThreadDead()) {
             break;
@@ -1110,6 +1330,7 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
         while (getReply(response)) {
 
             if (cmd == CMD_UNKNOWN || response->cmd == cmd) {
+                recordLatency(response->cmd);
                 return true;
             }
 
@@ -1132,8 +1353,14 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
             PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
             show_warning = false;
         }
-        // just to avoid CPU busy loop:
-        msleep(1);
+
+        // sleep until the communication thread stores a reply
+        uint64_t wait = 100;
+        if (ms_timeout != (size_t) - 1) {
+            uint64_t elapsed = msclock() - tmp_clk;
+            wait = (elapsed < ms_timeout) ? MIN(wait, ms_timeout - elapsed + 1) : 1;
+        }
+        waitRxSignal(seq, wait);
     }
     return false;
 }
@@ -1163,6 +1390,16 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response) {
 */
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
 
+    // bigger transfers are streamed when the firmware supports it
+    if (g_pm3_capabilities.bulk_download && (bytes > PM3_CMD_DATA_SIZE) &&
+            (memtype == BIG_BUF || memtype == BIG_BUF_EML || memtype == SPIFFS)) {
+        return GetFromDeviceBulk(memtype, dest, bytes, start_index, data, datalen, response, ms_timeout, 0);
+    }
+    return GetFromDeviceFramed(memtype, dest, bytes, start_index, data, datalen, response, ms_timeout, show_warning);
+}
+
+bool GetFromDeviceFramed(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
+
     if (dest == NULL) {
         return false;
     }
@@ -1217,6 +1454,179 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
     return false;
 }
 
+/**
+ * @brief Receives one window of a bulk download into the raw receive buffer
+ * @return true when the window and its trailer arrived and the trailer matches
+ */
+static bool dl_bulk_window(const uint8_t *raw, uint32_t offset, uint32_t n, size_t ms_timeout) {
+
+    // the device is quiet until it gets the ACK, so the communication thread can't be filling the buffer now.
+    // Expecting exactly this window keeps the last receive from waiting for more data
+    __atomic_store_n(&comm_raw_len, n + sizeof(uint16_t), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&comm_raw_pos, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&timeout_start_time, msclock(), __ATOMIC_SEQ_CST);
+
+    download_bulk_ack_t ack = { .offset = offset, .abort = 0 };
+    SendCommandNG(CMD_DOWNLOAD_BULK_ACK, (uint8_t *)&ack, sizeof(ack));
+
+    while (true) {
+        uint32_t seq = getRxSeq();
+        if (__atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST) >= n + sizeof(uint16_t)) {
+            break;
+        }
+
+        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+        if (msclock() - tmp_clk > ms_timeout || IsCommunicationThreadDead()) {
+            return false;
+        }
+        waitRxSignal(seq, 100);
+    }
+
+    // trailer is a CRC on links with CRC, same rule as the device uses, otherwise the postamble magic as placeholder.
+    // A window whose CRC happens to equal the magic is still checked against the data
+    uint16_t trailer = raw[n] | (raw[n + 1] << 8);
+    bool with_crc = (g_conn.send_via_fpc_usart && g_conn.send_with_crc_on_fpc) || ((!g_conn.send_via_fpc_usart) && g_conn.send_with_crc_on_usb);
+    if (with_crc == false) {
+        return (trailer == RESPONSENG_POSTAMBLE_MAGIC);
+    }
+
+    uint8_t first, second;
+    compute_crc(CRC_14443_A, raw, n, &first, &second);
+    return ((first << 8) | second) == trailer;
+}
+
+/**
+ * @brief Downloads device memory with the bulk protocol, see CMD_DOWNLOAD_BULK in pm3_cmd.h
+ * Data arrives as raw windows instead of 512 byte frames, each window is acknowledged
+ * and a broken or missing window is asked for again from its offset.
+ * response->oldarg[2] is set to the BigBuf tracelen like for the framed CMD_DOWNLOAD_BIGBUF.
+ * @param window bytes per window, 0 for the device default
+ */
+bool GetFromDeviceBulk(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, const uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, uint32_t window) {
+
+    if (dest == NULL) {
+        return false;
+    }
+
+    PacketResponseNG resp;
+    memset(&resp, 0, sizeof(resp));
+
+    if (response == NULL) {
+        response = &resp;
+    }
+
+    if (bytes == 0) return true;
+
+    download_bulk_t payload;
+    memset(&payload, 0, sizeof(payload));
+    payload.start = start_index;
+    payload.len = bytes;
+    payload.window = window;
+
+    switch (memtype) {
+        case BIG_BUF:
+            payload.source = DOWNLOAD_BULK_BIGBUF;
+            break;
+        case BIG_BUF_EML:
+            payload.source = DOWNLOAD_BULK_EML;
+            break;
+        case SPIFFS:
+            payload.source = DOWNLOAD_BULK_SPIFFS;
+            if (data) {
+                memcpy(payload.filename, data, MIN(datalen, sizeof(payload.filename) - 1));
+            }
+            break;
+        case FLASH_MEM:
+        case SIM_MEM:
+        case FPGA_MEM:
+        case MCU_FLASH:
+        case MCU_MEM:
+            // no bulk source on the device, use the framed download
+            return GetFromDeviceFramed(memtype, dest, bytes, start_index, (uint8_t *)data, datalen, response, ms_timeout, false);
+    }
+
+    // Add delay depending on the communication channel & speed
+    if (ms_timeout != (size_t) - 1) {
+        ms_timeout += communication_delay();
+    }
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_DOWNLOAD_BULK, (uint8_t *)&payload, sizeof(payload));
+    if (WaitForResponseTimeout(CMD_DOWNLOAD_BULK, response, ms_timeout) == false) {
+        PrintAndLogEx(FAILED, "Timed out while trying to download data from device");
+        return false;
+    }
+
+    if (response->status != PM3_SUCCESS || response->length != sizeof(download_bulk_hdr_t)) {
+        PrintAndLogEx(DEBUG, "bulk download refused by device ( %d )", response->status);
+        return false;
+    }
+
+    download_bulk_hdr_t hdr;
+    memcpy(&hdr, response->data.asBytes, sizeof(hdr));
+    uint32_t len = MIN(hdr.len, bytes);
+
+    // keep the fields of the framed download
+    response->oldarg[0] = 0;
+    response->oldarg[1] = len;
+    response->oldarg[2] = hdr.tracelen;
+
+    uint8_t *raw = calloc(hdr.window + sizeof(uint16_t), sizeof(uint8_t));
+    if (raw == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        download_bulk_ack_t ack = { .offset = 0, .abort = 1 };
+        SendCommandNG(CMD_DOWNLOAD_BULK_ACK, (uint8_t *)&ack, sizeof(ack));
+        WaitForResponseTimeout(CMD_DOWNLOAD_BULK_ACK, NULL, ms_timeout);
+        return false;
+    }
+
+    SetCommunicationRawReceiveBuffer(raw, hdr.window + sizeof(uint16_t));
+    SetCommunicationReceiveMode(true);
+
+    uint32_t offset = 0;
+    uint8_t retries = 0;
+    while (offset < len) {
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            break;
+        }
+
+        uint32_t n = MIN(hdr.window, len - offset);
+        if (dl_bulk_window(raw, offset, n, ms_timeout)) {
+            memcpy(dest + offset, raw, n);
+            offset += n;
+            retries = 0;
+            continue;
+        }
+
+        if (++retries > 3) {
+            PrintAndLogEx(FAILED, "Failed to download data from device at offset %u", offset);
+            break;
+        }
+        PrintAndLogEx(DEBUG, "bulk window at offset %u broken, asking again", offset);
+    }
+
+    // the final status comes as a normal frame
+    SetCommunicationReceiveMode(false);
+
+    download_bulk_ack_t ack = { .offset = len, .abort = (offset < len) };
+    SendCommandNG(CMD_DOWNLOAD_BULK_ACK, (uint8_t *)&ack, sizeof(ack));
+
+    PacketResponseNG fin;
+    bool done = WaitForResponseTimeout(CMD_DOWNLOAD_BULK_ACK, &fin, ms_timeout);
+    free(raw);
+
+    if (offset < len) {
+        return false;
+    }
+
+    if (done == false) {
+        PrintAndLogEx(DEBUG, "no final status after bulk download");
+    }
+    return true;
+}
+
 static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd) {
 
     uint32_t bytes_completed = 0;
@@ -1228,7 +1638,10 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
 
     while (true) {
 
-        if (getReply(response)) {
+        uint32_t seq = getRxSeq();
+
+        bool got_reply = getReply(response);
+        if (got_reply) {
 
             if (response->cmd == CMD_ACK)
                 return true;
@@ -1280,6 +1693,15 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
             PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
             show_warning = false;
         }
+
+        if (IsCommunicationThreadDead()) {
+            break;
+        }
+
+        // only sleep when there was nothing to process
+        if (got_reply == false) {
+            waitRxSignal(seq, 100);
+        }
     }
     return false;
 }
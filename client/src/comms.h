@@ -41,8 +41,16 @@ extern "C" {
 #endif
 
 //For storing command that are received from the device
+//default number of entries, overridden by the client.rxbuffer preference
 #ifndef CMD_BUFFER_SIZE
-#define CMD_BUFFER_SIZE 100
+#define CMD_BUFFER_SIZE 128
+#endif
+#define CMD_BUFFER_SIZE_MIN 16
+#define CMD_BUFFER_SIZE_MAX 16384
+
+// how long the communication thread waits for room in a full reply buffer before dropping
+#ifndef RX_BACKPRESSURE_MS
+#define RX_BACKPRESSURE_MS 500
 #endif
 
 #define COMM_RAW_RECEIVE_LEN (1024)
@@ -86,6 +94,24 @@ typedef struct {
 
 extern communication_arg_t g_conn;
 
+// round trip latency histogram, bucket n counts replies taking [2^n, 2^(n+1)) us
+#define COMMS_LATENCY_BUCKETS 24
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+    uint64_t min_us;
+    uint64_t max_us;
+    uint32_t buckets[COMMS_LATENCY_BUCKETS];
+} comms_latency_t;
+
+// reply buffer fill statistics
+typedef struct {
+    uint32_t size;
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t drops;
+} comms_rx_stats_t;
+
 typedef struct pm3_device {
     communication_arg_t *g_conn;
     int script_embedded;
@@ -122,8 +148,16 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response);
 
 int SetHfFieldTimeout(uint32_t timeout_sec, bool quiet);
 
+void AddCommunicationLatency(comms_latency_t *l, uint64_t us);
+void GetCommunicationLatency(comms_latency_t *out);
+void ResetCommunicationLatency(void);
+void GetCommunicationRxStats(comms_rx_stats_t *out);
+void ResetCommunicationRxStats(void);
+
 //bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
+bool GetFromDeviceFramed(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
+bool GetFromDeviceBulk(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, const uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, uint32_t window);
 
 #ifdef __cplusplus
 }
@@ -39,6 +39,7 @@
 #include <mbedtls/blowfish.h>
 #include "libpcrypto.h"
 #include "util.h"
+#include "commonutil.h"  // ARRAYLEN
 #include "ui.h"
 #include "fileutils.h"
 #include "math.h"
@@ -444,15 +445,21 @@ void des_decrypt(void *out, const void *in, const void *key) {
 }
 
 void des_encrypt_ecb(void *out, const void *in, const int length, const void *key) {
+    mbedtls_des_context ctx;
+    mbedtls_des_setkey_enc(&ctx, key);
     for (int i = 0; i < length; i += 8) {
-        des_encrypt((uint8_t *)out + i, (uint8_t *)in + i, key);
+        mbedtls_des_crypt_ecb(&ctx, (const uint8_t *)in + i, (uint8_t *)out + i);
     }
+    mbedtls_des_free(&ctx);
 }
 
 void des_decrypt_ecb(void *out, const void *in, const int length, const void *key) {
+    mbedtls_des_context ctx;
+    mbedtls_des_setkey_dec(&ctx, key);
     for (int i = 0; i < length; i += 8) {
-        des_decrypt((uint8_t *)out + i, (uint8_t *)in + i, key);
+        mbedtls_des_crypt_ecb(&ctx, (const uint8_t *)in + i, (uint8_t *)out + i);
     }
+    mbedtls_des_free(&ctx);
 }
 
 void des_encrypt_cbc(void *out, const void *in, const int length, const void *key, uint8_t *iv) {
@@ -515,6 +522,181 @@ void des3_decrypt(void *out, const void *in, const void *key, uint8_t keycount)
     }
 }
 
+size_t pcrypto_cipher_key_length(pcrypto_cipher_t type) {
+    switch (type) {
+        case PCRYPTO_DES:
+            return 8;
+        case PCRYPTO_3DES2:
+        case PCRYPTO_AES128:
+            return 16;
+        case PCRYPTO_3DES3:
+            return 24;
+        case PCRYPTO_AES256:
+            return 32;
+    }
+    return 0;
+}
+
+int pcrypto_cipher_init(pcrypto_cipher_ctx_t *ctx, pcrypto_cipher_t type, const uint8_t *key) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->type = type;
+    ctx->block_size = MBEDTLS_DES_KEY_SIZE;
+
+    int res = 0;
+    switch (type) {
+        case PCRYPTO_DES:
+            mbedtls_des_init(&ctx->u.des.enc);
+            mbedtls_des_init(&ctx->u.des.dec);
+            res = mbedtls_des_setkey_enc(&ctx->u.des.enc, key);
+            res |= mbedtls_des_setkey_dec(&ctx->u.des.dec, key);
+            break;
+        case PCRYPTO_3DES2:
+            mbedtls_des3_init(&ctx->u.des3.enc);
+            mbedtls_des3_init(&ctx->u.des3.dec);
+            res = mbedtls_des3_set2key_enc(&ctx->u.des3.enc, key);
+            res |= mbedtls_des3_set2key_dec(&ctx->u.des3.dec, key);
+            break;
+        case PCRYPTO_3DES3:
+            mbedtls_des3_init(&ctx->u.des3.enc);
+            mbedtls_des3_init(&ctx->u.des3.dec);
+            res = mbedtls_des3_set3key_enc(&ctx->u.des3.enc, key);
+            res |= mbedtls_des3_set3key_dec(&ctx->u.des3.dec, key);
+            break;
+        case PCRYPTO_AES128:
+        case PCRYPTO_AES256: {
+            unsigned int keybits = (type == PCRYPTO_AES128) ? 128 : 256;
+            ctx->block_size = CRYPTO_AES_BLOCK_SIZE;
+            mbedtls_aes_init(&ctx->u.aes.enc);
+            mbedtls_aes_init(&ctx->u.aes.dec);
+            res = mbedtls_aes_setkey_enc(&ctx->u.aes.enc, key, keybits);
+            res |= mbedtls_aes_setkey_dec(&ctx->u.aes.dec, key, keybits);
+            break;
+        }
+        default:
+            return PM3_EINVARG;
+    }
+
+    if (res) {
+        pcrypto_cipher_free(ctx);
+        return PM3_ESOFT;
+    }
+    return PM3_SUCCESS;
+}
+
+void pcrypto_cipher_free(pcrypto_cipher_ctx_t *ctx) {
+    switch (ctx->type) {
+        case PCRYPTO_DES:
+            mbedtls_des_free(&ctx->u.des.enc);
+            mbedtls_des_free(&ctx->u.des.dec);
+            break;
+        case PCRYPTO_3DES2:
+        case PCRYPTO_3DES3:
+            mbedtls_des3_free(&ctx->u.des3.enc);
+            mbedtls_des3_free(&ctx->u.des3.dec);
+            break;
+        case PCRYPTO_AES128:
+        case PCRYPTO_AES256:
+            mbedtls_aes_free(&ctx->u.aes.enc);
+            mbedtls_aes_free(&ctx->u.aes.dec);
+            break;
+    }
+}
+
+void pcrypto_cipher_block(pcrypto_cipher_ctx_t *ctx, bool encrypt, const uint8_t *in, uint8_t *out) {
+    switch (ctx->type) {
+        case PCRYPTO_DES:
+            mbedtls_des_crypt_ecb(encrypt ? &ctx->u.des.enc : &ctx->u.des.dec, in, out);
+            break;
+        case PCRYPTO_3DES2:
+        case PCRYPTO_3DES3:
+            mbedtls_des3_crypt_ecb(encrypt ? &ctx->u.des3.enc : &ctx->u.des3.dec, in, out);
+            break;
+        case PCRYPTO_AES128:
+        case PCRYPTO_AES256:
+            if (encrypt) {
+                mbedtls_aes_crypt_ecb(&ctx->u.aes.enc, MBEDTLS_AES_ENCRYPT, in, out);
+            } else {
+                mbedtls_aes_crypt_ecb(&ctx->u.aes.dec, MBEDTLS_AES_DECRYPT, in, out);
+            }
+            break;
+    }
+}
+
+void pcrypto_cipher_ecb(pcrypto_cipher_ctx_t *ctx, bool encrypt, const uint8_t *in, uint8_t *out, size_t length) {
+    for (size_t i = 0; i + ctx->block_size <= length; i += ctx->block_size) {
+        pcrypto_cipher_block(ctx, encrypt, in + i, out + i);
+    }
+}
+
+void pcrypto_cipher_cbc(pcrypto_cipher_ctx_t *ctx, bool encrypt, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t length) {
+    size_t bs = ctx->block_size;
+    uint8_t tmp[CRYPTO_AES_BLOCK_SIZE];
+
+    for (size_t i = 0; i + bs <= length; i += bs) {
+        if (encrypt) {
+            memcpy(tmp, in + i, bs);
+            bin_xor(tmp, iv, bs);
+            pcrypto_cipher_block(ctx, true, tmp, out + i);
+            memcpy(iv, out + i, bs);
+        } else {
+            // in and out may be the same buffer
+            memcpy(tmp, in + i, bs);
+            pcrypto_cipher_block(ctx, false, tmp, out + i);
+            bin_xor(out + i, iv, bs);
+            memcpy(iv, tmp, bs);
+        }
+    }
+}
+
+// NIST Special Publication 800-38B, subkey doubling in GF(2^64) or GF(2^128)
+static void pcrypto_cmac_dbl(uint8_t *d, size_t bs) {
+    uint8_t carry = d[0] >> 7;
+    for (size_t i = 0; i < bs - 1; i++) {
+        d[i] = (d[i] << 1) | (d[i + 1] >> 7);
+    }
+    d[bs - 1] <<= 1;
+    if (carry) {
+        d[bs - 1] ^= (bs == 8) ? 0x1B : 0x87;
+    }
+}
+
+int pcrypto_cipher_cmac(pcrypto_cipher_ctx_t *ctx, const uint8_t *in, size_t length, uint8_t *mac) {
+    size_t bs = ctx->block_size;
+    if (bs == 0 || bs > CRYPTO_AES_BLOCK_SIZE) {
+        return PM3_EINVARG;
+    }
+
+    uint8_t k[CRYPTO_AES_BLOCK_SIZE] = {0};
+    uint8_t last[CRYPTO_AES_BLOCK_SIZE] = {0};
+    uint8_t x[CRYPTO_AES_BLOCK_SIZE] = {0};
+
+    // K1, and K2 if the last block is partial
+    pcrypto_cipher_block(ctx, true, k, k);
+    pcrypto_cmac_dbl(k, bs);
+
+    size_t n = (length + bs - 1) / bs;
+    if (n == 0) {
+        n = 1;
+    }
+    size_t rest = length - (n - 1) * bs;
+    if (rest == bs) {
+        memcpy(last, in + (n - 1) * bs, bs);
+    } else {
+        pcrypto_cmac_dbl(k, bs);
+        memcpy(last, in + (n - 1) * bs, rest);
+        last[rest] = 0x80;
+    }
+    bin_xor(last, k, bs);
+
+    for (size_t i = 0; i < n - 1; i++) {
+        bin_xor(x, in + i * bs, bs);
+        pcrypto_cipher_block(ctx, true, x, x);
+    }
+    bin_xor(x, last, bs);
+    pcrypto_cipher_block(ctx, true, x, mac);
+    return PM3_SUCCESS;
+}
+
 // NIST Special Publication 800-38A — Recommendation for block cipher modes of operation: methods and techniques, 2001.
 int aes_encode(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *output, int length) {
     uint8_t iiv[16] = {0};
@@ -944,6 +1126,233 @@ int ecdsa_signature_r_s_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, ui
     return res;
 }
 
+// x = sqrt(a) mod p, p an odd prime. Tonelli-Shanks, single exponentiation when p = 3 mod 4
+static int pcrypto_mpi_sqrt_mod(mbedtls_mpi *x, const mbedtls_mpi *a, const mbedtls_mpi *p) {
+    int ret;
+    mbedtls_mpi q, z, c, t, b, e, tmp;
+    mbedtls_mpi_init(&q);
+    mbedtls_mpi_init(&z);
+    mbedtls_mpi_init(&c);
+    mbedtls_mpi_init(&t);
+    mbedtls_mpi_init(&b);
+    mbedtls_mpi_init(&e);
+    mbedtls_mpi_init(&tmp);
+
+    // p - 1 = q * 2^m
+    MBEDTLS_MPI_CHK(mbedtls_mpi_sub_int(&q, p, 1));
+    size_t m = mbedtls_mpi_lsb(&q);
+    MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(&q, m));
+
+    if (m == 1) {
+        MBEDTLS_MPI_CHK(mbedtls_mpi_add_int(&e, p, 1));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(&e, 2));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(x, a, &e, p, NULL));
+    } else {
+        // any quadratic non-residue
+        MBEDTLS_MPI_CHK(mbedtls_mpi_sub_int(&e, p, 1));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(&e, 1));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&z, 2));
+        for (;;) {
+            MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(&tmp, &z, &e, p, NULL));
+            if (mbedtls_mpi_cmp_int(&tmp, 1) != 0) {
+                break;
+            }
+            MBEDTLS_MPI_CHK(mbedtls_mpi_add_int(&z, &z, 1));
+        }
+
+        MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(&c, &z, &q, p, NULL));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(&t, a, &q, p, NULL));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_add_int(&e, &q, 1));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(&e, 1));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(x, a, &e, p, NULL));
+
+        while (mbedtls_mpi_cmp_int(&t, 1) != 0 && mbedtls_mpi_cmp_int(&t, 0) != 0) {
+            // least i with t^(2^i) = 1
+            size_t i = 0;
+            MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&tmp, &t));
+            while (mbedtls_mpi_cmp_int(&tmp, 1) != 0) {
+                MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&tmp, &tmp, &tmp));
+                MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&tmp, &tmp, p));
+                if (++i == m) {
+                    // not a square
+                    ret = MBEDTLS_ERR_MPI_NOT_ACCEPTABLE;
+                    goto cleanup;
+                }
+            }
+
+            // b = c^(2^(m - i - 1))
+            MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&b, &c));
+            for (size_t j = 0; j < m - i - 1; j++) {
+                MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&b, &b, &b));
+                MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&b, &b, p));
+            }
+            m = i;
+            MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&c, &b, &b));
+            MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&c, &c, p));
+            MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&t, &t, &c));
+            MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&t, &t, p));
+            MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(x, x, &b));
+            MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(x, x, p));
+        }
+        if (mbedtls_mpi_cmp_int(&t, 0) == 0) {
+            MBEDTLS_MPI_CHK(mbedtls_mpi_lset(x, 0));
+        }
+    }
+
+    // a might not have had a root at all
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&tmp, x, x));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&tmp, &tmp, p));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&e, a, p));
+    if (mbedtls_mpi_cmp_mpi(&tmp, &e) != 0) {
+        ret = MBEDTLS_ERR_MPI_NOT_ACCEPTABLE;
+    }
+
+cleanup:
+    mbedtls_mpi_free(&q);
+    mbedtls_mpi_free(&z);
+    mbedtls_mpi_free(&c);
+    mbedtls_mpi_free(&t);
+    mbedtls_mpi_free(&b);
+    mbedtls_mpi_free(&e);
+    mbedtls_mpi_free(&tmp);
+    return ret;
+}
+
+// SEC 1 v2, 4.1.6 public key recovery.
+// Every key which verifies r|s over input is one of the returned points, so instead of a trial
+// verification per known key, the candidates are simply compared against them.
+// The message representative is derived the same way mbedtls_ecdsa_verify does it.
+int ecdsa_public_key_recover(mbedtls_ecp_group *grp, const uint8_t *input, size_t length, const uint8_t *r_s, size_t r_s_len, bool hash,
+                             mbedtls_ecp_point *q, size_t q_max, size_t *q_count) {
+    *q_count = 0;
+    if ((r_s_len == 0) || (r_s_len & 1)) {
+        return PM3_EINVARG;
+    }
+
+    uint8_t shahash[32] = {0};
+    if (hash) {
+        int res = sha256hash((uint8_t *)input, length, shahash);
+        if (res) {
+            return res;
+        }
+        input = shahash;
+        length = sizeof(shahash);
+    }
+
+    int ret;
+    mbedtls_mpi r, s, e, rinv, u1, u2, x, y2, one, minus_one;
+    mbedtls_ecp_point R, A, B;
+    mbedtls_mpi_init(&one);
+    mbedtls_mpi_init(&minus_one);
+    mbedtls_ecp_point_init(&A);
+    mbedtls_ecp_point_init(&B);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    mbedtls_mpi_init(&e);
+    mbedtls_mpi_init(&rinv);
+    mbedtls_mpi_init(&u1);
+    mbedtls_mpi_init(&u2);
+    mbedtls_mpi_init(&x);
+    mbedtls_mpi_init(&y2);
+    mbedtls_ecp_point_init(&R);
+
+    MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&r, r_s, r_s_len / 2));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&s, r_s + r_s_len / 2, r_s_len / 2));
+
+    // no key at all can verify this one
+    if ((mbedtls_mpi_cmp_int(&r, 1) < 0) || (mbedtls_mpi_cmp_mpi(&r, &grp->N) >= 0) ||
+            (mbedtls_mpi_cmp_int(&s, 1) < 0) || (mbedtls_mpi_cmp_mpi(&s, &grp->N) >= 0)) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    // e, leftmost nbits of the input
+    size_t n_size = (grp->nbits + 7) / 8;
+    size_t use_size = (length > n_size) ? n_size : length;
+    MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&e, input, use_size));
+    if (use_size * 8 > grp->nbits) {
+        MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(&e, use_size * 8 - grp->nbits));
+    }
+    if (mbedtls_mpi_cmp_mpi(&e, &grp->N) >= 0) {
+        MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(&e, &e, &grp->N));
+    }
+
+    // Q = r^-1 (sR - eG) = u1 G + u2 R
+    MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&rinv, &r, &grp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u1, &e, &rinv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u1, &u1, &grp->N));
+    if (mbedtls_mpi_cmp_int(&u1, 0) != 0) {
+        MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(&u1, &grp->N, &u1));
+    }
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u2, &s, &rinv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u2, &u2, &grp->N));
+
+    // A = u1 G is shared by all R, and +-R only flips the sign of u2 R.
+    // So two multiplications give both candidates, about the cost of one verification.
+    MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&one, 1));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&minus_one, -1));
+    if (mbedtls_mpi_cmp_int(&u1, 0) == 0) {
+        MBEDTLS_MPI_CHK(mbedtls_ecp_set_zero(&A));
+    } else {
+        MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, &A, &u1, &grp->G, NULL, NULL));
+    }
+
+    // R.x is r + j * n, j = 0 on all but a handful of signatures
+    MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&x, &r));
+    while (mbedtls_mpi_cmp_mpi(&x, &grp->P) < 0) {
+
+        // y^2 = x^3 + ax + b
+        MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&y2, &x, &x));
+        if (grp->A.p == NULL) {
+            MBEDTLS_MPI_CHK(mbedtls_mpi_sub_int(&y2, &y2, 3));
+        } else {
+            MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&y2, &y2, &grp->A));
+        }
+        MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&y2, &y2, &x));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&y2, &y2, &grp->B));
+        MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&y2, &y2, &grp->P));
+
+        if (pcrypto_mpi_sqrt_mod(&R.Y, &y2, &grp->P) == 0) {
+            MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&R.X, &x));
+            MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&R.Z, 1));
+            MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, &B, &u2, &R, NULL, NULL));
+
+            // A + B for R, A - B for -R
+            for (int i = 0; i < 2; i++) {
+                if (*q_count >= q_max) {
+                    break;
+                }
+                if ((i == 1) && (mbedtls_mpi_cmp_int(&R.Y, 0) == 0)) {
+                    break;
+                }
+                MBEDTLS_MPI_CHK(mbedtls_ecp_muladd(grp, &q[*q_count], &one, &A, i ? &minus_one : &one, &B));
+                if (mbedtls_ecp_is_zero(&q[*q_count]) == 0) {
+                    (*q_count)++;
+                }
+            }
+        }
+
+        MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&x, &x, &grp->N));
+    }
+    ret = 0;
+
+cleanup:
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&e);
+    mbedtls_mpi_free(&rinv);
+    mbedtls_mpi_free(&u1);
+    mbedtls_mpi_free(&u2);
+    mbedtls_mpi_free(&x);
+    mbedtls_mpi_free(&y2);
+    mbedtls_mpi_free(&one);
+    mbedtls_mpi_free(&minus_one);
+    mbedtls_ecp_point_free(&R);
+    mbedtls_ecp_point_free(&A);
+    mbedtls_ecp_point_free(&B);
+    return ret;
+}
+
 
 #define T_PRIVATE_KEY "C477F9F65C22CCE20657FAA5B2D1D8122336F851A508A1ED04E479C34985BF96"
 #define T_Q_X         "B7E08AFDFE94BAD3F1DC8C734798BA1C62B3A0AD1E9EA2A38201CD0889BC7A19"
@@ -952,6 +1361,102 @@ int ecdsa_signature_r_s_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, ui
 #define T_R           "2B42F576D07F4165FF65D1F3B1500F81E44C316F1F0B3EF57325B69ACA46104F"
 #define T_S           "DC42C2122D6392CD3E3A993A89502A8198C1886FE69D262C4B329BDB6B63FAF1"
 
+// NIST SP 800-38A F.1.1 / F.2.1 and SP 800-38B D.1 vectors, TDEA CMAC checked against openssl
+int pcrypto_cipher_test(bool verbose) {
+    static const uint8_t aes_key[16] = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    static const uint8_t tdes_key[24] = {
+        0x8a, 0xa8, 0x3b, 0xf8, 0xcb, 0xda, 0x10, 0x62, 0x0b, 0xc1, 0xbf, 0x19, 0xfb, 0xb6, 0xcd, 0x58,
+        0xbc, 0x31, 0x3d, 0x4a, 0x37, 0x1c, 0xa8, 0xb5
+    };
+    static const uint8_t pt[64] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+    };
+    static const uint8_t ecb_ct[64] = {
+        0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60, 0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+        0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d, 0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+        0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23, 0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+        0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f, 0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4
+    };
+    static const uint8_t cbc_ct[64] = {
+        0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+        0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+        0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+        0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+    };
+    static const uint8_t cmac40[16] = {
+        0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27
+    };
+    static const uint8_t cmac64[16] = {
+        0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe
+    };
+    static const uint8_t cmac_3k3des[8] = { 0x74, 0x3d, 0xdb, 0xe0, 0xce, 0x2d, 0xc2, 0xed };
+    static const uint8_t cmac_2k3des[8] = { 0x90, 0xe1, 0xa8, 0x1e, 0x4d, 0x7b, 0xce, 0x16 };
+
+    uint8_t buf[64] = {0};
+    uint8_t iv[16] = {0};
+    uint8_t mac[16] = {0};
+    pcrypto_cipher_ctx_t ctx;
+    bool ok = true;
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "Keyed cipher test " NOLF);
+    }
+
+    if (pcrypto_cipher_init(&ctx, PCRYPTO_AES128, aes_key) != PM3_SUCCESS) {
+        ok = false;
+        goto out;
+    }
+
+    pcrypto_cipher_ecb(&ctx, true, pt, buf, sizeof(buf));
+    ok &= (memcmp(buf, ecb_ct, sizeof(buf)) == 0);
+    pcrypto_cipher_ecb(&ctx, false, buf, buf, sizeof(buf));
+    ok &= (memcmp(buf, pt, sizeof(buf)) == 0);
+
+    for (int i = 0; i < sizeof(iv); i++) {
+        iv[i] = i;
+    }
+    pcrypto_cipher_cbc(&ctx, true, iv, pt, buf, sizeof(buf));
+    ok &= (memcmp(buf, cbc_ct, sizeof(buf)) == 0);
+    for (int i = 0; i < sizeof(iv); i++) {
+        iv[i] = i;
+    }
+    pcrypto_cipher_cbc(&ctx, false, iv, buf, buf, sizeof(buf));
+    ok &= (memcmp(buf, pt, sizeof(buf)) == 0);
+
+    pcrypto_cipher_cmac(&ctx, pt, 40, mac);
+    ok &= (memcmp(mac, cmac40, sizeof(cmac40)) == 0);
+    pcrypto_cipher_cmac(&ctx, pt, 64, mac);
+    ok &= (memcmp(mac, cmac64, sizeof(cmac64)) == 0);
+    pcrypto_cipher_free(&ctx);
+
+    if (pcrypto_cipher_init(&ctx, PCRYPTO_3DES3, tdes_key) != PM3_SUCCESS) {
+        ok = false;
+        goto out;
+    }
+    pcrypto_cipher_cmac(&ctx, pt, 20, mac);
+    ok &= (memcmp(mac, cmac_3k3des, sizeof(cmac_3k3des)) == 0);
+    pcrypto_cipher_free(&ctx);
+
+    if (pcrypto_cipher_init(&ctx, PCRYPTO_3DES2, tdes_key) != PM3_SUCCESS) {
+        ok = false;
+        goto out;
+    }
+    pcrypto_cipher_cmac(&ctx, pt, 20, mac);
+    ok &= (memcmp(mac, cmac_2k3des, sizeof(cmac_2k3des)) == 0);
+    pcrypto_cipher_free(&ctx);
+
+out:
+    if (verbose) {
+        PrintAndLogEx(NORMAL, "( %s )", ok ? _GREEN_("ok") : _RED_("fail"));
+    }
+    return ok ? PM3_SUCCESS : PM3_ESOFT;
+}
+
 int ecdsa_nist_test(bool verbose) {
     int res;
     uint8_t input[] = "Example of ECDSA with P-256";
@@ -1041,6 +1546,98 @@ exit:
 }
 
 
+// recovers the key from fresh signatures on every curve the originality checks use
+int ecdsa_recover_test(bool verbose) {
+    static const mbedtls_ecp_group_id curves[] = {
+        MBEDTLS_ECP_DP_SECP128R1, MBEDTLS_ECP_DP_SECP192R1, MBEDTLS_ECP_DP_SECP224R1, MBEDTLS_ECP_DP_SECP256R1
+    };
+    uint8_t uid[] = {0x04, 0x2F, 0x63, 0xD2, 0x4A, 0x6E, 0x80};
+    const char *pers = "ecdsaproxmark";
+    int res = 0;
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "ECDSA public key recovery test " NOLF);
+    }
+
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    res = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, (const unsigned char *)pers, strlen(pers));
+    if (res) {
+        goto exit;
+    }
+
+    for (size_t i = 0; i < ARRAYLEN(curves) && res == 0; i++) {
+        // raw UID as the old tags sign it, and its sha256 like ST25 / ICODE do
+        for (int hash = 0; hash < 2 && res == 0; hash++) {
+            uint8_t shahash[32] = {0};
+            sha256hash(uid, sizeof(uid), shahash);
+
+            mbedtls_ecdsa_context ctx;
+            mbedtls_ecdsa_init(&ctx);
+            mbedtls_mpi r, s;
+            mbedtls_mpi_init(&r);
+            mbedtls_mpi_init(&s);
+            mbedtls_ecp_point q[4];
+            for (size_t j = 0; j < ARRAYLEN(q); j++) {
+                mbedtls_ecp_point_init(&q[j]);
+            }
+
+            uint8_t r_s[64] = {0};
+            size_t keylen = 0;
+            size_t q_count = 0;
+
+            res = mbedtls_ecdsa_genkey(&ctx, curves[i], mbedtls_ctr_drbg_random, &ctr_drbg);
+            if (res == 0) {
+                res = mbedtls_ecdsa_sign(&ctx.grp, &r, &s, &ctx.d, hash ? shahash : uid, hash ? sizeof(shahash) : sizeof(uid), mbedtls_ctr_drbg_random, &ctr_drbg);
+            }
+            if (res == 0) {
+                keylen = (ctx.grp.nbits + 7) / 8;
+                res = mbedtls_mpi_write_binary(&r, r_s, keylen);
+                res |= mbedtls_mpi_write_binary(&s, r_s + keylen, keylen);
+            }
+            if (res == 0) {
+                res = ecdsa_public_key_recover(&ctx.grp, uid, sizeof(uid), r_s, keylen * 2, hash, q, ARRAYLEN(q), &q_count);
+            }
+            if (res == 0) {
+                res = 1;
+                for (size_t j = 0; j < q_count; j++) {
+                    if (mbedtls_ecp_point_cmp(&q[j], &ctx.Q) == 0) {
+                        res = 0;
+                    }
+                }
+            }
+
+            // a damaged signature must not give back the key
+            if (res == 0) {
+                r_s[keylen * 2 - 1] ^= 0x01;
+                res = ecdsa_public_key_recover(&ctx.grp, uid, sizeof(uid), r_s, keylen * 2, hash, q, ARRAYLEN(q), &q_count);
+                for (size_t j = 0; j < q_count && res == 0; j++) {
+                    if (mbedtls_ecp_point_cmp(&q[j], &ctx.Q) == 0) {
+                        res = 2;
+                    }
+                }
+            }
+
+            for (size_t j = 0; j < ARRAYLEN(q); j++) {
+                mbedtls_ecp_point_free(&q[j]);
+            }
+            mbedtls_mpi_free(&r);
+            mbedtls_mpi_free(&s);
+            mbedtls_ecdsa_free(&ctx);
+        }
+    }
+
+exit:
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+    if (verbose) {
+        PrintAndLogEx(NORMAL, "( %s )", (res == 0) ? _GREEN_("ok") : _RED_("fail"));
+    }
+    return res;
+}
+
 // iceman:  todo,  remove and use xor in commonutil.c
 void bin_xor(uint8_t *d1, const uint8_t *d2, size_t len) {
     for (size_t i = 0; i < len; i++) {
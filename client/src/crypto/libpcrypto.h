@@ -25,6 +25,8 @@
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/pk.h>
+#include <mbedtls/des.h>
+#include <mbedtls/aes.h>
 
 #define CRYPTO_AES_BLOCK_SIZE 16
 #define CRYPTO_AES128_KEY_SIZE 16
@@ -48,6 +50,48 @@ void des_decrypt_cbc(void *out, const void *in, const int length, const void *ke
 void des3_encrypt(void *out, const void *in, const void *key, uint8_t keycount);
 void des3_decrypt(void *out, const void *in, const void *key, uint8_t keycount);
 
+// Keyed block cipher. The key schedule is built once by pcrypto_cipher_init and
+// reused for every block, use it instead of the one-shot helpers above when
+// more than one block is processed with the same key.
+typedef enum {
+    PCRYPTO_DES,        // 8 byte key
+    PCRYPTO_3DES2,      // 16 byte key, K1 K2 K1
+    PCRYPTO_3DES3,      // 24 byte key
+    PCRYPTO_AES128,     // 16 byte key
+    PCRYPTO_AES256,     // 32 byte key
+} pcrypto_cipher_t;
+
+typedef struct {
+    pcrypto_cipher_t type;
+    size_t block_size;
+    union {
+        struct {
+            mbedtls_des_context enc;
+            mbedtls_des_context dec;
+        } des;
+        struct {
+            mbedtls_des3_context enc;
+            mbedtls_des3_context dec;
+        } des3;
+        struct {
+            mbedtls_aes_context enc;
+            mbedtls_aes_context dec;
+        } aes;
+    } u;
+} pcrypto_cipher_ctx_t;
+
+size_t pcrypto_cipher_key_length(pcrypto_cipher_t type);
+int pcrypto_cipher_init(pcrypto_cipher_ctx_t *ctx, pcrypto_cipher_t type, const uint8_t *key);
+void pcrypto_cipher_free(pcrypto_cipher_ctx_t *ctx);
+// one block, in and out may overlap
+void pcrypto_cipher_block(pcrypto_cipher_ctx_t *ctx, bool encrypt, const uint8_t *in, uint8_t *out);
+// length is a multiple of the block size. cbc updates iv
+void pcrypto_cipher_ecb(pcrypto_cipher_ctx_t *ctx, bool encrypt, const uint8_t *in, uint8_t *out, size_t length);
+void pcrypto_cipher_cbc(pcrypto_cipher_ctx_t *ctx, bool encrypt, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t length);
+// NIST SP 800-38B CMAC, mac is one block
+int pcrypto_cipher_cmac(pcrypto_cipher_ctx_t *ctx, const uint8_t *in, size_t length, uint8_t *mac);
+int pcrypto_cipher_test(bool verbose);
+
 int aes_encode(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *output, int length);
 int aes_decode(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *output, int length);
 
@@ -66,11 +110,15 @@ int ecdsa_public_key_from_pk(mbedtls_pk_context *pk, mbedtls_ecp_group_id curvei
 int ecdsa_signature_create(mbedtls_ecp_group_id curveid, uint8_t *key_d, uint8_t *key_xy, uint8_t *input, int length, uint8_t *signature, size_t *signaturelen, bool hash);
 int ecdsa_signature_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, uint8_t *input, int length, uint8_t *signature, size_t signaturelen, bool hash);
 int ecdsa_signature_r_s_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, uint8_t *input, int length, uint8_t *r_s, size_t r_s_len, bool hash);
+// candidates for the public key that signed input, up to four points
+int ecdsa_public_key_recover(mbedtls_ecp_group *grp, const uint8_t *input, size_t length, const uint8_t *r_s, size_t r_s_len, bool hash,
+                             mbedtls_ecp_point *q, size_t q_max, size_t *q_count);
 int ensure_ec_private_key(const char *input_or_path, mbedtls_ecp_group_id curveid, uint8_t *out_priv, size_t out_priv_len);
 
 char *ecdsa_get_error(int ret);
 
 int ecdsa_nist_test(bool verbose);
+int ecdsa_recover_test(bool verbose);
 
 void bin_xor(uint8_t *d1, const uint8_t *d2, size_t len);
 
@@ -18,7 +18,9 @@
 
 #include "originality.h"
 #include <string.h>       // memcpy
+#include <pthread.h>
 #include "ui.h"
+#include "util.h"         // num_CPUs
 
 // See tools/recover_pk.py to recover Pk from UIDs and signatures
 const ecdsa_publickey_ng_t manufacturer_public_keys[] = {
@@ -145,14 +147,70 @@ const ecdsa_publickey_ng_t manufacturer_public_keys[] = {
         "04F971EDA742A4A80D32DCF6A814A707CC3DC396D35902F72929FDCD698B3468F2"
     },
 };
+_Static_assert(ARRAYLEN(manufacturer_public_keys) <= ORIGINALITY_MAX_KEYS, "manufacturer_public_keys must fit ORIGINALITY_MAX_KEYS");
 
 
-// returns index of pk if match else -1
-int originality_check_verify(uint8_t *data, uint8_t data_len, uint8_t *signature, uint8_t signature_len, pk_type_t type) {
-    return originality_check_verify_ex(data, data_len, signature, signature_len, type, false, false);
+// Every key in the table, parsed once. The points don't depend on anything else, so all threads share them.
+static mbedtls_ecp_point originality_keys[ARRAYLEN(manufacturer_public_keys)];
+static bool originality_keys_ok[ARRAYLEN(manufacturer_public_keys)];
+static pthread_once_t originality_keys_once = PTHREAD_ONCE_INIT;
+
+#define ORIGINALITY_MAX_CURVES      4
+#define ORIGINALITY_MAX_CANDIDATES  4
+
+// mbedtls caches its comb table for G inside the group, so every thread loads its own groups
+typedef struct {
+    mbedtls_ecp_group grp[ORIGINALITY_MAX_CURVES];
+    size_t count;
+} originality_groups_t;
+
+static mbedtls_ecp_group *originality_group(originality_groups_t *g, mbedtls_ecp_group_id id) {
+    for (size_t i = 0; i < g->count; i++) {
+        if (g->grp[i].id == id) {
+            return &g->grp[i];
+        }
+    }
+
+    if (g->count == ORIGINALITY_MAX_CURVES) {
+        return NULL;
+    }
+
+    mbedtls_ecp_group_init(&g->grp[g->count]);
+    if (mbedtls_ecp_group_load(&g->grp[g->count], id)) {
+        mbedtls_ecp_group_free(&g->grp[g->count]);
+        return NULL;
+    }
+    return &g->grp[g->count++];
 }
 
-int originality_check_verify_ex(uint8_t *data, uint8_t data_len, uint8_t *signature, uint8_t signature_len, pk_type_t type, bool reverse, bool hash) {
+static void originality_groups_free(originality_groups_t *g) {
+    for (size_t i = 0; i < g->count; i++) {
+        mbedtls_ecp_group_free(&g->grp[i]);
+    }
+    g->count = 0;
+}
+
+static void originality_keys_load(void) {
+    originality_groups_t g = {0};
+
+    for (size_t i = 0; i < ARRAYLEN(manufacturer_public_keys); i++) {
+        mbedtls_ecp_point_init(&originality_keys[i]);
+
+        int dl = 0;
+        uint8_t key[manufacturer_public_keys[i].keylen];
+        param_gethex_to_eol(manufacturer_public_keys[i].value, 0, key, manufacturer_public_keys[i].keylen, &dl);
+
+        mbedtls_ecp_group *grp = originality_group(&g, manufacturer_public_keys[i].grp_id);
+        originality_keys_ok[i] = (grp != NULL) && (dl == manufacturer_public_keys[i].keylen) &&
+                                 (mbedtls_ecp_point_read_binary(grp, &originality_keys[i], key, dl) == 0);
+    }
+
+    originality_groups_free(&g);
+}
+
+// Recovers the signing key once per curve and looks it up, instead of a trial verification per key.
+// Keys are still visited in table order, so the index returned is the same as before.
+static int originality_verify(originality_groups_t *g, uint8_t *data, uint8_t data_len, uint8_t *signature, uint8_t signature_len, pk_type_t type, bool reverse, bool hash) {
     // test if signature is all zeros
     bool is_zero = true;
     for (uint8_t i = 0; i < signature_len; i++) {
@@ -177,20 +235,159 @@ int originality_check_verify_ex(uint8_t *data, uint8_t data_len, uint8_t *signat
         memcpy(tmp_signature, signature, signature_len);
     }
 
-    for (uint8_t i = 0; i < ARRAYLEN(manufacturer_public_keys); i++) {
+    pthread_once(&originality_keys_once, originality_keys_load);
+
+    // candidates per curve, recovered on first use
+    mbedtls_ecp_group_id curve_id[ORIGINALITY_MAX_CURVES];
+    mbedtls_ecp_point candidates[ORIGINALITY_MAX_CURVES][ORIGINALITY_MAX_CANDIDATES];
+    size_t candidates_count[ORIGINALITY_MAX_CURVES] = {0};
+    bool recovered[ORIGINALITY_MAX_CURVES] = {0};
+    size_t curves = 0;
+    int index = -1;
+
+    for (size_t i = 0; i < ARRAYLEN(manufacturer_public_keys) && index < 0; i++) {
         if ((type != PK_ALL) && (type != manufacturer_public_keys[i].type)) {
             continue;
         }
 
+        size_t c = 0;
+        while (c < curves && curve_id[c] != manufacturer_public_keys[i].grp_id) {
+            c++;
+        }
+
+        if (c == curves && curves < ORIGINALITY_MAX_CURVES) {
+            curve_id[c] = manufacturer_public_keys[i].grp_id;
+            for (size_t j = 0; j < ORIGINALITY_MAX_CANDIDATES; j++) {
+                mbedtls_ecp_point_init(&candidates[c][j]);
+            }
+            curves++;
+
+            mbedtls_ecp_group *grp = originality_group(g, curve_id[c]);
+            recovered[c] = (grp != NULL) &&
+                           (ecdsa_public_key_recover(grp, tmp_data, data_len, tmp_signature, signature_len, hash,
+                                                     candidates[c], ORIGINALITY_MAX_CANDIDATES, &candidates_count[c]) == 0);
+        }
+
+        if (c < curves && recovered[c] && originality_keys_ok[i]) {
+            for (size_t j = 0; j < candidates_count[c]; j++) {
+                if (mbedtls_ecp_point_cmp(&candidates[c][j], &originality_keys[i]) == 0) {
+                    index = i;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        // couldn't recover, verify against this key the old way
         int dl = 0;
         uint8_t key[manufacturer_public_keys[i].keylen];
         param_gethex_to_eol(manufacturer_public_keys[i].value, 0, key, manufacturer_public_keys[i].keylen, &dl);
 
         if (ecdsa_signature_r_s_verify(manufacturer_public_keys[i].grp_id, key, tmp_data, data_len, tmp_signature, signature_len, hash) == 0) {
-            return i;
+            index = i;
+        }
+    }
+
+    for (size_t c = 0; c < curves; c++) {
+        for (size_t j = 0; j < ORIGINALITY_MAX_CANDIDATES; j++) {
+            mbedtls_ecp_point_free(&candidates[c][j]);
+        }
+    }
+    return index;
+}
+
+// returns index of pk if match else -1
+int originality_check_verify(uint8_t *data, uint8_t data_len, uint8_t *signature, uint8_t signature_len, pk_type_t type) {
+    return originality_check_verify_ex(data, data_len, signature, signature_len, type, false, false);
+}
+
+int originality_check_verify_ex(uint8_t *data, uint8_t data_len, uint8_t *signature, uint8_t signature_len, pk_type_t type, bool reverse, bool hash) {
+    originality_groups_t g = {0};
+    int index = originality_verify(&g, data, data_len, signature, signature_len, type, reverse, hash);
+    originality_groups_free(&g);
+    return index;
+}
+
+typedef struct {
+    originality_entry_t *entries;
+    size_t count;
+    size_t *next;
+    pk_type_t type;
+    bool reverse;
+    bool hash;
+} originality_batch_t;
+
+static void *originality_batch_worker(void *arg) {
+    originality_batch_t *b = (originality_batch_t *)arg;
+    originality_groups_t g = {0};
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(b->next, 1, __ATOMIC_RELAXED);
+        if (i >= b->count) {
+            break;
+        }
+        originality_entry_t *e = &b->entries[i];
+        e->index = originality_verify(&g, e->data, e->data_len, e->signature, e->signature_len, b->type, b->reverse, b->hash);
+    }
+
+    originality_groups_free(&g);
+    return NULL;
+}
+
+// fills in index of every entry, returns how many matched a key.
+// workers, when set, gets the number of threads that verified, the calling thread included
+size_t originality_check_verify_batch(originality_entry_t *entries, size_t count, pk_type_t type, bool reverse, bool hash, int *workers) {
+    size_t next = 0;
+
+    // the calling thread is one of the workers
+    int num_threads = MIN((size_t)num_CPUs(), count) - 1;
+    if (num_threads < 0) {
+        num_threads = 0;
+    }
+
+    originality_batch_t batch = {
+        .entries = entries,
+        .count = count,
+        .next = &next,
+        .type = type,
+        .reverse = reverse,
+        .hash = hash,
+    };
+
+    pthread_t threads[num_threads + 1];
+    int started = 0;
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, originality_batch_worker, &batch) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    // whatever is left if no thread could be started
+    originality_batch_worker(&batch);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (workers) {
+        *workers = started + 1;
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].index >= 0) {
+            found++;
         }
     }
-    return -1;
+    return found;
+}
+
+const char *originality_key_name(int index) {
+    if ((index < 0) || (index >= ARRAYLEN(manufacturer_public_keys))) {
+        return NULL;
+    }
+    return manufacturer_public_keys[index].desc;
 }
 
 int originality_check_print(uint8_t *signature, int signature_len, int index) {
@@ -25,6 +25,9 @@
 #include <mbedtls/pk.h>
 #include <mbedtls/ecp.h>
 
+// upper bound of the number of keys in the public key table, for callers counting per key
+#define ORIGINALITY_MAX_KEYS    64
+
 typedef enum {PK_MFC, PK_MFUL, PK_MFULAES, PK_MFP, PK_MFDES, PK_ST25TA, PK_ST25TN, PK_ST25TV, PK_15, PK_MIK, PK_ALL} pk_type_t;
 
 typedef struct {
@@ -39,4 +42,16 @@ int originality_check_verify(uint8_t *data, uint8_t data_len, uint8_t *signature
 int originality_check_verify_ex(uint8_t *data, uint8_t data_len, uint8_t *signature, uint8_t signature_len, pk_type_t type, bool reverse, bool hash);
 int originality_check_print(uint8_t *signature, int signature_len, int index);
 
+// one (UID, signature) pair of a batch, index is filled in like originality_check_verify returns it
+typedef struct {
+    uint8_t data[16];
+    uint8_t data_len;
+    uint8_t signature[64];
+    uint8_t signature_len;
+    int index;
+} originality_entry_t;
+
+size_t originality_check_verify_batch(originality_entry_t *entries, size_t count, pk_type_t type, bool reverse, bool hash, int *workers);
+const char *originality_key_name(int index);
+
 #endif /* originality.h */
@@ -84,9 +84,15 @@ int ExecuteCryptoTests(bool verbose, bool ignore_time, bool include_slow_tests)
     res = mbedtls_cmac_self_test(verbose);
     if (res) TestFail = true;
 
+    res = pcrypto_cipher_test(verbose);
+    if (res) TestFail = true;
+
     res = ecdsa_nist_test(verbose);
     if (res) TestFail = true;
 
+    res = ecdsa_recover_test(verbose);
+    if (res) TestFail = true;
+
     res = mbedtls_ecp_self_test(verbose);
     if (res) TestFail = true;
 
@@ -29,10 +29,13 @@
 #include "cmdhficlass.h"  // pagemap
 #include "iclass_cmd.h"
 #include "iso15.h"
+#include "crc32.h"
 
 #ifdef _WIN32
 #include "scandir.h"
 #include <direct.h>
+#else
+#include <sys/mman.h>
 #endif
 
 #define PATH_MAX_LENGTH 200
@@ -122,6 +125,28 @@ int fileExists(const char *filename) {
     return result == 0;
 }
 
+/**
+ * @brief moves a file written aside over the file it replaces, the aside file is removed on failure
+ * @param tmp_path file written aside, usually `<path>.tmp`
+ * @param path
+ * @return PM3_SUCCESS or PM3_EFILE
+ */
+int replaceFile(const char *tmp_path, const char *path) {
+
+    if (rename(tmp_path, path) == 0) {
+        return PM3_SUCCESS;
+    }
+
+    // windows doesn't replace an existing file
+    remove(path);
+    if (rename(tmp_path, path) == 0) {
+        return PM3_SUCCESS;
+    }
+
+    remove(tmp_path);
+    return PM3_EFILE;
+}
+
 /**
  * @brief checks if path is directory.
  * @param filename
@@ -2292,6 +2317,444 @@ int loadFileJSONroot(const char *preferredName, void **proot, bool verbose) {
     return retval;
 }
 
+//-----------------------------------------------------------------------------
+// Compiled dictionaries (.dicb)
+//
+// A compiled dictionary is the binary image of a .dic file for one key length:
+//   dicb_header_t | keys (count * keylen, dictionary order, no duplicates) | index (count * uint32_t)
+// The index holds the key numbers in ascending key order and is used for lookups.
+// It is stored next to the .dic file (or in the user dictionaries folder). The header records
+// the path, size and mtime of the text file, a compiled file that doesn't match is rebuilt.
+//-----------------------------------------------------------------------------
+static int loadFileDICTIONARY_safe_int(const char *preferredName, const char *suffix, void **pdata, uint8_t keylen, uint32_t *keycnt, bool verbose, bool use_cache);
+
+static char *dictionary_cache_path(const char *path, bool user_dir) {
+
+    if (user_dir == false) {
+        char *fn = calloc(strlen(path) + 2, sizeof(char));
+        if (fn != NULL) {
+            snprintf(fn, strlen(path) + 2, "%sb", path);
+        }
+        return fn;
+    }
+
+    const char *user_path = get_my_user_directory();
+    if (user_path == NULL) {
+        return NULL;
+    }
+
+    const char *base = path;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            base = p + 1;
+        }
+    }
+
+    size_t n = strlen(user_path) + strlen(PM3_USER_DIRECTORY) + strlen(DICTIONARIES_SUBDIR) + strlen(base) + 2;
+    char *fn = calloc(n, sizeof(char));
+    if (fn != NULL) {
+        snprintf(fn, n, "%s%s%s%sb", user_path, PM3_USER_DIRECTORY, DICTIONARIES_SUBDIR, base);
+    }
+    return fn;
+}
+
+static void dictionary_source_id(const char *path, const struct stat *st, dicb_header_t *hdr) {
+    uint8_t crc[4];
+    crc32_ex((const uint8_t *)path, strlen(path), crc);
+    hdr->src_path_crc = MemLeToUint4byte(crc);
+    hdr->src_size = (uint64_t)st->st_size;
+    hdr->src_mtime = (int64_t)st->st_mtime;
+}
+
+static size_t dictionary_index_offset(uint32_t count, uint8_t keylen) {
+    size_t offset = sizeof(dicb_header_t) + (size_t)count * keylen;
+    return (offset + 3) & ~((size_t)3);
+}
+
+static int dictionary_map(const char *fn, dictionary_t *dict) {
+
+    FILE *f = fopen(fn, "rb");
+    if (f == NULL) {
+        return PM3_EFILE;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (fsize < (long)sizeof(dicb_header_t)) {
+        fclose(f);
+        return PM3_EFILE;
+    }
+
+    dict->size = fsize;
+
+#ifdef _WIN32
+    dict->base = calloc(fsize, sizeof(uint8_t));
+    if (dict->base == NULL) {
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+
+    if (fread(dict->base, 1, fsize, f) != (size_t)fsize) {
+        free(dict->base);
+        dict->base = NULL;
+        fclose(f);
+        return PM3_EFILE;
+    }
+    dict->mapped = false;
+#else
+    dict->base = mmap(NULL, fsize, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (dict->base == MAP_FAILED) {
+        dict->base = NULL;
+        fclose(f);
+        return PM3_EFILE;
+    }
+    dict->mapped = true;
+#endif
+    fclose(f);
+    return PM3_SUCCESS;
+}
+
+void dictionary_close(dictionary_t *dict) {
+    if (dict == NULL || dict->base == NULL) {
+        return;
+    }
+
+#ifndef _WIN32
+    if (dict->mapped) {
+        munmap(dict->base, dict->size);
+    } else
+#endif
+    {
+        free(dict->base);
+    }
+    memset(dict, 0, sizeof(dictionary_t));
+}
+
+// open the compiled version of the dictionary at `path` if there is an up to date one,
+// a compiled file that was made from another version of the text file is rebuilt.
+static int dictionary_open_cache(const char *path, uint8_t keylen, dictionary_t *dict) {
+
+    memset(dict, 0, sizeof(dictionary_t));
+
+    struct stat st_dic;
+    if (stat(path, &st_dic) != 0) {
+        return PM3_EFILE;
+    }
+
+    dicb_header_t src;
+    dictionary_source_id(path, &st_dic, &src);
+
+    bool stale = false;
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+
+        for (uint8_t i = 0; i < 2; i++) {
+
+            char *fn = dictionary_cache_path(path, (i == 1));
+            if (fn == NULL) {
+                continue;
+            }
+
+            int res = dictionary_map(fn, dict);
+            if (res != PM3_SUCCESS) {
+                free(fn);
+                continue;
+            }
+
+            const dicb_header_t *hdr = (const dicb_header_t *)dict->base;
+            if (memcmp(hdr->magic, DICB_MAGIC, sizeof(hdr->magic)) != 0 ||
+                    hdr->version != DICB_VERSION ||
+                    hdr->keylen != keylen ||
+                    dictionary_index_offset(hdr->count, hdr->keylen) + (size_t)hdr->count * sizeof(uint32_t) > dict->size) {
+                PrintAndLogEx(DEBUG, "ignoring compiled dictionary `%s`", fn);
+                dictionary_close(dict);
+                free(fn);
+                continue;
+            }
+
+            if (hdr->src_path_crc != src.src_path_crc ||
+                    hdr->src_size != src.src_size ||
+                    hdr->src_mtime != src.src_mtime) {
+                PrintAndLogEx(DEBUG, "compiled dictionary `%s` is out of date", fn);
+                stale = true;
+                dictionary_close(dict);
+                free(fn);
+                continue;
+            }
+
+            dict->keylen = hdr->keylen;
+            dict->count = hdr->count;
+            dict->keys = (const uint8_t *)dict->base + sizeof(dicb_header_t);
+            dict->index = (const uint32_t *)((const uint8_t *)dict->base + dictionary_index_offset(hdr->count, hdr->keylen));
+            PrintAndLogEx(DEBUG, "using compiled dictionary `%s`", fn);
+            free(fn);
+            return PM3_SUCCESS;
+        }
+
+        // only dictionaries that were compiled before are rebuilt
+        if (stale == false || dictionary_compile(path, keylen, NULL, NULL, false) != PM3_SUCCESS) {
+            break;
+        }
+        PrintAndLogEx(DEBUG, "rebuilt compiled dictionary for `%s`", path);
+    }
+    return PM3_EFILE;
+}
+
+// same semantics as loadFileDICTIONARYEx, file positions are byte offsets in the compiled file.
+static int dictionary_read_chunk(const dictionary_t *dict, void *data, size_t maxdatalen, size_t *datalen, uint32_t *keycnt,
+                                 size_t startFilePosition, size_t *endFilePosition) {
+
+    size_t first = 0;
+    if (startFilePosition > sizeof(dicb_header_t)) {
+        first = (startFilePosition - sizeof(dicb_header_t)) / dict->keylen;
+    }
+    if (first > dict->count) {
+        first = dict->count;
+    }
+
+    size_t n = dict->count - first;
+    if (maxdatalen && n > maxdatalen / dict->keylen) {
+        n = maxdatalen / dict->keylen;
+    }
+
+    memcpy(data, dict->keys + first * dict->keylen, n * dict->keylen);
+
+    if (datalen) {
+        *datalen = n * dict->keylen;
+    }
+
+    if (keycnt) {
+        *keycnt = n;
+    }
+
+    if (first + n < dict->count) {
+        if (endFilePosition) {
+            *endFilePosition = sizeof(dicb_header_t) + (first + n) * dict->keylen;
+        }
+        return 1;
+    }
+
+    if (endFilePosition) {
+        *endFilePosition = 0;
+    }
+    return PM3_SUCCESS;
+}
+
+int dictionary_open(const char *preferredName, uint8_t keylen, dictionary_t *dict, bool verbose) {
+
+    if (dict == NULL) {
+        return PM3_EINVARG;
+    }
+
+    memset(dict, 0, sizeof(dictionary_t));
+
+    char *path;
+    if (searchFile(&path, DICTIONARIES_SUBDIR, preferredName, ".dic", false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    int res = dictionary_open_cache(path, keylen, dict);
+    if (res == PM3_SUCCESS && verbose) {
+        PrintAndLogEx(SUCCESS, "Mapped " _GREEN_("%u") " keys from compiled dictionary file `" _YELLOW_("%s") "`", dict->count, path);
+    }
+    free(path);
+    return res;
+}
+
+bool dictionary_contains(const dictionary_t *dict, const uint8_t *key, uint32_t *keyno) {
+
+    if (dict == NULL || dict->index == NULL || key == NULL) {
+        return false;
+    }
+
+    uint32_t lo = 0, hi = dict->count;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) >> 1);
+        int cmp = memcmp(dict->keys + (size_t)dict->index[mid] * dict->keylen, key, dict->keylen);
+        if (cmp == 0) {
+            if (keyno) {
+                *keyno = dict->index[mid];
+            }
+            return true;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+// stable merge sort of key numbers by key value
+static void dictionary_sort_index(uint32_t *idx, uint32_t *tmp, uint32_t n, const uint8_t *keys, uint8_t keylen) {
+    for (uint32_t width = 1; width < n; width <<= 1) {
+        for (uint32_t lo = 0; lo < n; lo += 2 * width) {
+            uint32_t mid = MIN(lo + width, n);
+            uint32_t hi = MIN(lo + 2 * width, n);
+            uint32_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                if (memcmp(keys + (size_t)idx[b] * keylen, keys + (size_t)idx[a] * keylen, keylen) < 0) {
+                    tmp[k++] = idx[b++];
+                } else {
+                    tmp[k++] = idx[a++];
+                }
+            }
+            while (a < mid) {
+                tmp[k++] = idx[a++];
+            }
+            while (b < hi) {
+                tmp[k++] = idx[b++];
+            }
+        }
+        memcpy(idx, tmp, n * sizeof(uint32_t));
+    }
+}
+
+int dictionary_compile(const char *preferredName, uint8_t keylen, uint32_t *keycnt, uint32_t *dupcnt, bool verbose) {
+
+    char *path;
+    if (searchFile(&path, DICTIONARIES_SUBDIR, preferredName, ".dic", false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    uint8_t *keys = NULL;
+    uint32_t count = 0;
+    int res = loadFileDICTIONARY_safe_int(preferredName, ".dic", (void **)&keys, keylen, &count, verbose, false);
+    if (res != PM3_SUCCESS) {
+        free(keys);
+        free(path);
+        return res;
+    }
+
+    uint32_t *idx = calloc(MAX(count, 1), sizeof(uint32_t));
+    uint32_t *tmp = calloc(MAX(count, 1), sizeof(uint32_t));
+    uint8_t *dup = calloc(MAX(count, 1), sizeof(uint8_t));
+    uint32_t *newno = calloc(MAX(count, 1), sizeof(uint32_t));
+    if (idx == NULL || tmp == NULL || dup == NULL || newno == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        res = PM3_EMALLOC;
+        goto out;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        idx[i] = i;
+    }
+    dictionary_sort_index(idx, tmp, count, keys, keylen);
+
+    // the sort is stable, so the first occurrence of a key is kept
+    for (uint32_t i = 1; i < count; i++) {
+        if (memcmp(keys + (size_t)idx[i] * keylen, keys + (size_t)idx[i - 1] * keylen, keylen) == 0) {
+            dup[idx[i]] = 1;
+        }
+    }
+
+    // compact the keys, dictionary order is kept
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (dup[i] == 0) {
+            memmove(keys + (size_t)n * keylen, keys + (size_t)i * keylen, keylen);
+            newno[i] = n++;
+        }
+    }
+
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (dup[idx[i]] == 0) {
+            tmp[m++] = newno[idx[i]];
+        }
+    }
+
+    dicb_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, DICB_MAGIC, sizeof(hdr.magic));
+    hdr.version = DICB_VERSION;
+    hdr.keylen = keylen;
+    hdr.count = n;
+
+    struct stat st_dic;
+    if (stat(path, &st_dic) != 0) {
+        res = PM3_EFILE;
+        goto out;
+    }
+    dictionary_source_id(path, &st_dic, &hdr);
+
+    size_t pad = dictionary_index_offset(n, keylen) - (sizeof(dicb_header_t) + (size_t)n * keylen);
+    const uint8_t zeros[4] = {0};
+
+    res = PM3_EFILE;
+    for (uint8_t i = 0; i < 2 && res != PM3_SUCCESS; i++) {
+
+        char *fn = dictionary_cache_path(path, (i == 1));
+        if (fn == NULL) {
+            continue;
+        }
+
+        // written aside and renamed, a mapped copy of the old file stays intact
+        size_t tlen = strlen(fn) + 5;
+        char *tfn = calloc(tlen, sizeof(char));
+        if (tfn == NULL) {
+            free(fn);
+            continue;
+        }
+        snprintf(tfn, tlen, "%s.tmp", fn);
+
+        FILE *f = fopen(tfn, "wb");
+        if (f == NULL) {
+            PrintAndLogEx(DEBUG, "can't write `%s`", tfn);
+            free(tfn);
+            free(fn);
+            continue;
+        }
+
+        bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+        ok &= (fwrite(keys, keylen, n, f) == n);
+        ok &= (fwrite(zeros, 1, pad, f) == pad);
+        ok &= (fwrite(tmp, sizeof(uint32_t), n, f) == n);
+        ok &= (fclose(f) == 0);
+
+        if (ok) {
+            ok = (replaceFile(tfn, fn) == PM3_SUCCESS);
+        }
+
+        if (ok == false) {
+            PrintAndLogEx(WARNING, "failed to write `" _YELLOW_("%s") "`", fn);
+            remove(tfn);
+            free(tfn);
+            free(fn);
+            continue;
+        }
+        free(tfn);
+
+        if (verbose) {
+            PrintAndLogEx(SUCCESS, "Saved " _GREEN_("%u") " keys to compiled dictionary file `" _YELLOW_("%s") "`", n, fn);
+        }
+        free(fn);
+        res = PM3_SUCCESS;
+    }
+
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "Can't write compiled dictionary for `" _YELLOW_("%s") "`", path);
+    }
+
+    if (keycnt) {
+        *keycnt = n;
+    }
+    if (dupcnt) {
+        *dupcnt = count - n;
+    }
+
+out:
+    free(newno);
+    free(dup);
+    free(tmp);
+    free(idx);
+    free(keys);
+    free(path);
+    return res;
+}
+
 // iceman:  todo - move all unsafe functions like this from client source.
 int loadFileDICTIONARY(const char *preferredName, void *data, size_t *datalen, uint8_t keylen, uint32_t *keycnt) {
     // t5577 == 4 bytes
@@ -2325,6 +2788,22 @@ int loadFileDICTIONARYEx(const char *preferredName, void *data, size_t maxdatale
         return PM3_EFILE;
     }
 
+    // a compiled dictionary is used with the same file positions, counted in the compiled file
+    dictionary_t dict;
+    if (dictionary_open_cache(path, keylen, &dict) == PM3_SUCCESS) {
+        uint32_t vkeycnt = 0;
+        int res = dictionary_read_chunk(&dict, data, maxdatalen, datalen, &vkeycnt, startFilePosition, endFilePosition);
+        if (verbose) {
+            PrintAndLogEx(SUCCESS, "Loaded " _GREEN_("%2d") " keys from compiled dictionary file `" _YELLOW_("%s") "`", vkeycnt, path);
+        }
+        if (keycnt) {
+            *keycnt = vkeycnt;
+        }
+        dictionary_close(&dict);
+        free(path);
+        return res;
+    }
+
     // double up since its chars
     keylen <<= 1;
 
@@ -2421,6 +2900,10 @@ int loadFileDICTIONARY_safe(const char *preferredName, void **pdata, uint8_t key
 }
 
 int loadFileDICTIONARY_safe_ex(const char *preferredName, const char *suffix, void **pdata, uint8_t keylen, uint32_t *keycnt, bool verbose) {
+    return loadFileDICTIONARY_safe_int(preferredName, suffix, pdata, keylen, keycnt, verbose, true);
+}
+
+static int loadFileDICTIONARY_safe_int(const char *preferredName, const char *suffix, void **pdata, uint8_t keylen, uint32_t *keycnt, bool verbose, bool use_cache) {
 
     int retval = PM3_SUCCESS;
 
@@ -2439,6 +2922,27 @@ int loadFileDICTIONARY_safe_ex(const char *preferredName, const char *suffix, vo
         keylen = 6;
     }
 
+    // use the compiled dictionary when it is up to date, no parsing needed
+    dictionary_t dict;
+    if (use_cache && dictionary_open_cache(path, keylen, &dict) == PM3_SUCCESS) {
+        *pdata = calloc(MAX(dict.count, 1), keylen);
+        if (*pdata == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            dictionary_close(&dict);
+            free(path);
+            return PM3_EMALLOC;
+        }
+        memcpy(*pdata, dict.keys, (size_t)dict.count * keylen);
+        *keycnt = dict.count;
+        dictionary_close(&dict);
+
+        if (verbose) {
+            PrintAndLogEx(SUCCESS, "Loaded " _GREEN_("%d") " keys from compiled dictionary file `" _YELLOW_("%s") "`", *keycnt, path);
+        }
+        free(path);
+        return PM3_SUCCESS;
+    }
+
     size_t block_size = 1000 * keylen;
 
     // double up since its chars
@@ -113,6 +113,7 @@ typedef enum {
 } iso15_df_e;
 
 int fileExists(const char *filename);
+int replaceFile(const char *tmp_path, const char *path);
 
 // set a path in the path list g_session.defaultPaths
 bool setDefaultPath(savePaths_t pathIndex, const char *path);
@@ -330,6 +331,69 @@ int loadFileDICTIONARY_safe(const char *preferredName, void **pdata, uint8_t key
 */
 int loadFileDICTIONARY_safe_ex(const char *preferredName, const char *suffix, void **pdata, uint8_t keylen, uint32_t *keycnt, bool verbose);
 
+// compiled dictionary file format (.dicb), see `data dict compile`
+#define DICB_MAGIC      "PM3D"
+#define DICB_VERSION    2
+
+typedef struct {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t keylen;
+    uint16_t flags;
+    uint32_t count;
+    // the .dic file it was compiled from, it is rebuilt when they don't match
+    uint32_t src_path_crc;      // crc32 of the full path
+    uint64_t src_size;
+    int64_t src_mtime;
+} PACKED dicb_header_t;
+
+typedef struct {
+    uint8_t keylen;
+    uint32_t count;
+    const uint8_t *keys;        // count * keylen bytes, in dictionary order
+    const uint32_t *index;      // key numbers in ascending key order
+    void *base;
+    size_t size;
+    bool mapped;
+} dictionary_t;
+
+/**
+ * @brief  Utility function to compile a DICTIONARY textfile into a binary, deduplicated and indexed .dicb file
+ * next to it, or in the user dictionaries folder. The compiled file is used by the dictionary loaders
+ * instead of the text file as long as the text file's path, size and mtime match the ones it was compiled from.
+ *
+ * @param preferredName
+ * @param keylen  the number of bytes a key per row is
+ * @param keycnt number of unique keys written. may be NULL
+ * @param dupcnt number of duplicate keys dropped. may be NULL
+ * @param verbose print messages if true
+ * @return PM3_SUCCESS if ok
+*/
+int dictionary_compile(const char *preferredName, uint8_t keylen, uint32_t *keycnt, uint32_t *dupcnt, bool verbose);
+
+/**
+ * @brief  Utility function to memory map the compiled version of a dictionary, the keys are not copied.
+ * Fails when there is no up to date compiled file, use the loaders for the text file.
+ *
+ * @param preferredName
+ * @param keylen  the number of bytes a key per row is
+ * @param dict the opened dictionary, release with dictionary_close()
+ * @param verbose print messages if true
+ * @return PM3_SUCCESS if ok
+*/
+int dictionary_open(const char *preferredName, uint8_t keylen, dictionary_t *dict, bool verbose);
+void dictionary_close(dictionary_t *dict);
+
+/**
+ * @brief  Utility function to look up a key in an opened dictionary, using its index
+ *
+ * @param dict the opened dictionary
+ * @param key the key to look for, dict->keylen bytes
+ * @param keyno the key number of the match. may be NULL
+ * @return true if the key is in the dictionary
+*/
+bool dictionary_contains(const dictionary_t *dict, const uint8_t *key, uint32_t *keyno);
+
 /**
  * @brief  Utility function to load data from a XML textfile. This method takes a preferred name.
  * E.g. dumpdata-15.xml
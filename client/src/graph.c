@@ -22,20 +22,89 @@
 #include "proxgui.h"
 #include "util.h"           // param_get32ex
 #include "lfdemod.h"
+#include "lfdsp.h"
 #include "cmddata.h"        // for g_debugmode
 #include "commonutil.h"     // Uint4bytetomemle
 
 
-int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
+static int32_t main_graph[MAX_GRAPH_TRACE_LEN];
+static uint8_t main_demod[MAX_DEMOD_BUF_LEN];
+static lf_demod_ctx_t main_ctx = {
+    .graph = main_graph,
+    .demod = main_demod,
+};
+__thread lf_demod_ctx_t *g_lf_demod_ctx = &main_ctx;
+
 int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
 int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
 bool    g_useOverlays = false;
-size_t  g_GraphTraceLen;
 buffer_savestate_t g_saveState_gb;
 marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 marker_t *g_TempMarkers;
 uint8_t g_TempMarkerSize = 0;
 
+lf_demod_ctx_t *lf_demod_ctx_create(void) {
+    lf_demod_ctx_t *ctx = calloc(1, sizeof(lf_demod_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    // full size, demodulators are allowed to write past the current length
+    ctx->graph = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int32_t));
+    ctx->demod = calloc(MAX_DEMOD_BUF_LEN, sizeof(uint8_t));
+    if (ctx->graph == NULL || ctx->demod == NULL) {
+        lf_demod_ctx_free(ctx);
+        return NULL;
+    }
+
+    // snapshot of the caller's signal properties, applied when a thread binds the context
+    ctx->signal = *getSignalProperties();
+    lf_demod_ctx_reset(ctx);
+    return ctx;
+}
+
+void lf_demod_ctx_free(lf_demod_ctx_t *ctx) {
+    if (ctx == NULL || ctx == &main_ctx) {
+        return;
+    }
+    free(ctx->graph);
+    free(ctx->demod);
+    free(ctx);
+}
+
+void lf_demod_ctx_reset(lf_demod_ctx_t *ctx) {
+    if (ctx == NULL || ctx == &main_ctx) {
+        return;
+    }
+
+    // the main context is only read, its owner waits while workers run
+    memcpy(ctx->graph, main_ctx.graph, main_ctx.graph_len * sizeof(int32_t));
+    ctx->graph_len = main_ctx.graph_len;
+    ctx->demod_len = 0;
+    ctx->demod_start_idx = 0;
+    ctx->demod_clock = 0;
+    ctx->grid_offset = main_ctx.grid_offset;
+
+    if (ctx == g_lf_demod_ctx) {
+        *getSignalProperties() = ctx->signal;
+    }
+}
+
+void lf_demod_ctx_bind(lf_demod_ctx_t *ctx) {
+    if (ctx == NULL) {
+        ctx = &main_ctx;
+    }
+    g_lf_demod_ctx = ctx;
+    // signal properties live in lfdemod.c, per thread
+    if (ctx != &main_ctx) {
+        *getSignalProperties() = ctx->signal;
+    }
+}
+
+bool lf_demod_ctx_is_main(void) {
+    return g_lf_demod_ctx == &main_ctx;
+}
+
 /* write a manchester bit to the graph
 */
 void AppendGraph(bool redraw, uint16_t clock, int bit) {
@@ -110,10 +179,8 @@ void setGraphBuffer(const uint8_t *src, size_t size) {
         size = MAX_GRAPH_TRACE_LEN;
     }
 
-    for (size_t i = 0; i < size; ++i) {
-        g_GraphBuffer[i] = src[i] - 128;
-        g_OperationBuffer[i] = src[i] - 128;
-    }
+    lfdsp_u8_to_s32(src, g_GraphBuffer, size);
+    memcpy(g_OperationBuffer, g_GraphBuffer, size * sizeof(int32_t));
 
     remove_temporary_markers();
     g_GraphTraceLen = size;
@@ -135,20 +202,10 @@ size_t getFromGraphBufferEx(uint8_t *dest, size_t maxLen) {
         return 0;
     }
 
-    size_t i;
     maxLen = (maxLen < g_GraphTraceLen) ? maxLen : g_GraphTraceLen;
-    for (i = 0; i < maxLen; ++i) {
-        //trim
-        if (g_GraphBuffer[i] > 127) {
-            g_GraphBuffer[i] = 127;
-        }
-
-        if (g_GraphBuffer[i] < -127) {
-            g_GraphBuffer[i] = -127;
-        }
-        dest[i] = (uint8_t)(g_GraphBuffer[i] + 128);
-    }
-    return i;
+    // trims the graph to -127..127 as well
+    lfdsp_s32_to_u8(g_GraphBuffer, dest, maxLen);
+    return maxLen;
 }
 
 //TODO: In progress function to get chunks of data from the GB w/o modifying the GB
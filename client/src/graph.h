@@ -20,6 +20,7 @@
 #define GRAPH_H__
 
 #include "common.h"
+#include "lfdemod.h"        // signal_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -71,18 +72,44 @@ size_t restore_buffer8(buffer_savestate_t saveState, uint8_t *dest);
 #define GRAPH_SAVE 1
 #define GRAPH_RESTORE 0
 
-extern int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
+// LF demodulation context, the samples a demodulator reads and the state it leaves behind.
+// g_GraphBuffer, g_DemodBuffer & co resolve to the context of the calling thread.
+// That is the main context (the one the plot shows) unless the thread bound its own,
+// which lets several demodulators run side by side, see `lf search`.
+typedef struct {
+    int32_t *graph;
+    size_t graph_len;
+    uint8_t *demod;
+    size_t demod_len;
+    int32_t demod_start_idx;
+    int demod_clock;
+    double grid_offset;
+    signal_t signal;
+} lf_demod_ctx_t;
+
+extern __thread lf_demod_ctx_t *g_lf_demod_ctx;
+
+// new context holding a copy of the main graph and the caller's signal properties
+lf_demod_ctx_t *lf_demod_ctx_create(void);
+void lf_demod_ctx_free(lf_demod_ctx_t *ctx);
+// NULL binds the main context again
+void lf_demod_ctx_bind(lf_demod_ctx_t *ctx);
+// reload the graph from the main context and clear the demod state
+void lf_demod_ctx_reset(lf_demod_ctx_t *ctx);
+bool lf_demod_ctx_is_main(void);
+
+#define g_GraphBuffer   (g_lf_demod_ctx->graph)
+#define g_GraphTraceLen (g_lf_demod_ctx->graph_len)
+#define g_GridOffset    (g_lf_demod_ctx->grid_offset)
+
 extern int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
 extern int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
 extern bool    g_useOverlays;
-extern size_t  g_GraphTraceLen;
 
 extern marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 extern marker_t *g_TempMarkers;
 extern uint8_t g_TempMarkerSize;
 
-extern double g_GridOffset;
-
 extern buffer_savestate_t g_saveState_gb;
 
 #ifdef __cplusplus
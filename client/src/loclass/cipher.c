@@ -40,7 +40,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #ifndef ON_DEVICE
+#include <inttypes.h>
 #include "fileutils.h"
+#include "util_posix.h"   // msclock
 #endif
 
 
@@ -257,6 +259,54 @@ void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_ke
 }
 
 #ifndef ON_DEVICE
+
+// below this many keys the bitsliced pass costs more than it saves
+#define ICLASS_BS_MIN_BATCH (ICLASS_BS_LANES / 16)
+
+void doMAC_batch(const uint8_t *cc_nr, const uint8_t *div_keys, size_t count, uint8_t *macs, iclass_cipher_engine_t engine) {
+
+    if (engine == ICLASS_CIPHER_AUTO) {
+        engine = (count >= ICLASS_BS_MIN_BATCH) ? ICLASS_CIPHER_BITSLICE : ICLASS_CIPHER_TABLE;
+    }
+
+    switch (engine) {
+        case ICLASS_CIPHER_REFERENCE: {
+            uint8_t cc[12];
+            uint8_t key[8];
+            memcpy(cc, cc_nr, sizeof(cc));
+            for (size_t i = 0; i < count; i++) {
+                memcpy(key, div_keys + (i * 8), sizeof(key));
+                doMAC(cc, key, macs + (i * 4));
+            }
+            break;
+        }
+        case ICLASS_CIPHER_BITSLICE:
+            doMAC_bitslice(cc_nr, div_keys, count, macs);
+            break;
+        case ICLASS_CIPHER_TABLE:
+        case ICLASS_CIPHER_AUTO:
+        default:
+            for (size_t i = 0; i < count; i++) {
+                doMAC_brute(cc_nr, div_keys + (i * 8), macs + (i * 4));
+            }
+            break;
+    }
+}
+
+const char *iclass_cipher_engine_name(iclass_cipher_engine_t engine) {
+    switch (engine) {
+        case ICLASS_CIPHER_REFERENCE:
+            return "reference";
+        case ICLASS_CIPHER_TABLE:
+            return "table";
+        case ICLASS_CIPHER_BITSLICE:
+            return "bitslice";
+        case ICLASS_CIPHER_AUTO:
+        default:
+            return "auto";
+    }
+}
+
 int testMAC(void) {
     PrintAndLogEx(SUCCESS, "Testing MAC calculation...");
 
@@ -279,4 +329,74 @@ int testMAC(void) {
     }
     return PM3_SUCCESS;
 }
+
+static uint64_t mac_test_rand(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+// compares every engine against doMAC on pseudo random keys, optionally prints keys/s
+int testMACEngines(bool benchmark) {
+    PrintAndLogEx(SUCCESS, "Testing MAC engines...");
+
+    // a few full bitsliced passes plus a partial one
+    const size_t count = (ICLASS_BS_LANES * 4) + 37;
+    uint8_t *keys = calloc(count, 8);
+    uint8_t *ref = calloc(count, 4);
+    uint8_t *mac = calloc(count, 4);
+    if (keys == NULL || ref == NULL || mac == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(keys);
+        free(ref);
+        free(mac);
+        return PM3_EMALLOC;
+    }
+
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    uint8_t cc_nr[12];
+    for (size_t i = 0; i < sizeof(cc_nr); i++) {
+        cc_nr[i] = mac_test_rand(&seed) & 0xFF;
+    }
+    for (size_t i = 0; i < count * 8; i++) {
+        keys[i] = mac_test_rand(&seed) & 0xFF;
+    }
+
+    doMAC_batch(cc_nr, keys, count, ref, ICLASS_CIPHER_REFERENCE);
+
+    int errors = 0;
+    for (iclass_cipher_engine_t e = ICLASS_CIPHER_AUTO; e <= ICLASS_CIPHER_BITSLICE; e++) {
+        if (e == ICLASS_CIPHER_REFERENCE) {
+            continue;
+        }
+        memset(mac, 0, count * 4);
+        doMAC_batch(cc_nr, keys, count, mac, e);
+        if (memcmp(ref, mac, count * 4) == 0) {
+            PrintAndLogEx(SUCCESS, "    %s engine ( %s )", iclass_cipher_engine_name(e), _GREEN_("ok"));
+        } else {
+            PrintAndLogEx(FAILED, "    %s engine ( %s )", iclass_cipher_engine_name(e), _RED_("fail"));
+            errors++;
+        }
+    }
+
+    if (benchmark && errors == 0) {
+        PrintAndLogEx(INFO, "MAC engine throughput, %u keys per bitsliced pass", ICLASS_BS_LANES);
+        for (iclass_cipher_engine_t e = ICLASS_CIPHER_REFERENCE; e <= ICLASS_CIPHER_BITSLICE; e++) {
+            uint64_t n = 0, ms = 0;
+            uint64_t t0 = msclock();
+            do {
+                doMAC_batch(cc_nr, keys, count, mac, e);
+                n += count;
+                ms = msclock() - t0;
+            } while (ms < 500);
+            PrintAndLogEx(INFO, "    %-10s " _YELLOW_("%10" PRIu64) " keys/s", iclass_cipher_engine_name(e), (n * 1000) / ms);
+        }
+    }
+
+    free(keys);
+    free(ref);
+    free(mac);
+    return (errors) ? PM3_ESOFT : PM3_SUCCESS;
+}
 #endif
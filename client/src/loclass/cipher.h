@@ -42,7 +42,29 @@ void doMAC_brute(const uint8_t *cc_nr, const uint8_t *div_key, uint8_t mac[4]);
 void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_key_p, uint8_t mac[4]);
 
 #ifndef ON_DEVICE
+#include <stdbool.h>
+#include <stddef.h>
+
+// keys per bitsliced pass, a multiple of 64
+#ifndef ICLASS_BS_LANES
+#define ICLASS_BS_LANES 256
+#endif
+
+// host side MAC engines for cracking, they all give the doMAC result
+typedef enum {
+    ICLASS_CIPHER_AUTO,
+    ICLASS_CIPHER_REFERENCE,    // doMAC, bitstream based
+    ICLASS_CIPHER_TABLE,        // doMAC_brute, byte wise with the select table
+    ICLASS_CIPHER_BITSLICE,     // ICLASS_BS_LANES keys per pass
+} iclass_cipher_engine_t;
+
+// div_keys holds count 8 byte keys, macs receives count 4 byte MACs, cc_nr is shared
+void doMAC_batch(const uint8_t *cc_nr, const uint8_t *div_keys, size_t count, uint8_t *macs, iclass_cipher_engine_t engine);
+void doMAC_bitslice(const uint8_t *cc_nr, const uint8_t *div_keys, size_t count, uint8_t *macs);
+const char *iclass_cipher_engine_name(iclass_cipher_engine_t engine);
+
 int testMAC(void);
+int testMACEngines(bool benchmark);
 #endif
 
 #endif // CIPHER_H
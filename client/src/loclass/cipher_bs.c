@@ -0,0 +1,212 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// WARNING
+//
+// THIS CODE IS CREATED FOR EXPERIMENTATION AND EDUCATIONAL USE ONLY.
+//
+// USAGE OF THIS CODE IN OTHER WAYS MAY INFRINGE UPON THE INTELLECTUAL
+// PROPERTY OF OTHER PARTIES, SUCH AS INSIDE SECURE AND HID GLOBAL,
+// AND MAY EXPOSE YOU TO AN INFRINGEMENT ACTION FROM THOSE PARTIES.
+//
+// THIS CODE SHOULD NEVER BE USED TO INFRINGE PATENTS OR INTELLECTUAL PROPERTY RIGHTS.
+//-----------------------------------------------------------------------------
+// Bitsliced iCLASS cipher, host side only.
+//
+// Every bit of the cipher state (l, r, b, t) and of the key is kept as a plane,
+// one bit per key, so one pass runs the cipher for ICLASS_BS_LANES keys with
+// plain boolean vector operations. The planes use the compiler vector extension,
+// on x86 linux the pass is also built for AVX2 and picked at load time.
+//-----------------------------------------------------------------------------
+
+#include "cipher.h"
+#include <string.h>
+
+#if (ICLASS_BS_LANES < 64) || (ICLASS_BS_LANES % 64)
+#error "ICLASS_BS_LANES must be a multiple of 64"
+#endif
+
+#define BS_WORDS (ICLASS_BS_LANES / 64)
+
+typedef uint64_t bs_t __attribute__((vector_size(ICLASS_BS_LANES / 8)));
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__linux__) && defined(__has_attribute)
+#  if __has_attribute(target_clones)
+#    define BS_CLONES __attribute__((target_clones("avx2", "default")))
+#  endif
+#endif
+#ifndef BS_CLONES
+#  define BS_CLONES
+#endif
+
+// s ? b : a, per bit
+#define BS_MUX(s, a, b) ((a) ^ (((a) ^ (b)) & (s)))
+
+// out = x + y, 8 bit ripple carry adder
+#define BS_ADD8(out, x, y) do {                     \
+        bs_t c_ = bs_zero;                          \
+        for (int i_ = 0; i_ < 8; i_++) {            \
+            bs_t xy_ = (x)[i_] ^ (y)[i_];           \
+            (out)[i_] = xy_ ^ c_;                   \
+            c_ = ((x)[i_] & (y)[i_]) | (c_ & xy_);  \
+        }                                           \
+    } while (0)
+
+// in place 64x64 bit matrix transpose, afterwards bit j of a[i] is bit i of the old a[j]
+static void bs_transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= (m << j)) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= (t << j);
+            a[k | j] ^= t;
+        }
+    }
+}
+
+/**
+ * @brief One bitsliced pass, same result as doMAC_brute for every lane
+ * @param cc_nr 12 bytes, shared by all lanes
+ * @param keys div keys, byte i of the key is bits 8i..8i+7
+ * @param macs MAC in the low 32 bits, byte i is bits 8i..8i+7
+ */
+BS_CLONES
+static void bs_mac_pass(const uint8_t *cc_nr, const uint64_t keys[ICLASS_BS_LANES], uint64_t macs[ICLASS_BS_LANES]) {
+
+    const bs_t bs_zero = {0};
+    const bs_t bs_ones = ~bs_zero;
+
+    uint64_t blk[64];
+
+    // k[8 * j + i] = bit i of key byte j
+    bs_t k[64];
+    for (int w = 0; w < BS_WORDS; w++) {
+        memcpy(blk, keys + (w * 64), sizeof(blk));
+        bs_transpose64(blk);
+        for (int p = 0; p < 64; p++) {
+            k[p][w] = blk[p];
+        }
+    }
+
+    // init, l = (k0 ^ 0x4c) + 0xEC, r = (k0 ^ 0x4c) + 0x21, b = 0x4c, t = 0xE012
+    bs_t x[8], c_l[8], c_r[8], l[8], r[8], b[8], t[16];
+    for (int i = 0; i < 8; i++) {
+        x[i] = ((0x4c >> i) & 1) ? ~k[i] : k[i];
+        c_l[i] = ((0xEC >> i) & 1) ? bs_ones : bs_zero;
+        c_r[i] = ((0x21 >> i) & 1) ? bs_ones : bs_zero;
+        b[i] = ((0x4c >> i) & 1) ? bs_ones : bs_zero;
+    }
+    for (int i = 0; i < 16; i++) {
+        t[i] = ((0xE012 >> i) & 1) ? bs_ones : bs_zero;
+    }
+    BS_ADD8(l, x, c_l);
+    BS_ADD8(r, x, c_r);
+
+    // 96 input bits, LSB first per byte, then 32 output bits fed with zeroes
+    bs_t out[32];
+    for (int step = 0; step < (12 * 8) + 32; step++) {
+
+        bs_t y = bs_zero;
+        if (step < 12 * 8) {
+            if ((cc_nr[step >> 3] >> (step & 7)) & 1) {
+                y = bs_ones;
+            }
+        } else {
+            out[step - (12 * 8)] = r[2];
+            if (step == (12 * 8) + 31) {
+                break;
+            }
+        }
+
+        // T(t), over the bits of mask 0xc533
+        bs_t tt = t[0] ^ t[1] ^ t[4] ^ t[5] ^ t[8] ^ t[10] ^ t[14] ^ t[15];
+
+        // select(T(t), y, r), the bit formulas behind opt_select_LUT
+        bs_t z0 = (r[7] & r[5]) ^ (r[6] & ~r[4]) ^ (r[5] | r[3]);
+        bs_t z1 = (r[7] | r[5]) ^ (r[2] | r[0]) ^ r[6] ^ r[1] ^ tt ^ y;
+        bs_t z2 = (r[4] & ~r[2]) ^ (r[3] & r[1]) ^ r[0] ^ tt;
+
+        bs_t t_in = tt ^ r[7] ^ r[3];
+        for (int i = 0; i < 15; i++) {
+            t[i] = t[i + 1];
+        }
+        t[15] = t_in;
+
+        bs_t b_in = b[0] ^ b[4] ^ b[5] ^ b[6] ^ r[0];
+        for (int i = 0; i < 7; i++) {
+            b[i] = b[i + 1];
+        }
+        b[7] = b_in;
+
+        // r' = (k[select] ^ b') + l,  l' = r' + r
+        bs_t kb[8], r_new[8];
+        for (int i = 0; i < 8; i++) {
+            bs_t m0 = BS_MUX(z2, k[i], k[8 + i]);
+            bs_t m1 = BS_MUX(z2, k[16 + i], k[24 + i]);
+            bs_t m2 = BS_MUX(z2, k[32 + i], k[40 + i]);
+            bs_t m3 = BS_MUX(z2, k[48 + i], k[56 + i]);
+            bs_t n0 = BS_MUX(z1, m0, m1);
+            bs_t n1 = BS_MUX(z1, m2, m3);
+            kb[i] = BS_MUX(z0, n0, n1) ^ b[i];
+        }
+        BS_ADD8(r_new, kb, l);
+        BS_ADD8(l, r_new, r);
+        memcpy(r, r_new, sizeof(r));
+    }
+
+    for (int w = 0; w < BS_WORDS; w++) {
+        for (int p = 0; p < 32; p++) {
+            blk[p] = out[p][w];
+        }
+        memset(blk + 32, 0, 32 * sizeof(uint64_t));
+        bs_transpose64(blk);
+        memcpy(macs + (w * 64), blk, sizeof(blk));
+    }
+}
+
+void doMAC_bitslice(const uint8_t *cc_nr, const uint8_t *div_keys, size_t count, uint8_t *macs) {
+
+    uint64_t keys[ICLASS_BS_LANES];
+    uint64_t res[ICLASS_BS_LANES];
+
+    for (size_t off = 0; off < count; off += ICLASS_BS_LANES) {
+
+        size_t n = count - off;
+        if (n > ICLASS_BS_LANES) {
+            n = ICLASS_BS_LANES;
+        }
+
+        for (size_t i = 0; i < ICLASS_BS_LANES; i++) {
+            uint64_t v = 0;
+            if (i < n) {
+                const uint8_t *key = div_keys + ((off + i) * 8);
+                for (int j = 7; j >= 0; j--) {
+                    v = (v << 8) | key[j];
+                }
+            }
+            keys[i] = v;
+        }
+
+        bs_mac_pass(cc_nr, keys, res);
+
+        for (size_t i = 0; i < n; i++) {
+            uint8_t *mac = macs + ((off + i) * 4);
+            mac[0] = res[i] & 0xFF;
+            mac[1] = (res[i] >> 8) & 0xFF;
+            mac[2] = (res[i] >> 16) & 0xFF;
+            mac[3] = (res[i] >> 24) & 0xFF;
+        }
+    }
+}
@@ -172,12 +172,11 @@ static void rk(const uint8_t *key, uint8_t n, uint8_t *outp_key) {
     }
 }
 
-static mbedtls_des_context ctx_enc;
-static mbedtls_des_context ctx_dec;
-
+// DES contexts live on the stack so hash2 can run from several threads at once
 static void desdecrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *output) {
     uint8_t key_std_format[8] = {0};
     permutekey_rev(iclass_key, key_std_format);
+    mbedtls_des_context ctx_dec;
     mbedtls_des_setkey_dec(&ctx_dec, key_std_format);
     mbedtls_des_crypt_ecb(&ctx_dec, input, output);
 }
@@ -185,6 +184,7 @@ static void desdecrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *outp
 static void desencrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *output) {
     uint8_t key_std_format[8] = {0};
     permutekey_rev(iclass_key, key_std_format);
+    mbedtls_des_context ctx_enc;
     mbedtls_des_setkey_enc(&ctx_enc, key_std_format);
     mbedtls_des_crypt_ecb(&ctx_enc, input, output);
 }
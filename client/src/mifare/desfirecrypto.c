@@ -206,8 +206,22 @@ uint8_t *DesfireGetKey(DesfireContext_t *ctx, DesfireCryptoOpKeyType key_type) {
 }
 
 
-static void DesfireCryptoEncDecSingleBlock(uint8_t *key, DesfireCryptoAlgorithm keyType, uint8_t *data, uint8_t *dstdata, uint8_t *ivect, bool dir_to_send, bool encode) {
-    size_t block_size = desfire_get_key_block_length(keyType);
+static pcrypto_cipher_t DesfireCipherType(DesfireCryptoAlgorithm keyType) {
+    switch (keyType) {
+        case T_DES:
+            return PCRYPTO_DES;
+        case T_3DES:
+            return PCRYPTO_3DES2;
+        case T_3K3DES:
+            return PCRYPTO_3DES3;
+        case T_AES:
+            return PCRYPTO_AES128;
+    }
+    return PCRYPTO_DES;
+}
+
+static void DesfireCryptoEncDecSingleBlock(pcrypto_cipher_ctx_t *cctx, uint8_t *data, uint8_t *dstdata, uint8_t *ivect, bool dir_to_send, bool encode) {
+    size_t block_size = cctx->block_size;
     uint8_t sdata[DESFIRE_MAX_CRYPTO_BLOCK_SIZE] = {0};
     memcpy(sdata, data, block_size);
     if (dir_to_send) {
@@ -215,52 +229,7 @@ static void DesfireCryptoEncDecSingleBlock(uint8_t *key, DesfireCryptoAlgorithm
     }
 
     uint8_t edata[DESFIRE_MAX_CRYPTO_BLOCK_SIZE] = {0};
-
-    switch (keyType) {
-        case T_DES:
-            if (encode)
-                des_encrypt(edata, sdata, key);
-            else
-                des_decrypt(edata, sdata, key);
-            break;
-        case T_3DES:
-            if (encode) {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set2key_enc(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            } else {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set2key_dec(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            }
-            break;
-        case T_3K3DES:
-            if (encode) {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set3key_enc(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            } else {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set3key_dec(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            }
-            break;
-        case T_AES:
-            if (encode) {
-                mbedtls_aes_context actx;
-                mbedtls_aes_init(&actx);
-                mbedtls_aes_setkey_enc(&actx, key, 128);
-                mbedtls_aes_crypt_ecb(&actx, MBEDTLS_AES_ENCRYPT, sdata, edata);
-                mbedtls_aes_free(&actx);
-            } else {
-                mbedtls_aes_context actx;
-                mbedtls_aes_init(&actx);
-                mbedtls_aes_setkey_dec(&actx, key, 128);
-                mbedtls_aes_crypt_ecb(&actx, MBEDTLS_AES_DECRYPT, sdata, edata);
-                mbedtls_aes_free(&actx);
-            }
-            break;
-    }
+    pcrypto_cipher_block(cctx, encode, sdata, edata);
 
     if (dir_to_send) {
         memcpy(ivect, edata, block_size);
@@ -296,12 +265,18 @@ void DesfireCryptoEncDecEx(DesfireContext_t *ctx, DesfireCryptoOpKeyType key_typ
         size_t dstlen = 0;
         LRPEncDec(key, xiv, encode, srcdata, srcdatalen, data, &dstlen);
     } else {
+        // one key schedule for the whole message
+        pcrypto_cipher_ctx_t cctx;
+        if (pcrypto_cipher_init(&cctx, DesfireCipherType(ctx->keyType), key) != PM3_SUCCESS)
+            return;
+
         size_t offset = 0;
         while (offset < srcdatalen) {
-            DesfireCryptoEncDecSingleBlock(key, ctx->keyType, srcdata + offset, data + offset, xiv, dir_to_send, encode);
+            DesfireCryptoEncDecSingleBlock(&cctx, srcdata + offset, data + offset, xiv, dir_to_send, encode);
 
             offset += block_size;
         }
+        pcrypto_cipher_free(&cctx);
     }
 
     if (iv == NULL)
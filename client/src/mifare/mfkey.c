@@ -18,6 +18,9 @@
 //-----------------------------------------------------------------------------
 #include "mfkey.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "crapto1/crapto1.h"
 
 // MIFARE
@@ -27,6 +30,57 @@ int inline compare_uint64(const void *a, const void *b) {
     return -1;
 }
 
+// sort a list ascending, same order as qsort() with compare_uint64 but in linear time.
+// LSD radix sort on 16 bit digits, passes where all entries share the same digit are skipped.
+bool radix_sort_uint64(uint64_t *list, uint32_t len) {
+    if (list == NULL || len < 2)
+        return true;
+
+    uint64_t *tmp = calloc(len, sizeof(uint64_t));
+    uint32_t *count = calloc(0x10000, sizeof(uint32_t));
+    if (tmp == NULL || count == NULL) {
+        free(tmp);
+        free(count);
+        return false;
+    }
+
+    uint64_t *src = list, *dst = tmp;
+    for (uint8_t shift = 0; shift < 64; shift += 16) {
+
+        memset(count, 0, 0x10000 * sizeof(uint32_t));
+        for (uint32_t i = 0; i < len; i++) {
+            count[(src[i] >> shift) & 0xFFFF]++;
+        }
+
+        if (count[(src[0] >> shift) & 0xFFFF] == len) {
+            continue;
+        }
+
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 0x10000; i++) {
+            uint32_t c = count[i];
+            count[i] = sum;
+            sum += c;
+        }
+
+        for (uint32_t i = 0; i < len; i++) {
+            dst[count[(src[i] >> shift) & 0xFFFF]++] = src[i];
+        }
+
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != list) {
+        memcpy(list, src, len * sizeof(uint64_t));
+    }
+
+    free(tmp);
+    free(count);
+    return true;
+}
+
 // create the intersection (common members) of two sorted lists. Lists are terminated by -1. Result will be in list1. Number of elements is returned.
 uint32_t intersection(uint64_t *listA, uint64_t *listB) {
     if (listA == NULL || listB == NULL)
@@ -30,6 +30,7 @@ bool mfkey32_nested(nonces_t *data, uint64_t *outputkey);
 int mfkey64(nonces_t *data, uint64_t *outputkey);
 
 int compare_uint64(const void *a, const void *b);
+bool radix_sort_uint64(uint64_t *list, uint32_t len);
 uint32_t intersection(uint64_t *listA, uint64_t *listB);
 
 #endif
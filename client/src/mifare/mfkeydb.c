@@ -0,0 +1,577 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Local database of recovered MIFARE Classic keys.
+//
+// Every key recovered on a card is appended to ~/.proxmark3/mfc_keydb.txt together
+// with what could be read from the card before its keys were known: UID, ATQA/SAK,
+// sector count, the manufacturer bytes of block 0 and the MAD. Sites reuse their keys
+// over many cards, so when the dictionary is loaded the database keys are weighted by
+// how close their card is to the current one and put first, best match first.
+//-----------------------------------------------------------------------------
+#include "mfkeydb.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commonutil.h"
+#include "util.h"
+#include "ui.h"
+#include "comms.h"
+#include "mifaredefault.h"
+
+typedef struct {
+    mfkeydb_fp_t fp;
+    uint64_t key;
+    uint8_t slots;      // sector keys it opened on that card
+} mfkeydb_rec_t;
+
+typedef struct {
+    uint64_t key;
+    uint64_t score;
+    uint32_t hits;      // cards
+    uint32_t slots;
+    bool strong;        // opened this card, or a card of the same site
+    bool first;         // goes ahead of the dictionary
+    bool listed;        // in the dictionary already
+} mfkeydb_rank_t;
+
+// database keys put ahead of the dictionary, one chunk of keys sent to the device
+#define MFKEYDB_PREPEND_MAX     (PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE)
+
+void mfkeydb_fp_from_card(mfkeydb_fp_t *fp, const iso14a_card_select_t *card, uint8_t sectors) {
+    memset(fp, 0, sizeof(mfkeydb_fp_t));
+    fp->uidlen = MIN(card->uidlen, sizeof(fp->uid));
+    memcpy(fp->uid, card->uid, fp->uidlen);
+    memcpy(fp->atqa, card->atqa, sizeof(fp->atqa));
+    fp->sak = card->sak;
+    fp->sectors = sectors;
+    fp->valid = true;
+}
+
+int mfkeydb_fp_select(mfkeydb_fp_t *fp) {
+
+    clearCommandBuffer();
+    SendCommandMIX(CMD_HF_ISO14443A_READER, ISO14A_CONNECT, 0, 0, NULL, 0);
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_ACK, &resp, 1500) == false) {
+        PrintAndLogEx(DEBUG, "iso14443a card select timeout");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.oldarg[0] == 0) {
+        return PM3_ECARDEXCHANGE;
+    }
+
+    iso14a_card_select_t card;
+    memcpy(&card, (iso14a_card_select_t *)resp.data.asBytes, sizeof(iso14a_card_select_t));
+    mfkeydb_fp_from_card(fp, &card, fp->sectors);
+    return PM3_SUCCESS;
+}
+
+static void mfkeydb_fp_sector0(mfkeydb_fp_t *fp, const uint8_t *sector0) {
+
+    // 4 byte UIDs are followed by the BCC
+    uint8_t skip = (fp->uidlen == 4) ? 5 : fp->uidlen;
+    fp->manufacturer_len = MFBLOCK_SIZE - skip;
+    memcpy(fp->manufacturer, sector0 + skip, fp->manufacturer_len);
+
+    // DA bit of the general purpose byte
+    if (sector0[(3 * MFBLOCK_SIZE) + 9] & 0x80) {
+        memcpy(fp->mad, sector0 + MFBLOCK_SIZE, sizeof(fp->mad));
+        fp->has_mad = true;
+    }
+}
+
+static bool mfkeydb_fp_read_sector0(mfkeydb_fp_t *fp, uint8_t keytype, const uint8_t *key) {
+    uint8_t sector0[4 * MFBLOCK_SIZE] = {0};
+    if (mf_read_sector(0, keytype, key, sector0) != PM3_SUCCESS) {
+        return false;
+    }
+    mfkeydb_fp_sector0(fp, sector0);
+    return true;
+}
+
+// sector 0 is often readable with a public key before anything else is known
+static void mfkeydb_fp_probe(mfkeydb_fp_t *fp) {
+    if (fp->probed) {
+        return;
+    }
+    fp->probed = true;
+
+    if (mfkeydb_fp_read_sector0(fp, MF_KEY_A, g_mifare_mad_key) == false) {
+        mfkeydb_fp_read_sector0(fp, MF_KEY_A, g_mifare_default_key);
+    }
+}
+
+static int mfkeydb_path(char **path, bool create_home) {
+    return searchHomeFilePath(path, NULL, MFKEYDB_FILE, create_home);
+}
+
+// "-" for unknown, otherwise exactly len bytes of hex
+static bool mfkeydb_parse_hex(const char *s, uint8_t *out, size_t len, bool *known) {
+    if (strcmp(s, "-") == 0) {
+        *known = false;
+        return true;
+    }
+    *known = true;
+    return (hex_to_bytes(s, out, len) == (int)len);
+}
+
+static bool mfkeydb_parse(const char *line, mfkeydb_rec_t *rec) {
+
+    char uid[21], atqa[5], sak[3], manufacturer[33], mad[65], key[13];
+    unsigned int sectors = 0, slots = 0;
+
+    if (sscanf(line, "%20s %4s %2s %u %32s %64s %12s %u", uid, atqa, sak, &sectors, manufacturer, mad, key, &slots) != 8) {
+        return false;
+    }
+
+    memset(rec, 0, sizeof(mfkeydb_rec_t));
+    mfkeydb_fp_t *fp = &rec->fp;
+
+    int uidlen = hex_to_bytes(uid, fp->uid, sizeof(fp->uid));
+    if (uidlen != 4 && uidlen != 7 && uidlen != 10) {
+        return false;
+    }
+    fp->uidlen = uidlen;
+    fp->valid = true;
+
+    bool known = false;
+    if (mfkeydb_parse_hex(atqa, fp->atqa, sizeof(fp->atqa), &known) == false || known == false) {
+        return false;
+    }
+    if (mfkeydb_parse_hex(sak, &fp->sak, 1, &known) == false || known == false) {
+        return false;
+    }
+    fp->sectors = sectors;
+
+    if (strcmp(manufacturer, "-")) {
+        int n = hex_to_bytes(manufacturer, fp->manufacturer, sizeof(fp->manufacturer));
+        if (n <= 0) {
+            return false;
+        }
+        fp->manufacturer_len = n;
+    }
+
+    if (mfkeydb_parse_hex(mad, fp->mad, sizeof(fp->mad), &fp->has_mad) == false) {
+        return false;
+    }
+
+    uint8_t k[MIFARE_KEY_SIZE];
+    if (mfkeydb_parse_hex(key, k, sizeof(k), &known) == false || known == false) {
+        return false;
+    }
+    rec->key = bytes_to_num(k, sizeof(k));
+    rec->slots = MIN(slots, 0xFF);
+    return true;
+}
+
+static int mfkeydb_load(mfkeydb_rec_t **recs, uint32_t *cnt) {
+
+    *recs = NULL;
+    *cnt = 0;
+
+    char *path = NULL;
+    if (mfkeydb_path(&path, false) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    FILE *f = fopen(path, "r");
+    free(path);
+    if (f == NULL) {
+        // no key recovered yet
+        return PM3_SUCCESS;
+    }
+
+    uint32_t capacity = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+
+        if (line[0] == '#') {
+            continue;
+        }
+
+        mfkeydb_rec_t rec;
+        if (mfkeydb_parse(line, &rec) == false) {
+            continue;
+        }
+
+        if (*cnt == capacity) {
+            capacity = (capacity) ? capacity << 1 : 256;
+            mfkeydb_rec_t *p = realloc(*recs, capacity * sizeof(mfkeydb_rec_t));
+            if (p == NULL) {
+                PrintAndLogEx(WARNING, "Failed to allocate memory");
+                fclose(f);
+                free(*recs);
+                *recs = NULL;
+                *cnt = 0;
+                return PM3_EMALLOC;
+            }
+            *recs = p;
+        }
+        (*recs)[(*cnt)++] = rec;
+    }
+
+    fclose(f);
+    return PM3_SUCCESS;
+}
+
+// card r is the current card, or has the same block 0 or MAD contents
+static bool mfkeydb_strong(const mfkeydb_fp_t *card, const mfkeydb_fp_t *r) {
+    if (card->valid && card->uidlen == r->uidlen && memcmp(card->uid, r->uid, r->uidlen) == 0) {
+        return true;
+    }
+    if (card->manufacturer_len && card->manufacturer_len == r->manufacturer_len && memcmp(card->manufacturer, r->manufacturer, r->manufacturer_len) == 0) {
+        return true;
+    }
+    return (card->has_mad && r->has_mad && memcmp(card->mad, r->mad, sizeof(r->mad)) == 0);
+}
+
+// how much a key recorded on card r says about the current card.
+// Fields only count when both sides know them, each matching field multiplies the weight
+// and a known mismatch of the block 0 or MAD contents halves it.
+static uint64_t mfkeydb_weight(const mfkeydb_fp_t *card, const mfkeydb_fp_t *r) {
+
+    // same card again
+    if (card->valid && card->uidlen == r->uidlen && memcmp(card->uid, r->uid, r->uidlen) == 0) {
+        return 1 << 16;
+    }
+
+    uint64_t w = 4;
+
+    if (card->valid && card->sak == r->sak && memcmp(card->atqa, r->atqa, sizeof(r->atqa)) == 0) {
+        w <<= 2;
+    }
+
+    if (card->sectors == r->sectors) {
+        w <<= 1;
+    }
+
+    if (card->manufacturer_len && r->manufacturer_len) {
+        if (card->manufacturer_len == r->manufacturer_len && memcmp(card->manufacturer, r->manufacturer, r->manufacturer_len) == 0) {
+            w <<= 4;
+        } else {
+            w >>= 1;
+        }
+    }
+
+    if (card->has_mad && r->has_mad) {
+        if (memcmp(card->mad, r->mad, sizeof(r->mad)) == 0) {
+            w <<= 4;
+        } else {
+            w >>= 1;
+        }
+    }
+    return w;
+}
+
+static int mfkeydb_cmp_key(const void *a, const void *b) {
+    uint64_t ka = ((const mfkeydb_rank_t *)a)->key;
+    uint64_t kb = ((const mfkeydb_rank_t *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static int mfkeydb_cmp_score(const void *a, const void *b) {
+    const mfkeydb_rank_t *ra = (const mfkeydb_rank_t *)a;
+    const mfkeydb_rank_t *rb = (const mfkeydb_rank_t *)b;
+    if (ra->score != rb->score) {
+        return (ra->score < rb->score) ? 1 : -1;
+    }
+    if (ra->hits != rb->hits) {
+        return (ra->hits < rb->hits) ? 1 : -1;
+    }
+    if (ra->slots != rb->slots) {
+        return (ra->slots < rb->slots) ? 1 : -1;
+    }
+    return mfkeydb_cmp_key(a, b);
+}
+
+static mfkeydb_rank_t *mfkeydb_find_key(mfkeydb_rank_t *sorted, uint32_t n, uint64_t key) {
+    mfkeydb_rank_t k = { .key = key };
+    return bsearch(&k, sorted, n, sizeof(mfkeydb_rank_t), mfkeydb_cmp_key);
+}
+
+static bool mfkeydb_in_list(const uint8_t *keys, uint32_t cnt, const uint8_t *k) {
+    for (uint32_t i = 0; i < cnt; i++) {
+        if (memcmp(keys + ((size_t)i * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Puts the strong database keys after the first keep keys of the list, best match for the card first.
+ * Strong keys opened this card before, a card with the same block 0 or MAD contents, or more than one card.
+ * At most one chunk of them goes ahead, the same keys are dropped from the rest of the list.
+ * Other database keys keep their place in the list, or are added at its end.
+ * The card is only touched when the database isn't empty.
+ * @param appended number of keys added at the end of the list. may be NULL
+ */
+int mfkeydb_prepend(mfkeydb_fp_t *fp, uint8_t **keys, uint32_t *keycnt, uint32_t keep, uint32_t *appended) {
+
+    if (appended) {
+        *appended = 0;
+    }
+
+    mfkeydb_rec_t *recs = NULL;
+    uint32_t cnt = 0;
+    int res = mfkeydb_load(&recs, &cnt);
+    if (res != PM3_SUCCESS || cnt == 0) {
+        free(recs);
+        return res;
+    }
+
+    if (fp->valid == false) {
+        mfkeydb_fp_select(fp);
+    }
+    mfkeydb_fp_probe(fp);
+
+    mfkeydb_rank_t *rank = calloc(cnt, sizeof(mfkeydb_rank_t));
+    if (rank == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(recs);
+        return PM3_EMALLOC;
+    }
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        rank[i].key = recs[i].key;
+        rank[i].score = mfkeydb_weight(fp, &recs[i].fp);
+        rank[i].hits = 1;
+        rank[i].slots = recs[i].slots;
+        rank[i].strong = mfkeydb_strong(fp, &recs[i].fp);
+    }
+    free(recs);
+
+    // one entry per key, scores of all its cards summed up
+    qsort(rank, cnt, sizeof(mfkeydb_rank_t), mfkeydb_cmp_key);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < cnt; i++) {
+        if (n && rank[n - 1].key == rank[i].key) {
+            rank[n - 1].score += rank[i].score;
+            rank[n - 1].hits += rank[i].hits;
+            rank[n - 1].slots += rank[i].slots;
+            rank[n - 1].strong |= rank[i].strong;
+        } else {
+            rank[n++] = rank[i];
+        }
+    }
+
+    keep = MIN(keep, *keycnt);
+    uint8_t *out = calloc((size_t)*keycnt + n, MIFARE_KEY_SIZE);
+    if (out == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(rank);
+        return PM3_EMALLOC;
+    }
+
+    uint32_t o = 0;
+    memcpy(out, *keys, (size_t)keep * MIFARE_KEY_SIZE);
+    o += keep;
+
+    // best strong keys first
+    qsort(rank, n, sizeof(mfkeydb_rank_t), mfkeydb_cmp_score);
+
+    uint32_t added = 0;
+    for (uint32_t i = 0; i < n && added < MFKEYDB_PREPEND_MAX; i++) {
+        uint8_t k[MIFARE_KEY_SIZE];
+        num_to_bytes(rank[i].key, MIFARE_KEY_SIZE, k);
+
+        if (rank[i].strong == false && rank[i].hits < 2) {
+            continue;
+        }
+
+        // already given by the user
+        rank[i].first = true;
+        if (mfkeydb_in_list(out, keep, k)) {
+            continue;
+        }
+
+        memcpy(out + ((size_t)o * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE);
+        PrintAndLogEx(DEBUG, _YELLOW_("%2u") " - %s score %" PRIu64 " cards %u", o, sprint_hex(k, MIFARE_KEY_SIZE), rank[i].score, rank[i].hits);
+        o++;
+        added++;
+    }
+
+    // rest of the list in its own order, without the keys moved ahead
+    qsort(rank, n, sizeof(mfkeydb_rank_t), mfkeydb_cmp_key);
+    for (uint32_t i = keep; i < *keycnt; i++) {
+        uint8_t *k = *keys + ((size_t)i * MIFARE_KEY_SIZE);
+        mfkeydb_rank_t *r = mfkeydb_find_key(rank, n, bytes_to_num(k, MIFARE_KEY_SIZE));
+        if (r != NULL) {
+            if (r->first || r->listed) {
+                continue;
+            }
+            r->listed = true;
+        }
+        memcpy(out + ((size_t)o * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE);
+        o++;
+    }
+
+    // remaining database keys at the end
+    qsort(rank, n, sizeof(mfkeydb_rank_t), mfkeydb_cmp_score);
+    uint32_t tail = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t k[MIFARE_KEY_SIZE];
+        num_to_bytes(rank[i].key, MIFARE_KEY_SIZE, k);
+        if (rank[i].first || rank[i].listed || mfkeydb_in_list(out, keep, k)) {
+            continue;
+        }
+        memcpy(out + ((size_t)o * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE);
+        o++;
+        tail++;
+    }
+
+    free(rank);
+    free(*keys);
+    *keys = out;
+    *keycnt = o;
+    if (appended) {
+        *appended = tail;
+    }
+
+    PrintAndLogEx(SUCCESS, "loaded " _GREEN_("%u") " keys from key database, " _GREEN_("%u") " of them tried first", added + tail, added);
+    return PM3_SUCCESS;
+}
+
+/**
+ * @brief Appends the keys found on the card to the database, keys already recorded for this UID are skipped.
+ */
+int mfkeydb_record(mfkeydb_fp_t *fp, uint8_t sectors, const sector_t *e_sector) {
+
+    fp->sectors = sectors;
+    if (fp->valid == false) {
+        int res = mfkeydb_fp_select(fp);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+
+    // with its own keys, sector 0 gives the full fingerprint
+    for (uint8_t kt = MF_KEY_A; kt <= MF_KEY_B && fp->manufacturer_len == 0; kt++) {
+        if (e_sector[0].foundKey[kt]) {
+            uint8_t key[MIFARE_KEY_SIZE];
+            num_to_bytes(e_sector[0].Key[kt], MIFARE_KEY_SIZE, key);
+            mfkeydb_fp_read_sector0(fp, kt, key);
+        }
+    }
+
+    // distinct keys of the card
+    mfkeydb_rank_t found[2 * MIFARE_4K_MAXSECTOR];
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < sectors; i++) {
+        for (uint8_t kt = MF_KEY_A; kt <= MF_KEY_B; kt++) {
+            if (e_sector[i].foundKey[kt] == 0) {
+                continue;
+            }
+
+            uint32_t j = 0;
+            while (j < n && found[j].key != e_sector[i].Key[kt]) {
+                j++;
+            }
+            if (j == n) {
+                found[n].key = e_sector[i].Key[kt];
+                found[n].slots = 0;
+                n++;
+            }
+            found[j].slots++;
+        }
+    }
+
+    if (n == 0) {
+        return PM3_SUCCESS;
+    }
+
+    mfkeydb_rec_t *recs = NULL;
+    uint32_t cnt = 0;
+    int res = mfkeydb_load(&recs, &cnt);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        if (recs[i].fp.uidlen != fp->uidlen || memcmp(recs[i].fp.uid, fp->uid, fp->uidlen)) {
+            continue;
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            if (found[j].key == recs[i].key) {
+                found[j].slots = 0;
+            }
+        }
+    }
+    free(recs);
+
+    char *path = NULL;
+    if (mfkeydb_path(&path, true) != PM3_SUCCESS) {
+        return PM3_EFILE;
+    }
+
+    FILE *f = fopen(path, "a");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "Could not open key database " _YELLOW_("%s"), path);
+        free(path);
+        return PM3_EFILE;
+    }
+
+    // the position after fopen "a" is implementation defined, a new file is an empty one
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 0) {
+        fprintf(f, "# Proxmark3 MIFARE Classic key database, one line per recovered key and card\n");
+        fprintf(f, "# uid atqa sak sectors manufacturer mad key slots\n");
+    }
+
+    char manufacturer[(2 * MFBLOCK_SIZE) + 1] = "-";
+    if (fp->manufacturer_len) {
+        snprintf(manufacturer, sizeof(manufacturer), "%s", sprint_hex_inrow(fp->manufacturer, fp->manufacturer_len));
+    }
+
+    char mad[(4 * MFBLOCK_SIZE) + 1] = "-";
+    if (fp->has_mad) {
+        snprintf(mad, sizeof(mad), "%s", sprint_hex_inrow(fp->mad, sizeof(fp->mad)));
+    }
+
+    char uid[(2 * sizeof(fp->uid)) + 1];
+    snprintf(uid, sizeof(uid), "%s", sprint_hex_inrow(fp->uid, fp->uidlen));
+
+    uint32_t added = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (found[i].slots == 0) {
+            continue;
+        }
+        uint8_t key[MIFARE_KEY_SIZE];
+        num_to_bytes(found[i].key, MIFARE_KEY_SIZE, key);
+        fprintf(f, "%s %02X%02X %02X %u %s %s %s %u\n",
+                uid,
+                fp->atqa[0], fp->atqa[1],
+                fp->sak,
+                sectors,
+                manufacturer,
+                mad,
+                sprint_hex_inrow(key, sizeof(key)),
+                found[i].slots
+               );
+        added++;
+    }
+    fclose(f);
+
+    if (added) {
+        PrintAndLogEx(SUCCESS, "Added " _GREEN_("%u") " keys to key database " _YELLOW_("%s"), added, path);
+    }
+    free(path);
+    return PM3_SUCCESS;
+}
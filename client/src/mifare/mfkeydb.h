@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Local database of recovered MIFARE Classic keys
+//-----------------------------------------------------------------------------
+#ifndef __MFKEYDB_H
+#define __MFKEYDB_H
+
+#include "common.h"
+#include "mifare.h"             // iso14a_card_select_t
+#include "mifarehost.h"         // sector_t
+
+#define MFKEYDB_FILE            "mfc_keydb.txt"
+
+// what is known about a card before its keys are, used to find cards of the same site
+typedef struct {
+    bool valid;                     // uid, atqa, sak are set
+    bool probed;                    // sector 0 read was attempted
+    uint8_t uid[10];
+    uint8_t uidlen;
+    uint8_t atqa[2];
+    uint8_t sak;
+    uint8_t sectors;
+    uint8_t manufacturer[MFBLOCK_SIZE];     // block 0 bytes after the UID
+    uint8_t manufacturer_len;               // 0 when block 0 couldn't be read
+    uint8_t mad[2 * MFBLOCK_SIZE];          // blocks 1 and 2, when the card has a MAD
+    bool has_mad;
+} mfkeydb_fp_t;
+
+void mfkeydb_fp_from_card(mfkeydb_fp_t *fp, const iso14a_card_select_t *card, uint8_t sectors);
+int mfkeydb_fp_select(mfkeydb_fp_t *fp);
+
+int mfkeydb_prepend(mfkeydb_fp_t *fp, uint8_t **keys, uint32_t *keycnt, uint32_t keep, uint32_t *appended);
+int mfkeydb_record(mfkeydb_fp_t *fp, uint8_t sectors, const sector_t *e_sector);
+
+#endif
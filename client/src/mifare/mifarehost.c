@@ -497,7 +497,61 @@ inline static int Compare16Bits(const void *a, const void *b) {
     return -1;
 }
 
-// wrapper function for multi-threaded lfsr_recovery32
+// Compare16Bits() as a sort key, in descending order
+static inline uint16_t nested_sort_key(const struct Crypto1State *s) {
+    return 0xFFFF - ((((s->even >> 16) & 0xFF) << 8) | ((s->odd >> 16) & 0xFF));
+}
+
+// counting sort, same order as qsort() with Compare16Bits
+static bool nested_sort_statelist(StateList_t *statelist) {
+
+    if (statelist->len < 2) {
+        return true;
+    }
+
+    struct Crypto1State *tmp = calloc(statelist->len, sizeof(struct Crypto1State));
+    uint32_t *count = calloc(0x10000, sizeof(uint32_t));
+    if (tmp == NULL || count == NULL) {
+        free(tmp);
+        free(count);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < statelist->len; i++) {
+        count[nested_sort_key(statelist->head.slhead + i)]++;
+    }
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < 0x10000; i++) {
+        uint32_t c = count[i];
+        count[i] = sum;
+        sum += c;
+    }
+
+    for (uint32_t i = 0; i < statelist->len; i++) {
+        tmp[count[nested_sort_key(statelist->head.slhead + i)]++] = statelist->head.slhead[i];
+    }
+
+    memcpy(statelist->head.slhead, tmp, statelist->len * sizeof(struct Crypto1State));
+    free(tmp);
+    free(count);
+    return true;
+}
+
+typedef struct {
+    lfsr_recovery32_t rec[2];
+    uint32_t numbuckets[2];
+    uint32_t next_bucket;
+} nested_recovery_t;
+
+typedef struct {
+    nested_recovery_t *recovery;
+    struct Crypto1State *head[2];
+    struct Crypto1State *tail[2];
+} nested_worker_t;
+
+// worker for multi-threaded lfsr_recovery32.
+// Both statelists are split into buckets up front, idle workers take the next unprocessed bucket.
 static void
 #ifdef __has_attribute
 #if __has_attribute(force_align_arg_pointer)
@@ -505,92 +559,152 @@ __attribute__((force_align_arg_pointer))
 #endif
 #endif
 *nested_worker_thread(void *arg) {
-    struct Crypto1State *p1;
-    StateList_t *statelist = arg;
-    statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+    nested_worker_t *worker = arg;
+    nested_recovery_t *recovery = worker->recovery;
 
-    for (p1 = statelist->head.slhead; p1->odd | p1->even; p1++) {};
+    size_t worksize = MAX(recovery->rec[0].worksize, recovery->rec[1].worksize);
+    uint32_t *work = calloc(worksize, sizeof(uint32_t));
+    if (work == NULL) {
+        return NULL;
+    }
 
-    statelist->len = p1 - statelist->head.slhead;
-    statelist->tail.sltail = --p1;
+    uint32_t total = recovery->numbuckets[0] + recovery->numbuckets[1];
+    while (true) {
+        uint32_t item = __atomic_fetch_add(&recovery->next_bucket, 1, __ATOMIC_SEQ_CST);
+        if (item >= total) {
+            break;
+        }
 
-    qsort(statelist->head.slhead, statelist->len, sizeof(uint64_t), Compare16Bits);
+        uint8_t i = (item < recovery->numbuckets[0]) ? 0 : 1;
+        uint32_t bucket = (i == 0) ? item : item - recovery->numbuckets[0];
+        worker->tail[i] = lfsr_recovery32_bucket(&recovery->rec[i], bucket, worker->tail[i], work);
+    }
 
-    return statelist->head.slhead;
+    free(work);
+    return worker;
 }
 
-int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate) {
-
-    uint32_t uid = 0;
-    StateList_t statelists[2];
-    struct Crypto1State *p1, *p2, *p3, *p4;
+// recover the statelists of both nonces in parallel on all available cores.
+// The statelists are returned sorted by Compare16Bits.
+static int nested_recover_statelists(StateList_t *statelists) {
 
-    struct {
-        uint8_t block;
-        uint8_t keytype;
-        uint8_t target_block;
-        uint8_t target_keytype;
-        bool calibrate;
-        uint8_t key[6];
-    } PACKED payload;
-    payload.block = blockNo;
-    payload.keytype = keyType;
-    payload.target_block = trgBlockNo;
-    payload.target_keytype = trgKeyType;
-    payload.calibrate = calibrate;
-    memcpy(payload.key, key, sizeof(payload.key));
+    nested_recovery_t recovery;
+    memset(&recovery, 0, sizeof(recovery));
 
-    PacketResponseNG resp;
-    clearCommandBuffer();
-    SendCommandNG(CMD_HF_MIFARE_NESTED, (uint8_t *)&payload, sizeof(payload));
+    for (uint8_t i = 0; i < 2; i++) {
+        statelists[i].head.slhead = NULL;
+    }
 
-    if (WaitForResponseTimeout(CMD_HF_MIFARE_NESTED, &resp, 2000) == false) {
-        SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
-        return PM3_ETIMEOUT;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (lfsr_recovery32_split(&recovery.rec[i], statelists[i].ks1, statelists[i].nt_enc ^ statelists[i].uid) == false) {
+            lfsr_recovery32_free(&recovery.rec[0]);
+            return PM3_EMALLOC;
+        }
+        recovery.numbuckets[i] = recovery.rec[i].buckets.numbuckets;
     }
 
-    struct p {
-        int16_t isOK;
-        uint8_t block;
-        uint8_t keytype;
-        uint8_t cuid[4];
-        uint8_t nt_a[4];
-        uint8_t ks_a[4];
-        uint8_t nt_b[4];
-        uint8_t ks_b[4];
-    } PACKED;
-    struct p *package = (struct p *)resp.data.asBytes;
+    uint32_t total = recovery.numbuckets[0] + recovery.numbuckets[1];
+    int thread_count = MAX(1, MIN(num_CPUs(), (int)total));
 
-    // error during nested on device side
-    if (package->isOK != PM3_SUCCESS) {
-        return package->isOK;
+    nested_worker_t *workers = calloc(thread_count, sizeof(nested_worker_t));
+    pthread_t *thread_ids = calloc(thread_count, sizeof(pthread_t));
+    if (workers == NULL || thread_ids == NULL) {
+        free(workers);
+        free(thread_ids);
+        lfsr_recovery32_free(&recovery.rec[0]);
+        lfsr_recovery32_free(&recovery.rec[1]);
+        return PM3_EMALLOC;
     }
 
-    memcpy(&uid, package->cuid, sizeof(package->cuid));
+    int res = PM3_SUCCESS;
+    int started = 0;    // workers with buffers, the threads first
+    int threads = 0;
+    for (; started < thread_count; started++) {
+        workers[started].recovery = &recovery;
+        for (uint8_t i = 0; i < 2; i++) {
+            workers[started].head[i] = workers[started].tail[i] = calloc(1, sizeof(struct Crypto1State) << 18);
+        }
+        if (workers[started].head[0] == NULL || workers[started].head[1] == NULL) {
+            free(workers[started].head[0]);
+            free(workers[started].head[1]);
+            res = PM3_EMALLOC;
+            break;
+        }
+        if (pthread_create(thread_ids + started, NULL, nested_worker_thread, workers + started) != 0) {
+            // no more threads, this worker runs here and takes the buckets left over
+            if (nested_worker_thread(workers + started) == NULL) {
+                res = PM3_EMALLOC;
+            }
+            started++;
+            break;
+        }
+        threads++;
+    }
 
-    for (uint8_t i = 0; i < 2; i++) {
-        statelists[i].blockNo = package->block;
-        statelists[i].keyType = package->keytype;
-        statelists[i].uid = uid;
+    size_t len[2] = {0, 0};
+    for (int t = 0; t < started; t++) {
+        if (t < threads) {
+            void *ret = NULL;
+            pthread_join(thread_ids[t], &ret);
+            if (ret == NULL) {
+                res = PM3_EMALLOC;
+            }
+        }
+        for (uint8_t i = 0; i < 2; i++) {
+            len[i] += workers[t].tail[i] - workers[t].head[i];
+        }
     }
 
-    memcpy(&statelists[0].nt_enc,  package->nt_a, sizeof(package->nt_a));
-    memcpy(&statelists[0].ks1, package->ks_a, sizeof(package->ks_a));
+    lfsr_recovery32_free(&recovery.rec[0]);
+    lfsr_recovery32_free(&recovery.rec[1]);
 
-    memcpy(&statelists[1].nt_enc,  package->nt_b, sizeof(package->nt_b));
-    memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
+    // gather the partial lists of all workers into one zero terminated list per nonce
+    for (uint8_t i = 0; i < 2 && res == PM3_SUCCESS; i++) {
+        statelists[i].head.slhead = calloc(len[i] + 1, sizeof(struct Crypto1State));
+        if (statelists[i].head.slhead == NULL) {
+            res = PM3_EMALLOC;
+            break;
+        }
 
-    // calc keys
-    pthread_t thread_id[2];
+        struct Crypto1State *p = statelists[i].head.slhead;
+        for (int t = 0; t < started; t++) {
+            size_t n = workers[t].tail[i] - workers[t].head[i];
+            memcpy(p, workers[t].head[i], n * sizeof(struct Crypto1State));
+            p += n;
+        }
 
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++) {
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
+        statelists[i].len = len[i];
+        statelists[i].tail.sltail = p - 1;
+
+        if (nested_sort_statelist(&statelists[i]) == false) {
+            res = PM3_EMALLOC;
+        }
     }
 
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++) {
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
+    for (int t = 0; t < started; t++) {
+        free(workers[t].head[0]);
+        free(workers[t].head[1]);
+    }
+    free(workers);
+    free(thread_ids);
+
+    if (res != PM3_SUCCESS) {
+        free(statelists[0].head.slhead);
+        free(statelists[1].head.slhead);
+        statelists[0].head.slhead = NULL;
+        statelists[1].head.slhead = NULL;
+    }
+    return res;
+}
+
+// recover the statelists and reduce them to the key candidates common to both nonces.
+// On success statelists[0] holds the sorted, -1 terminated candidate list and statelists[1] is freed.
+static int nested_recover_keys(StateList_t *statelists) {
+    struct Crypto1State *p1, *p2, *p3, *p4;
+
+    int res = nested_recover_statelists(statelists);
+    if (res != PM3_SUCCESS) {
+        return res;
     }
 
     // the first 16 Bits of the cryptostate already contain part of our key.
@@ -638,11 +752,89 @@ int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo
 
     // the statelists now contain possible keys. The key we are searching for must be in the
     // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
+    if (radix_sort_uint64(statelists[0].head.keyhead, statelists[0].len) == false ||
+            radix_sort_uint64(statelists[1].head.keyhead, statelists[1].len) == false) {
+        free(statelists[0].head.slhead);
+        free(statelists[1].head.slhead);
+        statelists[0].head.slhead = NULL;
+        statelists[1].head.slhead = NULL;
+        return PM3_EMALLOC;
+    }
+
     // Create the intersection
     statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
 
+    free(statelists[1].head.slhead);
+    statelists[1].head.slhead = NULL;
+    return PM3_SUCCESS;
+}
+
+int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate) {
+
+    uint32_t uid = 0;
+    StateList_t statelists[2];
+
+    struct {
+        uint8_t block;
+        uint8_t keytype;
+        uint8_t target_block;
+        uint8_t target_keytype;
+        bool calibrate;
+        uint8_t key[6];
+    } PACKED payload;
+    payload.block = blockNo;
+    payload.keytype = keyType;
+    payload.target_block = trgBlockNo;
+    payload.target_keytype = trgKeyType;
+    payload.calibrate = calibrate;
+    memcpy(payload.key, key, sizeof(payload.key));
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_NESTED, (uint8_t *)&payload, sizeof(payload));
+
+    if (WaitForResponseTimeout(CMD_HF_MIFARE_NESTED, &resp, 2000) == false) {
+        SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+        return PM3_ETIMEOUT;
+    }
+
+    struct p {
+        int16_t isOK;
+        uint8_t block;
+        uint8_t keytype;
+        uint8_t cuid[4];
+        uint8_t nt_a[4];
+        uint8_t ks_a[4];
+        uint8_t nt_b[4];
+        uint8_t ks_b[4];
+    } PACKED;
+    struct p *package = (struct p *)resp.data.asBytes;
+
+    // error during nested on device side
+    if (package->isOK != PM3_SUCCESS) {
+        return package->isOK;
+    }
+
+    memcpy(&uid, package->cuid, sizeof(package->cuid));
+
+    for (uint8_t i = 0; i < 2; i++) {
+        statelists[i].blockNo = package->block;
+        statelists[i].keyType = package->keytype;
+        statelists[i].uid = uid;
+    }
+
+    memcpy(&statelists[0].nt_enc,  package->nt_a, sizeof(package->nt_a));
+    memcpy(&statelists[0].ks1, package->ks_a, sizeof(package->ks_a));
+
+    memcpy(&statelists[1].nt_enc,  package->nt_b, sizeof(package->nt_b));
+    memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
+
+    // calc keys
+    int res = nested_recover_keys(statelists);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
     bool looped = false;
 
     //statelists[0].tail.keytail = --p7;
@@ -668,7 +860,7 @@ int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo
 
         register uint8_t j;
         for (j = 0; j < size; j++) {
-            crypto1_get_lfsr(statelists[0].head.slhead + i, &key64);
+            crypto1_get_lfsr(statelists[0].head.slhead + i + j, &key64);
             num_to_bytes(key64, MIFARE_KEY_SIZE, keyBlock + j * MIFARE_KEY_SIZE);
         }
 
@@ -679,7 +871,6 @@ int mf_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo
             }
 
             free(statelists[0].head.slhead);
-            free(statelists[1].head.slhead);
             num_to_bytes(key64, MIFARE_KEY_SIZE, resultKey);
 
             if (package->keytype < 2) {
@@ -721,7 +912,6 @@ out:
                      );
     }
     free(statelists[0].head.slhead);
-    free(statelists[1].head.slhead);
     return PM3_ESOFT;
 }
 
@@ -729,7 +919,6 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
 
     uint32_t uid = 0;
     StateList_t statelists[2];
-    struct Crypto1State *p1, *p2, *p3, *p4;
 
     struct {
         uint8_t block;
@@ -782,62 +971,11 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
     memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
 
     // calc keys
-    pthread_t thread_id[2];
-
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
-
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
-
-    // the first 16 Bits of the cryptostate already contain part of our key.
-    // Create the intersection of the two lists based on these 16 Bits and
-    // roll back the cryptostate
-    p1 = p3 = statelists[0].head.slhead;
-    p2 = p4 = statelists[1].head.slhead;
-
-    while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
-        if (Compare16Bits(p1, p2) == 0) {
-
-            struct Crypto1State savestate;
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
-                *p3 = *p1;
-                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
-                p3++;
-                p1++;
-            }
-            savestate = *p2;
-            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
-                *p4 = *p2;
-                lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
-                p4++;
-                p2++;
-            }
-        } else {
-            while (Compare16Bits(p1, p2) == -1) p1++;
-            while (Compare16Bits(p1, p2) == 1) p2++;
-        }
+    int res = nested_recover_keys(statelists);
+    if (res != PM3_SUCCESS) {
+        return res;
     }
 
-    p3->odd = -1;
-    p3->even = -1;
-    p4->odd = -1;
-    p4->even = -1;
-    statelists[0].len = p3 - statelists[0].head.slhead;
-    statelists[1].len = p4 - statelists[1].head.slhead;
-    statelists[0].tail.sltail = --p3;
-    statelists[1].tail.sltail = --p4;
-
-    // the statelists now contain possible keys. The key we are searching for must be in the
-    // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
-    // Create the intersection
-    statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
-
     uint32_t keycnt = statelists[0].len;
     if (keycnt == 0) {
         goto out;
@@ -897,7 +1035,7 @@ int mf_static_nested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trg
             return PM3_EOPABORTED;
         }
 
-        int res = 0;
+        res = PM3_SUCCESS;
         uint64_t key64 = 0;
         uint32_t chunk = keycnt - i > max_keys_chunk ? max_keys_chunk : keycnt - i;
 
@@ -963,7 +1101,6 @@ out:
                  );
 
     free(statelists[0].head.slhead);
-    free(statelists[1].head.slhead);
     return PM3_ESOFT;
 }
 
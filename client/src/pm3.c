@@ -19,6 +19,7 @@
 #include "pm3.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "proxmark3.h"
 #include "cmdmain.h"
@@ -92,3 +93,104 @@ const char *pm3_grabbed_output_get(pm3_device_t *dev) {
 pm3_device_t *pm3_get_current_dev(void) {
     return g_session.current_device;
 }
+
+static int pm3_packet_send(pm3_packet_t *packet) {
+    if (packet->ng) {
+        if (packet->length > PM3_CMD_DATA_SIZE) {
+            return PM3_EINVARG;
+        }
+        SendCommandNG(packet->cmd, packet->data, packet->length);
+    } else {
+        if (packet->length > PM3_CMD_DATA_SIZE_MIX) {
+            return PM3_EINVARG;
+        }
+        SendCommandMIX(packet->cmd, packet->arg[0], packet->arg[1], packet->arg[2], packet->data, packet->length);
+    }
+    return PM3_SUCCESS;
+}
+
+static int pm3_packet_wait(pm3_packet_t *packet) {
+    PacketResponseNG resp;
+    uint16_t expected = (packet->resp_expected) ? packet->resp_expected : packet->cmd;
+    uint32_t timeout = (packet->timeout) ? packet->timeout : 2000;
+
+    if (WaitForResponseTimeoutW(expected, &resp, timeout, false) == false) {
+        return IsCommunicationThreadDead() ? PM3_EIO : PM3_ETIMEOUT;
+    }
+
+    packet->resp_cmd = resp.cmd;
+    packet->resp_status = resp.status;
+    packet->resp_reason = resp.reason;
+    packet->resp_ng = resp.ng;
+    memcpy(packet->resp_arg, resp.oldarg, sizeof(packet->resp_arg));
+    packet->resp_length = MIN(resp.length, PM3_PACKET_DATA_SIZE);
+    memcpy(packet->resp_data, resp.data.asBytes, packet->resp_length);
+    return PM3_SUCCESS;
+}
+
+int pm3_exchange(pm3_device_t *dev, pm3_packet_t *packet) {
+    return pm3_exchange_batch(dev, packet, 1, 1, NULL, NULL);
+}
+
+// Sends up to window packets ahead of the one whose response is awaited, so the device
+// finds the next command queued as soon as it has answered the previous one.
+// Responses are expected in order. After a timeout the remaining packets are not sent
+// and get PM3_EOPABORTED, as a late response could otherwise be matched to the wrong packet.
+// A callback error ends the batch, the packets in flight are drained and all after it get PM3_EOPABORTED.
+int pm3_exchange_batch(pm3_device_t *dev, pm3_packet_t *packets, size_t count, size_t window, pm3_packet_cb cb, void *ctx) {
+
+    if (packets == NULL) {
+        return PM3_EINVARG;
+    }
+
+    if (g_session.pm3_present == false) {
+        return PM3_ENOTTY;
+    }
+
+    if (window == 0) {
+        window = 1;
+    }
+
+    clearCommandBuffer();
+
+    int res = PM3_SUCCESS;
+    size_t sent = 0;
+    for (size_t done = 0; done < count; done++) {
+
+        while ((res == PM3_SUCCESS) && (sent < count) && (sent - done < window)) {
+            packets[sent].status = pm3_packet_send(&packets[sent]);
+            sent++;
+        }
+
+        pm3_packet_t *packet = &packets[done];
+        if (done >= sent) {
+            packet->status = PM3_EOPABORTED;
+        } else if (packet->status == PM3_SUCCESS) {
+            packet->status = pm3_packet_wait(packet);
+            if (packet->status != PM3_SUCCESS) {
+                // stop queueing, drain what is already in flight
+                res = packet->status;
+            }
+        }
+
+        if (cb) {
+            int cb_res = cb(dev, done, packet, ctx);
+            if (cb_res != PM3_SUCCESS) {
+                // drain what is already in flight, a late response would otherwise reach the caller's next command
+                for (size_t i = done + 1; i < count; i++) {
+                    if (i < sent && packets[i].status == PM3_SUCCESS) {
+                        pm3_packet_wait(&packets[i]);
+                    }
+                    packets[i].status = PM3_EOPABORTED;
+                }
+                res = cb_res;
+                break;
+            }
+        }
+    }
+
+    if (res != PM3_SUCCESS) {
+        clearCommandBuffer();
+    }
+    return res;
+}
@@ -0,0 +1,264 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// a Python module for binary device I/O, `import pm3bin`
+//
+// Hand written on purpose, next to the SWIG generated `pm3` module: it works
+// on the current device and exchanges bytes instead of hex strings.
+//-----------------------------------------------------------------------------
+
+#ifdef HAVE_PYTHON
+
+#ifdef _POSIX_C_SOURCE
+#undef _POSIX_C_SOURCE
+#endif
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "pm3_pybinlib.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "pm3.h"
+#include "pm3_cmd.h"
+#include "comms.h"
+#include "graph.h"
+
+// pm3bin.bigbuf(start, length) returns BigBuf bytes, downloaded straight into the bytes object
+static PyObject *pm3bin_bigbuf(PyObject *self, PyObject *args) {
+    (void) self;
+    unsigned int start = 0, length = 0;
+    if (PyArg_ParseTuple(args, "II", &start, &length) == 0) {
+        return NULL;
+    }
+
+    PyObject *out = PyBytes_FromStringAndSize(NULL, length);
+    if (out == NULL) {
+        return NULL;
+    }
+    if (length && GetFromDevice(BIG_BUF, (uint8_t *)PyBytes_AS_STRING(out), length, start, NULL, 0, NULL, 2500, false) == false) {
+        Py_DECREF(out);
+        PyErr_SetString(PyExc_TimeoutError, "command execution time out");
+        return NULL;
+    }
+    return out;
+}
+
+// pm3bin.bigbuf_into(buffer, start=0) fills any writable buffer (bytearray, numpy array, mmap...), returns bytes written
+static PyObject *pm3bin_bigbuf_into(PyObject *self, PyObject *args) {
+    (void) self;
+    Py_buffer view;
+    unsigned int start = 0;
+    if (PyArg_ParseTuple(args, "w*|I", &view, &start) == 0) {
+        return NULL;
+    }
+    if (PyBuffer_IsContiguous(&view, 'C') == 0) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer must be contiguous");
+        return NULL;
+    }
+    if (view.len > UINT32_MAX) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too large");
+        return NULL;
+    }
+
+    uint32_t len = (uint32_t)view.len;
+    bool ok = (len == 0) || GetFromDevice(BIG_BUF, (uint8_t *)view.buf, len, start, NULL, 0, NULL, 2500, false);
+    PyBuffer_Release(&view);
+    if (ok == false) {
+        PyErr_SetString(PyExc_TimeoutError, "command execution time out");
+        return NULL;
+    }
+    return PyLong_FromUnsignedLong(len);
+}
+
+// pm3bin.graph() returns a writable memoryview of the graph samples, format 'i',
+// it shares memory with the client so changes show up in `data plot` & co
+static PyObject *pm3bin_graph(PyObject *self, PyObject *args) {
+    (void) self;
+    (void) args;
+    PyObject *raw = PyMemoryView_FromMemory((char *)g_GraphBuffer, g_GraphTraceLen * sizeof(int32_t), PyBUF_WRITE);
+    if (raw == NULL) {
+        return NULL;
+    }
+    PyObject *mv = PyObject_CallMethod(raw, "cast", "s", "i");
+    Py_DECREF(raw);
+    return mv;
+}
+
+// pm3bin.batch(packets, window=4, callback=None)
+// packets: sequence of (cmd, data[, (arg0, arg1, arg2)[, resp_cmd[, timeout_ms]]]), a MIX frame is sent when args are given
+// returns a list of (status, resp_cmd, resp_status, resp_reason, (arg0, arg1, arg2), resp_data),
+// callback(index, result) is called as soon as each response arrives
+typedef struct {
+    PyObject *callback;
+    PyObject *results;
+    bool failed;
+} pm3bin_batch_t;
+
+static PyObject *pm3bin_packet_result(const pm3_packet_t *p) {
+    return Py_BuildValue("(iiii(KKK)y#)", p->status, p->resp_cmd, p->resp_status, p->resp_reason,
+                         (unsigned long long)p->resp_arg[0], (unsigned long long)p->resp_arg[1], (unsigned long long)p->resp_arg[2],
+                         (const char *)p->resp_data, (Py_ssize_t)p->resp_length);
+}
+
+// a Python exception stops the batch, it is raised by pm3bin.batch()
+static int pm3bin_batch_cb(pm3 *dev, size_t index, pm3_packet_t *packet, void *ctx) {
+    (void) dev;
+    pm3bin_batch_t *b = (pm3bin_batch_t *)ctx;
+
+    PyObject *r = pm3bin_packet_result(packet);
+    if (r == NULL) {
+        b->failed = true;
+        return PM3_ESOFT;
+    }
+    PyList_SET_ITEM(b->results, index, r);
+
+    if (b->callback) {
+        Py_INCREF(r);
+        PyObject *ret = PyObject_CallFunction(b->callback, "nO", (Py_ssize_t)index, r);
+        Py_DECREF(r);
+        if (ret == NULL) {
+            b->failed = true;
+            return PM3_ESOFT;
+        }
+        Py_DECREF(ret);
+    }
+    return PM3_SUCCESS;
+}
+
+static PyObject *pm3bin_batch(PyObject *self, PyObject *args, PyObject *kwargs) {
+    (void) self;
+    static char kw_packets[] = "packets", kw_window[] = "window", kw_callback[] = "callback";
+    static char *kwlist[] = {kw_packets, kw_window, kw_callback, NULL};
+    PyObject *packets = NULL;
+    PyObject *callback = Py_None;
+    int window = 4;
+    if (PyArg_ParseTupleAndKeywords(args, kwargs, "O|iO", kwlist, &packets, &window, &callback) == 0) {
+        return NULL;
+    }
+
+    if (callback == Py_None) {
+        callback = NULL;
+    }
+    if (callback && PyCallable_Check(callback) == 0) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+
+    PyObject *seq = PySequence_Fast(packets, "packets must be a sequence");
+    if (seq == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    pm3_packet_t *p = calloc(n ? n : 1, sizeof(pm3_packet_t));
+    if (p == NULL) {
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        unsigned short cmd = 0, resp_cmd = 0;
+        unsigned int timeout = 0;
+        Py_buffer data;
+        PyObject *margs = Py_None;
+        if (PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "Hy*|OHI", &cmd, &data, &margs, &resp_cmd, &timeout) == 0) {
+            free(p);
+            Py_DECREF(seq);
+            return NULL;
+        }
+
+        if (data.len > PM3_PACKET_DATA_SIZE) {
+            PyBuffer_Release(&data);
+            free(p);
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "packet %zd: data too long", i);
+            return NULL;
+        }
+        memcpy(p[i].data, data.buf, data.len);
+        p[i].length = data.len;
+        PyBuffer_Release(&data);
+
+        p[i].cmd = cmd;
+        p[i].resp_expected = resp_cmd;
+        p[i].timeout = timeout;
+        p[i].ng = (margs == Py_None);
+        if (p[i].ng == false) {
+            unsigned long long a0 = 0, a1 = 0, a2 = 0;
+            if (PyArg_ParseTuple(margs, "KKK", &a0, &a1, &a2) == 0) {
+                free(p);
+                Py_DECREF(seq);
+                return NULL;
+            }
+            p[i].arg[0] = a0;
+            p[i].arg[1] = a1;
+            p[i].arg[2] = a2;
+        }
+    }
+    Py_DECREF(seq);
+
+    pm3bin_batch_t b = { callback, PyList_New(n), false };
+    if (b.results == NULL) {
+        free(p);
+        return NULL;
+    }
+
+    // the callback fills the result slots, in order
+    pm3_exchange_batch(pm3_get_current_dev(), p, n, (window > 0) ? window : 1, pm3bin_batch_cb, &b);
+    free(p);
+
+    if (b.failed) {
+        Py_DECREF(b.results);
+        return NULL;
+    }
+
+    // offline, nothing was exchanged
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (PyList_GET_ITEM(b.results, i) == NULL) {
+            Py_INCREF(Py_None);
+            PyList_SET_ITEM(b.results, i, Py_None);
+        }
+    }
+    return b.results;
+}
+
+static PyMethodDef pm3bin_methods[] = {
+    {"bigbuf", pm3bin_bigbuf, METH_VARARGS, "Download BigBuf bytes"},
+    {"bigbuf_into", pm3bin_bigbuf_into, METH_VARARGS, "Download BigBuf into a writable buffer"},
+    {"graph", pm3bin_graph, METH_NOARGS, "Graph buffer as a writable memoryview"},
+    {"batch", (PyCFunction)(void (*)(void))pm3bin_batch, METH_VARARGS | METH_KEYWORDS, "Exchange binary packets, several in flight"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef pm3bin_module = {
+    PyModuleDef_HEAD_INIT,
+    "pm3bin",
+    "Binary device I/O for the current Proxmark3",
+    -1,
+    pm3bin_methods,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+PyObject *PyInit_pm3bin(void) {
+    return PyModule_Create(&pm3bin_module);
+}
+
+#endif // HAVE_PYTHON
@@ -45,6 +45,7 @@ const static vocabulary_t vocabulary[] = {
     { 1, "prefs get client.debug" },
     { 1, "prefs get client.delay" },
     { 1, "prefs get client.timeout" },
+    { 1, "prefs get client.rxbuffer" },
     { 1, "prefs get hf.field.timeout_sec" },
     { 1, "prefs get color" },
     { 1, "prefs get savepaths" },
@@ -58,6 +59,7 @@ const static vocabulary_t vocabulary[] = {
     { 1, "prefs set client.debug" },
     { 1, "prefs set client.delay" },
     { 1, "prefs set client.timeout" },
+    { 1, "prefs set client.rxbuffer" },
     { 1, "prefs set hf.field.timeout_sec" },
     { 1, "prefs set color" },
     { 1, "prefs set emoji" },
@@ -127,6 +129,8 @@ const static vocabulary_t vocabulary[] = {
     { 0, "data test_ss8" },
     { 0, "data test_ss32" },
     { 0, "data test_ss32s" },
+    { 1, "data dict help" },
+    { 1, "data dict compile" },
     { 1, "emv help" },
     { 1, "emv list" },
     { 1, "emv test" },
@@ -148,6 +152,7 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hf plot" },
     { 0, "hf tune" },
     { 1, "hf search" },
+    { 1, "hf sig" },
     { 0, "hf sniff" },
     { 1, "hf 14a help" },
     { 1, "hf 14a list" },
@@ -605,6 +610,7 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hw bootloader" },
     { 1, "hw connect" },
     { 0, "hw dbg" },
+    { 0, "hw dlbench" },
     { 0, "hw fpgaoff" },
     { 0, "hw lcd" },
     { 0, "hw lcdreset" },
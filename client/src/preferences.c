@@ -103,6 +103,7 @@ int preferences_load(void) {
     //  g_session.device_debug_level = ddbOFF;
     g_session.timeout = uart_get_timeouts();
     g_session.hf_field_timeout_sec = 0;
+    g_session.rx_buffer_size = CMD_BUFFER_SIZE;
 
     g_session.window_changed = false;
     g_session.plot.x = 10;
@@ -331,6 +332,7 @@ void preferences_save_callback(json_t *root) {
     JsonSaveInt(root, "client.exe.delay", g_session.client_exe_delay);
     JsonSaveInt(root, "client.timeout", g_session.timeout);
     JsonSaveInt(root, "hf.field.timeout_sec", g_session.hf_field_timeout_sec);
+    JsonSaveInt(root, "client.rxbuffer", g_session.rx_buffer_size);
 
     // MQTT
     JsonSaveStr(root, "mqtt.server", g_session.mqtt_server);
@@ -446,6 +448,10 @@ void preferences_load_callback(json_t *root) {
     if (json_unpack_ex(root, &up_error, 0, "{s:i}", "hf.field.timeout_sec", &i1) == 0)
         g_session.hf_field_timeout_sec = (i1 > 0) ? (uint32_t)i1 : 0;
 
+    // client reply buffer entries
+    if (json_unpack_ex(root, &up_error, 0, "{s:i}", "client.rxbuffer", &i1) == 0)
+        g_session.rx_buffer_size = MAX(MIN(i1, CMD_BUFFER_SIZE_MAX), CMD_BUFFER_SIZE_MIN);
+
     // MQTT server
     if (json_unpack_ex(root, &up_error, 0, "{s:s}", "mqtt.server", &s1) == 0)
         setDefaultMqttServer(s1);
@@ -677,6 +683,10 @@ static void showClientTimeoutState(void) {
     PrintAndLogEx(INFO, "    communication timeout... " _GREEN_("%u") " ms", g_session.timeout);
 }
 
+static void showClientRxBufferState(void) {
+    PrintAndLogEx(INFO, "    reply buffer............ " _GREEN_("%u") " entries", g_session.rx_buffer_size);
+}
+
 static void showFieldTimeoutState(void) {
     if (g_session.hf_field_timeout_sec == 0) {
         PrintAndLogEx(INFO, "    HF field timeout........ " _WHITE_("off"));
@@ -1081,6 +1091,41 @@ static int setCmdClientTimeout(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int setCmdClientRxBuffer(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "prefs set client.rxbuffer",
+                  "Set persistent preference of how many device replies the client can queue.\n"
+                  "When full, the client stalls reading from the device for a while and then drops replies.\n"
+                  "Rounded up to a power of two, takes effect on next connect",
+                  "prefs set client.rxbuffer --size 128    --> default\n"
+                  "prefs set client.rxbuffer --size 4096   --> for long bursts of unsolicited replies\n"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_1("s", "size", "<dec>", "number of reply entries ( 16..16384 )"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+    uint32_t new_value = arg_get_u32_def(ctx, 1, CMD_BUFFER_SIZE);
+    CLIParserFree(ctx);
+
+    if (new_value < CMD_BUFFER_SIZE_MIN || new_value > CMD_BUFFER_SIZE_MAX) {
+        PrintAndLogEx(WARNING, "Size must be between %u and %u", CMD_BUFFER_SIZE_MIN, CMD_BUFFER_SIZE_MAX);
+        return PM3_EINVARG;
+    }
+
+    if (g_session.rx_buffer_size != new_value) {
+        showClientRxBufferState();
+        g_session.rx_buffer_size = new_value;
+        showClientRxBufferState();
+        preferences_save();
+    } else {
+        showClientRxBufferState();
+    }
+    return PM3_SUCCESS;
+}
+
 static int setCmdHfFieldTimeout(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "prefs set hf.field.timeout_sec",
@@ -1575,6 +1620,22 @@ static int getCmdClientTimeout(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int getCmdClientRxBuffer(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "prefs get client.rxbuffer",
+                  "Get preference of how many device replies the client can queue",
+                  "prefs get client.rxbuffer"
+                 );
+    void *argtable[] = {
+        arg_param_begin,
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIParserFree(ctx);
+    showClientRxBufferState();
+    return PM3_SUCCESS;
+}
+
 static int getCmdHfFieldTimeout(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "prefs get hf.field.timeout_sec",
@@ -1614,6 +1675,7 @@ static command_t CommandTableGet[] = {
     {"client.debug",     getCmdDebug,         AlwaysAvailable, "Get client debug level preference"},
     {"client.delay",     getCmdExeDelay,      AlwaysAvailable, "Get client execution delay preference"},
     {"client.timeout",   getCmdClientTimeout, AlwaysAvailable, "Get client execution delay preference"},
+    {"client.rxbuffer",  getCmdClientRxBuffer, AlwaysAvailable, "Get client reply buffer size preference"},
     {"hf.field.timeout_sec", getCmdHfFieldTimeout, AlwaysAvailable, "Get PM3 HF field inactivity timeout preference"},
     {"color",            getCmdColor,         AlwaysAvailable, "Get color support preference"},
     {"savepaths",        getCmdSavePaths,     AlwaysAvailable, "Get file folder  "},
@@ -1632,6 +1694,7 @@ static command_t CommandTableSet[] = {
     {"client.debug",     setCmdDebug,         AlwaysAvailable, "Set client debug level"},
     {"client.delay",     setCmdExeDelay,      AlwaysAvailable, "Set client execution delay"},
     {"client.timeout",   setCmdClientTimeout, AlwaysAvailable, "Set client communication timeout"},
+    {"client.rxbuffer",  setCmdClientRxBuffer, AlwaysAvailable, "Set client reply buffer size"},
     {"hf.field.timeout_sec", setCmdHfFieldTimeout, AlwaysAvailable, "Set PM3 HF field inactivity timeout"},
 
     {"color",            setCmdColor,         AlwaysAvailable, "Set color support"},
@@ -1706,6 +1769,7 @@ static int CmdPrefShow(const char *Cmd) {
     showClientExeDelayState();
     showOutputState(prefShowNone);
     showClientTimeoutState();
+    showClientRxBufferState();
     showFieldTimeoutState();
     showMqttServer(prefShowNone);
     showMqttPort(prefShowNone);
@@ -48,6 +48,7 @@
 #include "cmdlfem4x50.h"  // read 4350
 #include "em4x50.h"       // 4x50 structs
 #include "iso7816/iso7816core.h"  // ISODEPSTATE
+#include "graph.h"        // g_GraphBuffer
 
 static int returnToLuaWithError(lua_State *L, const char *fmt, ...) {
     char buffer[1024];
@@ -185,6 +186,241 @@ static int l_SendCommandNG(lua_State *L) {
     return 1;
 }
 
+// pm3.buffer userdata, a binary view lua scripts can index and hand to the
+// *Bin senders without going through hex strings.
+// Owned buffers keep their bytes right after the header, the graph view
+// resolves g_GraphBuffer on every access so it follows the current trace.
+#define LUA_PM3_BUFFER "pm3.buffer"
+
+typedef struct {
+    bool is_graph;
+    size_t len;       // number of elements
+    uint8_t width;    // bytes per element
+    uint8_t storage[];
+} lua_pm3_buffer_t;
+
+static uint8_t *lua_pm3_buffer_data(lua_pm3_buffer_t *b, size_t *len) {
+    if (b->is_graph) {
+        *len = g_GraphTraceLen;
+        return (uint8_t *)g_GraphBuffer;
+    }
+    *len = b->len;
+    return b->storage;
+}
+
+static lua_pm3_buffer_t *lua_pm3_buffer_new(lua_State *L, size_t len, uint8_t width) {
+    lua_pm3_buffer_t *b = lua_newuserdatauv(L, sizeof(lua_pm3_buffer_t) + (len * width), 0);
+    b->is_graph = false;
+    b->len = len;
+    b->width = width;
+    memset(b->storage, 0, len * width);
+    luaL_setmetatable(L, LUA_PM3_BUFFER);
+    return b;
+}
+
+/**
+ * @brief Accepts either a lua string or a pm3.buffer as raw bytes
+ * @param L
+ * @param idx  stack index
+ * @param len  number of bytes
+ * @return pointer to the bytes, valid while the value stays on the stack
+ */
+static const uint8_t *lua_pm3_checkbytes(lua_State *L, int idx, size_t *len) {
+    lua_pm3_buffer_t *b = luaL_testudata(L, idx, LUA_PM3_BUFFER);
+    if (b != NULL) {
+        size_t n;
+        const uint8_t *p = lua_pm3_buffer_data(b, &n);
+        *len = n * b->width;
+        return p;
+    }
+    return (const uint8_t *)luaL_checklstring(L, idx, len);
+}
+
+// 1-based element index, optional end index, both clamped to the buffer
+static void lua_pm3_buffer_range(lua_State *L, size_t n, size_t *first, size_t *last) {
+    lua_Integer i = luaL_optinteger(L, 2, 1);
+    lua_Integer j = luaL_optinteger(L, 3, (lua_Integer)n);
+    if (i < 1) {
+        i = 1;
+    }
+    if (j > (lua_Integer)n) {
+        j = n;
+    }
+    *first = i - 1;
+    *last = (j < i) ? *first : (size_t)j;
+}
+
+static int l_pm3_buffer_len(lua_State *L) {
+    lua_pm3_buffer_t *b = luaL_checkudata(L, 1, LUA_PM3_BUFFER);
+    size_t n;
+    lua_pm3_buffer_data(b, &n);
+    lua_pushinteger(L, n);
+    return 1;
+}
+
+static int l_pm3_buffer_index(lua_State *L) {
+    lua_pm3_buffer_t *b = luaL_checkudata(L, 1, LUA_PM3_BUFFER);
+
+    if (lua_isinteger(L, 2) == false) {
+        // methods table
+        lua_gettable(L, lua_upvalueindex(1));
+        return 1;
+    }
+
+    size_t n;
+    uint8_t *p = lua_pm3_buffer_data(b, &n);
+    lua_Integer i = lua_tointeger(L, 2);
+    if (i < 1 || (size_t)i > n) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    if (b->width == sizeof(int32_t)) {
+        int32_t v;
+        memcpy(&v, p + ((i - 1) * b->width), sizeof(v));
+        lua_pushinteger(L, v);
+    } else {
+        lua_pushinteger(L, p[i - 1]);
+    }
+    return 1;
+}
+
+static int l_pm3_buffer_newindex(lua_State *L) {
+    lua_pm3_buffer_t *b = luaL_checkudata(L, 1, LUA_PM3_BUFFER);
+    lua_Integer i = luaL_checkinteger(L, 2);
+    lua_Integer v = luaL_checkinteger(L, 3);
+
+    size_t n;
+    uint8_t *p = lua_pm3_buffer_data(b, &n);
+    if (i < 1 || (size_t)i > n) {
+        return luaL_error(L, "index %d out of range 1..%d", (int)i, (int)n);
+    }
+
+    if (b->width == sizeof(int32_t)) {
+        int32_t v32 = (int32_t)v;
+        memcpy(p + ((i - 1) * b->width), &v32, sizeof(v32));
+    } else {
+        p[i - 1] = v & 0xFF;
+    }
+    return 0;
+}
+
+/**
+ * @brief buf:bytes([i [, j]]) raw bytes of elements i..j as a lua string
+ */
+static int l_pm3_buffer_bytes(lua_State *L) {
+    lua_pm3_buffer_t *b = luaL_checkudata(L, 1, LUA_PM3_BUFFER);
+    size_t n, first, last;
+    const uint8_t *p = lua_pm3_buffer_data(b, &n);
+    lua_pm3_buffer_range(L, n, &first, &last);
+    lua_pushlstring(L, (const char *)p + (first * b->width), (last - first) * b->width);
+    return 1;
+}
+
+/**
+ * @brief buf:hex([i [, j]]) same as bytes() but as hexstring, for the old hex based helpers
+ */
+static int l_pm3_buffer_hex(lua_State *L) {
+    static const char hexdigits[] = "0123456789ABCDEF";
+    lua_pm3_buffer_t *b = luaL_checkudata(L, 1, LUA_PM3_BUFFER);
+    size_t n, first, last;
+    const uint8_t *p = lua_pm3_buffer_data(b, &n);
+    lua_pm3_buffer_range(L, n, &first, &last);
+
+    size_t bytes = (last - first) * b->width;
+    p += first * b->width;
+
+    luaL_Buffer lb;
+    char *out = luaL_buffinitsize(L, &lb, bytes * 2);
+    for (size_t i = 0; i < bytes; i++) {
+        out[i * 2] = hexdigits[p[i] >> 4];
+        out[(i * 2) + 1] = hexdigits[p[i] & 0x0F];
+    }
+    luaL_pushresultsize(&lb, bytes * 2);
+    return 1;
+}
+
+static void register_pm3_buffer(lua_State *L) {
+    static const luaL_Reg meta[] = {
+        {"__len",       l_pm3_buffer_len},
+        {"__index",     l_pm3_buffer_index},
+        {"__newindex",  l_pm3_buffer_newindex},
+        {NULL, NULL}
+    };
+    static const luaL_Reg methods[] = {
+        {"bytes",       l_pm3_buffer_bytes},
+        {"hex",         l_pm3_buffer_hex},
+        {NULL, NULL}
+    };
+
+    luaL_newmetatable(L, LUA_PM3_BUFFER);
+    luaL_newlib(L, methods);
+    luaL_setfuncs(L, meta, 1);
+    lua_pop(L, 1);
+}
+
+/**
+ * The following params expected:
+ * @brief l_SendCommandMIXBin
+ * @param cmd   max u64
+ * @param arg0  max u64
+ * @param arg1  max u64
+ * @param arg2  max u64
+ * @param data  raw bytes, lua string or pm3.buffer, max 512 bytes
+ * @return
+ */
+static int l_SendCommandMIXBin(lua_State *L) {
+
+    int n = lua_gettop(L);
+    if (n != 5) {
+        return returnToLuaWithError(L, "You need to supply five parameters");
+    }
+
+    uint64_t cmd = luaL_checkinteger(L, 1);
+    uint64_t arg0 = luaL_checkinteger(L, 2);
+    uint64_t arg1 = luaL_checkinteger(L, 3);
+    uint64_t arg2 = luaL_checkinteger(L, 4);
+
+    size_t len;
+    const uint8_t *data = lua_pm3_checkbytes(L, 5, &len);
+    if (len > PM3_CMD_DATA_SIZE_MIX) {
+        return returnToLuaWithError(L, "data too large, max %d bytes", (int)PM3_CMD_DATA_SIZE_MIX);
+    }
+
+    clearCommandBuffer();
+    SendCommandMIX(cmd, arg0, arg1, arg2, data, len);
+    lua_pushboolean(L, true);
+    return 1;
+}
+
+/**
+ * The following params expected:
+ * @brief l_SendCommandNGBin
+ * @param cmd   max u16
+ * @param data  raw bytes, lua string or pm3.buffer, max 512 bytes
+ * @return
+ */
+static int l_SendCommandNGBin(lua_State *L) {
+
+    int n = lua_gettop(L);
+    if (n != 2) {
+        return returnToLuaWithError(L, "You need to supply two parameters");
+    }
+
+    uint16_t cmd = luaL_checkinteger(L, 1);
+
+    size_t len;
+    const uint8_t *data = lua_pm3_checkbytes(L, 2, &len);
+    if (len > PM3_CMD_DATA_SIZE) {
+        return returnToLuaWithError(L, "data too large, max %d bytes", PM3_CMD_DATA_SIZE);
+    }
+
+    clearCommandBuffer();
+    SendCommandNG(cmd, (uint8_t *)data, len);
+    lua_pushboolean(L, true);
+    return 1;
+}
+
 
 /**
  * @brief The following params expected:
@@ -400,6 +636,98 @@ static int l_WaitForResponseTimeout(lua_State *L) {
     return 1;
 }
 
+/**
+ * @brief Downloads BigBuf straight into a pm3.buffer, no lua string copy
+ * int start_index
+ * int bytes
+ * @param L
+ * @return pm3.buffer
+ */
+static int l_GetBigBufBuffer(lua_State *L) {
+
+    if (lua_gettop(L) < 2) {
+        return returnToLuaWithError(L, "You need to supply startindex and number of bytes");
+    }
+
+    uint32_t startindex = luaL_checkinteger(L, 1);
+    uint32_t len = luaL_checkinteger(L, 2);
+    if (len == 0) {
+        return returnToLuaWithError(L, "You need to supply number of bytes larger than zero");
+    }
+
+    lua_pm3_buffer_t *b = lua_pm3_buffer_new(L, len, sizeof(uint8_t));
+    if (GetFromDevice(BIG_BUF, b->storage, len, startindex, NULL, 0, NULL, 2500, false) == false) {
+        return returnToLuaWithError(L, "command execution time out");
+    }
+    return 1;
+}
+
+/**
+ * @brief A pm3.buffer view of the graph, elements are the signed samples.
+ * Writes go straight to the graph, the length follows the current trace.
+ * @param L
+ * @return pm3.buffer
+ */
+static int l_GetGraphBuffer(lua_State *L) {
+    lua_pm3_buffer_t *b = lua_pm3_buffer_new(L, 0, sizeof(int32_t));
+    b->is_graph = true;
+    return 1;
+}
+
+/**
+ * @brief Like WaitForResponseTimeout but returns the response as a table,
+ * Data holds exactly resp.length raw bytes.
+ * uint32_t cmd
+ * size_t ms_timeout
+ * @param L
+ * @return table {Cmd, Length, Magic, Status, Reason, Crc, Oldarg0..2, Data, Ng}
+ */
+static int l_WaitForResponseBin(lua_State *L) {
+
+    int n = lua_gettop(L);
+    if (n == 0) {
+        return returnToLuaWithError(L, "You need to supply at least command to wait for");
+    }
+
+    uint32_t cmd = (uint32_t)luaL_checkinteger(L, 1);
+    size_t ms_timeout = -1;
+    if (n >= 2) {
+        ms_timeout = (size_t)luaL_checkinteger(L, 2);
+    }
+
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(cmd, &resp, ms_timeout) == false) {
+        return returnToLuaWithError(L, "No response from the device");
+    }
+
+    size_t len = MIN(resp.length, sizeof(resp.data.asBytes));
+
+    lua_createtable(L, 0, 11);
+    lua_pushinteger(L, resp.cmd);
+    lua_setfield(L, -2, "Cmd");
+    lua_pushinteger(L, resp.length);
+    lua_setfield(L, -2, "Length");
+    lua_pushinteger(L, resp.magic);
+    lua_setfield(L, -2, "Magic");
+    lua_pushinteger(L, resp.status);
+    lua_setfield(L, -2, "Status");
+    lua_pushinteger(L, resp.reason);
+    lua_setfield(L, -2, "Reason");
+    lua_pushinteger(L, resp.crc);
+    lua_setfield(L, -2, "Crc");
+    lua_pushinteger(L, resp.oldarg[0]);
+    lua_setfield(L, -2, "Oldarg0");
+    lua_pushinteger(L, resp.oldarg[1]);
+    lua_setfield(L, -2, "Oldarg1");
+    lua_pushinteger(L, resp.oldarg[2]);
+    lua_setfield(L, -2, "Oldarg2");
+    lua_pushlstring(L, (const char *)resp.data.asBytes, len);
+    lua_setfield(L, -2, "Data");
+    lua_pushboolean(L, resp.ng);
+    lua_setfield(L, -2, "Ng");
+    return 1;
+}
+
 static int l_mfDarkside(lua_State *L) {
 
     uint32_t blockno = 0;
@@ -1402,10 +1730,15 @@ int set_pm3_libraries(lua_State *L) {
     static const luaL_Reg libs[] = {
         {"SendCommandMIX",              l_SendCommandMIX},
         {"SendCommandNG",               l_SendCommandNG},
+        {"SendCommandMIXBin",           l_SendCommandMIXBin},
+        {"SendCommandNGBin",            l_SendCommandNGBin},
         {"GetFromBigBuf",               l_GetFromBigBuf},
         {"GetFromFlashMem",             l_GetFromFlashMem},
         {"GetFromFlashMemSpiffs",       l_GetFromFlashMemSpiffs},
         {"WaitForResponseTimeout",      l_WaitForResponseTimeout},
+        {"WaitForResponseBin",          l_WaitForResponseBin},
+        {"GetBigBufBuffer",             l_GetBigBufBuffer},
+        {"GetGraphBuffer",              l_GetGraphBuffer},
         {"mfDarkside",                  l_mfDarkside},
         {"foobar",                      l_foobar},
         {"kbd_enter_pressed",           l_kbd_enter_pressed},
@@ -1452,6 +1785,9 @@ int set_pm3_libraries(lua_State *L) {
     // bit32 compatibility shim
     register_bit32_lib(L);
 
+    // binary buffer type used by the *Bin functions
+    register_pm3_buffer(L);
+
     // Core module
     luaL_newlib(L, libs);
     lua_setfield(L, -2, "core");
@@ -1,98 +1,187 @@
 #include "ringbuffer.h"
 #include <stdlib.h>
+#include <string.h>
 
 RingBuffer *RingBuf_create(int capacity) {
+    return RingBuf_createEx(capacity, sizeof(uint8_t));
+}
+
+RingBuffer *RingBuf_createEx(int capacity, size_t elemsize) {
+    if (capacity <= 0 || elemsize == 0) {
+        return NULL;
+    }
+
+    // free running head/tail counters need a power of two to wrap cleanly
+    uint32_t rounded = 1;
+    while (rounded < (uint32_t)capacity) {
+        rounded <<= 1;
+    }
+
     RingBuffer *buffer = (RingBuffer *)calloc(sizeof(RingBuffer), sizeof(uint8_t));
     if (!buffer) {
         return NULL;
     }
 
-    buffer->data = (uint8_t *)calloc(capacity, sizeof(uint8_t));
+    buffer->data = (uint8_t *)calloc(rounded, elemsize);
     if (!buffer->data) {
         free(buffer);
         return NULL;
     }
 
-    buffer->capacity = capacity;
-    buffer->size = 0;
-    buffer->front = 0;
-    buffer->rear = 0;
+    buffer->elemsize = elemsize;
+    buffer->capacity = rounded;
+    buffer->mask = rounded - 1;
+    buffer->head = 0;
+    buffer->tail = 0;
+    buffer->high_water = 0;
+    buffer->drops = 0;
 
     return buffer;
 }
 
+// producer view: own head, consumer's tail
+static inline uint32_t producer_used(RingBuffer *buffer) {
+    return __atomic_load_n(&buffer->head, __ATOMIC_RELAXED) - __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+}
+
+// consumer view: producer's head, own tail
+static inline uint32_t consumer_used(RingBuffer *buffer) {
+    return __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&buffer->tail, __ATOMIC_RELAXED);
+}
+
+// publish count new elements to the consumer
+static inline void producer_commit(RingBuffer *buffer, uint32_t count) {
+    uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_RELAXED) + count;
+    uint32_t used = head - __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+    if (used > __atomic_load_n(&buffer->high_water, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&buffer->high_water, used, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&buffer->head, head, __ATOMIC_RELEASE);
+}
+
+static inline void consumer_commit(RingBuffer *buffer, uint32_t count) {
+    __atomic_store_n(&buffer->tail, __atomic_load_n(&buffer->tail, __ATOMIC_RELAXED) + count, __ATOMIC_RELEASE);
+}
+
 inline bool RingBuf_isFull(RingBuffer *buffer) {
-    return buffer->size == buffer->capacity;
+    return producer_used(buffer) == buffer->capacity;
 }
 
 inline bool RingBuf_isEmpty(RingBuffer *buffer) {
-    return buffer->size == 0;
+    return consumer_used(buffer) == 0;
 }
 
 bool RingBuf_enqueue(RingBuffer *buffer, uint8_t value) {
-    if (RingBuf_isFull(buffer)) {
-        return false;
-    }
-
-    buffer->data[buffer->rear] = value;
-    buffer->rear = (buffer->rear + 1) % buffer->capacity;
-    buffer->size++;
-    return true;
+    return RingBuf_enqueueBatch(buffer, &value, 1) == 1;
 }
 
 bool RingBuf_dequeue(RingBuffer *buffer, uint8_t *value) {
-    if (RingBuf_isEmpty(buffer)) {
-        return false;
-    }
-
-    *value = buffer->data[buffer->front];
-    buffer->front = (buffer->front + 1) % buffer->capacity;
-    buffer->size--;
-    return true;
+    return RingBuf_dequeueBatch(buffer, value, 1) == 1;
 }
 
 int RingBuf_enqueueBatch(RingBuffer *buffer, const uint8_t *values, int count) {
-    int processed = 0;
+    if (count <= 0) {
+        return 0;
+    }
 
-    if (RingBuf_getAvailableSize(buffer) < count) {
-        count = RingBuf_getAvailableSize(buffer);
+    uint32_t available = buffer->capacity - producer_used(buffer);
+    if (available < (uint32_t)count) {
+        // no overwriting of unread data, whatever doesn't fit is lost
+        RingBuf_addDrops(buffer, (uint32_t)count - available);
+        count = available;
     }
 
-    for (int i = 0; i < count; i++) {
-        buffer->data[buffer->rear] = values[i];
-        buffer->rear = (buffer->rear + 1) % buffer->capacity;
-        processed++;
+    uint32_t pos = __atomic_load_n(&buffer->head, __ATOMIC_RELAXED) & buffer->mask;
+    uint32_t first = buffer->capacity - pos;
+    if (first > (uint32_t)count) {
+        first = count;
     }
 
-    buffer->size += processed;
+    memcpy(buffer->data + pos, values, first);
+    memcpy(buffer->data, values + first, count - first);
 
-    return processed;
+    producer_commit(buffer, count);
+    return count;
 }
 
 int RingBuf_dequeueBatch(RingBuffer *buffer, uint8_t *values, int count) {
-    int processed = 0;
+    if (count <= 0) {
+        return 0;
+    }
 
-    if (buffer->size < count) {
-        count = buffer->size;
+    uint32_t used = consumer_used(buffer);
+    if (used < (uint32_t)count) {
+        count = used;
     }
 
-    for (int i = 0; i < count; i++) {
-        values[i] = buffer->data[buffer->front];
-        buffer->front = (buffer->front + 1) % buffer->capacity;
-        processed++;
+    uint32_t pos = __atomic_load_n(&buffer->tail, __ATOMIC_RELAXED) & buffer->mask;
+    uint32_t first = buffer->capacity - pos;
+    if (first > (uint32_t)count) {
+        first = count;
     }
 
-    buffer->size -= processed;
+    memcpy(values, buffer->data + pos, first);
+    memcpy(values + first, buffer->data, count - first);
 
-    return processed;
+    consumer_commit(buffer, count);
+    return count;
+}
+
+bool RingBuf_push(RingBuffer *buffer, const void *elem) {
+    if (producer_used(buffer) == buffer->capacity) {
+        return false;
+    }
+
+    uint32_t pos = __atomic_load_n(&buffer->head, __ATOMIC_RELAXED) & buffer->mask;
+    memcpy(buffer->data + (pos * buffer->elemsize), elem, buffer->elemsize);
+
+    producer_commit(buffer, 1);
+    return true;
+}
+
+bool RingBuf_pop(RingBuffer *buffer, void *elem) {
+    if (consumer_used(buffer) == 0) {
+        return false;
+    }
+
+    uint32_t pos = __atomic_load_n(&buffer->tail, __ATOMIC_RELAXED) & buffer->mask;
+    memcpy(elem, buffer->data + (pos * buffer->elemsize), buffer->elemsize);
+
+    consumer_commit(buffer, 1);
+    return true;
+}
+
+void RingBuf_clear(RingBuffer *buffer) {
+    __atomic_store_n(&buffer->tail, __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
 }
 
 inline int RingBuf_getUsedSize(RingBuffer *buffer) {
-    return buffer->size;
+    return __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
 }
 
 inline int RingBuf_getAvailableSize(RingBuffer *buffer) {
-    return (buffer->capacity) - (buffer->size);
+    return buffer->capacity - RingBuf_getUsedSize(buffer);
+}
+
+inline int RingBuf_getCapacity(RingBuffer *buffer) {
+    return buffer->capacity;
+}
+
+uint32_t RingBuf_getHighWater(RingBuffer *buffer) {
+    return __atomic_load_n(&buffer->high_water, __ATOMIC_RELAXED);
+}
+
+uint32_t RingBuf_getDrops(RingBuffer *buffer) {
+    return __atomic_load_n(&buffer->drops, __ATOMIC_RELAXED);
+}
+
+void RingBuf_addDrops(RingBuffer *buffer, uint32_t count) {
+    __atomic_add_fetch(&buffer->drops, count, __ATOMIC_RELAXED);
+}
+
+void RingBuf_resetStats(RingBuffer *buffer) {
+    __atomic_store_n(&buffer->high_water, RingBuf_getUsedSize(buffer), __ATOMIC_RELAXED);
+    __atomic_store_n(&buffer->drops, 0, __ATOMIC_RELAXED);
 }
 
 void RingBuf_destroy(RingBuffer *buffer) {
@@ -102,17 +191,16 @@ void RingBuf_destroy(RingBuffer *buffer) {
 }
 
 inline int RingBuf_getContinousAvailableSize(RingBuffer *buffer) {
-    const int availableSize = RingBuf_getAvailableSize(buffer);
-    const int continousSize = (buffer->capacity) - (buffer->rear);
+    const uint32_t availableSize = buffer->capacity - producer_used(buffer);
+    const uint32_t continousSize = buffer->capacity - (__atomic_load_n(&buffer->head, __ATOMIC_RELAXED) & buffer->mask);
     return (availableSize < continousSize) ? availableSize : continousSize;
 }
 
 inline void RingBuf_postEnqueueBatch(RingBuffer *buffer, int count) {
     // no check there
-    buffer->rear = (buffer->rear + count) % buffer->capacity;
-    buffer->size += count;
+    producer_commit(buffer, count);
 }
 
 inline uint8_t *RingBuf_getRearPtr(RingBuffer *buffer) {
-    return buffer->data + buffer->rear;
+    return buffer->data + ((__atomic_load_n(&buffer->head, __ATOMIC_RELAXED) & buffer->mask) * buffer->elemsize);
 }
@@ -2,17 +2,27 @@
 #define _RINGBUFFER_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// Single producer / single consumer ring buffer.
+// One thread may enqueue while another one dequeues without any lock:
+// head is only written by the producer, tail only by the consumer.
+// Both are free running counters, the capacity is rounded up to a power of two.
+// Elements are bytes by default, RingBuf_createEx allows larger elements (e.g. packets).
 typedef struct {
     uint8_t *data;
-    int capacity;
-    int size;
-    int front;
-    int rear;
+    size_t elemsize;
+    uint32_t capacity;
+    uint32_t mask;
+    uint32_t head;          // producer, next slot to write
+    uint32_t tail;          // consumer, next slot to read
+    uint32_t high_water;    // most elements ever queued at once
+    uint32_t drops;         // elements which didn't fit
 } RingBuffer;
 
 RingBuffer *RingBuf_create(int capacity);
+RingBuffer *RingBuf_createEx(int capacity, size_t elemsize);
 bool RingBuf_isFull(RingBuffer *buffer);
 bool RingBuf_isEmpty(RingBuffer *buffer);
 bool RingBuf_enqueue(RingBuffer *buffer, uint8_t value);
@@ -21,8 +31,21 @@ int RingBuf_enqueueBatch(RingBuffer *buffer, const uint8_t *values, int count);
 int RingBuf_dequeueBatch(RingBuffer *buffer, uint8_t *values, int count);
 int RingBuf_getUsedSize(RingBuffer *buffer);
 int RingBuf_getAvailableSize(RingBuffer *buffer);
+int RingBuf_getCapacity(RingBuffer *buffer);
 void RingBuf_destroy(RingBuffer *buffer);
 
+// element access, for rings created with RingBuf_createEx
+bool RingBuf_push(RingBuffer *buffer, const void *elem);
+bool RingBuf_pop(RingBuffer *buffer, void *elem);
+// consumer side, drops everything queued so far
+void RingBuf_clear(RingBuffer *buffer);
+
+// statistics
+uint32_t RingBuf_getHighWater(RingBuffer *buffer);
+uint32_t RingBuf_getDrops(RingBuffer *buffer);
+void RingBuf_addDrops(RingBuffer *buffer, uint32_t count);
+void RingBuf_resetStats(RingBuffer *buffer);
+
 // for direct write
 int RingBuf_getContinousAvailableSize(RingBuffer *buffer);
 void RingBuf_postEnqueueBatch(RingBuffer *buffer, int count);
@@ -62,6 +62,11 @@ void uart_close(const serial_port sp);
  */
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen);
 
+/* Makes a uart_receive blocked in another thread, waiting for the start of a frame, return early.
+ * Used by the communication thread to send a queued command without waiting for the receive timeout.
+ */
+void uart_wakeup(void);
+
 /* Sends a buffer to a given serial port.
  *   pbtTx: A pointer to a buffer containing the data to send.
  *   len: The amount of data to be sent.
@@ -36,6 +36,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <errno.h>
+#include <pthread.h>
 
 #ifdef HAVE_BLUEZ
 #include <bluetooth/bluetooth.h>
@@ -72,6 +73,33 @@ static uint32_t newtimeout_value = 0;
 static bool newtimeout_pending = false;
 static uint8_t rx_empty_counter = 0;
 
+// self-pipe to interrupt the select() in uart_receive when a command is queued for sending
+static int wakeup_fd[2] = { -1, -1 };
+static pthread_once_t wakeup_once = PTHREAD_ONCE_INIT;
+
+static void uart_wakeup_init(void) {
+    if (pipe(wakeup_fd) != 0) {
+        wakeup_fd[0] = wakeup_fd[1] = -1;
+        return;
+    }
+    fcntl(wakeup_fd[0], F_SETFL, fcntl(wakeup_fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wakeup_fd[1], F_SETFL, fcntl(wakeup_fd[1], F_GETFL) | O_NONBLOCK);
+}
+
+void uart_wakeup(void) {
+    pthread_once(&wakeup_once, uart_wakeup_init);
+    if (wakeup_fd[1] >= 0) {
+        uint8_t b = 0;
+        // a full pipe already guarantees a wakeup
+        if (write(wakeup_fd[1], &b, 1) < 0) {}
+    }
+}
+
+static void uart_wakeup_drain(void) {
+    uint8_t b[16];
+    while (read(wakeup_fd[0], b, sizeof(b)) > 0) {};
+}
+
 int uart_reconfigure_timeouts(uint32_t value) {
     newtimeout_value = value;
     newtimeout_pending = true;
@@ -482,6 +510,9 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
         timeout.tv_usec = ((suseconds_t)newtimeout_value) * 1000;
         newtimeout_pending = false;
     }
+
+    pthread_once(&wakeup_once, uart_wakeup_init);
+
     // Reset the output count
     *pszRxLen = 0;
     do {
@@ -489,7 +520,7 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
         if (spu->udpBuffer != NULL) {
             // for UDP connection, try to use the data from the buffer
 
-            byteCount = RingBuf_getAvailableSize(spu->udpBuffer);
+            byteCount = RingBuf_getUsedSize(spu->udpBuffer);
             // Cap the number of bytes, so we don't overrun the buffer
             if (pszMaxRxLen - (*pszRxLen) < byteCount) {
 //                PrintAndLogEx(ERR, "UART:: RX prevent overrun (have %u, need %u)", pszMaxRxLen - (*pszRxLen), byteCount);
@@ -507,14 +538,27 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
         // Reset file descriptor
         FD_ZERO(&rfds);
         FD_SET(spu->fd, &rfds);
+        // only wake up between frames, a partially received frame is completed first
+        bool use_wakeup = (wakeup_fd[0] >= 0) && (*pszRxLen == 0);
+        if (use_wakeup) {
+            FD_SET(wakeup_fd[0], &rfds);
+        }
         tv = timeout;
-        res = select(spu->fd + 1, &rfds, NULL, NULL, &tv);
+        res = select(MAX(spu->fd, wakeup_fd[0]) + 1, &rfds, NULL, NULL, &tv);
 
         // Read error
         if (res < 0) {
             return PM3_EIO;
         }
 
+        // Woken up to send a command
+        if (use_wakeup && FD_ISSET(wakeup_fd[0], &rfds)) {
+            uart_wakeup_drain();
+            if (FD_ISSET(spu->fd, &rfds) == false) {
+                return PM3_ENODATA;
+            }
+        }
+
         // Read time-out
         if (res == 0) {
             if (*pszRxLen == 0) {
@@ -549,14 +593,14 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
         if (spu->udpBuffer != NULL) {
             if (RingBuf_getContinousAvailableSize(spu->udpBuffer) >= byteCount) {
                 // write to the buffer directly
-                res = read(spu->fd, RingBuf_getRearPtr(spu->udpBuffer), RingBuf_getAvailableSize(spu->udpBuffer));
+                res = read(spu->fd, RingBuf_getRearPtr(spu->udpBuffer), RingBuf_getContinousAvailableSize(spu->udpBuffer));
                 if (res >= 0) {
                     RingBuf_postEnqueueBatch(spu->udpBuffer, res);
                 }
             } else {
                 // use transit buffer
                 uint8_t transitBuf[MAX(sizeof(PacketResponseNGRaw), sizeof(PacketResponseOLD)) * 30];
-                res = read(spu->fd, transitBuf, RingBuf_getAvailableSize(spu->udpBuffer));
+                res = read(spu->fd, transitBuf, sizeof(transitBuf));
                 RingBuf_enqueueBatch(spu->udpBuffer, transitBuf, res);
             }
             // Stop if the OS has some troubles reading the data
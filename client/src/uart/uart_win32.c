@@ -365,6 +365,10 @@ uint32_t uart_get_speed(const serial_port sp) {
     return 0;
 }
 
+// the receive timeouts are left to the driver on Windows, nothing to interrupt
+void uart_wakeup(void) {
+}
+
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
     const serial_port_windows_t *spw = (serial_port_windows_t *)sp;
     if (spw->hSocket == INVALID_SOCKET) {
@@ -399,7 +403,7 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
             if (spw->udpBuffer != NULL) {
                 // for UDP connection, try to use the data from the buffer
 
-                byteCount = RingBuf_getAvailableSize(spw->udpBuffer);
+                byteCount = RingBuf_getUsedSize(spw->udpBuffer);
                 // Cap the number of bytes, so we don't overrun the buffer
                 if (pszMaxRxLen - (*pszRxLen) < byteCount) {
                     // PrintAndLogEx(ERR, "UART:: RX prevent overrun (have %u, need %u)", pszMaxRxLen - (*pszRxLen), byteCount);
@@ -460,14 +464,14 @@ int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uin
             if (spw->udpBuffer != NULL) {
                 if (RingBuf_getContinousAvailableSize(spw->udpBuffer) >= byteCount) {
                     // write to the buffer directly
-                    res = recv(spw->hSocket, (char *)RingBuf_getRearPtr(spw->udpBuffer), RingBuf_getAvailableSize(spw->udpBuffer), 0);
+                    res = recv(spw->hSocket, (char *)RingBuf_getRearPtr(spw->udpBuffer), RingBuf_getContinousAvailableSize(spw->udpBuffer), 0);
                     if (res >= 0) {
                         RingBuf_postEnqueueBatch(spw->udpBuffer, res);
                     }
                 } else {
                     // use transit buffer
                     uint8_t transitBuf[MAX(sizeof(PacketResponseNGRaw), sizeof(PacketResponseOLD)) * 30];
-                    res = recv(spw->hSocket, (char *)transitBuf, RingBuf_getAvailableSize(spw->udpBuffer), 0);
+                    res = recv(spw->hSocket, (char *)transitBuf, sizeof(transitBuf), 0);
                     RingBuf_enqueueBatch(spw->udpBuffer, transitBuf, res);
                 }
                 // Stop if the OS has some troubles reading the data
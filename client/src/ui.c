@@ -56,7 +56,8 @@ uint32_t g_GraphStop = 0;
 uint32_t g_GraphStart_old = 0;
 double g_GraphPixelsPerPoint = 1.f; // How many visual pixels are between each sample point (x axis)
 static bool flushAfterWrite = false;
-double g_GridOffset = 0;
+// per thread, for workers whose results get reported by someone else
+static __thread bool print_muted = false;
 bool g_GridLocked = false;
 
 pthread_mutex_t g_print_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -272,6 +273,10 @@ static uint8_t PrintAndLogEx_spinidx = 0;
 
 void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
 
+    if (print_muted) {
+        return;
+    }
+
     // skip debug messages if client debugging is turned off i.e. 'DATA SETDEBUG -0'
     if (g_debugMode == 0 && level == DEBUG) {
         return;
@@ -549,6 +554,10 @@ bool GetFlushAfterWrite(void) {
     return flushAfterWrite;
 }
 
+void SetPrintMuted(bool value) {
+    print_muted = value;
+}
+
 void memcpy_filter_rlmarkers(void *dest, const void *src, size_t n) {
     uint8_t *rdest = (uint8_t *)dest;
     uint8_t *rsrc = (uint8_t *)src;
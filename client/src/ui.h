@@ -64,6 +64,7 @@ typedef struct {
     pm3_device_t *current_device;
     uint32_t timeout;
     uint32_t hf_field_timeout_sec;
+    uint32_t rx_buffer_size;
     char *mqtt_server;
     char *mqtt_port;
     char *mqtt_topic;
@@ -83,6 +84,8 @@ void PrintAndLogInfoHeaderWithWidth(const char *title, size_t width);
 void PrintAndLogInfoHeader(const char *title);
 void SetFlushAfterWrite(bool value);
 bool GetFlushAfterWrite(void);
+// silence PrintAndLogEx on the calling thread
+void SetPrintMuted(bool value);
 void memcpy_filter_ansi(void *dest, const void *src, size_t n, bool filter);
 void memcpy_filter_rlmarkers(void *dest, const void *src, size_t n);
 void memcpy_filter_emoji(void *dest, const void *src, size_t n, emojiMode_t mode);
@@ -15,6 +15,8 @@
 //-----------------------------------------------------------------------------
 #include "bucketsort.h"
 
+#include <string.h>
+
 extern void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
                                   uint32_t *const ostart, uint32_t *const ostop,
                                   bucket_info_t *bucket_info, bucket_array_t bucket) {
@@ -58,3 +60,53 @@ extern void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
         bucket_info->numbuckets = nonempty_bucket;
     }
 }
+
+// Same result as bucket_sort_intersect(), but counts the bucket sizes first and scatters
+// through a single scratch array (at least as large as the longer list) instead of
+// 512 fixed size buckets. This keeps the memory footprint small enough to run several
+// recoveries in parallel.
+void radix_sort_intersect(uint32_t *const estart, uint32_t *const estop,
+                          uint32_t *const ostart, uint32_t *const ostop,
+                          bucket_info_t *bucket_info, uint32_t *scratch) {
+    uint32_t *start[2];
+    uint32_t *stop[2];
+    uint32_t count[2][0x100] = {{0}};
+
+    start[0] = estart;
+    stop[0] = estop;
+    start[1] = ostart;
+    stop[1] = ostop;
+
+    // histogram of the MSB (contribution bits)
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t *p1 = start[i]; p1 <= stop[i]; p1++) {
+            count[i][*p1 >> 24]++;
+        }
+    }
+
+    // write back intersecting buckets as sorted list.
+    for (uint32_t i = 0; i < 2; i++) {
+        uint32_t offset[0x100];
+        uint32_t total = 0;
+        uint32_t nonempty_bucket = 0;
+        for (uint32_t j = 0x00; j <= 0xff; j++) {
+            offset[j] = total;
+            if (count[0][j] && count[1][j]) { // non-empty intersecting buckets only
+                bucket_info->bucket_info[i][nonempty_bucket].head = start[i] + total;
+                total += count[i][j];
+                bucket_info->bucket_info[i][nonempty_bucket].tail = start[i] + total - 1;
+                nonempty_bucket++;
+            }
+        }
+
+        for (uint32_t *p1 = start[i]; p1 <= stop[i]; p1++) {
+            uint32_t bucket_index = *p1 >> 24;
+            if (count[0][bucket_index] && count[1][bucket_index]) {
+                scratch[offset[bucket_index]++] = *p1;
+            }
+        }
+
+        memcpy(start[i], scratch, total * sizeof(uint32_t));
+        bucket_info->numbuckets = nonempty_bucket;
+    }
+}
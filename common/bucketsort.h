@@ -36,4 +36,8 @@ void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
                            uint32_t *const ostart, uint32_t *const ostop,
                            bucket_info_t *bucket_info, bucket_array_t bucket);
 
+void radix_sort_intersect(uint32_t *const estart, uint32_t *const estop,
+                          uint32_t *const ostart, uint32_t *const ostop,
+                          bucket_info_t *bucket_info, uint32_t *scratch);
+
 #endif
@@ -19,6 +19,7 @@
 #include "bucketsort.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include "parity.h"
 
 
@@ -114,7 +115,7 @@ static inline void extend_table_simple(uint32_t *tbl, uint32_t **end, int bit) {
 static struct Crypto1State *
 recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
         uint32_t *e_head, uint32_t *e_tail, uint32_t eks, int rem,
-        struct Crypto1State *sl, uint32_t in, bucket_array_t bucket) {
+        struct Crypto1State *sl, uint32_t in, uint32_t *scratch) {
     bucket_info_t bucket_info;
 
     if (rem == -1) {
@@ -142,12 +143,12 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
             return sl;
     }
 
-    bucket_sort_intersect(e_head, e_tail, o_head, o_tail, &bucket_info, bucket);
+    radix_sort_intersect(e_head, e_tail, o_head, o_tail, &bucket_info, scratch);
 
     for (int i = bucket_info.numbuckets - 1; i >= 0; i--) {
         sl = recover(bucket_info.bucket_info[1][i].head, bucket_info.bucket_info[1][i].tail, oks,
                      bucket_info.bucket_info[0][i].head, bucket_info.bucket_info[0][i].tail, eks,
-                     rem, sl, in, bucket);
+                     rem, sl, in, scratch);
     }
 
     return sl;
@@ -161,38 +162,67 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
  * that was fed into the lfsr at the time the keystream was generated
  */
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
-    struct Crypto1State *statelist;
-    uint32_t *odd_head = 0, *odd_tail = 0, oks = 0;
-    uint32_t *even_head = 0, *even_tail = 0, eks = 0;
-    register int i;
+    lfsr_recovery32_t rec;
+    struct Crypto1State *statelist, *sl;
+    uint32_t *work = NULL;
 
-    // split the keystream into an odd and even part
-    for (i = 31; i >= 0; i -= 2)
-        oks = oks << 1 | BEBIT(ks2, i);
-    for (i = 30; i >= 0; i -= 2)
-        eks = eks << 1 | BEBIT(ks2, i);
+    statelist = calloc(1, sizeof(struct Crypto1State) << 18);
+    if (!statelist) {
+        return NULL;
+    }
+
+    statelist->odd = statelist->even = 0;
 
-    odd_head = odd_tail = calloc(1, sizeof(uint32_t) << 21);
-    even_head = even_tail = calloc(1, sizeof(uint32_t) << 21);
-    statelist =  calloc(1, sizeof(struct Crypto1State) << 18);
-    if (!odd_tail-- || !even_tail-- || !statelist) {
+    if (lfsr_recovery32_split(&rec, ks2, in) == false) {
         free(statelist);
-        statelist = 0;
+        return NULL;
+    }
+
+    work = calloc(rec.worksize, sizeof(uint32_t));
+    if (!work) {
+        free(statelist);
+        statelist = NULL;
         goto out;
     }
 
-    statelist->odd = statelist->even = 0;
+    // same order as the recursion in recover() would walk them
+    sl = statelist;
+    for (int i = rec.buckets.numbuckets - 1; i >= 0; i--) {
+        sl = lfsr_recovery32_bucket(&rec, i, sl, work);
+    }
 
-    // allocate memory for out of place bucket_sort
-    bucket_array_t bucket;
+out:
+    free(work);
+    lfsr_recovery32_free(&rec);
+    return statelist;
+}
 
-    for (i = 0; i < 2; i++) {
-        for (uint32_t j = 0; j <= 0xff; j++) {
-            bucket[i][j].head = calloc(1, sizeof(uint32_t) << 14);
-            if (!bucket[i][j].head) {
-                goto out;
-            }
-        }
+/** lfsr_recovery32_split
+ * first stage of lfsr_recovery32: build the odd and even tables for the first 14 bits of
+ * keystream and split them into intersecting buckets. The buckets are independent from
+ * each other and can be finished, in any order and from several threads, with
+ * lfsr_recovery32_bucket().
+ */
+bool lfsr_recovery32_split(lfsr_recovery32_t *rec, uint32_t ks2, uint32_t in) {
+    uint32_t *odd_tail, *even_tail, *scratch;
+    uint32_t oks = 0, eks = 0;
+    register int i;
+
+    memset(rec, 0, sizeof(lfsr_recovery32_t));
+
+    // split the keystream into an odd and even part
+    for (i = 31; i >= 0; i -= 2)
+        oks = oks << 1 | BEBIT(ks2, i);
+    for (i = 30; i >= 0; i -= 2)
+        eks = eks << 1 | BEBIT(ks2, i);
+
+    rec->odd_head = odd_tail = calloc(1, sizeof(uint32_t) << 21);
+    rec->even_head = even_tail = calloc(1, sizeof(uint32_t) << 21);
+    scratch = calloc(1, sizeof(uint32_t) << 21);
+    if (!odd_tail-- || !even_tail-- || !scratch) {
+        free(scratch);
+        lfsr_recovery32_free(rec);
+        return false;
     }
 
     // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream
@@ -209,23 +239,82 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
 
     // extend the statelists. Look at the next 8 Bits of the keystream (4 Bit each odd and even):
     for (i = 0; i < 4; i++) {
-        extend_table_simple(odd_head,  &odd_tail, (oks >>= 1) & 1);
-        extend_table_simple(even_head, &even_tail, (eks >>= 1) & 1);
+        extend_table_simple(rec->odd_head,  &odd_tail, (oks >>= 1) & 1);
+        extend_table_simple(rec->even_head, &even_tail, (eks >>= 1) & 1);
     }
 
     // the statelists now contain all states which could have generated the last 10 Bits of the keystream.
     // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
     // parameter into account.
     in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
-    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+    in <<= 1;
 
-out:
-    for (i = 0; i < 2; i++)
-        for (uint32_t j = 0; j <= 0xff; j++)
-            free(bucket[i][j].head);
-    free(odd_head);
-    free(even_head);
-    return statelist;
+    // first round of recover(), only the recursion into the buckets is left to do
+    for (i = 0; i < 4; i++) {
+        oks >>= 1;
+        eks >>= 1;
+        in >>= 2;
+        extend_table(rec->odd_head, &odd_tail, oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1, 0);
+        if (rec->odd_head > odd_tail)
+            break;
+
+        extend_table(rec->even_head, &even_tail, eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1, in & 3);
+        if (rec->even_head > even_tail)
+            break;
+    }
+
+    if (i == 4) {
+        radix_sort_intersect(rec->even_head, even_tail, rec->odd_head, odd_tail, &rec->buckets, scratch);
+    }
+    free(scratch);
+
+    rec->oks = oks;
+    rec->eks = eks;
+    rec->in = in;
+
+    // every bucket grows by at most a factor of 2 for each of the remaining 7 keystream bits
+    uint32_t maxlen = 0;
+    for (uint32_t j = 0; j < rec->buckets.numbuckets; j++) {
+        for (uint32_t k = 0; k < 2; k++) {
+            uint32_t len = rec->buckets.bucket_info[k][j].tail - rec->buckets.bucket_info[k][j].head + 1;
+            if (len > maxlen)
+                maxlen = len;
+        }
+    }
+    size_t tblsize = ((size_t)maxlen << 7) + 2;
+    if (tblsize > (1 << 21))
+        tblsize = 1 << 21;
+    rec->tblsize = tblsize;
+    rec->worksize = 3 * tblsize;
+    return true;
+}
+
+/** lfsr_recovery32_bucket
+ * second stage of lfsr_recovery32: recover the states of a single bucket.
+ * The states are appended at sl, the returned pointer is the new end of the list (always zero terminated).
+ * work must point to rec->worksize words of scratch memory owned by the caller.
+ */
+struct Crypto1State *lfsr_recovery32_bucket(const lfsr_recovery32_t *rec, uint32_t bucket, struct Crypto1State *sl, uint32_t *work) {
+    uint32_t *o_head = work;
+    uint32_t *e_head = work + rec->tblsize;
+    uint32_t *scratch = work + 2 * rec->tblsize;
+
+    uint32_t o_len = rec->buckets.bucket_info[1][bucket].tail - rec->buckets.bucket_info[1][bucket].head + 1;
+    uint32_t e_len = rec->buckets.bucket_info[0][bucket].tail - rec->buckets.bucket_info[0][bucket].head + 1;
+
+    // recover() extends the tables in place, so work on a private copy
+    memcpy(o_head, rec->buckets.bucket_info[1][bucket].head, o_len * sizeof(uint32_t));
+    memcpy(e_head, rec->buckets.bucket_info[0][bucket].head, e_len * sizeof(uint32_t));
+
+    sl->odd = sl->even = 0;
+    return recover(o_head, o_head + o_len - 1, rec->oks, e_head, e_head + e_len - 1, rec->eks, 7, sl, rec->in, scratch);
+}
+
+void lfsr_recovery32_free(lfsr_recovery32_t *rec) {
+    free(rec->odd_head);
+    free(rec->even_head);
+    rec->odd_head = NULL;
+    rec->even_head = NULL;
 }
 
 static const uint32_t S1[] = {     0x62141, 0x310A0, 0x18850, 0x0C428, 0x06214,
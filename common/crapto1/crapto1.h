@@ -35,7 +35,24 @@ uint32_t crypto1_word(struct Crypto1State *, uint32_t, int);
 uint32_t prng_successor(uint32_t x, uint32_t n);
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+#include "bucketsort.h"
+
+// lfsr_recovery32 split in two stages, see lfsr_recovery32_split()
+typedef struct {
+    uint32_t *odd_head;
+    uint32_t *even_head;
+    uint32_t oks;
+    uint32_t eks;
+    uint32_t in;
+    bucket_info_t buckets;
+    size_t tblsize;
+    size_t worksize;        // words of scratch memory needed by lfsr_recovery32_bucket()
+} lfsr_recovery32_t;
+
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in);
+bool lfsr_recovery32_split(lfsr_recovery32_t *rec, uint32_t ks2, uint32_t in);
+struct Crypto1State *lfsr_recovery32_bucket(const lfsr_recovery32_t *rec, uint32_t bucket, struct Crypto1State *sl, uint32_t *work);
+void lfsr_recovery32_free(lfsr_recovery32_t *rec);
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3);
 struct Crypto1State *
 lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par);
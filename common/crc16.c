@@ -20,9 +20,293 @@
 #include <string.h>
 #include "commonutil.h"
 
+#ifndef ON_DEVICE
+// one lookup table per polynomial, precomputed so any number of crc types can be
+// used at the same time, from any thread. They are what generate_table() gives.
+
+// poly 0x1021, msb first (CCITT, XMODEM, FeliCa, FDX-B, Philips)
+static const uint16_t crc16_table_ccitt[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+// poly 0x1021, reflected (CRC-A, X-25, iCLASS, KERMIT, CryptoRF)
+static const uint16_t crc16_table_ccitt_refl[256] = {
+    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+    0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+    0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+    0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+    0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+    0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+    0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+    0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+    0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+    0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+    0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+    0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+    0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+    0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+    0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+    0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+    0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+    0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+    0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+    0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+    0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+    0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+    0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+    0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+    0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+    0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+    0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+    0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+// poly 0xc6c6, reflected (LEGIC)
+static const uint16_t crc16_table_legic[256] = {
+    0x0000, 0x0b11, 0x1622, 0x1d33, 0x2c44, 0x2755, 0x3a66, 0x3177,
+    0x5888, 0x5399, 0x4eaa, 0x45bb, 0x74cc, 0x7fdd, 0x62ee, 0x69ff,
+    0x77d7, 0x7cc6, 0x61f5, 0x6ae4, 0x5b93, 0x5082, 0x4db1, 0x46a0,
+    0x2f5f, 0x244e, 0x397d, 0x326c, 0x031b, 0x080a, 0x1539, 0x1e28,
+    0x2969, 0x2278, 0x3f4b, 0x345a, 0x052d, 0x0e3c, 0x130f, 0x181e,
+    0x71e1, 0x7af0, 0x67c3, 0x6cd2, 0x5da5, 0x56b4, 0x4b87, 0x4096,
+    0x5ebe, 0x55af, 0x489c, 0x438d, 0x72fa, 0x79eb, 0x64d8, 0x6fc9,
+    0x0636, 0x0d27, 0x1014, 0x1b05, 0x2a72, 0x2163, 0x3c50, 0x3741,
+    0x52d2, 0x59c3, 0x44f0, 0x4fe1, 0x7e96, 0x7587, 0x68b4, 0x63a5,
+    0x0a5a, 0x014b, 0x1c78, 0x1769, 0x261e, 0x2d0f, 0x303c, 0x3b2d,
+    0x2505, 0x2e14, 0x3327, 0x3836, 0x0941, 0x0250, 0x1f63, 0x1472,
+    0x7d8d, 0x769c, 0x6baf, 0x60be, 0x51c9, 0x5ad8, 0x47eb, 0x4cfa,
+    0x7bbb, 0x70aa, 0x6d99, 0x6688, 0x57ff, 0x5cee, 0x41dd, 0x4acc,
+    0x2333, 0x2822, 0x3511, 0x3e00, 0x0f77, 0x0466, 0x1955, 0x1244,
+    0x0c6c, 0x077d, 0x1a4e, 0x115f, 0x2028, 0x2b39, 0x360a, 0x3d1b,
+    0x54e4, 0x5ff5, 0x42c6, 0x49d7, 0x78a0, 0x73b1, 0x6e82, 0x6593,
+    0x6363, 0x6872, 0x7541, 0x7e50, 0x4f27, 0x4436, 0x5905, 0x5214,
+    0x3beb, 0x30fa, 0x2dc9, 0x26d8, 0x17af, 0x1cbe, 0x018d, 0x0a9c,
+    0x14b4, 0x1fa5, 0x0296, 0x0987, 0x38f0, 0x33e1, 0x2ed2, 0x25c3,
+    0x4c3c, 0x472d, 0x5a1e, 0x510f, 0x6078, 0x6b69, 0x765a, 0x7d4b,
+    0x4a0a, 0x411b, 0x5c28, 0x5739, 0x664e, 0x6d5f, 0x706c, 0x7b7d,
+    0x1282, 0x1993, 0x04a0, 0x0fb1, 0x3ec6, 0x35d7, 0x28e4, 0x23f5,
+    0x3ddd, 0x36cc, 0x2bff, 0x20ee, 0x1199, 0x1a88, 0x07bb, 0x0caa,
+    0x6555, 0x6e44, 0x7377, 0x7866, 0x4911, 0x4200, 0x5f33, 0x5422,
+    0x31b1, 0x3aa0, 0x2793, 0x2c82, 0x1df5, 0x16e4, 0x0bd7, 0x00c6,
+    0x6939, 0x6228, 0x7f1b, 0x740a, 0x457d, 0x4e6c, 0x535f, 0x584e,
+    0x4666, 0x4d77, 0x5044, 0x5b55, 0x6a22, 0x6133, 0x7c00, 0x7711,
+    0x1eee, 0x15ff, 0x08cc, 0x03dd, 0x32aa, 0x39bb, 0x2488, 0x2f99,
+    0x18d8, 0x13c9, 0x0efa, 0x05eb, 0x349c, 0x3f8d, 0x22be, 0x29af,
+    0x4050, 0x4b41, 0x5672, 0x5d63, 0x6c14, 0x6705, 0x7a36, 0x7127,
+    0x6f0f, 0x641e, 0x792d, 0x723c, 0x434b, 0x485a, 0x5569, 0x5e78,
+    0x3787, 0x3c96, 0x21a5, 0x2ab4, 0x1bc3, 0x10d2, 0x0de1, 0x06f0,
+};
+
+// poly 0x002d, reflected (LEGIC 16)
+static const uint16_t crc16_table_legic16[256] = {
+    0x0000, 0x0168, 0x02d0, 0x03b8, 0x05a0, 0x04c8, 0x0770, 0x0618,
+    0x0b40, 0x0a28, 0x0990, 0x08f8, 0x0ee0, 0x0f88, 0x0c30, 0x0d58,
+    0x1680, 0x17e8, 0x1450, 0x1538, 0x1320, 0x1248, 0x11f0, 0x1098,
+    0x1dc0, 0x1ca8, 0x1f10, 0x1e78, 0x1860, 0x1908, 0x1ab0, 0x1bd8,
+    0x2d00, 0x2c68, 0x2fd0, 0x2eb8, 0x28a0, 0x29c8, 0x2a70, 0x2b18,
+    0x2640, 0x2728, 0x2490, 0x25f8, 0x23e0, 0x2288, 0x2130, 0x2058,
+    0x3b80, 0x3ae8, 0x3950, 0x3838, 0x3e20, 0x3f48, 0x3cf0, 0x3d98,
+    0x30c0, 0x31a8, 0x3210, 0x3378, 0x3560, 0x3408, 0x37b0, 0x36d8,
+    0x5a00, 0x5b68, 0x58d0, 0x59b8, 0x5fa0, 0x5ec8, 0x5d70, 0x5c18,
+    0x5140, 0x5028, 0x5390, 0x52f8, 0x54e0, 0x5588, 0x5630, 0x5758,
+    0x4c80, 0x4de8, 0x4e50, 0x4f38, 0x4920, 0x4848, 0x4bf0, 0x4a98,
+    0x47c0, 0x46a8, 0x4510, 0x4478, 0x4260, 0x4308, 0x40b0, 0x41d8,
+    0x7700, 0x7668, 0x75d0, 0x74b8, 0x72a0, 0x73c8, 0x7070, 0x7118,
+    0x7c40, 0x7d28, 0x7e90, 0x7ff8, 0x79e0, 0x7888, 0x7b30, 0x7a58,
+    0x6180, 0x60e8, 0x6350, 0x6238, 0x6420, 0x6548, 0x66f0, 0x6798,
+    0x6ac0, 0x6ba8, 0x6810, 0x6978, 0x6f60, 0x6e08, 0x6db0, 0x6cd8,
+    0xb400, 0xb568, 0xb6d0, 0xb7b8, 0xb1a0, 0xb0c8, 0xb370, 0xb218,
+    0xbf40, 0xbe28, 0xbd90, 0xbcf8, 0xbae0, 0xbb88, 0xb830, 0xb958,
+    0xa280, 0xa3e8, 0xa050, 0xa138, 0xa720, 0xa648, 0xa5f0, 0xa498,
+    0xa9c0, 0xa8a8, 0xab10, 0xaa78, 0xac60, 0xad08, 0xaeb0, 0xafd8,
+    0x9900, 0x9868, 0x9bd0, 0x9ab8, 0x9ca0, 0x9dc8, 0x9e70, 0x9f18,
+    0x9240, 0x9328, 0x9090, 0x91f8, 0x97e0, 0x9688, 0x9530, 0x9458,
+    0x8f80, 0x8ee8, 0x8d50, 0x8c38, 0x8a20, 0x8b48, 0x88f0, 0x8998,
+    0x84c0, 0x85a8, 0x8610, 0x8778, 0x8160, 0x8008, 0x83b0, 0x82d8,
+    0xee00, 0xef68, 0xecd0, 0xedb8, 0xeba0, 0xeac8, 0xe970, 0xe818,
+    0xe540, 0xe428, 0xe790, 0xe6f8, 0xe0e0, 0xe188, 0xe230, 0xe358,
+    0xf880, 0xf9e8, 0xfa50, 0xfb38, 0xfd20, 0xfc48, 0xfff0, 0xfe98,
+    0xf3c0, 0xf2a8, 0xf110, 0xf078, 0xf660, 0xf708, 0xf4b0, 0xf5d8,
+    0xc300, 0xc268, 0xc1d0, 0xc0b8, 0xc6a0, 0xc7c8, 0xc470, 0xc518,
+    0xc840, 0xc928, 0xca90, 0xcbf8, 0xcde0, 0xcc88, 0xcf30, 0xce58,
+    0xd580, 0xd4e8, 0xd750, 0xd638, 0xd020, 0xd148, 0xd2f0, 0xd398,
+    0xdec0, 0xdfa8, 0xdc10, 0xdd78, 0xdb60, 0xda08, 0xd9b0, 0xd8d8,
+};
+// slice-by-8 tables for the ones above, built on the first long buffer.
+// t[k][i] is the crc of byte i followed by k + 1 zero bytes
+typedef struct {
+    const uint16_t *base;
+    bool refin;
+    uint8_t state;      // 0 = not built, 1 = being built, 2 = ready
+    uint16_t t[7][256];
+} crc16_slices_t;
+
+static crc16_slices_t crc16_slices[] = {
+    { crc16_table_ccitt, false, 0, {{0}} },
+    { crc16_table_ccitt_refl, true, 0, {{0}} },
+    { crc16_table_legic, true, 0, {{0}} },
+    { crc16_table_legic16, true, 0, {{0}} },
+};
+
+// below this the byte loop is as fast and doesn't touch the 3.5kb of slice tables
+#define CRC16_SLICE_MIN 32
+
+// table selected with init_table() / generate_table(), used by crc16_fast() and crc16_legic()
+static __thread const uint16_t *crc_table = NULL;
+static __thread uint16_t custom_table[256];
+#else
+// on device there is a single table, regenerated when another crc type is asked for
 static uint16_t crc_table[256];
 static bool crc_table_init = false;
 static CrcType_t current_crc_type = CRC_NONE;
+#endif
+
+static void crc16_generate(uint16_t *table, uint16_t polynomial, bool refin) {
+
+    for (uint16_t i = 0; i < 256; i++) {
+
+        uint16_t c, crc = 0;
+
+        if (refin) {
+            c = reflect8(i) << 8;
+        } else {
+            c = i << 8;
+        }
+
+        for (uint16_t j = 0; j < 8; j++) {
+
+            if ((crc ^ c) & 0x8000) {
+                crc = (crc << 1) ^ polynomial;
+            } else {
+                crc =   crc << 1;
+            }
+
+            c = c << 1;
+        }
+
+        if (refin) {
+            crc = reflect16(crc);
+        }
+
+        table[i] = crc;
+    }
+}
+
+#ifndef ON_DEVICE
+
+const uint16_t *crc16_table(CrcType_t ct) {
+    switch (ct) {
+        case CRC_14443_A:
+        case CRC_14443_B:
+        case CRC_15693:
+        case CRC_ICLASS:
+        case CRC_CRYPTORF:
+        case CRC_KERMIT:
+            return crc16_table_ccitt_refl;
+        case CRC_FELICA:
+        case CRC_XMODEM:
+        case CRC_CCITT:
+        case CRC_11784:
+        case CRC_PHILIPS:
+            return crc16_table_ccitt;
+        case CRC_LEGIC:
+            return crc16_table_legic;
+        case CRC_LEGIC_16:
+            return crc16_table_legic16;
+        case CRC_NONE:
+            break;
+    }
+    return NULL;
+}
+
+void init_table(CrcType_t crctype) {
+    crc_table = crc16_table(crctype);
+}
+
+void generate_table(uint16_t polynomial, bool refin) {
+    crc16_generate(custom_table, polynomial, refin);
+    crc_table = custom_table;
+}
+
+void reset_table(void) {
+    crc_table = NULL;
+}
+
+static const crc16_slices_t *get_slices(const uint16_t *table, bool refin) {
+    for (size_t i = 0; i < ARRAYLEN(crc16_slices); i++) {
+        crc16_slices_t *s = &crc16_slices[i];
+        if (s->base != table || s->refin != refin) {
+            continue;
+        }
+
+        uint8_t state = __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);
+        if (state == 2) {
+            return s;
+        }
+
+        // first one in builds them, anyone arriving meanwhile takes the byte loop
+        uint8_t expected = 0;
+        if (__atomic_compare_exchange_n(&s->state, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == false) {
+            return NULL;
+        }
+
+        for (int k = 0; k < 7; k++) {
+            const uint16_t *prev = (k == 0) ? s->base : s->t[k - 1];
+            for (int v = 0; v < 256; v++) {
+                if (refin) {
+                    s->t[k][v] = (prev[v] >> 8) ^ s->base[prev[v] & 0xFF];
+                } else {
+                    s->t[k][v] = (prev[v] << 8) ^ s->base[prev[v] >> 8];
+                }
+            }
+        }
+        __atomic_store_n(&s->state, 2, __ATOMIC_RELEASE);
+        return s;
+    }
+    return NULL;
+}
+
+#else
+
+const uint16_t *crc16_table(CrcType_t ct) {
+    init_table(ct);
+    return crc_table_init ? crc_table : NULL;
+}
 
 void init_table(CrcType_t crctype) {
 
@@ -68,34 +352,7 @@ void init_table(CrcType_t crctype) {
 }
 
 void generate_table(uint16_t polynomial, bool refin) {
-
-    for (uint16_t i = 0; i < 256; i++) {
-
-        uint16_t c, crc = 0;
-
-        if (refin) {
-            c = reflect8(i) << 8;
-        } else {
-            c = i << 8;
-        }
-
-        for (uint16_t j = 0; j < 8; j++) {
-
-            if ((crc ^ c) & 0x8000) {
-                crc = (crc << 1) ^ polynomial;
-            } else {
-                crc =   crc << 1;
-            }
-
-            c = c << 1;
-        }
-
-        if (refin) {
-            crc = reflect16(crc);
-        }
-
-        crc_table[i] = crc;
-    }
+    crc16_generate(crc_table, polynomial, refin);
     crc_table_init = true;
 }
 
@@ -105,8 +362,10 @@ void reset_table(void) {
     current_crc_type = CRC_NONE;
 }
 
+#endif
+
 // table lookup LUT solution
-uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
+uint16_t crc16_fast_ex(const uint16_t *table, uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
 
     // fast lookup table algorithm without augmented zero bytes, e.g. used in pkzip.
     // only usable with polynom orders of 8, 16, 24 or 32.
@@ -120,10 +379,30 @@ uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bo
         crc = reflect16(crc);
     }
 
+#ifndef ON_DEVICE
+    // slice-by-8, eight independent lookups per step instead of a dependency chain
+    const crc16_slices_t *s = (n >= CRC16_SLICE_MIN) ? get_slices(table, refin) : NULL;
+    if (s != NULL) {
+        const uint16_t (*t)[256] = s->t;
+        if (refin == false) {
+            for (; n >= 8; n -= 8, d += 8) {
+                crc = t[6][(crc >> 8) ^ d[0]] ^ t[5][(crc & 0xFF) ^ d[1]] ^ t[4][d[2]] ^ t[3][d[3]] ^
+                      t[2][d[4]] ^ t[1][d[5]] ^ t[0][d[6]] ^ table[d[7]];
+            }
+        } else {
+            for (; n >= 8; n -= 8, d += 8) {
+                crc ^= d[0] | (d[1] << 8);
+                crc = t[6][crc & 0xFF] ^ t[5][crc >> 8] ^ t[4][d[2]] ^ t[3][d[3]] ^
+                      t[2][d[4]] ^ t[1][d[5]] ^ t[0][d[6]] ^ table[d[7]];
+            }
+        }
+    }
+#endif
+
     if (refin == false) {
-        while (n--) crc = (crc << 8) ^ crc_table[((crc >> 8) ^ *d++) & 0xFF ];
+        while (n--) crc = (crc << 8) ^ table[((crc >> 8) ^ *d++) & 0xFF ];
     } else {
-        while (n--) crc = (crc >> 8) ^ crc_table[(crc & 0xFF) ^ *d++];
+        while (n--) crc = (crc >> 8) ^ table[(crc & 0xFF) ^ *d++];
     }
 
     if (refout ^ refin) {
@@ -133,6 +412,19 @@ uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bo
     return crc;
 }
 
+uint16_t crc16_fast(uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
+#ifndef ON_DEVICE
+    const uint16_t *table = crc_table;
+    // nothing selected on this thread, all types but LEGIC are CCITT
+    if (table == NULL) {
+        table = refin ? crc16_table_ccitt_refl : crc16_table_ccitt;
+    }
+    return crc16_fast_ex(table, d, n, initval, refin, refout);
+#else
+    return crc16_fast_ex(crc_table, d, n, initval, refin, refout);
+#endif
+}
+
 // bit looped solution  TODO REMOVED
 uint16_t update_crc16_ex(uint16_t crc, uint8_t c, uint16_t polynomial) {
     uint16_t tmp = 0;
@@ -195,8 +487,6 @@ void compute_crc(CrcType_t ct, const uint8_t *d, size_t n, uint8_t *first, uint8
     // can't calc a crc on less than 1 byte
     if (n == 0) return;
 
-    init_table(ct);
-
     uint16_t crc = 0;
     switch (ct) {
         case CRC_14443_A:
@@ -241,7 +531,6 @@ uint16_t Crc16ex(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return 0;
 
-    init_table(ct);
     switch (ct) {
         case CRC_14443_A:
             return crc16_a(d, n);
@@ -287,8 +576,6 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return false;
 
-    init_table(ct);
-
     switch (ct) {
         case CRC_14443_A:
             return (crc16_a(d, n) == 0);
@@ -323,24 +610,24 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
 
 // poly=0x1021  init=0xffff  refin=false  refout=false  xorout=0x0000  check=0x29b1  residue=0x0000  name="CRC-16/CCITT-FALSE"
 uint16_t crc16_ccitt(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xffff, false, false);
+    return crc16_fast_ex(crc16_table(CRC_CCITT), d, n, 0xffff, false, false);
 }
 
 // FDX-B ISO11784/85) uses KERMIT/CCITT
 // poly 0x xx  init=0x000  refin=false  refout=true  xorout=0x0000 ...
 uint16_t crc16_fdxb(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, true);
+    return crc16_fast_ex(crc16_table(CRC_11784), d, n, 0x0000, false, true);
 }
 
 // poly=0x1021  init=0x0000  refin=true  refout=true  xorout=0x0000 name="KERMIT"
 uint16_t crc16_kermit(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, true, true);
+    return crc16_fast_ex(crc16_table(CRC_KERMIT), d, n, 0x0000, true, true);
 }
 
 // FeliCa uses XMODEM
 // poly=0x1021  init=0x0000  refin=false  refout=false  xorout=0x0000 name="XMODEM"
 uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, false);
+    return crc16_fast_ex(crc16_table(CRC_XMODEM), d, n, 0x0000, false, false);
 }
 
 // Following standards uses X-25
@@ -349,14 +636,14 @@ uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
 //   ISO/IEC 13239 (formerly ISO/IEC 3309)
 // poly=0x1021  init=0xffff  refin=true  refout=true  xorout=0xffff name="X-25"
 uint16_t crc16_x25(uint8_t const *d, size_t n) {
-    uint16_t crc = crc16_fast(d, n, 0xffff, true, true);
+    uint16_t crc = crc16_fast_ex(crc16_table(CRC_15693), d, n, 0xffff, true, true);
     crc = ~crc;
     return crc;
 }
 // CRC-A (14443-3)
 // poly=0x1021 init=0xc6c6 refin=true refout=true xorout=0x0000 name="CRC-A"
 uint16_t crc16_a(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xC6C6, true, true);
+    return crc16_fast_ex(crc16_table(CRC_14443_A), d, n, 0xC6C6, true, true);
 }
 
 // iClass crc
@@ -364,7 +651,7 @@ uint16_t crc16_a(uint8_t const *d, size_t n) {
 // poly       0x1021 reflected 0x8408
 // poly=0x1021  init=0x4807  refin=true  refout=true  xorout=0x0BC3  check=0xF0B8  name="CRC-16/ICLASS"
 uint16_t crc16_iclass(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x4807, true, true);
+    return crc16_fast_ex(crc16_table(CRC_ICLASS), d, n, 0x4807, true, true);
 }
 
 // This CRC-16 is used in Legic Advant systems.
@@ -375,5 +662,5 @@ uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc) {
 }
 
 uint16_t crc16_philips(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x49A3, false, false);
+    return crc16_fast_ex(crc16_table(CRC_PHILIPS), d, n, 0x49A3, false, false);
 }
@@ -84,6 +84,13 @@ uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc);
 uint16_t crc16_philips(uint8_t const *d, size_t n);
 
 // table implementation
+// lookup table of a crc type, NULL for CRC_NONE. On the client these are constant
+// and can be used from any thread, on device it is the one shared table.
+const uint16_t *crc16_table(CrcType_t ct);
+uint16_t crc16_fast_ex(const uint16_t *table, uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout);
+
+// crc16_fast() and crc16_legic() use the table selected by init_table() / generate_table().
+// The Crc16ex / compute_crc / check_crc and crc16_xxx functions don't need it.
 void init_table(CrcType_t crctype);
 void reset_table(void);
 void generate_table(uint16_t polynomial, bool refin);
@@ -62,6 +62,7 @@
 #include "ui.h"
 #include "util.h"
 # include "cmddata.h"
+# include "lfdsp.h"
 # define prnt(args...) PrintAndLogEx(DEBUG, ## args );
 #else
 # include "dbprint.h"
@@ -69,7 +70,12 @@ uint8_t g_debugMode = 0;
 # define prnt Dbprintf
 #endif
 
+#ifndef ON_DEVICE
+// the client may run demodulators on several threads at once, each one keeps its own
+static __thread signal_t signalprop = { 255, -255, 0, 0, true };
+#else
 static signal_t signalprop = { 255, -255, 0, 0, true };
+#endif
 signal_t *getSignalProperties(void) {
     return &signalprop;
 }
@@ -92,15 +98,6 @@ static void printSignal(void) {
     prnt("  THRESHOLD noise amplitude......%d", NOISE_AMPLITUDE_THRESHOLD);
 }
 
-#ifndef ON_DEVICE
-static int cmp_uint8(const void *a, const void *b) {
-    if (*(const uint8_t *)a < * (const uint8_t *)b)
-        return -1;
-    else
-        return *(const uint8_t *)a > *(const uint8_t *)b;
-}
-#endif
-
 void computeSignalProperties(const uint8_t *samples, uint32_t size) {
     resetSignal();
 
@@ -110,23 +107,25 @@ void computeSignalProperties(const uint8_t *samples, uint32_t size) {
     uint32_t offset_size = size - SIGNAL_IGNORE_FIRST_SAMPLES;
 
 #ifndef ON_DEVICE
-    uint8_t tmp[offset_size];
-    memcpy(tmp, samples + SIGNAL_IGNORE_FIRST_SAMPLES, sizeof(tmp));
-    qsort(tmp, sizeof(tmp), sizeof(uint8_t), cmp_uint8);
+    // 8 bit samples, a histogram gives the same percentiles as sorting a copy
+    uint32_t hist[256];
+    lfdsp_histogram_u8(samples + SIGNAL_IGNORE_FIRST_SAMPLES, offset_size, hist);
 
-    uint8_t low10 = 0.5 * (tmp[(int)(offset_size * 0.1)] + tmp[(int)((offset_size - 1) * 0.1)]);
-    uint8_t hi90 =  0.5 * (tmp[(int)(offset_size * 0.9)] + tmp[(int)((offset_size - 1) * 0.9)]);
+    uint8_t low10 = 0.5 * (lfdsp_hist_nth(hist, (int)(offset_size * 0.1)) + lfdsp_hist_nth(hist, (int)((offset_size - 1) * 0.1)));
+    uint8_t hi90 =  0.5 * (lfdsp_hist_nth(hist, (int)(offset_size * 0.9)) + lfdsp_hist_nth(hist, (int)((offset_size - 1) * 0.9)));
     uint32_t cnt = 0;
-    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
+    for (int v = 0; v < 256; v++) {
+        if (hist[v] == 0)
+            continue;
 
-        if (samples[i] < signalprop.low) signalprop.low = samples[i];
-        if (samples[i] > signalprop.high) signalprop.high = samples[i];
+        if (v < signalprop.low) signalprop.low = v;
+        if (v > signalprop.high) signalprop.high = v;
 
-        if (samples[i] < low10 || samples[i] > hi90)
+        if (v < low10 || v > hi90)
             continue;
 
-        sum += samples[i];
-        cnt++;
+        sum += v * hist[v];
+        cnt += hist[v];
     }
     if (cnt > 0)
         signalprop.mean = sum / cnt;
@@ -161,20 +160,15 @@ void removeSignalOffset(uint8_t *samples, uint32_t size) {
 
 #ifndef ON_DEVICE
 
-    uint8_t tmp[offset_size];
-    memcpy(tmp, samples + SIGNAL_IGNORE_FIRST_SAMPLES, sizeof(tmp));
-    qsort(tmp, sizeof(tmp), sizeof(uint8_t), cmp_uint8);
+    uint32_t hist[256];
+    lfdsp_histogram_u8(samples + SIGNAL_IGNORE_FIRST_SAMPLES, offset_size, hist);
 
-    uint8_t low10 = 0.5 * (tmp[(int)(offset_size * 0.05)] + tmp[(int)((offset_size - 1) * 0.05)]);
-    uint8_t hi90 =  0.5 * (tmp[(int)(offset_size * 0.95)] + tmp[(int)((offset_size - 1) * 0.95)]);
+    uint8_t low10 = 0.5 * (lfdsp_hist_nth(hist, (int)(offset_size * 0.05)) + lfdsp_hist_nth(hist, (int)((offset_size - 1) * 0.05)));
+    uint8_t hi90 =  0.5 * (lfdsp_hist_nth(hist, (int)(offset_size * 0.95)) + lfdsp_hist_nth(hist, (int)((offset_size - 1) * 0.95)));
     int32_t cnt = 0;
-    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
-
-        if (samples[i] < low10 || samples[i] > hi90)
-            continue;
-
-        acc_off += samples[i] - 128;
-        cnt++;
+    for (int v = low10; v <= hi90; v++) {
+        acc_off += (v - 128) * (int)hist[v];
+        cnt += hist[v];
     }
     if (cnt > 0)
         acc_off /= cnt;
@@ -188,6 +182,9 @@ void removeSignalOffset(uint8_t *samples, uint32_t size) {
 #endif
 
     // shift and saturate samples to center the mean
+#ifndef ON_DEVICE
+    lfdsp_offset_u8(samples, size, acc_off);
+#else
     for (uint32_t i = 0; i < size; i++) {
         if (acc_off > 0) {
             samples[i] = (samples[i] >= acc_off) ? samples[i] - acc_off : 0;
@@ -196,6 +193,7 @@ void removeSignalOffset(uint8_t *samples, uint32_t size) {
             samples[i] = (255 - samples[i] >=  -acc_off) ? samples[i] - acc_off : 255;
         }
     }
+#endif
 }
 
 // get high and low values of a wave with passed in fuzz factor. also return noise test = 1 for passed or 0 for only noise
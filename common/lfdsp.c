@@ -0,0 +1,582 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// LF sample conditioning kernels for the host side (client, tools).
+//
+// SSE2 is the x86_64 baseline and always built, AVX2 is built with a target
+// attribute and only used when the CPU reports it. NEON is used whenever the
+// compiler targets it. Every kernel gives bit exact results of the scalar one.
+//-----------------------------------------------------------------------------
+
+#include "lfdsp.h"
+
+#include <string.h>
+#include "commonutil.h"  // ARRAYLEN
+
+#if defined(__x86_64__) || defined(__i386__)
+# if defined(__SSE2__)
+#  define LFDSP_HAVE_SSE2
+#  include <emmintrin.h>
+# endif
+# if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#  define LFDSP_HAVE_AVX2
+#  include <immintrin.h>
+#  define AVX2_TARGET __attribute__((target("avx2")))
+# endif
+#elif defined(__ARM_NEON)
+# define LFDSP_HAVE_NEON
+# include <arm_neon.h>
+#endif
+
+typedef struct {
+    lfdsp_isa_t isa;
+    void (*offset_u8)(uint8_t *samples, size_t len, int offset);
+    void (*s32_to_u8)(int32_t *src, uint8_t *dest, size_t len);
+    void (*u8_to_s32)(const uint8_t *src, int32_t *dest, size_t len);
+    void (*minmax_s32)(const int32_t *src, size_t len, int32_t *min, int32_t *max);
+    void (*center_clip_s32)(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down);
+    // number of leading samples which are >= 0 (positive) or <= 0 (negative)
+    size_t (*sign_run_s32)(const int32_t *src, size_t len, bool positive);
+} lfdsp_ops_t;
+
+//-----------------------------------------------------------------------------
+// scalar, also used for the tails of the vector versions
+//-----------------------------------------------------------------------------
+static void offset_u8_scalar(uint8_t *samples, size_t len, int offset) {
+    for (size_t i = 0; i < len; i++) {
+        if (offset > 0) {
+            samples[i] = (samples[i] >= offset) ? samples[i] - offset : 0;
+        }
+        if (offset < 0) {
+            samples[i] = (255 - samples[i] >= -offset) ? samples[i] - offset : 255;
+        }
+    }
+}
+
+static void s32_to_u8_scalar(int32_t *src, uint8_t *dest, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] > 127) {
+            src[i] = 127;
+        }
+        if (src[i] < -127) {
+            src[i] = -127;
+        }
+        dest[i] = (uint8_t)(src[i] + 128);
+    }
+}
+
+static void u8_to_s32_scalar(const uint8_t *src, int32_t *dest, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dest[i] = src[i] - 128;
+    }
+}
+
+static void minmax_s32_scalar(const int32_t *src, size_t len, int32_t *min, int32_t *max) {
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] > *max) *max = src[i];
+        if (src[i] < *min) *min = src[i];
+    }
+}
+
+static void center_clip_s32_scalar(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down) {
+    for (size_t i = 0; i < len; i++) {
+        if ((in[i] <= up) && (in[i] >= down)) {
+            out[i] = 0;
+        }
+    }
+}
+
+static size_t sign_run_s32_scalar(const int32_t *src, size_t len, bool positive) {
+    size_t i = 0;
+    if (positive) {
+        while (i < len && src[i] >= 0) i++;
+    } else {
+        while (i < len && src[i] <= 0) i++;
+    }
+    return i;
+}
+
+static const lfdsp_ops_t ops_scalar = {
+    LFDSP_SCALAR, offset_u8_scalar, s32_to_u8_scalar, u8_to_s32_scalar,
+    minmax_s32_scalar, center_clip_s32_scalar, sign_run_s32_scalar
+};
+
+//-----------------------------------------------------------------------------
+// SSE2
+//-----------------------------------------------------------------------------
+#ifdef LFDSP_HAVE_SSE2
+static void offset_u8_sse2(uint8_t *samples, size_t len, int offset) {
+    if (offset == 0) {
+        return;
+    }
+    // saturating byte arithmetic is exactly the scalar clamp
+    __m128i off = _mm_set1_epi8((char)MIN(ABS(offset), 255));
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(samples + i));
+        x = (offset > 0) ? _mm_subs_epu8(x, off) : _mm_adds_epu8(x, off);
+        _mm_storeu_si128((__m128i *)(samples + i), x);
+    }
+    offset_u8_scalar(samples + i, len - i, offset);
+}
+
+static void s32_to_u8_sse2(int32_t *src, uint8_t *dest, size_t len) {
+    const __m128i lo = _mm_set1_epi16(-127);
+    const __m128i hi = _mm_set1_epi16(127);
+    const __m128i bias = _mm_set1_epi16(128);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        // int32 -> int16 saturates, clamping to +-127 afterwards is the same as clamping first
+        __m128i p = _mm_packs_epi32(a, b);
+        p = _mm_min_epi16(_mm_max_epi16(p, lo), hi);
+        _mm_storeu_si128((__m128i *)(src + i), _mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16));
+        _mm_storeu_si128((__m128i *)(src + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(p, p), 16));
+        p = _mm_add_epi16(p, bias);
+        _mm_storel_epi64((__m128i *)(dest + i), _mm_packus_epi16(p, p));
+    }
+    s32_to_u8_scalar(src + i, dest + i, len - i);
+}
+
+static void u8_to_s32_sse2(const uint8_t *src, int32_t *dest, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i l = _mm_sub_epi16(_mm_unpacklo_epi8(x, zero), bias);
+        __m128i h = _mm_sub_epi16(_mm_unpackhi_epi8(x, zero), bias);
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_srai_epi32(_mm_unpacklo_epi16(l, l), 16));
+        _mm_storeu_si128((__m128i *)(dest + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(l, l), 16));
+        _mm_storeu_si128((__m128i *)(dest + i + 8), _mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16));
+        _mm_storeu_si128((__m128i *)(dest + i + 12), _mm_srai_epi32(_mm_unpackhi_epi16(h, h), 16));
+    }
+    u8_to_s32_scalar(src + i, dest + i, len - i);
+}
+
+static void minmax_s32_sse2(const int32_t *src, size_t len, int32_t *min, int32_t *max) {
+    __m128i vmin = _mm_set1_epi32(*min);
+    __m128i vmax = _mm_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        // no pminsd / pmaxsd before SSE4.1
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i gt = _mm_cmpgt_epi32(x, vmax);
+        vmax = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, vmax));
+        __m128i lt = _mm_cmplt_epi32(x, vmin);
+        vmin = _mm_or_si128(_mm_and_si128(lt, x), _mm_andnot_si128(lt, vmin));
+    }
+    int32_t lmin[4], lmax[4];
+    _mm_storeu_si128((__m128i *)lmin, vmin);
+    _mm_storeu_si128((__m128i *)lmax, vmax);
+    minmax_s32_scalar(lmin, 4, min, max);
+    minmax_s32_scalar(lmax, 4, min, max);
+    minmax_s32_scalar(src + i, len - i, min, max);
+}
+
+static void center_clip_s32_sse2(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down) {
+    const __m128i vup = _mm_set1_epi32(up);
+    const __m128i vdown = _mm_set1_epi32(down);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i keep = _mm_or_si128(_mm_cmpgt_epi32(x, vup), _mm_cmplt_epi32(x, vdown));
+        __m128i o = _mm_loadu_si128((const __m128i *)(out + i));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_and_si128(o, keep));
+    }
+    center_clip_s32_scalar(in + i, out + i, len - i, up, down);
+}
+
+static size_t sign_run_s32_sse2(const int32_t *src, size_t len, bool positive) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i fail = positive ? x : _mm_cmpgt_epi32(x, zero);
+        int m = _mm_movemask_ps(_mm_castsi128_ps(fail));
+        if (m) {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return i + sign_run_s32_scalar(src + i, len - i, positive);
+}
+
+static const lfdsp_ops_t ops_sse2 = {
+    LFDSP_SSE2, offset_u8_sse2, s32_to_u8_sse2, u8_to_s32_sse2,
+    minmax_s32_sse2, center_clip_s32_sse2, sign_run_s32_sse2
+};
+#endif
+
+//-----------------------------------------------------------------------------
+// AVX2
+//-----------------------------------------------------------------------------
+#ifdef LFDSP_HAVE_AVX2
+AVX2_TARGET static void offset_u8_avx2(uint8_t *samples, size_t len, int offset) {
+    if (offset == 0) {
+        return;
+    }
+    __m256i off = _mm256_set1_epi8((char)MIN(ABS(offset), 255));
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(samples + i));
+        x = (offset > 0) ? _mm256_subs_epu8(x, off) : _mm256_adds_epu8(x, off);
+        _mm256_storeu_si256((__m256i *)(samples + i), x);
+    }
+    offset_u8_scalar(samples + i, len - i, offset);
+}
+
+AVX2_TARGET static void s32_to_u8_avx2(int32_t *src, uint8_t *dest, size_t len) {
+    const __m256i lo = _mm256_set1_epi32(-127);
+    const __m256i hi = _mm256_set1_epi32(127);
+    const __m256i bias = _mm256_set1_epi16(128);
+    // the packs work per 128 bit lane, this puts the dwords back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v[4];
+        for (int j = 0; j < 4; j++) {
+            v[j] = _mm256_loadu_si256((const __m256i *)(src + i + j * 8));
+            v[j] = _mm256_min_epi32(_mm256_max_epi32(v[j], lo), hi);
+            _mm256_storeu_si256((__m256i *)(src + i + j * 8), v[j]);
+        }
+        __m256i ab = _mm256_add_epi16(_mm256_packs_epi32(v[0], v[1]), bias);
+        __m256i cd = _mm256_add_epi16(_mm256_packs_epi32(v[2], v[3]), bias);
+        __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, cd), order);
+        _mm256_storeu_si256((__m256i *)(dest + i), bytes);
+    }
+    s32_to_u8_scalar(src + i, dest + i, len - i);
+}
+
+AVX2_TARGET static void u8_to_s32_avx2(const uint8_t *src, int32_t *dest, size_t len) {
+    const __m256i bias = _mm256_set1_epi32(128);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_sub_epi32(x, bias));
+    }
+    u8_to_s32_scalar(src + i, dest + i, len - i);
+}
+
+AVX2_TARGET static void minmax_s32_avx2(const int32_t *src, size_t len, int32_t *min, int32_t *max) {
+    __m256i vmin = _mm256_set1_epi32(*min);
+    __m256i vmax = _mm256_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        vmin = _mm256_min_epi32(vmin, x);
+        vmax = _mm256_max_epi32(vmax, x);
+    }
+    int32_t lmin[8], lmax[8];
+    _mm256_storeu_si256((__m256i *)lmin, vmin);
+    _mm256_storeu_si256((__m256i *)lmax, vmax);
+    minmax_s32_scalar(lmin, 8, min, max);
+    minmax_s32_scalar(lmax, 8, min, max);
+    minmax_s32_scalar(src + i, len - i, min, max);
+}
+
+AVX2_TARGET static void center_clip_s32_avx2(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down) {
+    const __m256i vup = _mm256_set1_epi32(up);
+    const __m256i vdown = _mm256_set1_epi32(down);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i keep = _mm256_or_si256(_mm256_cmpgt_epi32(x, vup), _mm256_cmpgt_epi32(vdown, x));
+        __m256i o = _mm256_loadu_si256((const __m256i *)(out + i));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_and_si256(o, keep));
+    }
+    center_clip_s32_scalar(in + i, out + i, len - i, up, down);
+}
+
+AVX2_TARGET static size_t sign_run_s32_avx2(const int32_t *src, size_t len, bool positive) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i fail = positive ? x : _mm256_cmpgt_epi32(x, zero);
+        int m = _mm256_movemask_ps(_mm256_castsi256_ps(fail));
+        if (m) {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return i + sign_run_s32_scalar(src + i, len - i, positive);
+}
+
+static const lfdsp_ops_t ops_avx2 = {
+    LFDSP_AVX2, offset_u8_avx2, s32_to_u8_avx2, u8_to_s32_avx2,
+    minmax_s32_avx2, center_clip_s32_avx2, sign_run_s32_avx2
+};
+#endif
+
+//-----------------------------------------------------------------------------
+// NEON
+//-----------------------------------------------------------------------------
+#ifdef LFDSP_HAVE_NEON
+static void offset_u8_neon(uint8_t *samples, size_t len, int offset) {
+    if (offset == 0) {
+        return;
+    }
+    uint8x16_t off = vdupq_n_u8((uint8_t)MIN(ABS(offset), 255));
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t x = vld1q_u8(samples + i);
+        x = (offset > 0) ? vqsubq_u8(x, off) : vqaddq_u8(x, off);
+        vst1q_u8(samples + i, x);
+    }
+    offset_u8_scalar(samples + i, len - i, offset);
+}
+
+static void s32_to_u8_neon(int32_t *src, uint8_t *dest, size_t len) {
+    const int32x4_t lo = vdupq_n_s32(-127);
+    const int32x4_t hi = vdupq_n_s32(127);
+    const int16x8_t bias = vdupq_n_s16(128);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        int32x4_t a = vminq_s32(vmaxq_s32(vld1q_s32(src + i), lo), hi);
+        int32x4_t b = vminq_s32(vmaxq_s32(vld1q_s32(src + i + 4), lo), hi);
+        vst1q_s32(src + i, a);
+        vst1q_s32(src + i + 4, b);
+        int16x8_t p = vaddq_s16(vcombine_s16(vmovn_s32(a), vmovn_s32(b)), bias);
+        vst1_u8(dest + i, vqmovun_s16(p));
+    }
+    s32_to_u8_scalar(src + i, dest + i, len - i);
+}
+
+static void u8_to_s32_neon(const uint8_t *src, int32_t *dest, size_t len) {
+    const int32x4_t bias = vdupq_n_s32(128);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint16x8_t x = vmovl_u8(vld1_u8(src + i));
+        int32x4_t l = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(x)));
+        int32x4_t h = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(x)));
+        vst1q_s32(dest + i, vsubq_s32(l, bias));
+        vst1q_s32(dest + i + 4, vsubq_s32(h, bias));
+    }
+    u8_to_s32_scalar(src + i, dest + i, len - i);
+}
+
+static void minmax_s32_neon(const int32_t *src, size_t len, int32_t *min, int32_t *max) {
+    int32x4_t vmin = vdupq_n_s32(*min);
+    int32x4_t vmax = vdupq_n_s32(*max);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        int32x4_t x = vld1q_s32(src + i);
+        vmin = vminq_s32(vmin, x);
+        vmax = vmaxq_s32(vmax, x);
+    }
+    int32_t lmin[4], lmax[4];
+    vst1q_s32(lmin, vmin);
+    vst1q_s32(lmax, vmax);
+    minmax_s32_scalar(lmin, 4, min, max);
+    minmax_s32_scalar(lmax, 4, min, max);
+    minmax_s32_scalar(src + i, len - i, min, max);
+}
+
+static void center_clip_s32_neon(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down) {
+    const int32x4_t vup = vdupq_n_s32(up);
+    const int32x4_t vdown = vdupq_n_s32(down);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        int32x4_t x = vld1q_s32(in + i);
+        uint32x4_t keep = vorrq_u32(vcgtq_s32(x, vup), vcltq_s32(x, vdown));
+        int32x4_t o = vld1q_s32(out + i);
+        vst1q_s32(out + i, vandq_s32(o, vreinterpretq_s32_u32(keep)));
+    }
+    center_clip_s32_scalar(in + i, out + i, len - i, up, down);
+}
+
+static size_t sign_run_s32_neon(const int32_t *src, size_t len, bool positive) {
+    const int32x4_t zero = vdupq_n_s32(0);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        int32x4_t x = vld1q_s32(src + i);
+        uint32x4_t fail = positive ? vcltq_s32(x, zero) : vcgtq_s32(x, zero);
+        uint32x2_t any = vorr_u32(vget_low_u32(fail), vget_high_u32(fail));
+        if (vget_lane_u32(vpmax_u32(any, any), 0)) {
+            break;
+        }
+    }
+    return i + sign_run_s32_scalar(src + i, len - i, positive);
+}
+
+static const lfdsp_ops_t ops_neon = {
+    LFDSP_NEON, offset_u8_neon, s32_to_u8_neon, u8_to_s32_neon,
+    minmax_s32_neon, center_clip_s32_neon, sign_run_s32_neon
+};
+#endif
+
+//-----------------------------------------------------------------------------
+// dispatch
+//-----------------------------------------------------------------------------
+static const lfdsp_ops_t *lfdsp_ops = NULL;
+
+static const lfdsp_ops_t *ops_for_isa(lfdsp_isa_t isa) {
+    switch (isa) {
+        case LFDSP_AVX2:
+#ifdef LFDSP_HAVE_AVX2
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &ops_avx2 : NULL;
+#else
+            return NULL;
+#endif
+        case LFDSP_SSE2:
+#ifdef LFDSP_HAVE_SSE2
+            return &ops_sse2;
+#else
+            return NULL;
+#endif
+        case LFDSP_NEON:
+#ifdef LFDSP_HAVE_NEON
+            return &ops_neon;
+#else
+            return NULL;
+#endif
+        case LFDSP_SCALAR:
+            return &ops_scalar;
+        case LFDSP_AUTO: {
+            const lfdsp_isa_t order[] = { LFDSP_AVX2, LFDSP_SSE2, LFDSP_NEON };
+            for (size_t i = 0; i < ARRAYLEN(order); i++) {
+                const lfdsp_ops_t *ops = ops_for_isa(order[i]);
+                if (ops != NULL) {
+                    return ops;
+                }
+            }
+            return &ops_scalar;
+        }
+    }
+    return NULL;
+}
+
+static const lfdsp_ops_t *get_ops(void) {
+    const lfdsp_ops_t *ops = __atomic_load_n(&lfdsp_ops, __ATOMIC_ACQUIRE);
+    if (ops == NULL) {
+        ops = ops_for_isa(LFDSP_AUTO);
+        __atomic_store_n(&lfdsp_ops, ops, __ATOMIC_RELEASE);
+    }
+    return ops;
+}
+
+bool lfdsp_set_isa(lfdsp_isa_t isa) {
+    const lfdsp_ops_t *ops = ops_for_isa(isa);
+    if (ops == NULL) {
+        return false;
+    }
+    __atomic_store_n(&lfdsp_ops, ops, __ATOMIC_RELEASE);
+    return true;
+}
+
+lfdsp_isa_t lfdsp_get_isa(void) {
+    return get_ops()->isa;
+}
+
+const char *lfdsp_isa_name(lfdsp_isa_t isa) {
+    switch (isa) {
+        case LFDSP_AUTO:
+            return "auto";
+        case LFDSP_SCALAR:
+            return "scalar";
+        case LFDSP_SSE2:
+            return "SSE2";
+        case LFDSP_AVX2:
+            return "AVX2";
+        case LFDSP_NEON:
+            return "NEON";
+    }
+    return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+// kernels
+//-----------------------------------------------------------------------------
+void lfdsp_histogram_u8(const uint8_t *src, size_t len, uint32_t hist[256]) {
+    // four partial histograms, runs of equal samples would otherwise
+    // serialise on the same counter
+    uint32_t part[4][256];
+    memset(part, 0, sizeof(part));
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        part[0][src[i]]++;
+        part[1][src[i + 1]]++;
+        part[2][src[i + 2]]++;
+        part[3][src[i + 3]]++;
+    }
+    for (; i < len; i++) {
+        part[0][src[i]]++;
+    }
+
+    for (int v = 0; v < 256; v++) {
+        hist[v] = part[0][v] + part[1][v] + part[2][v] + part[3][v];
+    }
+}
+
+uint8_t lfdsp_hist_nth(const uint32_t hist[256], size_t nth) {
+    size_t seen = 0;
+    for (int v = 0; v < 256; v++) {
+        seen += hist[v];
+        if (seen > nth) {
+            return v;
+        }
+    }
+    return 255;
+}
+
+void lfdsp_offset_u8(uint8_t *samples, size_t len, int offset) {
+    get_ops()->offset_u8(samples, len, offset);
+}
+
+void lfdsp_s32_to_u8(int32_t *src, uint8_t *dest, size_t len) {
+    get_ops()->s32_to_u8(src, dest, len);
+}
+
+void lfdsp_u8_to_s32(const uint8_t *src, int32_t *dest, size_t len) {
+    get_ops()->u8_to_s32(src, dest, len);
+}
+
+void lfdsp_minmax_s32(const int32_t *src, size_t len, int32_t *min, int32_t *max) {
+    get_ops()->minmax_s32(src, len, min, max);
+}
+
+void lfdsp_center_clip_s32(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down) {
+    get_ops()->center_clip_s32(in, out, len, up, down);
+}
+
+void lfdsp_zero_crossings_s32(int32_t *data, size_t len) {
+    const lfdsp_ops_t *ops = get_ops();
+    int sign = 1;
+    int32_t zc = 0, last_zc = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        // no change in sign, reproduce the previous sample count
+        size_t run = ops->sign_run_s32(data + i, len - i, sign > 0);
+        for (size_t j = 0; j < run; j++) {
+            data[i + j] = last_zc;
+        }
+        zc += run;
+        i += run;
+
+        if (i < len) {
+            // change in sign, reset the sample count
+            sign = -sign;
+            data[i] = last_zc;
+            if (sign > 0) {
+                last_zc = zc;
+                zc = 0;
+            }
+            i++;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// LF sample conditioning kernels for the host side (client, tools).
+// SSE2 / AVX2 / NEON variants, picked at runtime, with a scalar fallback.
+//-----------------------------------------------------------------------------
+
+#ifndef LFDSP_H__
+#define LFDSP_H__
+
+#include "common.h"
+
+typedef enum {
+    LFDSP_AUTO = 0,
+    LFDSP_SCALAR,
+    LFDSP_SSE2,
+    LFDSP_AVX2,
+    LFDSP_NEON,
+} lfdsp_isa_t;
+
+// force a variant (LFDSP_AUTO = best one the CPU supports). Returns false if not available
+bool lfdsp_set_isa(lfdsp_isa_t isa);
+lfdsp_isa_t lfdsp_get_isa(void);
+const char *lfdsp_isa_name(lfdsp_isa_t isa);
+
+// histogram of 8 bit samples, hist is cleared first
+void lfdsp_histogram_u8(const uint8_t *src, size_t len, uint32_t hist[256]);
+// value at index nth of the sorted samples, i.e. what sorting and indexing would give
+uint8_t lfdsp_hist_nth(const uint32_t hist[256], size_t nth);
+
+// samples - offset, saturated to 0..255
+void lfdsp_offset_u8(uint8_t *samples, size_t len, int offset);
+
+// graph <-> 8 bit samples. to_u8 clamps the graph to -127..127 in place, like getFromGraphBuffer always did
+void lfdsp_s32_to_u8(int32_t *src, uint8_t *dest, size_t len);
+void lfdsp_u8_to_s32(const uint8_t *src, int32_t *dest, size_t len);
+
+void lfdsp_minmax_s32(const int32_t *src, size_t len, int32_t *min, int32_t *max);
+
+// out[i] = 0 where down <= in[i] <= up
+void lfdsp_center_clip_s32(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down);
+
+// replace each sample by the length of the previous full period, see `data zerocrossings`
+void lfdsp_zero_crossings_s32(int32_t *data, size_t len);
+
+#endif
@@ -57,6 +57,10 @@
  * Comment to disable the use of assembly code.
  */
 //#define MBEDTLS_HAVE_ASM
+// Proxmark3: only on x86-64 hosts, for MBEDTLS_AESNI_C. The firmware shares this file.
+#if !defined(ON_DEVICE) && defined(__GNUC__) && (defined(__amd64__) || defined(__x86_64__))
+#define MBEDTLS_HAVE_ASM
+#endif
 
 /**
  * \def MBEDTLS_NO_UDBL_DIVISION
@@ -2275,6 +2279,10 @@
  * This modules adds support for the AES-NI instructions on x86-64
  */
 //#define MBEDTLS_AESNI_C
+// Proxmark3: picked at runtime, the table code is still used on CPUs without AES-NI
+#if defined(MBEDTLS_HAVE_ASM)
+#define MBEDTLS_AESNI_C
+#endif
 
 /**
  * \def MBEDTLS_AES_C
@@ -243,10 +243,46 @@ typedef struct {
     bool hw_available_flash : 1;
     bool hw_available_smartcard : 1;
     bool is_rdv4 : 1;
+
+    // comms
+    bool bulk_download : 1;
 } PACKED capabilities_t;
-#define CAPABILITIES_VERSION 7
+#define CAPABILITIES_VERSION 8
 extern capabilities_t g_pm3_capabilities;
 
+// For CMD_DOWNLOAD_BULK
+// Memory is streamed as raw windows, each followed by two bytes: CRC_14443_A of the window when the link
+// uses CRC (same rule as NG replies), RESPONSENG_POSTAMBLE_MAGIC otherwise.
+// The device announces the transfer with a download_bulk_hdr_t reply and then sends one window per
+// CMD_DOWNLOAD_BULK_ACK, starting at the requested offset. This allows to resume / resend a window.
+// An offset >= len ends the transfer, the device answers with CMD_DOWNLOAD_BULK_ACK and the final status.
+#define DOWNLOAD_BULK_BIGBUF            0
+#define DOWNLOAD_BULK_EML               1
+#define DOWNLOAD_BULK_SPIFFS            2
+
+#define DOWNLOAD_BULK_WINDOW_DEFAULT    8192
+#define DOWNLOAD_BULK_WINDOW_MAX        32768
+#define DOWNLOAD_BULK_ACK_TIMEOUT_MS    2000
+
+typedef struct {
+    uint8_t source;
+    uint32_t start;         // start index in source memory
+    uint32_t len;           // bytes to transfer
+    uint32_t window;        // bytes per window, 0 = default
+    uint8_t filename[32];   // spiffs only
+} PACKED download_bulk_t;
+
+typedef struct {
+    uint32_t len;           // bytes which will be streamed, clipped to the source size
+    uint32_t tracelen;      // BigBuf tracelen
+    uint32_t window;
+} PACKED download_bulk_hdr_t;
+
+typedef struct {
+    uint32_t offset;        // first byte of the requested window
+    uint8_t abort;
+} PACKED download_bulk_ack_t;
+
 typedef struct {
     uint16_t stabilize_ms;
     uint16_t measure_us;
@@ -532,6 +568,8 @@ typedef struct {
 #define CMD_BREAK_LOOP 0x0118
 #define CMD_SET_TEAROFF 0x0119
 #define CMD_SET_HF_FIELD_TIMEOUT 0x011A
+#define CMD_DOWNLOAD_BULK 0x011B
+#define CMD_DOWNLOAD_BULK_ACK 0x011C
 #define CMD_GET_DBGMODE 0x0120
 
 // RDV40, Flash memory operations
@@ -0,0 +1,348 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Micro benchmark of the LF sample conditioning kernels (common/lfdsp.c)
+// against the plain loops they replaced. Every variant is checked against
+// the reference output, exit code is 1 on any mismatch.
+//
+//   lfdsp_bench [samples] [rounds]
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lfdsp.h"
+
+// same as MAX_GRAPH_TRACE_LEN in the client
+#define DEFAULT_SAMPLES (40000 * 8)
+#define DEFAULT_ROUNDS  100
+
+// keeps the compiler from folding the repeated rounds of a kernel into one
+static inline void clobber(void *p) {
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//-----------------------------------------------------------------------------
+// the loops as they were in lfdemod.c / graph.c / cmddata.c
+//-----------------------------------------------------------------------------
+static int cmp_uint8(const void *a, const void *b) {
+    if (*(const uint8_t *)a < * (const uint8_t *)b)
+        return -1;
+    else
+        return *(const uint8_t *)a > *(const uint8_t *)b;
+}
+
+static void ref_percentiles(const uint8_t *samples, size_t len, uint8_t *lo, uint8_t *hi) {
+    uint8_t *tmp = malloc(len);
+    memcpy(tmp, samples, len);
+    qsort(tmp, len, sizeof(uint8_t), cmp_uint8);
+    *lo = 0.5 * (tmp[(int)(len * 0.1)] + tmp[(int)((len - 1) * 0.1)]);
+    *hi = 0.5 * (tmp[(int)(len * 0.9)] + tmp[(int)((len - 1) * 0.9)]);
+    free(tmp);
+}
+
+static void ref_offset(uint8_t *samples, size_t len, int offset) {
+    for (size_t i = 0; i < len; i++) {
+        if (offset > 0) {
+            samples[i] = (samples[i] >= offset) ? samples[i] - offset : 0;
+        }
+        if (offset < 0) {
+            samples[i] = (255 - samples[i] >= -offset) ? samples[i] - offset : 255;
+        }
+    }
+}
+
+static void ref_to_u8(int32_t *src, uint8_t *dest, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (src[i] > 127) {
+            src[i] = 127;
+        }
+        if (src[i] < -127) {
+            src[i] = -127;
+        }
+        dest[i] = (uint8_t)(src[i] + 128);
+    }
+}
+
+static void ref_to_s32(const uint8_t *src, int32_t *dest, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dest[i] = src[i] - 128;
+    }
+}
+
+static void ref_minmax(const int32_t *src, size_t len, int32_t *min, int32_t *max) {
+    for (size_t i = 0; i < len; ++i) {
+        if (src[i] > *max) *max = src[i];
+        if (src[i] < *min) *min = src[i];
+    }
+}
+
+static void ref_center_clip(const int32_t *in, int32_t *out, size_t len, int32_t up, int32_t down) {
+    for (size_t i = 0; i < len; ++i) {
+        if ((in[i] <= up) && (in[i] >= down)) {
+            out[i] = 0;
+        }
+    }
+}
+
+static void ref_zero_crossings(int32_t *data, size_t len) {
+    int sign = 1, zc = 0, lastZc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (data[i] * sign >= 0) {
+            zc++;
+            data[i] = lastZc;
+        } else {
+            sign = -sign;
+            data[i] = lastZc;
+            if (sign > 0) {
+                lastZc = zc;
+                zc = 0;
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+typedef struct {
+    size_t len;
+    uint8_t *u8;        // 8 bit samples, like the device sends them
+    int32_t *s32;       // graph, with some values outside -127..127
+    int32_t *ref;
+    int32_t *out;
+    uint8_t *u8ref;
+    uint8_t *u8out;
+} bench_data_t;
+
+static int errors = 0;
+
+static void check(const char *kernel, const char *isa, int ok) {
+    if (ok == 0) {
+        printf("[!] %s / %s: result differs from the reference\n", kernel, isa);
+        errors++;
+    }
+}
+
+static void report(const char *kernel, const char *isa, double ms, double ref_ms, size_t samples) {
+    printf("    %-14s %-7s %9.1f Msamples/s   x%.2f\n", kernel, isa, samples / (ms * 1000.0), ref_ms / ms);
+}
+
+// synthetic ASK-ish signal: square wave, ringing, DC offset and noise
+static void make_signal(bench_data_t *d) {
+    uint32_t seed = 0x1234567;
+    for (size_t i = 0; i < d->len; i++) {
+        seed = seed * 1103515245 + 12345;
+        int noise = (int)((seed >> 16) & 0x1f) - 16;
+        int v = (((i / 32) & 1) ? 90 : -70) + ((i % 32) < 4 ? 40 : 0) + 12 + noise;
+        d->s32[i] = v * 3 / 2;
+        d->u8[i] = (uint8_t)MAX(0, MIN(255, v + 128));
+    }
+}
+
+static void bench_isa(bench_data_t *d, lfdsp_isa_t isa, int rounds, double *ref_ms) {
+    const char *name = lfdsp_isa_name(isa);
+    size_t len = d->len;
+    size_t total = len * rounds;
+    // the reference loops are timed on the first pass only, later passes just check
+    int rr = (ref_ms[0] == 0) ? rounds : 1;
+    double t;
+
+    // percentiles
+    uint8_t rlo = 0, rhi = 0;
+    t = now_ms();
+    for (int r = 0; r < rr; r++) {
+        ref_percentiles(d->u8, len, &rlo, &rhi);
+        clobber(d);
+    }
+    if (ref_ms[0] == 0) ref_ms[0] = now_ms() - t;
+
+    uint8_t lo = 0, hi = 0;
+    uint32_t hist[256];
+    t = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        lfdsp_histogram_u8(d->u8, len, hist);
+        lo = 0.5 * (lfdsp_hist_nth(hist, (int)(len * 0.1)) + lfdsp_hist_nth(hist, (int)((len - 1) * 0.1)));
+        hi = 0.5 * (lfdsp_hist_nth(hist, (int)(len * 0.9)) + lfdsp_hist_nth(hist, (int)((len - 1) * 0.9)));
+        clobber(d);
+    }
+    report("percentiles", name, now_ms() - t, ref_ms[0], total);
+    check("percentiles", name, lo == rlo && hi == rhi);
+
+    // offset, both directions
+    const int offsets[] = { 37, -53 };
+    for (int o = 0; o < 2; o++) {
+        memcpy(d->u8ref, d->u8, len);
+        t = now_ms();
+        for (int r = 0; r < rounds; r++) {
+            ref_offset(d->u8ref, len, r & 1 ? -offsets[o] : offsets[o]);
+            clobber(d);
+        }
+        if (ref_ms[1] == 0) ref_ms[1] = now_ms() - t;
+
+        memcpy(d->u8out, d->u8, len);
+        t = now_ms();
+        for (int r = 0; r < rounds; r++) {
+            lfdsp_offset_u8(d->u8out, len, r & 1 ? -offsets[o] : offsets[o]);
+            clobber(d);
+        }
+        if (o == 0) report("offset_u8", name, now_ms() - t, ref_ms[1], total);
+        check("offset_u8", name, memcmp(d->u8ref, d->u8out, len) == 0);
+    }
+
+    // graph -> samples
+    memcpy(d->ref, d->s32, len * sizeof(int32_t));
+    t = now_ms();
+    for (int r = 0; r < rr; r++) {
+        ref_to_u8(d->ref, d->u8ref, len);
+        clobber(d);
+    }
+    if (ref_ms[2] == 0) ref_ms[2] = now_ms() - t;
+    memcpy(d->out, d->s32, len * sizeof(int32_t));
+    t = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        lfdsp_s32_to_u8(d->out, d->u8out, len);
+        clobber(d);
+    }
+    report("s32_to_u8", name, now_ms() - t, ref_ms[2], total);
+    check("s32_to_u8", name, memcmp(d->u8ref, d->u8out, len) == 0 && memcmp(d->ref, d->out, len * sizeof(int32_t)) == 0);
+
+    // samples -> graph
+    t = now_ms();
+    for (int r = 0; r < rr; r++) {
+        ref_to_s32(d->u8, d->ref, len);
+        clobber(d);
+    }
+    if (ref_ms[3] == 0) ref_ms[3] = now_ms() - t;
+    t = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        lfdsp_u8_to_s32(d->u8, d->out, len);
+        clobber(d);
+    }
+    report("u8_to_s32", name, now_ms() - t, ref_ms[3], total);
+    check("u8_to_s32", name, memcmp(d->ref, d->out, len * sizeof(int32_t)) == 0);
+
+    // min / max
+    int32_t rmin = INT32_MAX, rmax = INT32_MIN;
+    t = now_ms();
+    for (int r = 0; r < rr; r++) {
+        rmin = INT32_MAX;
+        rmax = INT32_MIN;
+        ref_minmax(d->s32, len, &rmin, &rmax);
+        clobber(&rmin);
+        clobber(&rmax);
+    }
+    if (ref_ms[4] == 0) ref_ms[4] = now_ms() - t;
+    int32_t min = INT32_MAX, max = INT32_MIN;
+    t = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        min = INT32_MAX;
+        max = INT32_MIN;
+        lfdsp_minmax_s32(d->s32, len, &min, &max);
+        clobber(&min);
+        clobber(&max);
+    }
+    report("minmax_s32", name, now_ms() - t, ref_ms[4], total);
+    check("minmax_s32", name, min == rmin && max == rmax);
+
+    // center threshold
+    memcpy(d->ref, d->s32, len * sizeof(int32_t));
+    t = now_ms();
+    for (int r = 0; r < rr; r++) {
+        ref_center_clip(d->s32, d->ref, len, 20, -20);
+        clobber(d);
+    }
+    if (ref_ms[5] == 0) ref_ms[5] = now_ms() - t;
+    memcpy(d->out, d->s32, len * sizeof(int32_t));
+    t = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        lfdsp_center_clip_s32(d->s32, d->out, len, 20, -20);
+        clobber(d);
+    }
+    report("center_clip", name, now_ms() - t, ref_ms[5], total);
+    check("center_clip", name, memcmp(d->ref, d->out, len * sizeof(int32_t)) == 0);
+
+    // zero crossings, destroys its input so the copy is part of both timings
+    t = now_ms();
+    for (int r = 0; r < rr; r++) {
+        memcpy(d->ref, d->s32, len * sizeof(int32_t));
+        ref_zero_crossings(d->ref, len);
+        clobber(d);
+    }
+    if (ref_ms[6] == 0) ref_ms[6] = now_ms() - t;
+    t = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        memcpy(d->out, d->s32, len * sizeof(int32_t));
+        lfdsp_zero_crossings_s32(d->out, len);
+        clobber(d);
+    }
+    report("zero_crossings", name, now_ms() - t, ref_ms[6], total);
+    check("zero_crossings", name, memcmp(d->ref, d->out, len * sizeof(int32_t)) == 0);
+}
+
+int main(int argc, char *argv[]) {
+    bench_data_t d;
+    d.len = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_SAMPLES;
+    int rounds = (argc > 2) ? atoi(argv[2]) : DEFAULT_ROUNDS;
+    if (d.len < 16 || rounds < 1) {
+        printf("usage: %s [samples >= 16] [rounds >= 1]\n", argv[0]);
+        return 2;
+    }
+
+    d.u8 = malloc(d.len);
+    d.u8ref = malloc(d.len);
+    d.u8out = malloc(d.len);
+    d.s32 = malloc(d.len * sizeof(int32_t));
+    d.ref = malloc(d.len * sizeof(int32_t));
+    d.out = malloc(d.len * sizeof(int32_t));
+    if (!d.u8 || !d.u8ref || !d.u8out || !d.s32 || !d.ref || !d.out) {
+        printf("[!] out of memory\n");
+        return 2;
+    }
+    make_signal(&d);
+
+    printf("[=] %zu samples x %d rounds, auto selects %s\n", d.len, rounds, lfdsp_isa_name(lfdsp_get_isa()));
+    printf("    kernel         isa      throughput         vs reference loop\n");
+
+    // reference timings are taken once, on the first pass
+    double ref_ms[7] = {0};
+    const lfdsp_isa_t isas[] = { LFDSP_SCALAR, LFDSP_SSE2, LFDSP_AVX2, LFDSP_NEON };
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+        if (lfdsp_set_isa(isas[i]) == false) {
+            printf("    %s not available\n", lfdsp_isa_name(isas[i]));
+            continue;
+        }
+        bench_isa(&d, isas[i], rounds, ref_ms);
+    }
+
+    free(d.u8);
+    free(d.u8ref);
+    free(d.u8out);
+    free(d.s32);
+    free(d.ref);
+    free(d.out);
+
+    if (errors) {
+        printf("[!] %d mismatches\n", errors);
+        return 1;
+    }
+    printf("[+] all kernels match the reference\n");
+    return 0;
+}
@@ -28,6 +28,7 @@ TESTMFNONCEBRUTE=false
 TESTMFDAESBRUTE=false
 TESTMFULCDESBRUTE=false
 TESTHITAG2CRACK=false
+TESTPM3VIRTUAL=false
 TESTCRYPTORF=false
 TESTFPGACOMPRESS=false
 TESTBOOTROM=false
@@ -42,7 +43,7 @@ while (( "$#" )); do
   case "$1" in
     -h|--help)
       echo """
-Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|mf_nonce_brute|staticnested|mfd_aes_brute|mfulc_des_brute|cryptorf|fpga_compress|bootrom|armsrc|client|recovery|common]
+Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|mf_nonce_brute|staticnested|mfd_aes_brute|mfulc_des_brute|cryptorf|fpga_compress|pm3_virtual|bootrom|armsrc|client|recovery|common]
     --long:          Enable slow tests
     --opencl:        Enable tests requiring OpenCL (preferably a Nvidia GPU)
     --clientbin ...: Specify path to proxmark3 binary to test
@@ -112,6 +113,11 @@ Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|
       TESTHITAG2CRACK=true
       shift
       ;;
+    pm3_virtual)
+      TESTALL=false
+      TESTPM3VIRTUAL=true
+      shift
+      ;;
     bootrom)
       TESTALL=false
       TESTBOOTROM=true
@@ -433,6 +439,28 @@ while true; do
       # Order of magnitude to crack it: ~15s -> tagged as "slow"
       if ! CheckExecute slow opencl "ht2crack5opencl test"     "cd $HT2CRACK5OPENCLPATH; ./ht2crack5opencl $HT2CRACK5OPENCLUID $HT2CRACK5OPENCLNRAR" "Key found.*$HT2CRACK5OPENCLKEY"; then break; fi
     fi
+    # pm3_virtual not part of "all" either, it needs a built client
+    if $TESTPM3VIRTUAL; then
+      echo -e "\n${C_BLUE}Testing pm3_virtual:${C_NC} ${PM3VIRTUALBIN:=./tools/pm3_virtual/pm3_virtual} ${CLIENTBIN:=./client/proxmark3}"
+      if ! CheckFileExist "pm3_virtual exists"             "$PM3VIRTUALBIN"; then break; fi
+      if ! CheckFileExist "proxmark3 exists"               "$CLIENTBIN"; then break; fi
+      PM3VIRTUALPORT=18889
+      $PM3VIRTUALBIN -p $PM3VIRTUALPORT -s 1 > /dev/null 2>&1 &
+      PM3VIRTUALPID=$!
+      sleep 1
+      PM3VIRTUALCLIENT="$CLIENTBIN --incognito -p tcp:127.0.0.1:$PM3VIRTUALPORT"
+      PM3VIRTUALOK=false
+      while true; do
+        if ! CheckExecute "pm3_virtual hw ping"            "$PM3VIRTUALCLIENT -c 'hw ping'" "Ping response received"; then break; fi
+        if ! CheckExecute "pm3_virtual hf 14a reader"      "$PM3VIRTUALCLIENT -c 'hf 14a reader'" "UID:"; then break; fi
+        if ! CheckExecute "pm3_virtual hf mf fchk"         "$PM3VIRTUALCLIENT -c 'hf mf fchk --1k'" "015 \| 063 \| [0-9A-F]{12} \| 1 \| [0-9A-F]{12} \| 1"; then break; fi
+        PM3VIRTUALOK=true
+        break
+      done
+      kill $PM3VIRTUALPID 2> /dev/null
+      wait $PM3VIRTUALPID 2> /dev/null
+      if ! $PM3VIRTUALOK; then break; fi
+    fi
     if $TESTALL || $TESTCLIENT; then
       echo -e "\n${C_BLUE}Testing client:${C_NC} ${CLIENTBIN:=./client/proxmark3}"
       if ! CheckFileExist "proxmark3 exists"               "$CLIENTBIN"; then break; fi
@@ -472,8 +500,10 @@ while true; do
       if ! CheckExecute "mfu keygen test"         "$CLIENTBIN -c 'hf mfu keygen --uid 11223344556677'" "80 B1 C2 71 D8 A0"; then break; fi
       if ! CheckExecute "jooki encode test"       "$CLIENTBIN -c 'hf jooki encode --test'" "04 28 F4 DA F0 4A 81  \( ok \)"; then break; fi
       if ! CheckExecute "analyse regex selftest"  "$CLIENTBIN -c 'analyse regex --test'" "Tests \( ok \)"; then break; fi
+      if ! CheckExecute "analyse crc bench"       "$CLIENTBIN -c 'analyse crc --bench'" "Tests \( ok \)"; then break; fi
       if ! CheckExecute "trace load/list 14a"     "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a;'" "READBLOCK\(8\)"; then break; fi
       if ! CheckExecute "trace load/list x"       "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -x1 -t 14a;'" "0.0101840425"; then break; fi
+      if ! CheckExecute "trace save/load v2"      "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace save -f /tmp/pm3_tests_trace -t 14a; trace load -f /tmp/pm3_tests_trace.trace; trace list -1;' | grep -A100 'Trace file v2'; rm -f /tmp/pm3_tests_trace.trace" "READBLOCK\(8\)"; then break; fi
       if ! CheckExecute "nfc decode test - oob"          "$CLIENTBIN -c 'nfc decode -d DA2010016170706C69636174696F6E2F766E642E626C7565746F6F74682E65702E6F6F62301000649201B96DFB0709466C65782032'" "Flex 2"; then break; fi
       if ! CheckExecute "nfc decode test - device info"  "$CLIENTBIN -c 'nfc decode -d d1025744690004536f6e79010752432d533338300220426c61636b204e46432052656164657220636f6e6e656374656420746f2050430310123e4567e89b12d3a45642665544000004124e464320506f72742d3130302076312e3032'" "NFC Port-100 v1.02"; then break; fi
       if ! CheckExecute "nfc decode test - vcard"        "$CLIENTBIN -c 'nfc decode -d d20ca3746578742f782d7643617264424547494e3a56434152440a56455253494f4e3a332e300a4e3a43687269733b4963656d616e3b3b3b0a464e3a476f7468656e627572670a5245563a323032312d30362d32345432303a31353a30385a0a6974656d322e582d4142444154453b747970653d707265663a323032302d30362d32340a4954454d322e582d41424c4142454c3a5f24213c416e6e69766572736172793e21245f0a454e443a56434152440a'" "END:VCARD"; then break; fi
@@ -630,7 +660,12 @@ while true; do
       if ! CheckExecute slow "emv long test"               "$CLIENTBIN -c 'emv test -l'" "Tests \( ok"; then break; fi
       if ! CheckExecute "hf iclass lookup test"            "$CLIENTBIN -c 'hf iclass lookup --csn 9655a400f8ff12e0 --epurse f0ffffffffffffff --macs 0000000089cb984b -f $DICPATH/iclass_default_keys.dic'" \
                                                                 "valid key AEA684A6DAB23278"; then break; fi
+      if ! CheckExecute "data dict compile round trip"   "cp $DICPATH/iclass_default_keys.dic /tmp/pm3_tests_dict.dic && $CLIENTBIN -c 'data dict compile -f /tmp/pm3_tests_dict.dic --keylen 8; hf iclass lookup --csn 9655a400f8ff12e0 --epurse f0ffffffffffffff --macs 0000000089cb984b -f /tmp/pm3_tests_dict.dic' | grep -A10 'compiled dictionary file'; rm -f /tmp/pm3_tests_dict.dic*" \
+                                                                "valid key AEA684A6DAB23278"; then break; fi
+      if ! CheckExecute "hf sig recovery test"           "printf '04E10CDA993C80,8B76052EE42F5567BEB53238B3E3F9950707C0DCC956B5C5EFCFDB709B2D82B3\n04DB0BDA993C80,6048EFD9417CD10F6B7F1818D471A7FE5B46868D2EABDC6307A1E0AAE139D8D0\n' > /tmp/pm3_tests_sig.csv && $CLIENTBIN -c 'hf sig -f /tmp/pm3_tests_sig.csv'; rm -f /tmp/pm3_tests_sig.csv" \
+                                                                "Verified 2 / 2, failed 0"; then break; fi
       if ! CheckExecute "hf iclass loclass test"         "$CLIENTBIN -c 'hf iclass loclass --test'" "Key diversification \( ok \)"; then break; fi
+      if ! CheckExecute "hf iclass loclass engine test"  "$CLIENTBIN -c 'hf iclass loclass --test'" "bitslice engine \( ok \)"; then break; fi
       if ! CheckExecute "emv test"                       "$CLIENTBIN -c 'emv test'" "Tests \( ok"; then break; fi
       if ! CheckExecute "hf cipurse test"                "$CLIENTBIN -c 'hf cipurse test'" "Tests \( ok"; then break; fi
       if ! CheckExecute "hf mfdes test"                  "$CLIENTBIN -c 'hf mfdes test'"   "Tests \( ok"; then break; fi
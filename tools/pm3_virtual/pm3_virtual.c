@@ -0,0 +1,1312 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Virtual Proxmark3
+//
+// Speaks the NG / MIX / OLD frame protocol over TCP, like a device behind
+// `tcp:` would, so the client can be exercised and benchmarked without
+// hardware:  ./pm3 -p tcp:localhost
+//
+// The handlers mirror the reply shapes of armsrc/appmain.c and friends.
+// Behind them sits a deterministic tag model, a MIFARE Classic 1K or a
+// MIFARE Ultralight EV1, generated from a seed, and a BigBuf filled with
+// a synthetic ISO14443-A trace.
+//-----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "common.h"
+#include "pm3_cmd.h"
+#include "mifare.h"
+#include "protocols.h"
+#include "ansi.h"
+#include "crc16.h"
+#include "commonutil.h"
+
+#define VPM3_DEFAULT_PORT       "18888"
+#define VPM3_DEFAULT_BIGBUF     40000
+#define VPM3_CHIP_ID            0x270B0A40  // AT91SAM7S512 Rev A
+#define VPM3_SPEED_TEST_MS      500         // CONN_SPEED_TEST_MIN_TIME_DEFAULT
+
+#define CARD_MEMORY_SIZE        4096
+#define MFC_BLOCKS              64
+#define MFC_SECTORS             16
+#define MFC_BLOCK_SIZE          16
+#define MFC_KEY_SIZE            6
+#define MFU_PAGES               41          // MF0UL21
+#define MFU_PAGE_SIZE           4
+
+typedef enum {
+    TAG_MFC,
+    TAG_MFU,
+} tag_type_t;
+
+// session and settings
+static int s_sock = -1;
+static uint8_t s_rx[4096];
+static size_t s_rx_len = 0;
+static size_t s_rx_pos = 0;
+static bool s_reply_with_crc = false;
+static uint32_t s_latency_us = 0;
+static uint32_t s_auth_us = 0;
+static bool s_verbose = false;
+static tag_type_t s_tag = TAG_MFC;
+static uint8_t s_dbglevel = DBG_ERROR;
+
+// per connection statistics
+static uint32_t s_cmds = 0;
+static uint64_t s_bytes_out = 0;
+
+// device memory
+static uint8_t *s_bigbuf = NULL;
+static uint32_t s_bigbuf_size = VPM3_DEFAULT_BIGBUF;
+static uint32_t s_tracelen = 0;
+static uint32_t s_tracelimit = 0;
+static uint8_t s_eml[CARD_MEMORY_SIZE];
+
+// tag models
+static uint64_t s_seed = 0;
+static uint8_t s_dump[MFC_BLOCKS * MFC_BLOCK_SIZE];
+static bool s_have_dump = false;
+static uint8_t s_mfc[MFC_BLOCKS * MFC_BLOCK_SIZE];
+static uint8_t s_mfu[MFU_PAGES * MFU_PAGE_SIZE];
+static uint8_t s_uid[10];
+static uint8_t s_uidlen = 4;
+
+// keys found in the default key list of the client and in mfc_default_keys.dic,
+// so `hf mf chk` and `hf mf fchk` find all of them without a dictionary
+static const uint64_t s_default_keys[] = {
+    0xFFFFFFFFFFFF,
+    0xA0A1A2A3A4A5,
+    0xB0B1B2B3B4B5,
+    0x89ECA97F8C2A,
+    0xD3F7D3F7D3F7,
+    0x4B791BEA7BCC,
+    0x5C8FF9990DA2,
+    0xD01AFEEB890A,
+};
+
+static uint64_t s_prng_state = 0;
+
+// splitmix64, good enough for test data and fully reproducible
+static uint64_t prng_next(void) {
+    uint64_t z = (s_prng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void prng_fill(uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = prng_next() & 0xFF;
+    }
+}
+
+static void sleep_us(uint32_t us) {
+    if (us == 0) {
+        return;
+    }
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+static uint64_t msclock(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec * 1000) + (t.tv_nsec / 1000000);
+}
+
+//-----------------------------------------------------------------------------
+// Tag models
+//-----------------------------------------------------------------------------
+static bool mfc_is_trailer(uint16_t blockno) {
+    if (blockno < 128) {
+        return ((blockno & 0x03) == 0x03);
+    }
+    return ((blockno & 0x0F) == 0x0F);
+}
+
+static uint8_t mfc_trailer_of(uint8_t blockno) {
+    return blockno | 0x03;
+}
+
+static uint64_t mfc_get_key(uint8_t blockno, uint8_t keytype) {
+    const uint8_t *trailer = s_mfc + (mfc_trailer_of(blockno) * MFC_BLOCK_SIZE);
+    return bytes_to_num(trailer + ((keytype & 1) ? 10 : 0), MFC_KEY_SIZE);
+}
+
+// one authentication attempt, costs the configured time like on the air
+static bool mfc_auth(uint8_t blockno, uint8_t keytype, uint64_t key) {
+    sleep_us(s_auth_us);
+    if (s_tag != TAG_MFC || blockno >= MFC_BLOCKS) {
+        return false;
+    }
+    return mfc_get_key(blockno, keytype) == key;
+}
+
+static void mfc_init(void) {
+    s_uidlen = 4;
+    prng_fill(s_uid, 4);
+    s_uid[0] &= 0xF7;   // keep clear of the cascade tag
+
+    uint8_t *b0 = s_mfc;
+    memcpy(b0, s_uid, 4);
+    b0[4] = s_uid[0] ^ s_uid[1] ^ s_uid[2] ^ s_uid[3];
+    b0[5] = 0x08;
+    b0[6] = 0x04;
+    b0[7] = 0x00;
+    prng_fill(b0 + 8, 8);
+
+    for (uint8_t blk = 1; blk < MFC_BLOCKS; blk++) {
+        uint8_t *d = s_mfc + (blk * MFC_BLOCK_SIZE);
+        if (mfc_is_trailer(blk) == false) {
+            prng_fill(d, MFC_BLOCK_SIZE);
+            continue;
+        }
+        num_to_bytes(s_default_keys[prng_next() % ARRAYLEN(s_default_keys)], MFC_KEY_SIZE, d);
+        d[6] = 0xFF;
+        d[7] = 0x07;
+        d[8] = 0x80;
+        d[9] = 0x69;
+        num_to_bytes(s_default_keys[prng_next() % ARRAYLEN(s_default_keys)], MFC_KEY_SIZE, d + 10);
+    }
+}
+
+static void mfu_init(void) {
+    s_uidlen = 7;
+    s_uid[0] = 0x04;    // NXP
+    prng_fill(s_uid + 1, 6);
+
+    memset(s_mfu, 0, sizeof(s_mfu));
+    memcpy(s_mfu, s_uid, 3);
+    s_mfu[3] = 0x88 ^ s_uid[0] ^ s_uid[1] ^ s_uid[2];
+    memcpy(s_mfu + 4, s_uid + 3, 4);
+    s_mfu[8] = s_uid[3] ^ s_uid[4] ^ s_uid[5] ^ s_uid[6];
+    s_mfu[9] = 0x48;
+    // user memory, pages 4..35
+    prng_fill(s_mfu + (4 * MFU_PAGE_SIZE), 32 * MFU_PAGE_SIZE);
+    // CFG0 / CFG1, no password protection
+    s_mfu[(37 * MFU_PAGE_SIZE) + 3] = 0xFF;
+}
+
+// READ returns four pages and rolls over at the end of memory
+static void mfu_read(uint8_t page, uint8_t *out) {
+    memset(out, 0, MFU_PAGE_SIZE * 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t p = (page + i) % MFU_PAGES;
+        // PWD and PACK read back as zeros
+        if (p < 39) {
+            memcpy(out + (i * MFU_PAGE_SIZE), s_mfu + (p * MFU_PAGE_SIZE), MFU_PAGE_SIZE);
+        }
+    }
+}
+
+// emulator memory after `hf mf eclr`, zeros and transport configuration trailers
+static void eml_clear(void) {
+    memset(s_eml, 0, sizeof(s_eml));
+    uint8_t trailer[MFC_BLOCK_SIZE] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+    };
+    for (uint16_t blk = 0; blk < (CARD_MEMORY_SIZE / MFC_BLOCK_SIZE); blk++) {
+        if (mfc_is_trailer(blk)) {
+            memcpy(s_eml + (blk * MFC_BLOCK_SIZE), trailer, sizeof(trailer));
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Synthetic trace
+//-----------------------------------------------------------------------------
+static uint32_t s_trace_ts = 0;
+
+static bool trace_log(const uint8_t *frame, uint16_t len, bool response, uint32_t limit) {
+    uint16_t parlen = (len + 7) / 8;
+    uint32_t need = sizeof(tracelog_hdr_t) + len + parlen;
+    if (s_tracelen + need > limit) {
+        return false;
+    }
+
+    tracelog_hdr_t *hdr = (tracelog_hdr_t *)(s_bigbuf + s_tracelen);
+    // 14a timings are in carrier cycles, one byte with parity is 9 * 128 of them
+    uint16_t duration = len * 9 * 128;
+    hdr->timestamp = s_trace_ts;
+    hdr->duration = duration;
+    hdr->data_len = len;
+    hdr->isResponse = response;
+    memcpy(hdr->frame, frame, len);
+
+    uint8_t *par = hdr->frame + len;
+    memset(par, 0, parlen);
+    for (uint16_t i = 0; i < len; i++) {
+        if (__builtin_parity(frame[i]) == 0) {
+            par[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+
+    s_tracelen += need;
+    s_trace_ts += duration + 1236 + (prng_next() & 0x3FF);
+    return true;
+}
+
+static bool trace_log_crc(uint8_t *frame, uint16_t len, bool response, uint32_t limit) {
+    compute_crc(CRC_14443_A, frame, len, frame + len, frame + len + 1);
+    return trace_log(frame, len + 2, response, limit);
+}
+
+// fills the start of BigBuf with read sessions of the modelled tag
+static void trace_init(uint32_t limit) {
+    s_tracelen = 0;
+    s_trace_ts = 0;
+
+    uint8_t f[32];
+    for (uint8_t blk = 0; ; blk = (blk + 1) % MFC_BLOCKS) {
+        f[0] = ISO14443A_CMD_WUPA;
+        if (trace_log(f, 1, false, limit) == false) break;
+        f[0] = 0x04;
+        f[1] = 0x00;
+        if (trace_log(f, 2, true, limit) == false) break;
+        f[0] = ISO14443A_CMD_ANTICOLL_OR_SELECT;
+        f[1] = 0x20;
+        if (trace_log(f, 2, false, limit) == false) break;
+        memcpy(f, s_mfc, 5);
+        if (trace_log(f, 5, true, limit) == false) break;
+        f[0] = ISO14443A_CMD_ANTICOLL_OR_SELECT;
+        f[1] = 0x70;
+        memcpy(f + 2, s_mfc, 5);
+        if (trace_log_crc(f, 7, false, limit) == false) break;
+        f[0] = 0x08;
+        if (trace_log_crc(f, 1, true, limit) == false) break;
+        f[0] = MIFARE_AUTH_KEYA;
+        f[1] = blk;
+        if (trace_log_crc(f, 2, false, limit) == false) break;
+        prng_fill(f, 4);
+        if (trace_log(f, 4, true, limit) == false) break;
+        prng_fill(f, 8);
+        if (trace_log(f, 8, false, limit) == false) break;
+        prng_fill(f, 4);
+        if (trace_log(f, 4, true, limit) == false) break;
+        prng_fill(f, 4);
+        if (trace_log(f, 4, false, limit) == false) break;
+        prng_fill(f, 18);
+        if (trace_log(f, 18, true, limit) == false) break;
+        f[0] = ISO14443A_CMD_HALT;
+        f[1] = 0x00;
+        if (trace_log_crc(f, 2, false, limit) == false) break;
+        s_trace_ts += 100000;
+    }
+}
+
+// device and tag state at power up, identical for every connection
+static void power_on(void) {
+    s_prng_state = s_seed;
+    if (s_have_dump) {
+        memcpy(s_mfc, s_dump, sizeof(s_mfc));
+        s_uidlen = 4;
+        memcpy(s_uid, s_mfc, 4);
+    } else if (s_tag == TAG_MFC) {
+        mfc_init();
+    } else {
+        mfu_init();
+    }
+
+    eml_clear();
+
+    // trace first, the rest of BigBuf is left as noise
+    trace_init(s_tracelimit);
+    prng_fill(s_bigbuf + s_tracelen, s_bigbuf_size - s_tracelen);
+}
+
+//-----------------------------------------------------------------------------
+// Transport
+//-----------------------------------------------------------------------------
+
+// reads exactly len bytes. timeout_ms < 0 blocks.
+static int net_read(uint8_t *dst, size_t len, int timeout_ms) {
+    while (len) {
+        if (s_rx_pos == s_rx_len) {
+            struct pollfd pfd = { .fd = s_sock, .events = POLLIN };
+            int res = poll(&pfd, 1, timeout_ms);
+            if (res == 0) {
+                return PM3_ETIMEOUT;
+            }
+            if (res < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return PM3_EIO;
+            }
+            ssize_t n = recv(s_sock, s_rx, sizeof(s_rx), 0);
+            if (n <= 0) {
+                return PM3_EIO;
+            }
+            s_rx_len = n;
+            s_rx_pos = 0;
+        }
+        size_t n = MIN(len, s_rx_len - s_rx_pos);
+        memcpy(dst, s_rx + s_rx_pos, n);
+        s_rx_pos += n;
+        dst += n;
+        len -= n;
+    }
+    return PM3_SUCCESS;
+}
+
+static int net_write(const void *src, size_t len) {
+    const uint8_t *p = src;
+    while (len) {
+        ssize_t n = send(s_sock, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return PM3_EIO;
+        }
+        p += n;
+        len -= n;
+        s_bytes_out += n;
+    }
+    return PM3_SUCCESS;
+}
+
+// same parsing as receive_ng_internal() in armsrc/cmd.c
+// PM3_EIO means the client is gone, PM3_ESOFT a malformed frame
+static int receive_ng(PacketCommandNG *rx, int timeout_ms) {
+
+    PacketCommandNGRaw rx_raw;
+    int res = net_read((uint8_t *)&rx_raw.pre, sizeof(PacketCommandNGPreamble), timeout_ms);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    rx->magic = rx_raw.pre.magic;
+    rx->ng = rx_raw.pre.ng;
+    rx->cmd = rx_raw.pre.cmd;
+
+    uint16_t length = rx_raw.pre.length;
+
+    if (rx->magic == COMMANDNG_PREAMBLE_MAGIC) {
+        if (length > PM3_CMD_DATA_SIZE) {
+            return PM3_ESOFT;
+        }
+
+        res = net_read(rx_raw.data, length, 1000);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+
+        if (rx->ng) {
+            memcpy(rx->data.asBytes, rx_raw.data, length);
+            rx->length = length;
+        } else {
+            uint64_t arg[3] = {0};
+            if (length < sizeof(arg)) {
+                return PM3_ESOFT;
+            }
+            memcpy(arg, rx_raw.data, sizeof(arg));
+            rx->oldarg[0] = arg[0];
+            rx->oldarg[1] = arg[1];
+            rx->oldarg[2] = arg[2];
+            memcpy(rx->data.asBytes, rx_raw.data + sizeof(arg), length - sizeof(arg));
+            rx->length = length - sizeof(arg);
+        }
+
+        PacketCommandNGPostamble post;
+        res = net_read((uint8_t *)&post, sizeof(post), 1000);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+
+        // Check CRC, accept MAGIC as placeholder
+        rx->crc = post.crc;
+        if (rx->crc != COMMANDNG_POSTAMBLE_MAGIC) {
+            uint8_t first, second;
+            compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, sizeof(PacketCommandNGPreamble) + length, &first, &second);
+            if ((first << 8) + second != rx->crc) {
+                return PM3_ESOFT;
+            }
+        }
+    } else {
+        PacketCommandOLD rx_old;
+        memcpy(&rx_old, &rx_raw.pre, sizeof(PacketCommandNGPreamble));
+        res = net_read(((uint8_t *)&rx_old) + sizeof(PacketCommandNGPreamble), sizeof(PacketCommandOLD) - sizeof(PacketCommandNGPreamble), 1000);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+        rx->ng = false;
+        rx->magic = 0;
+        rx->crc = 0;
+        rx->cmd = (rx_old.cmd & 0xFFFF);
+        rx->oldarg[0] = rx_old.arg[0];
+        rx->oldarg[1] = rx_old.arg[1];
+        rx->oldarg[2] = rx_old.arg[2];
+        rx->length = PM3_CMD_DATA_SIZE;
+        memcpy(&rx->data, &rx_old.d.asBytes, rx->length);
+    }
+    return PM3_SUCCESS;
+}
+
+static int reply_ng_internal(uint16_t cmd, int8_t status, const uint8_t *data, size_t len, bool ng) {
+    PacketResponseNGRaw tx;
+
+    tx.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
+    tx.pre.cmd = cmd;
+    tx.pre.status = status;
+    tx.pre.reason = PM3_REASON_UNKNOWN;
+    tx.pre.ng = ng;
+    if (len > PM3_CMD_DATA_SIZE) {
+        len = PM3_CMD_DATA_SIZE;
+        tx.pre.status = PM3_EOVFLOW;
+    }
+    tx.pre.length = (len & 0x7FFF);
+
+    if (data && len) {
+        memcpy(tx.data, data, len);
+    }
+
+    PacketResponseNGPostamble *post = (PacketResponseNGPostamble *)((uint8_t *)&tx + sizeof(PacketResponseNGPreamble) + len);
+    if (s_reply_with_crc) {
+        uint8_t first, second;
+        compute_crc(CRC_14443_A, (uint8_t *)&tx, sizeof(PacketResponseNGPreamble) + len, &first, &second);
+        post->crc = (first << 8) | second;
+    } else {
+        post->crc = RESPONSENG_POSTAMBLE_MAGIC;
+    }
+    return net_write(&tx, sizeof(PacketResponseNGPreamble) + len + sizeof(PacketResponseNGPostamble));
+}
+
+static int reply_ng(uint16_t cmd, int8_t status, const uint8_t *data, size_t len) {
+    return reply_ng_internal(cmd, status, data, len, true);
+}
+
+static int reply_mix(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    int8_t status = PM3_SUCCESS;
+    uint64_t arg[3] = {arg0, arg1, arg2};
+    if (len > PM3_CMD_DATA_SIZE - sizeof(arg)) {
+        len = PM3_CMD_DATA_SIZE - sizeof(arg);
+        status = PM3_EOVFLOW;
+    }
+    uint8_t cmddata[PM3_CMD_DATA_SIZE];
+    memcpy(cmddata, arg, sizeof(arg));
+    if (len && data) {
+        memcpy(cmddata + sizeof(arg), data, len);
+    }
+    return reply_ng_internal((cmd & 0xFFFF), status, cmddata, len + sizeof(arg), false);
+}
+
+static int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    PacketResponseOLD tx;
+    memset(&tx, 0, sizeof(tx));
+    tx.cmd = cmd;
+    tx.arg[0] = arg0;
+    tx.arg[1] = arg1;
+    tx.arg[2] = arg2;
+    if (data && len) {
+        memcpy(tx.d.asBytes, data, MIN(len, PM3_CMD_DATA_SIZE));
+    }
+    return net_write(&tx, sizeof(tx));
+}
+
+static void Dbprintf(const char *fmt, ...) {
+    struct {
+        uint16_t flag;
+        uint8_t buf[200];
+    } PACKED data;
+    data.flag = FLAG_LOG;
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf((char *)data.buf, sizeof(data.buf), fmt, ap);
+    va_end(ap);
+    len = MIN(MAX(len, 0), (int)sizeof(data.buf) - 1);
+    reply_ng(CMD_DEBUG_PRINT_STRING, PM3_SUCCESS, (uint8_t *)&data, sizeof(data.flag) + len);
+}
+
+//-----------------------------------------------------------------------------
+// Command handlers
+//-----------------------------------------------------------------------------
+static void SendCapabilities(void) {
+    capabilities_t capabilities;
+    memset(&capabilities, 0, sizeof(capabilities));
+    capabilities.version = CAPABILITIES_VERSION;
+    capabilities.baudrate = 0;
+    capabilities.bigbuf_size = s_bigbuf_size;
+    capabilities.via_usb = true;
+    capabilities.compiled_with_iso14443a = true;
+    capabilities.bulk_download = true;
+    reply_ng(CMD_CAPABILITIES, PM3_SUCCESS, (uint8_t *)&capabilities, sizeof(capabilities));
+}
+
+static void SendVersion(void) {
+    struct p {
+        uint32_t id;
+        uint32_t section_size;
+        uint32_t versionstr_len;
+        char versionstr[PM3_CMD_DATA_SIZE - 12];
+    } PACKED payload;
+
+    payload.id = VPM3_CHIP_ID;
+    payload.section_size = 0;
+    snprintf(payload.versionstr, sizeof(payload.versionstr),
+             " [ ARM ]\n"
+             "  Bootrom.... virtual\n"
+             "  OS......... virtual pm3 ( %s tag model, %u bytes BigBuf )\n",
+             (s_tag == TAG_MFC) ? "MIFARE Classic 1K" : "MIFARE Ultralight EV1",
+             s_bigbuf_size
+            );
+    payload.versionstr_len = strlen(payload.versionstr) + 1;
+    reply_ng(CMD_VERSION, PM3_SUCCESS, (uint8_t *)&payload, 12 + payload.versionstr_len);
+}
+
+// like printConnSpeed() on the device, floods the client for `wait` ms
+static void SendStatus(uint32_t wait) {
+    Dbprintf(_CYAN_("Memory"));
+    Dbprintf("  BigBuf_size............. %u", s_bigbuf_size);
+    Dbprintf("  BigBuf_hi............... %u", s_bigbuf_size);
+    Dbprintf("  trace len............... %u", s_tracelen);
+    Dbprintf(_CYAN_("Transfer Speed"));
+    Dbprintf("  Sending packets to client...");
+
+    uint64_t start_time = msclock();
+    uint64_t delta_time = 0;
+    uint32_t bytes_transferred = 0;
+    while (delta_time < wait) {
+        if (reply_ng(CMD_DOWNLOADED_BIGBUF, PM3_SUCCESS, s_bigbuf, PM3_CMD_DATA_SIZE) != PM3_SUCCESS) {
+            return;
+        }
+        bytes_transferred += PM3_CMD_DATA_SIZE;
+        delta_time = msclock() - start_time;
+    }
+
+    Dbprintf("  Time elapsed................... %ums", (uint32_t)delta_time);
+    Dbprintf("  Bytes transferred.............. %u", bytes_transferred);
+    if (delta_time) {
+        Dbprintf("  Transfer Speed PM3 -> Client... " _YELLOW_("%llu") " bytes/s", 1000 * (unsigned long long)bytes_transferred / delta_time);
+    }
+    reply_ng(CMD_STATUS, PM3_SUCCESS, NULL, 0);
+}
+
+// same protocol as reply_bulk() in armsrc/cmd.c
+static int reply_bulk(const uint8_t *mem, uint32_t len, uint32_t window) {
+
+    if (window == 0 || window > DOWNLOAD_BULK_WINDOW_MAX) {
+        window = DOWNLOAD_BULK_WINDOW_DEFAULT;
+    }
+
+    download_bulk_hdr_t hdr = {
+        .len = len,
+        .tracelen = s_tracelen,
+        .window = window,
+    };
+    int res = reply_ng(CMD_DOWNLOAD_BULK, PM3_SUCCESS, (uint8_t *)&hdr, sizeof(hdr));
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    for (;;) {
+        PacketCommandNG rx;
+        res = receive_ng(&rx, DOWNLOAD_BULK_ACK_TIMEOUT_MS);
+        if (res == PM3_EIO) {
+            return res;
+        }
+        if (res == PM3_ETIMEOUT) {
+            break;
+        }
+        if (res != PM3_SUCCESS) {
+            continue;
+        }
+
+        if (rx.cmd == CMD_BREAK_LOOP) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        if (rx.cmd != CMD_DOWNLOAD_BULK_ACK || rx.length < sizeof(download_bulk_ack_t)) {
+            continue;
+        }
+
+        const download_bulk_ack_t *ack = (download_bulk_ack_t *)rx.data.asBytes;
+        if (ack->abort) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        if (ack->offset >= len) {
+            res = PM3_SUCCESS;
+            break;
+        }
+
+        uint32_t n = MIN(window, len - ack->offset);
+        uint16_t crc = RESPONSENG_POSTAMBLE_MAGIC;
+        if (s_reply_with_crc) {
+            uint8_t first, second;
+            compute_crc(CRC_14443_A, mem + ack->offset, n, &first, &second);
+            crc = (first << 8) | second;
+        }
+
+        res = net_write(mem + ack->offset, n);
+        if (res == PM3_SUCCESS) {
+            res = net_write(&crc, sizeof(crc));
+        }
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+
+    return reply_ng(CMD_DOWNLOAD_BULK_ACK, res, NULL, 0);
+}
+
+static void ReaderIso14443a(PacketCommandNG *c) {
+    iso14a_command_t param = c->oldarg[0];
+
+    if ((param & ISO14A_CONNECT) && ((param & ISO14A_NO_SELECT) == 0)) {
+        iso14a_card_select_t card;
+        memset(&card, 0, sizeof(card));
+        memcpy(card.uid, s_uid, s_uidlen);
+        card.uidlen = s_uidlen;
+        if (s_tag == TAG_MFC) {
+            card.atqa[0] = 0x04;
+            card.sak = 0x08;
+        } else {
+            card.atqa[0] = 0x44;
+            card.sak = 0x00;
+        }
+        // 2 == selected, no RATS support
+        reply_mix(CMD_ACK, 2, card.uidlen, 0, &card, sizeof(card));
+    }
+
+    if ((param & (ISO14A_RAW | ISO14A_APDU)) == 0) {
+        return;
+    }
+
+    // the Ultralight answers GET_VERSION and READ, anything else stays silent
+    uint8_t *cmd = c->data.asBytes;
+    uint8_t buf[MFU_PAGE_SIZE * 4 + 2] = {0};
+    uint16_t len = 0;
+    if (s_tag == TAG_MFU && (param & ISO14A_RAW)) {
+        if (cmd[0] == MIFARE_ULEV1_VERSION) {
+            // MF0UL21
+            const uint8_t version[] = {0x00, 0x04, 0x03, 0x01, 0x01, 0x00, 0x0E, 0x03};
+            memcpy(buf, version, sizeof(version));
+            len = sizeof(version);
+        } else if (cmd[0] == ISO14443A_CMD_READBLOCK && cmd[1] < MFU_PAGES) {
+            mfu_read(cmd[1], buf);
+            len = MFU_PAGE_SIZE * 4;
+        }
+    }
+    if (len) {
+        compute_crc(CRC_14443_A, buf, len, buf + len, buf + len + 1);
+        len += 2;
+    }
+    reply_mix(CMD_ACK, len, 0, 0, buf, len);
+}
+
+static void MifareReadBlock(const mf_readblock_t *payload) {
+    uint8_t outbuf[MFC_BLOCK_SIZE] = {0};
+    int16_t retval = PM3_ESOFT;
+
+    if (mfc_auth(payload->blockno, payload->keytype, bytes_to_num(payload->key, MFC_KEY_SIZE))) {
+        memcpy(outbuf, s_mfc + (payload->blockno * MFC_BLOCK_SIZE), MFC_BLOCK_SIZE);
+        // key A is never readable
+        if (mfc_is_trailer(payload->blockno)) {
+            memset(outbuf, 0, MFC_KEY_SIZE);
+        }
+        retval = PM3_SUCCESS;
+    }
+    reply_ng(CMD_HF_MIFARE_READBL, retval, outbuf, sizeof(outbuf));
+}
+
+static void MifareWriteBlock(uint8_t blockno, uint8_t keytype, const uint8_t *datain) {
+    uint8_t isOK = 0;
+    // block 0 of a genuine tag is read only
+    if (blockno != 0 && mfc_auth(blockno, keytype, bytes_to_num(datain, MFC_KEY_SIZE))) {
+        memcpy(s_mfc + (blockno * MFC_BLOCK_SIZE), datain + 10, MFC_BLOCK_SIZE);
+        isOK = 1;
+    }
+    reply_mix(CMD_ACK, isOK, 0, 0, 0, 0);
+}
+
+static void MifareChkKeys(const uint8_t *datain) {
+    struct {
+        uint8_t key[MFC_KEY_SIZE];
+        bool found;
+    } PACKED keyresult;
+    memset(&keyresult, 0, sizeof(keyresult));
+
+    uint8_t keytype = datain[0];
+    uint8_t blockno = datain[1];
+    uint16_t key_count = (datain[3] << 8) | datain[4];
+    key_count = MIN(key_count, (PM3_CMD_DATA_SIZE - 5) / MFC_KEY_SIZE);
+    datain += 5;
+
+    for (uint16_t i = 0; i < key_count; i++) {
+        if (mfc_auth(blockno, keytype, bytes_to_num(datain + (i * MFC_KEY_SIZE), MFC_KEY_SIZE))) {
+            memcpy(keyresult.key, datain + (i * MFC_KEY_SIZE), MFC_KEY_SIZE);
+            keyresult.found = true;
+            break;
+        }
+    }
+    reply_ng(CMD_HF_MIFARE_CHKKEYS, PM3_SUCCESS, (uint8_t *)&keyresult, sizeof(keyresult));
+}
+
+// parameters and replies as MifareChkKeys_fast() in armsrc/mifarecmd.c
+static void MifareChkKeys_fast(uint32_t arg0, uint32_t arg1, uint32_t arg2, const uint8_t *datain) {
+    uint8_t sectorcnt = arg0 & 0xFF;
+    uint8_t firstchunk = (arg0 >> 8) & 0xF;
+    uint8_t lastchunk = (arg0 >> 12) & 0xF;
+    uint16_t singleSectorParams = (arg0 >> 16) & 0xFFFF;
+    uint8_t use_flashmem = (arg1 >> 8) & 0xFF;
+    uint16_t keyCount = arg2 & 0xFF;
+    bool singleSectorMode = (singleSectorParams >> 15) & 1;
+    uint8_t keytype = (singleSectorParams >> 8) & 1;
+    uint8_t blockn = singleSectorParams & 0xFF;
+
+    static uint8_t foundkeys = 0;
+    static uint8_t found[80];
+    static struct {
+        uint8_t keyA[MFC_KEY_SIZE];
+        uint8_t keyB[MFC_KEY_SIZE];
+    } PACKED k_sector[40];
+
+    // no flash memory here, nothing to check
+    if (use_flashmem) {
+        keyCount = 0;
+    }
+
+    if (singleSectorMode) {
+        for (uint16_t i = 0; i < keyCount; i++) {
+            if (mfc_auth(blockn, keytype, bytes_to_num(datain + (i * MFC_KEY_SIZE), MFC_KEY_SIZE))) {
+                reply_old(CMD_ACK, 1, 0, 0, datain + (i * MFC_KEY_SIZE), MFC_KEY_SIZE);
+                return;
+            }
+        }
+        reply_mix(CMD_ACK, 0, 0, 0, 0, 0);
+        return;
+    }
+
+    sectorcnt = MIN(sectorcnt, ARRAYLEN(k_sector));
+    uint8_t allkeys = sectorcnt << 1;
+
+    if (firstchunk) {
+        foundkeys = 0;
+        memset(found, 0, sizeof(found));
+        memset(k_sector, 0, sizeof(k_sector));
+    }
+
+    for (uint16_t i = 0; i < keyCount && foundkeys < allkeys; i++) {
+        uint64_t key = bytes_to_num(datain + (i * MFC_KEY_SIZE), MFC_KEY_SIZE);
+        for (uint8_t s = 0; s < sectorcnt; s++) {
+            uint8_t blockno = (s * 4) + 3;
+            for (uint8_t kt = 0; kt < 2; kt++) {
+                if (found[(s * 2) + kt]) {
+                    continue;
+                }
+                if (s >= MFC_SECTORS || mfc_auth(blockno, kt, key) == false) {
+                    continue;
+                }
+                memcpy(kt ? k_sector[s].keyB : k_sector[s].keyA, datain + (i * MFC_KEY_SIZE), MFC_KEY_SIZE);
+                found[(s * 2) + kt] = 1;
+                foundkeys++;
+            }
+        }
+    }
+
+    if (foundkeys == allkeys || lastchunk) {
+        uint64_t foo = 0;
+        for (uint8_t m = 0; m < 64; m++) {
+            foo |= ((uint64_t)(found[m] & 1) << m);
+        }
+
+        uint16_t bar = 0;
+        uint8_t j = 0;
+        for (uint8_t m = 64; m < ARRAYLEN(found); m++) {
+            bar |= ((uint16_t)(found[m] & 1) << j++);
+        }
+
+        uint8_t tmp[480 + 10] = {0};
+        memcpy(tmp, k_sector, sectorcnt * sizeof(k_sector[0]));
+        num_to_bytes(foo, 8, tmp + 480);
+        tmp[488] = bar & 0xFF;
+        tmp[489] = bar >> 8 & 0xFF;
+
+        reply_old(CMD_ACK, foundkeys, 0, 0, tmp, sizeof(tmp));
+    } else {
+        reply_mix(CMD_ACK, foundkeys, 0, 0, 0, 0);
+    }
+}
+
+static void MifareUReadBlock(const mful_readblock_t *payload) {
+    uint8_t outbuf[16] = {0};
+    if (s_tag != TAG_MFU || payload->block_no >= MFU_PAGES) {
+        reply_ng(CMD_HF_MIFAREU_READBL, PM3_ESOFT, NULL, 0);
+        return;
+    }
+    mfu_read(payload->block_no, outbuf);
+    reply_ng(CMD_HF_MIFAREU_READBL, PM3_SUCCESS, outbuf, sizeof(outbuf));
+}
+
+// like the device, pages go to the top of a cleared BigBuf, the client downloads them from there
+static void MifareUReadCard(const mful_readblock_t *payload) {
+    if (s_tag != TAG_MFU || payload->block_no >= MFU_PAGES || payload->num_of_blocks == 0) {
+        reply_ng(CMD_HF_MIFAREU_READCARD, PM3_ECARDEXCHANGE, NULL, 0);
+        return;
+    }
+
+    memset(s_bigbuf, 0, s_bigbuf_size);
+    s_tracelen = 0;
+
+    uint32_t startidx = s_bigbuf_size - CARD_MEMORY_SIZE;
+    uint16_t pages = MIN(payload->num_of_blocks, MFU_PAGES - payload->block_no);
+    for (uint16_t i = 0; i < pages; i++) {
+        uint8_t out[MFU_PAGE_SIZE * 4];
+        mfu_read(payload->block_no + i, out);
+        memcpy(s_bigbuf + startidx + (i * MFU_PAGE_SIZE), out, MFU_PAGE_SIZE);
+    }
+
+    mful_readblock_resp_t resp = {
+        .bytelen = pages * MFU_PAGE_SIZE,
+        .startidx = startidx,
+    };
+    reply_ng(CMD_HF_MIFAREU_READCARD, PM3_SUCCESS, (uint8_t *)&resp, sizeof(resp));
+}
+
+static void DownloadOld(uint64_t reply_cmd, const uint8_t *mem, uint32_t size, uint32_t startidx, uint32_t numofbytes, uint32_t arg2) {
+    if (startidx > size) {
+        startidx = size;
+    }
+    numofbytes = MIN(numofbytes, size - startidx);
+    for (uint32_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
+        uint32_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+        if (reply_old(reply_cmd, i, len, arg2, mem + startidx + i, len) != PM3_SUCCESS) {
+            return;
+        }
+    }
+    // Trigger a finish downloading signal with an ACK frame
+    reply_mix(CMD_ACK, 1, 0, arg2, NULL, 0);
+}
+
+static void PacketReceived(PacketCommandNG *packet) {
+
+    sleep_us(s_latency_us);
+
+    switch (packet->cmd) {
+        case CMD_QUIT_SESSION:
+        case CMD_BREAK_LOOP:
+        case CMD_HF_DROPFIELD:
+            break;
+        case CMD_PING: {
+            reply_ng(CMD_PING, PM3_SUCCESS, packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_CAPABILITIES: {
+            SendCapabilities();
+            break;
+        }
+        case CMD_VERSION: {
+            SendVersion();
+            break;
+        }
+        case CMD_STATUS: {
+            if (packet->length == 4)
+                SendStatus(packet->data.asDwords[0]);
+            else
+                SendStatus(VPM3_SPEED_TEST_MS);
+            break;
+        }
+        case CMD_SET_DBGMODE: {
+            s_dbglevel = packet->data.asBytes[0];
+            reply_ng(CMD_SET_DBGMODE, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_GET_DBGMODE: {
+            reply_ng(CMD_GET_DBGMODE, PM3_SUCCESS, &s_dbglevel, 1);
+            break;
+        }
+        case CMD_BUFF_CLEAR: {
+            memset(s_bigbuf, 0, s_bigbuf_size);
+            s_tracelen = 0;
+            break;
+        }
+        case CMD_DOWNLOAD_BIGBUF: {
+            DownloadOld(CMD_DOWNLOADED_BIGBUF, s_bigbuf, s_bigbuf_size, packet->oldarg[0], packet->oldarg[1], s_tracelen);
+            break;
+        }
+        case CMD_DOWNLOAD_EML_BIGBUF: {
+            DownloadOld(CMD_DOWNLOADED_EML_BIGBUF, s_eml, sizeof(s_eml), packet->oldarg[0], packet->oldarg[1], 0);
+            break;
+        }
+        case CMD_DOWNLOAD_BULK: {
+            if (packet->length < sizeof(download_bulk_t)) {
+                reply_ng(CMD_DOWNLOAD_BULK, PM3_EINVARG, NULL, 0);
+                break;
+            }
+            const download_bulk_t *payload = (download_bulk_t *)packet->data.asBytes;
+            const uint8_t *mem = NULL;
+            uint32_t size = 0;
+            if (payload->source == DOWNLOAD_BULK_BIGBUF) {
+                mem = s_bigbuf;
+                size = s_bigbuf_size;
+            } else if (payload->source == DOWNLOAD_BULK_EML) {
+                mem = s_eml;
+                size = sizeof(s_eml);
+            }
+            if (mem == NULL || payload->start > size) {
+                reply_ng(CMD_DOWNLOAD_BULK, (mem == NULL) ? PM3_EMALLOC : PM3_EOVFLOW, NULL, 0);
+                break;
+            }
+            reply_bulk(mem + payload->start, MIN(payload->len, size - payload->start), payload->window);
+            break;
+        }
+        case CMD_HF_ISO14443A_READER: {
+            ReaderIso14443a(packet);
+            break;
+        }
+        case CMD_HF_MIFARE_READBL: {
+            MifareReadBlock((mf_readblock_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_WRITEBL: {
+            MifareWriteBlock(packet->oldarg[0] & 0xFF, packet->oldarg[1] & 0xFF, packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CHKKEYS: {
+            MifareChkKeys(packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CHKKEYS_FAST: {
+            MifareChkKeys_fast(packet->oldarg[0], packet->oldarg[1], packet->oldarg[2], packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFAREU_READBL: {
+            MifareUReadBlock((mful_readblock_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CIDENT: {
+            // a genuine tag, no magic
+            uint16_t flag = 0;
+            reply_ng(CMD_HF_MIFARE_CIDENT, PM3_SUCCESS, (uint8_t *)&flag, sizeof(flag));
+            break;
+        }
+        case CMD_HF_MIFARE_STATIC_NONCE: {
+            uint8_t data[1] = { (s_tag == TAG_MFC) ? NONCE_NORMAL : NONCE_FAIL };
+            reply_ng(CMD_HF_MIFARE_STATIC_NONCE, (s_tag == TAG_MFC) ? PM3_SUCCESS : PM3_ESOFT, data, sizeof(data));
+            break;
+        }
+        case CMD_HF_MIFAREU_READCARD: {
+            MifareUReadCard((mful_readblock_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMCLR: {
+            eml_clear();
+            reply_ng(CMD_HF_MIFARE_EML_MEMCLR, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMSET: {
+            struct p {
+                uint16_t blockno;
+                uint8_t blockcnt;
+                uint8_t blockwidth;
+                uint8_t data[];
+            } PACKED;
+            struct p *payload = (struct p *) packet->data.asBytes;
+            uint8_t width = (payload->blockwidth) ? payload->blockwidth : MFC_BLOCK_SIZE;
+            uint32_t offset = payload->blockno * width;
+            uint32_t len = payload->blockcnt * width;
+            if (offset + len <= sizeof(s_eml)) {
+                memcpy(s_eml + offset, payload->data, len);
+            }
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMGET: {
+            struct p {
+                uint16_t blockno;
+                uint8_t blockcnt;
+                uint8_t blockwidth;
+            } PACKED;
+            struct p *payload = (struct p *) packet->data.asBytes;
+            uint32_t offset = payload->blockno * payload->blockwidth;
+            uint32_t len = payload->blockcnt * payload->blockwidth;
+            if (len > PM3_CMD_DATA_SIZE || offset + len > sizeof(s_eml)) {
+                reply_ng(CMD_HF_MIFARE_EML_MEMGET, PM3_EMALLOC, NULL, 0);
+                break;
+            }
+            reply_ng(CMD_HF_MIFARE_EML_MEMGET, PM3_SUCCESS, s_eml + offset, len);
+            break;
+        }
+        default: {
+            Dbprintf("%s: 0x%04x", "unknown command", packet->cmd);
+            break;
+        }
+    }
+}
+
+static void serve(void) {
+    s_rx_len = 0;
+    s_rx_pos = 0;
+    s_cmds = 0;
+    s_bytes_out = 0;
+    uint64_t t1 = msclock();
+
+    for (;;) {
+        PacketCommandNG rx;
+        int res = receive_ng(&rx, -1);
+        if (res == PM3_EIO) {
+            break;
+        }
+        if (res != PM3_SUCCESS) {
+            continue;
+        }
+
+        s_cmds++;
+        if (s_verbose) {
+            printf("[=] cmd 0x%04x %s len %u\n", rx.cmd, rx.ng ? "NG " : "MIX", rx.length);
+        }
+        PacketReceived(&rx);
+    }
+
+    uint64_t t = msclock() - t1;
+    printf("[=] client disconnected after %" PRIu64 " ms, %u commands, %" PRIu64 " bytes sent\n", t, s_cmds, s_bytes_out);
+}
+
+static int listen_on(const char *addr, const char *port) {
+    struct addrinfo hints, *ai = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    int res = getaddrinfo(addr, port, &hints, &ai);
+    if (res != 0) {
+        fprintf(stderr, "[!] getaddrinfo: %s\n", gai_strerror(res));
+        return -1;
+    }
+
+    int sfd = -1;
+    for (struct addrinfo *p = ai; p != NULL; p = p->ai_next) {
+        sfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (sfd == -1) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(sfd, p->ai_addr, p->ai_addrlen) == 0 && listen(sfd, 1) == 0) {
+            break;
+        }
+        close(sfd);
+        sfd = -1;
+    }
+    freeaddrinfo(ai);
+
+    if (sfd == -1) {
+        fprintf(stderr, "[!] can't listen on %s:%s, %s\n", addr, port, strerror(errno));
+    }
+    return sfd;
+}
+
+static void usage(const char *prog) {
+    printf("Virtual Proxmark3, answers the client over TCP like a device would\n\n");
+    printf("Usage: %s [options]\n", prog);
+    printf("  -a, --addr <ip>        address to listen on (default 127.0.0.1)\n");
+    printf("  -p, --port <port>      TCP port to listen on (default " VPM3_DEFAULT_PORT ")\n");
+    printf("  -l, --latency <us>     delay before handling each command, e.g. 1000 for USB-CDC like latency\n");
+    printf("  -u, --auth <us>        time spent per simulated MIFARE Classic authentication\n");
+    printf("  -t, --tag <mfc|mfu>    tag in the field, MIFARE Classic 1K (default) or MIFARE Ultralight EV1\n");
+    printf("  -s, --seed <n>         seed of the tag model and trace content (default 0)\n");
+    printf("  -f, --file <dump.bin>  use a 1K binary dump as MIFARE Classic tag, keys are taken from its trailers\n");
+    printf("  -b, --bigbuf <bytes>   BigBuf size (default %u)\n", VPM3_DEFAULT_BIGBUF);
+    printf("  -T, --trace <bytes>    size of the synthetic trace at the start of BigBuf (default: all of it)\n");
+    printf("  -c, --crc              add CRC to replies instead of the postamble magic\n");
+    printf("  -1, --once             exit after the first client disconnects\n");
+    printf("  -v, --verbose          log every command\n");
+    printf("\nExamples:\n");
+    printf("  %s -l 1000 &\n", prog);
+    printf("  ./pm3 -p tcp:localhost -c \"hw ping -c 100; hw dlbench; hf mf fchk\"\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *addr = "127.0.0.1";
+    const char *port = VPM3_DEFAULT_PORT;
+    const char *dumpfn = NULL;
+    int64_t tracesize = -1;
+    bool once = false;
+
+    static const struct option long_options[] = {
+        {"addr",    required_argument, NULL, 'a'},
+        {"port",    required_argument, NULL, 'p'},
+        {"latency", required_argument, NULL, 'l'},
+        {"auth",    required_argument, NULL, 'u'},
+        {"tag",     required_argument, NULL, 't'},
+        {"seed",    required_argument, NULL, 's'},
+        {"file",    required_argument, NULL, 'f'},
+        {"bigbuf",  required_argument, NULL, 'b'},
+        {"trace",   required_argument, NULL, 'T'},
+        {"crc",     no_argument,       NULL, 'c'},
+        {"once",    no_argument,       NULL, '1'},
+        {"verbose", no_argument,       NULL, 'v'},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "a:p:l:u:t:s:f:b:T:c1vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'a':
+                addr = optarg;
+                break;
+            case 'p':
+                port = optarg;
+                break;
+            case 'l':
+                s_latency_us = strtoul(optarg, NULL, 0);
+                break;
+            case 'u':
+                s_auth_us = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                if (strcmp(optarg, "mfc") == 0) {
+                    s_tag = TAG_MFC;
+                } else if (strcmp(optarg, "mfu") == 0) {
+                    s_tag = TAG_MFU;
+                } else {
+                    fprintf(stderr, "[!] unknown tag type `%s`\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                s_seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'f':
+                dumpfn = optarg;
+                break;
+            case 'b':
+                s_bigbuf_size = strtoul(optarg, NULL, 0);
+                break;
+            case 'T':
+                tracesize = strtoll(optarg, NULL, 0);
+                break;
+            case 'c':
+                s_reply_with_crc = true;
+                break;
+            case '1':
+                once = true;
+                break;
+            case 'v':
+                s_verbose = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (s_bigbuf_size < CARD_MEMORY_SIZE) {
+        fprintf(stderr, "[!] BigBuf must be at least %u bytes\n", CARD_MEMORY_SIZE);
+        return EXIT_FAILURE;
+    }
+
+    s_bigbuf = calloc(s_bigbuf_size, sizeof(uint8_t));
+    if (s_bigbuf == NULL) {
+        fprintf(stderr, "[!] failed to allocate memory\n");
+        return EXIT_FAILURE;
+    }
+
+    if (dumpfn != NULL) {
+        FILE *f = fopen(dumpfn, "rb");
+        if (f == NULL) {
+            fprintf(stderr, "[!] can't open `%s`\n", dumpfn);
+            free(s_bigbuf);
+            return EXIT_FAILURE;
+        }
+        size_t n = fread(s_dump, 1, sizeof(s_dump), f);
+        fclose(f);
+        if (n != sizeof(s_dump)) {
+            fprintf(stderr, "[!] `%s` is not a MIFARE Classic 1K dump\n", dumpfn);
+            free(s_bigbuf);
+            return EXIT_FAILURE;
+        }
+        s_tag = TAG_MFC;
+        s_have_dump = true;
+    }
+
+    s_tracelimit = (tracesize < 0 || tracesize > s_bigbuf_size) ? s_bigbuf_size : (uint32_t)tracesize;
+    power_on();
+
+    int lfd = listen_on(addr, port);
+    if (lfd == -1) {
+        free(s_bigbuf);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("[+] virtual pm3 listening on %s:%s\n", addr, port);
+    printf("[+] tag....... %s, UID ", (s_tag == TAG_MFC) ? "MIFARE Classic 1K" : "MIFARE Ultralight EV1");
+    for (uint8_t i = 0; i < s_uidlen; i++) {
+        printf("%02X", s_uid[i]);
+    }
+    printf("\n");
+    printf("[+] BigBuf.... %u bytes, trace %u bytes\n", s_bigbuf_size, s_tracelen);
+    printf("[+] latency... %u us, auth %u us\n", s_latency_us, s_auth_us);
+    fflush(stdout);
+
+    for (;;) {
+        s_sock = accept(lfd, NULL, NULL);
+        if (s_sock == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        int one = 1;
+        setsockopt(s_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        printf("[+] client connected\n");
+        fflush(stdout);
+        serve();
+        fflush(stdout);
+        close(s_sock);
+        s_sock = -1;
+
+        // next client gets a freshly powered device and tag
+        power_on();
+
+        if (once) {
+            break;
+        }
+    }
+
+    close(lfd);
+    free(s_bigbuf);
+    return EXIT_SUCCESS;
+}